@@ -0,0 +1,289 @@
+/**
+ * Open Space Program
+ * Copyright © 2019-2023 Open Space Program Project
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <osp/tasks/tasks.h>
+#include <osp/tasks/builder.h>
+#include <osp/tasks/execute.h>
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+
+using namespace osp;
+
+// Count every allocation made by the process, so benchmarks can report allocations per iteration
+
+static std::atomic<std::size_t> g_allocations{0};
+
+void* operator new(std::size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *pOut = std::malloc(size == 0 ? 1 : size))
+    {
+        return pOut;
+    }
+    throw std::bad_alloc{};
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+//-----------------------------------------------------------------------------
+
+namespace bench
+{
+
+using LoopFunc_t        = TaskActions(*)(int &rLoopsLeft);
+using BasicTraits_t     = BasicBuilderTraits<LoopFunc_t>;
+using Builder_t         = BasicTraits_t::Builder;
+using TaskFuncVec_t     = BasicTraits_t::FuncVec_t;
+
+enum class Stages { Schedule, Process, Done, Clear };
+
+/**
+ * @brief A looping pipeline with two child pipelines, same as the BasicSingleThreadedLoop test
+ */
+struct Group
+{
+    PipelineDef<Stages> main;
+    PipelineDef<Stages> loop;
+    PipelineDef<Stages> stepA;
+    PipelineDef<Stages> stepB;
+};
+
+/**
+ * @brief Synthetic Tasks and TaskGraph made of many Groups
+ *
+ * Each Group's Done task syncs with the previous Group's, so Groups depend on each other through
+ * cross-pipeline sync_with edges.
+ */
+struct World
+{
+    explicit World(int const groupCount)
+    {
+        Builder_t builder{tasks, edges, functions};
+
+        groups.reserve(groupCount);
+
+        for (int i = 0; i < groupCount; ++i)
+        {
+            using enum Stages;
+
+            Group const pl = builder.create_pipelines<Group>();
+
+            builder.pipeline(pl.loop) .parent(pl.main).loops(true);
+            builder.pipeline(pl.stepA).parent(pl.loop);
+            builder.pipeline(pl.stepB).parent(pl.loop);
+
+            auto const add_task = [this, &builder, i] (LoopFunc_t func) -> BasicTraits_t::TaskRef
+            {
+                BasicTraits_t::TaskRef task = builder.task();
+                task.func(std::move(func));
+                taskToGroup.resize(tasks.m_taskIds.capacity(), -1);
+                taskToGroup[task.m_taskId] = i;
+                return task;
+            };
+
+            add_task([] (int &rLoopsLeft) -> TaskActions
+            {
+                if (rLoopsLeft == 0)
+                {
+                    return TaskAction::Cancel;
+                }
+                -- rLoopsLeft;
+                return { };
+            }).run_on({pl.loop(Schedule)}).sync_with({pl.main(Process), pl.stepA(Schedule), pl.stepB(Schedule)});
+
+            add_task([] (int&) -> TaskActions { return { }; })
+                .run_on({pl.stepA(Process)}).sync_with({pl.main(Process), pl.loop(Process)});
+
+            add_task([] (int&) -> TaskActions { return { }; })
+                .run_on({pl.stepB(Process)}).sync_with({pl.main(Process), pl.stepA(Done), pl.loop(Process)});
+
+            BasicTraits_t::TaskRef done = add_task([] (int&) -> TaskActions { return { }; });
+            done.run_on({pl.main(Done)});
+            if (i != 0)
+            {
+                done.sync_with({groups.back().main(Done)});
+            }
+
+            add_task([] (int&) -> TaskActions { return { }; })
+                .run_on({pl.main(Clear)});
+
+            groups.push_back(pl);
+        }
+
+        loopsLeft.resize(groupCount, 0);
+    }
+
+    Tasks                   tasks;
+    TaskEdges               edges;
+    TaskFuncVec_t           functions;
+    KeyedVec<TaskId, int>   taskToGroup;
+    std::vector<Group>      groups;
+    std::vector<int>        loopsLeft;
+};
+
+} // namespace bench
+
+using namespace bench;
+
+// Time to compile a TaskGraph
+static void BM_MakeExecGraph(benchmark::State &rState)
+{
+    World const world{int(rState.range(0))};
+
+    std::size_t const allocsBefore = g_allocations.load(std::memory_order_relaxed);
+
+    for (auto _ : rState)
+    {
+        TaskGraph graph = make_exec_graph(world.tasks, {&world.edges});
+        benchmark::DoNotOptimize(graph);
+    }
+
+    std::size_t const allocations = g_allocations.load(std::memory_order_relaxed) - allocsBefore;
+
+    rState.counters["allocs"] = benchmark::Counter(double(allocations), benchmark::Counter::kAvgIterations);
+
+    // Inverted rate gives seconds per task
+    rState.counters["t/task"] = benchmark::Counter(double(world.tasks.m_taskIds.size()),
+                                                   benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert);
+}
+BENCHMARK(BM_MakeExecGraph)->Arg(16)->Arg(256)->Arg(1024)->Unit(benchmark::kMicrosecond);
+
+// Time to remove the last Group from a TaskGraph then add it back, without rebuilding the graph
+static void BM_UpdateExecGraph(benchmark::State &rState)
+{
+    World const world{int(rState.range(0))};
+
+    Group const&            last = world.groups.back();
+    std::vector<TaskId>     lastTasks;
+    std::vector<PipelineId> lastPipelines{last.main, last.loop, last.stepA, last.stepB};
+
+    for (TaskInt const taskInt : world.tasks.m_taskIds.bitview().zeros())
+    {
+        if (world.taskToGroup[TaskId(taskInt)] == int(world.groups.size()) - 1)
+        {
+            lastTasks.push_back(TaskId(taskInt));
+        }
+    }
+
+    TaskGraph graph = make_exec_graph(world.tasks, {&world.edges});
+
+    std::size_t const allocsBefore = g_allocations.load(std::memory_order_relaxed);
+
+    for (auto _ : rState)
+    {
+        update_exec_graph(graph, world.tasks, {&world.edges}, {.tasksRemoved = lastTasks, .pipelinesRemoved = lastPipelines});
+        update_exec_graph(graph, world.tasks, {&world.edges}, {.tasksAdded   = lastTasks, .pipelinesAdded   = lastPipelines});
+        benchmark::DoNotOptimize(graph);
+    }
+
+    std::size_t const allocations = g_allocations.load(std::memory_order_relaxed) - allocsBefore;
+
+    rState.counters["allocs"] = benchmark::Counter(double(allocations), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_UpdateExecGraph)->Arg(16)->Arg(256)->Arg(1024)->Unit(benchmark::kMicrosecond);
+
+// Time to run a whole frame, excluding time spent inside task functions. Every Group is run,
+// and each loop repeats range(1) times.
+static void BM_ExecFrame(benchmark::State &rState)
+{
+    using Clock_t = std::chrono::steady_clock;
+
+    World world{int(rState.range(0))};
+    int const loops = int(rState.range(1));
+
+    TaskGraph const graph = make_exec_graph(world.tasks, {&world.edges});
+
+    ExecContext exec;
+    exec.doLogging = false;
+    exec_conform(world.tasks, exec);
+
+    Clock_t::duration updateTime{};
+    Clock_t::duration completeTime{};
+    std::size_t tasksRun = 0;
+    std::size_t allocations = 0;
+
+    for (auto _ : rState)
+    {
+        std::fill(world.loopsLeft.begin(), world.loopsLeft.end(), loops);
+
+        std::size_t const allocsBefore = g_allocations.load(std::memory_order_relaxed);
+
+        for (Group const& group : world.groups)
+        {
+            exec_request_run(exec, group.main);
+        }
+
+        Clock_t::time_point updateStart = Clock_t::now();
+        exec_update(world.tasks, graph, exec);
+        updateTime += Clock_t::now() - updateStart;
+
+        while ( ! exec.tasksQueuedRun.empty() )
+        {
+            TaskId const        task    = exec.tasksQueuedRun[0];
+            TaskActions const   status  = world.functions[task](world.loopsLeft[std::size_t(world.taskToGroup[task])]);
+
+            Clock_t::time_point const completeStart = Clock_t::now();
+            complete_task(world.tasks, graph, exec, task, status);
+            updateStart = Clock_t::now();
+            exec_update(world.tasks, graph, exec);
+            Clock_t::time_point const updateEnd = Clock_t::now();
+
+            completeTime    += updateStart - completeStart;
+            updateTime      += updateEnd   - updateStart;
+            ++ tasksRun;
+        }
+
+        allocations += g_allocations.load(std::memory_order_relaxed) - allocsBefore;
+
+        if (exec.pipelinesRunning != 0)
+        {
+            rState.SkipWithError("Pipelines are stuck");
+            break;
+        }
+    }
+
+    using std::chrono::duration, std::chrono::nanoseconds;
+
+    double const tasks = double(std::max<std::size_t>(tasksRun, 1));
+    rState.counters["allocs"]       = benchmark::Counter(double(allocations), benchmark::Counter::kAvgIterations);
+    rState.counters["tasks"]        = benchmark::Counter(double(tasksRun),    benchmark::Counter::kAvgIterations);
+    rState.counters["update/task"]  = duration<double, std::nano>(updateTime)   .count() / tasks;
+    rState.counters["complete/task"]= duration<double, std::nano>(completeTime) .count() / tasks;
+}
+BENCHMARK(BM_ExecFrame)->ArgsProduct({{16, 256, 1024}, {0, 4}})->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,211 @@
+/**
+ * Open Space Program
+ * Copyright © 2019-2023 Open Space Program Project
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include <osp/universe/coordinates.h>
+#include <osp/universe/sat_integrate.h>
+#include <osp/universe/sat_kepler.h>
+#include <osp/universe/universe.h>
+
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace osp;
+using namespace osp::universe;
+
+using SatIntegrateFunc_t = void(*)(CoSpaceSatData&, std::size_t, std::size_t, SatIntegrateParams const&) noexcept;
+
+/**
+ * @brief Make satellites scattered randomly around the origin, similar to setup_uni_testplanets
+ */
+static CoSpaceSatData make_sats(uint32_t const count)
+{
+    CoSpaceSatData out{};
+    sat_data_allocate(out, count);
+    out.m_satCount = count;
+
+    auto const [x, y, z]        = sat_views(out.m_satPositions,   out.m_data, count);
+    auto const [vx, vy, vz]     = sat_views(out.m_satVelocities,  out.m_data, count);
+    auto const [qx, qy, qz, qw] = sat_views(out.m_satRotations,   out.m_data, count);
+    auto const [wx, wy, wz]     = sat_views(out.m_satAngularVels, out.m_data, count);
+
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<spaceint_t> posDist(-(spaceint_t(1) << 40), spaceint_t(1) << 40);
+    std::uniform_real_distribution<double> velDist(-10000.0, 10000.0);
+    std::uniform_real_distribution<double> angVelDist(-1.0, 1.0);
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        x[i]  = posDist(gen);
+        y[i]  = posDist(gen);
+        z[i]  = posDist(gen);
+        vx[i] = velDist(gen);
+        vy[i] = velDist(gen);
+        vz[i] = velDist(gen);
+        qx[i] = 0.0;
+        qy[i] = 0.0;
+        qz[i] = 0.0;
+        qw[i] = 1.0;
+        wx[i] = angVelDist(gen);
+        wy[i] = angVelDist(gen);
+        wz[i] = angVelDist(gen);
+    }
+
+    return out;
+}
+
+// Time to advance every satellite by one step, single threaded
+template <SatIntegrateFunc_t FUNC_T>
+static void BM_SatIntegrate(benchmark::State &rState)
+{
+    uint32_t const count = uint32_t(rState.range(0));
+    CoSpaceSatData sats = make_sats(count);
+
+    SatIntegrateParams const params
+    {
+        .m_deltaTime     = 1.0 / 60.0,
+        .m_metersPerUnit = std::ldexp(1.0, -10),
+        .m_gravParam     = 10000000000.0
+    };
+
+    for (auto _ : rState)
+    {
+        FUNC_T(sats, 0, count, params);
+        benchmark::ClobberMemory();
+    }
+
+    // Inverted rate gives seconds per satellite
+    rState.counters["t/sat"] = benchmark::Counter(double(count), benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert);
+    rState.SetBytesProcessed(int64_t(rState.iterations()) * int64_t(sats.m_data.size()));
+}
+BENCHMARK(BM_SatIntegrate<sat_integrate>)       ->Arg(10000)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_SatIntegrate<sat_integrate_scalar>)->Arg(10000)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMicrosecond);
+
+using TransformFunc_t = void(*)(CoordTransformer const&, CoSpaceSatData const&, std::array<std::vector<spaceint_t>, 3>&);
+
+static void transform_batched(CoordTransformer const& transformer, CoSpaceSatData const& sats, std::array<std::vector<spaceint_t>, 3> &rOut)
+{
+    auto const [x, y, z] = sat_views(sats.m_satPositions, sats.m_data, sats.m_satCount);
+    transformer.transform_positions(x, y, z, Corrade::Containers::arrayView(rOut[0]),
+                                             Corrade::Containers::arrayView(rOut[1]),
+                                             Corrade::Containers::arrayView(rOut[2]));
+}
+
+static void transform_each(CoordTransformer const& transformer, CoSpaceSatData const& sats, std::array<std::vector<spaceint_t>, 3> &rOut)
+{
+    auto const [x, y, z] = sat_views(sats.m_satPositions, sats.m_data, sats.m_satCount);
+    for (std::size_t i = 0; i < sats.m_satCount; ++i)
+    {
+        Vector3g const out = transformer.transform_position(to_vec<Vector3g>(i, x, y, z));
+        rOut[0][i] = out.x();
+        rOut[1][i] = out.y();
+        rOut[2][i] = out.z();
+    }
+}
+
+// Time to transform every satellite's position into another coordinate space, single threaded.
+// Rotated transforms convert positions to doubles and back, translated ones only shift and add.
+template <TransformFunc_t FUNC_T, bool ROTATE_T>
+static void BM_TransformPositions(benchmark::State &rState)
+{
+    uint32_t const count = uint32_t(rState.range(0));
+    CoSpaceSatData const sats = make_sats(count);
+
+    Quaterniond const rot = ROTATE_T ? Quaterniond::rotation(Radd{0.5}, Vector3d{1.0, 2.0, 3.0}.normalized())
+                                     : Quaterniond{};
+
+    CoordTransformer const transformer
+    {
+        .m_rotOut = rot,
+        .m_rotIn  = rot,
+        .m_c      = {1000, -2000, 3000},
+        .m_n      = -3,
+        .m_m      = 2
+    };
+
+    std::array<std::vector<spaceint_t>, 3> out{std::vector<spaceint_t>(count),
+                                               std::vector<spaceint_t>(count),
+                                               std::vector<spaceint_t>(count)};
+
+    for (auto _ : rState)
+    {
+        FUNC_T(transformer, sats, out);
+        benchmark::ClobberMemory();
+    }
+
+    rState.counters["t/sat"] = benchmark::Counter(double(count), benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert);
+}
+BENCHMARK(BM_TransformPositions<transform_batched, false>)->Arg(10000)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_TransformPositions<transform_each,    false>)->Arg(10000)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_TransformPositions<transform_batched, true> )->Arg(10000)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_TransformPositions<transform_each,    true> )->Arg(10000)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMicrosecond);
+
+using KeplerSolveFunc_t = void(*)(double const*, double const*, double*, std::size_t) noexcept;
+
+/**
+ * @brief Solve one satellite per call, like sat_kepler_derail
+ */
+static void kepler_solve_each(double const *meanAnomaly, double const *eccentricity, double *eccAnomaly, std::size_t const count) noexcept
+{
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        kepler_solve(meanAnomaly + i, eccentricity + i, eccAnomaly + i, 1);
+    }
+}
+
+// Time to solve Kepler's equation for every satellite on rails
+template <KeplerSolveFunc_t FUNC_T>
+static void BM_KeplerSolve(benchmark::State &rState)
+{
+    std::size_t const count = std::size_t(rState.range(0));
+
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<double> meanAnomalyDist(-3.14159, 3.14159);
+    std::uniform_real_distribution<double> eccentricityDist(0.0, gc_keplerMaxEccentricity);
+
+    std::vector<double> meanAnomalies(count);
+    std::vector<double> eccentricities(count);
+    std::vector<double> eccAnomalies(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        meanAnomalies[i]  = meanAnomalyDist(gen);
+        eccentricities[i] = eccentricityDist(gen);
+    }
+
+    for (auto _ : rState)
+    {
+        FUNC_T(meanAnomalies.data(), eccentricities.data(), eccAnomalies.data(), count);
+        benchmark::ClobberMemory();
+    }
+
+    rState.counters["t/sat"] = benchmark::Counter(double(count), benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert);
+}
+BENCHMARK(BM_KeplerSolve<kepler_solve>)       ->Arg(10000)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_KeplerSolve<kepler_solve_scalar>)->Arg(10000)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_KeplerSolve<kepler_solve_each>)  ->Arg(10000)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
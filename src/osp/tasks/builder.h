@@ -138,6 +138,19 @@ struct TaskBuilderBase
         return out;
     }
 
+    /**
+     * @brief Create a semaphore that limits how many tasks that acquire it can run at once
+     */
+    SemaphoreId create_semaphore(unsigned int const limit)
+    {
+        SemaphoreId const sema = m_rTasks.m_semaIds.create();
+
+        m_rTasks.m_semaLimits.resize(m_rTasks.m_semaIds.capacity());
+        m_rTasks.m_semaLimits[sema] = limit;
+
+        return sema;
+    }
+
     Tasks       & m_rTasks;
     TaskEdges   & m_rEdges;
 
@@ -196,6 +209,33 @@ struct TaskRefBase
         return add_edges(m_rBuilder.m_rEdges.m_syncWith, specs);
     }
 
+    TaskRef_t& acquires(ArrayView<SemaphoreId const> const semaphores) noexcept
+    {
+        for (SemaphoreId const sema : semaphores)
+        {
+            m_rBuilder.m_rEdges.m_semaphoreEdges.push_back({
+                .task       = m_taskId,
+                .semaphore  = sema
+            });
+        }
+        return static_cast<TaskRef_t&>(*this);
+    }
+
+    TaskRef_t& acquires(std::initializer_list<SemaphoreId const> semaphores) noexcept
+    {
+        return acquires(arrayView(semaphores));
+    }
+
+    /**
+     * @brief Allow this task to be fused with other tasks that run on the same stage and sync
+     *        with the same stages, for tasks that take less time than it takes to dispatch them
+     */
+    TaskRef_t& fusable() noexcept
+    {
+        m_rBuilder.m_rEdges.m_fusable.push_back(m_taskId);
+        return static_cast<TaskRef_t&>(*this);
+    }
+
     TaskId          m_taskId;
     Builder_t       & m_rBuilder;
 
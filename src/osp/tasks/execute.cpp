@@ -27,10 +27,36 @@
 
 #include <Corrade/Containers/ArrayViewStl.h>
 
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <utility>
+
 namespace osp
 {
 
-static void exec_log(ExecContext &rExec, ExecContext::LogMsg_t msg) noexcept;
+/**
+ * @brief Orders tasks by ExecContext::taskPriority, for a max-heap of tasksQueuedRunHeap
+ */
+struct TaskPriorityLess
+{
+    bool operator()(TaskId const lhs, TaskId const rhs) const noexcept
+    {
+        return priority(lhs) < priority(rhs);
+    }
+
+    int64_t priority(TaskId const task) const noexcept
+    {
+        return (std::size_t(task) < rExec.taskPriority.size()) ? rExec.taskPriority[task] : 0;
+    }
+
+    ExecContext const &rExec;
+};
+
+template <typename MSG_T>
+static void exec_log(ExecContext &rExec, MSG_T const& msg) noexcept;
+
+static void exec_trace_stage(ExecContext &rExec, PipelineId pipeline, StageId stage) noexcept;
 
 static void pipeline_run_root(Tasks const& tasks, TaskGraph const& graph, ExecContext &rExec, PipelineId pipeline) noexcept;
 
@@ -48,6 +74,14 @@ static void pipeline_try_advance(ExecContext &rExec, ExecPipeline &rExecPl, Pipe
 
 static void pipeline_cancel(Tasks const& tasks, TaskGraph const& graph, ExecContext& rExec, ExecPipeline& rExecPl, PipelineId pipeline) noexcept;
 
+static void task_enqueue_run(Tasks const& tasks, TaskGraph const& graph, ExecContext &rExec, TaskId task) noexcept;
+
+static void task_queue_run(ExecContext &rExec, TaskId task) noexcept;
+
+static bool task_try_acquire_semaphores(Tasks const& tasks, TaskGraph const& graph, ExecContext &rExec, TaskId task) noexcept;
+
+static bool is_task_done(ExecContext const& exec, PipelineId pipeline, StageId stage, TaskId task) noexcept;
+
 struct ArgsForIsPipelineInLoop
 {
     PipelineId viewedFrom;
@@ -133,8 +167,42 @@ void complete_task(Tasks const& tasks, TaskGraph const& graph, ExecContext &rExe
     LGRN_ASSERT(rExec.tasksQueuedRun.contains(task));
     rExec.tasksQueuedRun.erase(task);
 
+    // Drop tasks that are no longer queued from the top of the heap, so its top is always queued
+    std::vector<TaskId> &rHeap = rExec.tasksQueuedRunHeap;
+    while ( ! rHeap.empty() && ! rExec.tasksQueuedRun.contains(rHeap.front()) )
+    {
+        std::pop_heap(rHeap.begin(), rHeap.end(), TaskPriorityLess{rExec});
+        rHeap.pop_back();
+    }
+
     exec_log(rExec, ExecContext::CompleteTask{task});
 
+    if (rExec.pRecording != nullptr)
+    {
+        rExec.pRecording->events.push_back(ExecRecording::Complete{task, actions});
+    }
+
+    // Release semaphores, then let tasks waiting for them try again
+    auto const semaView = ArrayView<SemaphoreId const>(fanout_view(graph.taskToFirstSemaacq, graph.semaacqToSema, task));
+    for (SemaphoreId const sema : semaView)
+    {
+        LGRN_ASSERT(rExec.semaAcquired[sema] != 0);
+        -- rExec.semaAcquired[sema];
+    }
+    for (SemaphoreId const sema : semaView)
+    {
+        for (TaskId const waiting : fanout_view(graph.semaToFirstRevSemaacq, graph.revSemaacqToTask, sema))
+        {
+            if (   rExec.tasksQueuedSema.contains(waiting)
+                && task_try_acquire_semaphores(tasks, graph, rExec, waiting))
+            {
+                exec_log(rExec, ExecContext::SemaphoreAcquire{waiting});
+                rExec.tasksQueuedSema.erase(waiting);
+                task_queue_run(rExec, waiting);
+            }
+        }
+    }
+
     auto const [pipeline, stage] = tasks.m_taskRunOn[task];
     ExecPipeline &rExecPl = rExec.plData[pipeline];
 
@@ -204,6 +272,11 @@ void exec_signal(ExecContext &rExec, PipelineId pipeline) noexcept
     ExecPipeline &rExecPl = rExec.plData[pipeline];
     exec_log(rExec, ExecLog::ExternalSignal{pipeline, ! rExecPl.waitSignaled});
 
+    if (rExec.pRecording != nullptr)
+    {
+        rExec.pRecording->events.push_back(ExecRecording::Signal{pipeline});
+    }
+
     if ( ! rExecPl.waitSignaled )
     {
         rExecPl.waitSignaled = true;
@@ -211,6 +284,271 @@ void exec_signal(ExecContext &rExec, PipelineId pipeline) noexcept
     }
 }
 
+TaskId exec_pick_task(ExecContext const& exec) noexcept
+{
+    if (exec.tasksQueuedRun.empty())
+    {
+        return lgrn::id_null<TaskId>();
+    }
+
+    // Heap can be empty if taskPriority was assigned while tasks were already queued
+    if (exec.taskPriority.empty() || exec.tasksQueuedRunHeap.empty())
+    {
+        return exec.tasksQueuedRun[0];
+    }
+
+    return exec.tasksQueuedRunHeap.front();
+}
+
+TaskId exec_pop_task(ExecContext &rExec) noexcept
+{
+    std::vector<TaskId> &rHeap = rExec.tasksQueuedRunHeap;
+    while ( ! rHeap.empty() )
+    {
+        std::pop_heap(rHeap.begin(), rHeap.end(), TaskPriorityLess{rExec});
+        TaskId const task = rHeap.back();
+        rHeap.pop_back();
+
+        if (rExec.tasksQueuedRun.contains(task))
+        {
+            return task;
+        }
+    }
+    return lgrn::id_null<TaskId>();
+}
+
+void exec_push_task(ExecContext &rExec, TaskId const task) noexcept
+{
+    LGRN_ASSERTM(rExec.tasksQueuedRun.contains(task), "Task must be queued");
+    rExec.tasksQueuedRunHeap.push_back(task);
+    std::push_heap(rExec.tasksQueuedRunHeap.begin(), rExec.tasksQueuedRunHeap.end(), TaskPriorityLess{rExec});
+}
+
+ExecStall exec_find_stall(Tasks const& tasks, TaskGraph const& graph, ExecContext const& exec, ExecStallScratch &rScratch)
+{
+    using enum ExecWait::EReason;
+    using EVisit = ExecStallScratch::EVisit;
+
+    ExecStall out;
+
+    if ( ! exec.tasksQueuedRun.empty() || exec.pipelinesRunning == 0 )
+    {
+        return out; // Still making progress, or there's nothing to be stuck
+    }
+
+    std::size_t const plCount = exec.plData.size();
+
+    // Gather everything that running pipelines are waiting for
+
+    std::vector<ExecWait> &waits = rScratch.waits;
+    waits.clear();
+
+    for (PipelineInt const plInt : tasks.m_pipelineIds.bitview().zeros())
+    {
+        auto const          pipeline    = PipelineId(plInt);
+        ExecPipeline const  &execPl     = exec.plData[pipeline];
+
+        if ( ! execPl.running || execPl.stage == lgrn::id_null<StageId>() )
+        {
+            continue;
+        }
+
+        AnyStageId const anystg = anystg_from(graph, pipeline, execPl.stage);
+
+        if (execPl.ownStageReqTasksLeft != 0)
+        {
+            for (StageRequiresTask const& req : fanout_view(graph.anystgToFirstStgreqtask, graph.stgreqtaskData, anystg))
+            {
+                if ( ! is_task_done(exec, req.reqPipeline, req.reqStage, req.reqTask) )
+                {
+                    waits.push_back({pipeline, execPl.stage, req.reqTask, req.reqPipeline, req.reqStage, StageReqTask});
+                }
+            }
+        }
+
+        if (execPl.tasksReqOwnStageLeft != 0)
+        {
+            for (TaskId const task : fanout_view(graph.anystgToFirstRevTaskreqstg, graph.revTaskreqstgToTask, anystg))
+            {
+                auto const [reqPipeline, reqStage] = tasks.m_taskRunOn[task];
+                if ( ! is_task_done(exec, reqPipeline, reqStage, task) )
+                {
+                    waits.push_back({pipeline, execPl.stage, task, reqPipeline, reqStage, StageReqByTask});
+                }
+            }
+        }
+    }
+
+    for (auto const [task, blocked] : exec.tasksQueuedBlocked.each())
+    {
+        StageId const stage = exec.plData[blocked.pipeline].stage;
+        for (TaskRequiresStage const& req : fanout_view(graph.taskToFirstTaskreqstg, graph.taskreqstgData, task))
+        {
+            if (exec.plData[req.reqPipeline].stage != req.reqStage)
+            {
+                waits.push_back({blocked.pipeline, stage, task, req.reqPipeline, req.reqStage, TaskReqStage});
+            }
+        }
+    }
+
+    for (TaskId const task : exec.tasksQueuedSema)
+    {
+        PipelineId const pipeline = tasks.m_taskRunOn[task].pipeline;
+        waits.push_back({pipeline, exec.plData[pipeline].stage, task, lgrn::id_null<PipelineId>(), lgrn::id_null<StageId>(), Semaphore});
+    }
+
+    if (waits.empty())
+    {
+        return out; // Nothing to be stuck on
+    }
+
+    // Sort waits by pipeline, so waits[waitsFirst[pl] .. waitsFirst[pl+1]] are what pl waits for
+
+    std::vector<uint32_t> &waitsFirst = rScratch.waitsFirst;
+    waitsFirst.assign(plCount + 1, 0);
+    for (ExecWait const& wait : waits)
+    {
+        ++ waitsFirst[std::size_t(wait.pipeline) + 1];
+    }
+    for (std::size_t i = 1; i < waitsFirst.size(); ++i)
+    {
+        waitsFirst[i] += waitsFirst[i - 1];
+    }
+    std::vector<ExecWait> &sorted = rScratch.sorted;
+    sorted.resize(waits.size());
+    {
+        std::vector<uint32_t> &next = rScratch.next;
+        next.assign(waitsFirst.begin(), waitsFirst.end() - 1);
+        for (ExecWait const& wait : waits)
+        {
+            sorted[next[std::size_t(wait.pipeline)] ++] = wait;
+        }
+    }
+
+    auto const edge_to = [&exec, plCount] (ExecWait const& wait) -> std::size_t
+    {
+        // Waiting for a finished pipeline or a semaphore isn't an edge, but a dead end
+        return (wait.waitsFor != lgrn::id_null<PipelineId>() && exec.plData[wait.waitsFor].running)
+             ? std::size_t(wait.waitsFor) : plCount;
+    };
+
+    // Depth-first search for any cycle. This is the common case that runs every frame, so don't
+    // bother finding the shortest cycle unless there is one.
+
+    std::vector<EVisit> &visit = rScratch.visit;
+    visit.assign(plCount, EVisit::New);
+    std::vector<std::pair<std::size_t, uint32_t>> &stack = rScratch.stack;
+    stack.clear();
+    bool hasCycle = false;
+
+    for (std::size_t start = 0; start < plCount && ! hasCycle; ++start)
+    {
+        if (visit[start] != EVisit::New || waitsFirst[start] == waitsFirst[start + 1])
+        {
+            continue;
+        }
+
+        visit[start] = EVisit::InStack;
+        stack.emplace_back(start, waitsFirst[start]);
+
+        while ( ! stack.empty() && ! hasCycle )
+        {
+            auto &[pl, next] = stack.back();
+            if (next == waitsFirst[pl + 1])
+            {
+                visit[pl] = EVisit::Done;
+                stack.pop_back();
+                continue;
+            }
+
+            std::size_t const to = edge_to(sorted[next]);
+            ++ next;
+
+            if (to == plCount)
+            {
+                continue;
+            }
+            else if (visit[to] == EVisit::InStack)
+            {
+                hasCycle = true;
+            }
+            else if (visit[to] == EVisit::New)
+            {
+                visit[to] = EVisit::InStack;
+                stack.emplace_back(to, waitsFirst[to]);
+            }
+        }
+    }
+
+    if (hasCycle)
+    {
+        // Breadth-first search from each pipeline back to itself, keeping the shortest cycle
+
+        std::vector<uint32_t>       viaWait(plCount);
+        std::vector<bool>           seen(plCount);
+        std::vector<std::size_t>    queue;
+
+        for (std::size_t start = 0; start < plCount; ++start)
+        {
+            if (waitsFirst[start] == waitsFirst[start + 1])
+            {
+                continue;
+            }
+
+            std::fill(seen.begin(), seen.end(), false);
+            queue.assign(1, start);
+            seen[start] = true;
+
+            for (std::size_t i = 0; i < queue.size(); ++i)
+            {
+                std::size_t const pl = queue[i];
+                for (uint32_t w = waitsFirst[pl]; w < waitsFirst[pl + 1]; ++w)
+                {
+                    std::size_t const to = edge_to(sorted[w]);
+                    if (to == start)
+                    {
+                        std::vector<ExecWait> chain{sorted[w]};
+                        for (std::size_t at = pl; at != start; at = std::size_t(sorted[viaWait[at]].pipeline))
+                        {
+                            chain.push_back(sorted[viaWait[at]]);
+                        }
+                        std::reverse(chain.begin(), chain.end());
+
+                        if (out.chain.empty() || chain.size() < out.chain.size())
+                        {
+                            out.chain = std::move(chain);
+                        }
+                        queue.clear(); // Found the shortest cycle through start, stop
+                        break;
+                    }
+                    else if (to != plCount && ! seen[to])
+                    {
+                        seen[to]    = true;
+                        viaWait[to] = w;
+                        queue.push_back(to);
+                    }
+                }
+            }
+        }
+
+        out.cycle = true;
+        return out;
+    }
+
+    // No cycles; anything left that's waiting on a dead end is stuck
+
+    for (ExecWait const& wait : sorted)
+    {
+        if (edge_to(wait) == plCount)
+        {
+            out.chain.push_back(wait);
+            return out;
+        }
+    }
+
+    return out;
+}
+
 //-----------------------------------------------------------------------------
 
 // Major steps
@@ -251,6 +589,11 @@ static int pipeline_run(Tasks const& tasks, TaskGraph const& graph, ExecContext
 
             rExec.plAdvance.set(std::size_t(pipeline));
             exec_log(rExec, ExecContext::PipelineRun{pipeline});
+
+            if (rExec.pStats != nullptr)
+            {
+                rExec.pStats->plStartNs[pipeline] = rExec.pStats->now();
+            }
         }
 
         if (rerunLoop)
@@ -329,6 +672,11 @@ static void loop_scope_done(Tasks const& tasks, TaskGraph const& graph, ExecCont
             {
                 LGRN_ASSERT(rExec.pipelinesRunning != 0);
                 -- rExec.pipelinesRunning;
+
+                if (rExec.pStats != nullptr)
+                {
+                    stats_add_sample(rExec.pStats->pipelines[loopPipeline], rExec.pStats->now() - rExec.pStats->plStartNs[loopPipeline]);
+                }
             }
 
             rLoopExecPl.running  = false;
@@ -411,6 +759,7 @@ static void pipeline_advance_stage(Tasks const& tasks, TaskGraph const& graph, E
     if (nextStage != StageId(stageCount))
     {
         exec_log(rExec, ExecContext::StageChange{pipeline, rExecPl.stage, nextStage});
+        exec_trace_stage(rExec, pipeline, nextStage);
 
         // Proceed to next stage since its valid
         rExecPl.stage = nextStage;
@@ -430,6 +779,12 @@ static void pipeline_advance_stage(Tasks const& tasks, TaskGraph const& graph, E
         -- rExec.pipelinesRunning;
 
         exec_log(rExec, ExecContext::PipelineFinish{pipeline});
+        exec_trace_stage(rExec, pipeline, lgrn::id_null<StageId>());
+
+        if (rExec.pStats != nullptr)
+        {
+            stats_add_sample(rExec.pStats->pipelines[pipeline], rExec.pStats->now() - rExec.pStats->plStartNs[pipeline]);
+        }
     }
 }
 
@@ -465,8 +820,8 @@ static void pipeline_advance_reqs(Tasks const& tasks, TaskGraph const& graph, Ex
                 ExecPipeline &rTaskPlExec = rExec.plData[rBlocked.pipeline];
                 -- rTaskPlExec.tasksQueuedBlocked;
                 ++ rTaskPlExec.tasksQueuedRun;
-                rExec.tasksQueuedRun.push(task);
                 rExec.tasksQueuedBlocked.erase(task);
+                task_enqueue_run(tasks, graph, rExec, task);
             }
         }
         else
@@ -491,42 +846,7 @@ static void pipeline_advance_reqs(Tasks const& tasks, TaskGraph const& graph, Ex
     // Decrement ownStageReqTasksLeft, as some of these tasks might already be complete
     for (StageRequiresTask const& stgreqtask : stgreqtaskView)
     {
-        ExecPipeline &rReqTaskExecPl = rExec.plData[stgreqtask.reqPipeline];
-
-        // NOLINTBEGIN(bugprone-branch-clone)
-        bool const reqTaskDone = [&tasks, &rReqTaskExecPl, &stgreqtask, &rExec] () noexcept -> bool
-        {
-            if ( ! rReqTaskExecPl.running )
-            {
-                return true; // Not running, which means the whole pipeline finished already
-            }
-            else if (rReqTaskExecPl.canceled)
-            {
-                return true; // Stage cancelled. Required task is considered finish and will never run
-            }
-            else if (int(rReqTaskExecPl.stage) < int(stgreqtask.reqStage))
-            {
-                return false; // Not yet reached required stage. Required task didn't run yet
-            }
-            else if (int(rReqTaskExecPl.stage) > int(stgreqtask.reqStage))
-            {
-                return true; // Passed required stage. Required task finished
-            }
-            else if ( ! rReqTaskExecPl.tasksQueueDone )
-            {
-                return false; // Required tasks not queued yet
-            }
-            else if (   rExec.tasksQueuedBlocked.contains(stgreqtask.reqTask)
-                     || rExec.tasksQueuedRun    .contains(stgreqtask.reqTask))
-            {
-                return false; // Required task is queued and not yet finished running
-            }
-            else
-            {
-                return true; // On the right stage and task not running. This means it's done
-            }
-        }();
-        // NOLINTEND(bugprone-branch-clone)
+        bool const reqTaskDone = is_task_done(rExec, stgreqtask.reqPipeline, stgreqtask.reqStage, stgreqtask.reqTask);
 
         if (reqTaskDone)
         {
@@ -557,6 +877,7 @@ static void pipeline_advance_run(Tasks const& tasks, TaskGraph const& graph, Exe
         {
             LGRN_ASSERTM( ! rExec.tasksQueuedBlocked.contains(task), "Impossible to queue a task that's already queued");
             LGRN_ASSERTM( ! rExec.tasksQueuedRun    .contains(task), "Impossible to queue a task that's already queued");
+            LGRN_ASSERTM( ! rExec.tasksQueuedSema   .contains(task), "Impossible to queue a task that's already queued");
 
             // Evaluate Task-requires-Stages
             // Some requirements may already be satisfied
@@ -577,6 +898,8 @@ static void pipeline_advance_run(Tasks const& tasks, TaskGraph const& graph, Exe
 
             bool const blocked = reqStagesLeft != 0;
 
+            exec_log(rExec, ExecContext::EnqueueTask{pipeline, rExecPl.stage, task, blocked});
+
             if (blocked)
             {
                 rExec.tasksQueuedBlocked.emplace(task, BlockedTask{reqStagesLeft, pipeline});
@@ -584,11 +907,10 @@ static void pipeline_advance_run(Tasks const& tasks, TaskGraph const& graph, Exe
             }
             else
             {
-                rExec.tasksQueuedRun.push(task);
                 ++ rExecPl.tasksQueuedRun;
+                task_enqueue_run(tasks, graph, rExec, task);
             }
 
-            exec_log(rExec, ExecContext::EnqueueTask{pipeline, rExecPl.stage, task, blocked});
             if (rExec.doLogging)
             {
                 for (TaskRequiresStage const& req : taskreqstageView)
@@ -764,6 +1086,54 @@ static void pipeline_cancel(Tasks const& tasks, TaskGraph const& graph, ExecCont
     });
 }
 
+static void task_queue_run(ExecContext &rExec, TaskId const task) noexcept
+{
+    rExec.tasksQueuedRun.push(task);
+
+    if ( ! rExec.taskPriority.empty() )
+    {
+        exec_push_task(rExec, task);
+    }
+}
+
+static void task_enqueue_run(Tasks const& tasks, TaskGraph const& graph, ExecContext &rExec, TaskId const task) noexcept
+{
+    if (task_try_acquire_semaphores(tasks, graph, rExec, task))
+    {
+        task_queue_run(rExec, task);
+    }
+    else
+    {
+        exec_log(rExec, ExecContext::SemaphoreWait{task});
+        rExec.tasksQueuedSema.push(task);
+    }
+}
+
+/**
+ * @brief Acquire all of a task's semaphores, or none of them if any are at their limit
+ *
+ * Never holding onto some semaphores while waiting for others avoids deadlocks.
+ */
+static bool task_try_acquire_semaphores(Tasks const& tasks, TaskGraph const& graph, ExecContext &rExec, TaskId const task) noexcept
+{
+    auto const semaView = ArrayView<SemaphoreId const>(fanout_view(graph.taskToFirstSemaacq, graph.semaacqToSema, task));
+
+    for (SemaphoreId const sema : semaView)
+    {
+        if (rExec.semaAcquired[sema] >= tasks.m_semaLimits[sema])
+        {
+            return false;
+        }
+    }
+
+    for (SemaphoreId const sema : semaView)
+    {
+        ++ rExec.semaAcquired[sema];
+    }
+
+    return true;
+}
+
 static void pipeline_try_advance(ExecContext &rExec, ExecPipeline &rExecPl, PipelineId const pipeline) noexcept
 {
     if (pipeline_can_advance(rExecPl))
@@ -777,6 +1147,44 @@ static void pipeline_try_advance(ExecContext &rExec, ExecPipeline &rExecPl, Pipe
 
 // Read-only checks
 
+static bool is_task_done(ExecContext const& exec, PipelineId const pipeline, StageId const stage, TaskId const task) noexcept
+{
+    ExecPipeline const &execPl = exec.plData[pipeline];
+
+    // NOLINTBEGIN(bugprone-branch-clone)
+    if ( ! execPl.running )
+    {
+        return true; // Not running, which means the whole pipeline finished already
+    }
+    else if (execPl.canceled)
+    {
+        return true; // Stage cancelled. Required task is considered finish and will never run
+    }
+    else if (int(execPl.stage) < int(stage))
+    {
+        return false; // Not yet reached required stage. Required task didn't run yet
+    }
+    else if (int(execPl.stage) > int(stage))
+    {
+        return true; // Passed required stage. Required task finished
+    }
+    else if ( ! execPl.tasksQueueDone )
+    {
+        return false; // Required tasks not queued yet
+    }
+    else if (   exec.tasksQueuedBlocked.contains(task)
+             || exec.tasksQueuedRun    .contains(task)
+             || exec.tasksQueuedSema   .contains(task))
+    {
+        return false; // Required task is queued and not yet finished running
+    }
+    else
+    {
+        return true; // On the right stage and task not running. This means it's done
+    }
+    // NOLINTEND(bugprone-branch-clone)
+}
+
 static constexpr bool pipeline_can_advance(ExecPipeline &rExecPl) noexcept
 {
     // Pipeline can advance if...
@@ -894,12 +1302,17 @@ void exec_conform(Tasks const& tasks, ExecContext &rOut)
     std::size_t const maxPipeline   = tasks.m_pipelineIds.capacity();
 
     rOut.tasksQueuedRun    .reserve(maxTasks);
+    rOut.tasksQueuedRunHeap.reserve(maxTasks);
     rOut.tasksQueuedBlocked.reserve(maxTasks);
+    rOut.tasksQueuedSema   .reserve(maxTasks);
+    rOut.semaAcquired.resize(tasks.m_semaIds.capacity(), 0);
     rOut.plData.resize(maxPipeline);
     bitvector_resize(rOut.plAdvance,     maxPipeline);
     bitvector_resize(rOut.plAdvanceNext, maxPipeline);
     bitvector_resize(rOut.plRequestRun,  maxPipeline);
 
+    rOut.logRing.resize(std::bit_ceil(std::max<std::size_t>(rOut.logCapacity, 1)));
+
     for (PipelineInt const pipelineInt : tasks.m_pipelineIds.bitview().zeros())
     {
         auto const pipeline = PipelineId(pipelineInt);
@@ -907,11 +1320,58 @@ void exec_conform(Tasks const& tasks, ExecContext &rOut)
     }
 }
 
-static void exec_log(ExecContext &rExec, ExecContext::LogMsg_t msg) noexcept
+template <typename MSG_T>
+static void exec_log(ExecContext &rExec, MSG_T const& msg) noexcept
+{
+    using Record_t = ExecLog::LogRecord;
+
+    static_assert(std::is_trivially_copyable_v<MSG_T>);
+    static_assert(sizeof(MSG_T) <= sizeof(Record_t::data));
+
+    static constexpr auto type = ExecLog::LogMsg_t{std::in_place_type<MSG_T>}.index();
+
+    if (rExec.doLogging && ! rExec.logRing.empty())
+    {
+        Record_t &rRecord = rExec.logRing[rExec.logWritten & (rExec.logRing.size() - 1)];
+        rRecord.type = type;
+        std::memcpy(rRecord.data, &msg, sizeof(MSG_T));
+        ++ rExec.logWritten;
+    }
+}
+
+template <typename MSG_T>
+static ExecLog::LogMsg_t log_decode_as(ExecLog::LogRecord const& record) noexcept
+{
+    MSG_T msg;
+    std::memcpy(&msg, record.data, sizeof(MSG_T));
+    return msg;
+}
+
+template <std::size_t ... INDEX_T>
+static ExecLog::LogMsg_t log_decode(ExecLog::LogRecord const& record, std::index_sequence<INDEX_T...>) noexcept
+{
+    using Decode_t = ExecLog::LogMsg_t(*)(ExecLog::LogRecord const&) noexcept;
+
+    static constexpr Decode_t decoders[] = { &log_decode_as< std::variant_alternative_t<INDEX_T, ExecLog::LogMsg_t> > ... };
+
+    return decoders[record.type](record);
+}
+
+ExecLog::LogMsg_t exec_log_decode(ExecLog const& log, uint64_t const index) noexcept
+{
+    LGRN_ASSERTMV(index >= exec_log_first_available(log) && index < log.logWritten,
+                  "Log record is overwritten or not written yet",
+                  index, exec_log_first_available(log), log.logWritten);
+
+    return log_decode(log.logRing[index & (log.logRing.size() - 1)],
+                      std::make_index_sequence<std::variant_size_v<ExecLog::LogMsg_t>>{});
+}
+
+static void exec_trace_stage(ExecContext &rExec, PipelineId const pipeline, StageId const stage) noexcept
 {
-    if (rExec.doLogging)
+    if (rExec.pTrace != nullptr)
     {
-        rExec.logMsg.push_back(msg);
+        rExec.pTrace->stageMarks.push_back({pipeline, stage, rExec.pTrace->now()});
     }
 }
 
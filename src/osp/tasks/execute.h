@@ -24,14 +24,21 @@
  */
 #pragma once
 
+#include "recording.h"
+#include "stats.h"
 #include "tasks.h"
+#include "trace.h"
 #include "worker.h"
 
 #include "../core/bitvector.h"
 
 #include <entt/entity/storage.hpp>
 
+#include <algorithm>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
 #include <variant>
 #include <vector>
 
@@ -44,7 +51,8 @@ namespace osp
 struct ExecPipeline
 {
 
-    /// Number of Tasks with satisfied dependencies that are ready to run
+    /// Number of Tasks with satisfied dependencies that are ready to run, including ones waiting
+    /// for semaphores
     int             tasksQueuedRun          { 0 };
 
     ///< Number of Tasks waiting for their TaskReqStage dependencies to be satisfied
@@ -95,6 +103,10 @@ struct LoopRequestRun
 
 /**
  * @brief Fast plain-old-data log for ExecContext state changes
+ *
+ * Messages are copied into a fixed-size ring buffer of LogRecords, and are only decoded back
+ * into LogMsg_t when read. Logging does not allocate after exec_conform, so it's cheap enough to
+ * leave on, and the last few frames can be dumped when something gets stuck.
  */
 struct ExecLog
 {
@@ -155,6 +167,16 @@ struct ExecLog
         TaskId      task;
     };
 
+    struct SemaphoreWait
+    {
+        TaskId      task;
+    };
+
+    struct SemaphoreAcquire
+    {
+        TaskId      task;
+    };
+
     struct CompleteTask
     {
         TaskId      task;
@@ -184,12 +206,43 @@ struct ExecLog
             EnqueueTask,
             EnqueueTaskReq,
             UnblockTask,
+            SemaphoreWait,
+            SemaphoreAcquire,
             CompleteTask,
             ExternalRunRequest,
             ExternalSignal>;
 
-    std::vector<LogMsg_t>           logMsg;
+    /**
+     * @brief Compact copy of any LogMsg_t alternative, as stored in the log ring buffer
+     */
+    struct LogRecord
+    {
+        alignas(4) std::byte        data[16];
+        uint8_t                     type;       ///< Index of alternative in LogMsg_t
+    };
+
+    /// Ring buffer of log records, sized to a power of two of at least logCapacity by exec_conform.
+    /// Oldest records are overwritten once full.
+    std::vector<LogRecord>          logRing;
+    std::size_t                     logCapacity{4096};
+
+    /// Total number of records ever written. Record N is at logRing[N % logRing.size()]
+    uint64_t                        logWritten{0};
+
+    /// Number of records already read, see exec_log_mark_read
+    uint64_t                        logRead{0};
+
     bool                            doLogging{true};
+
+    /// Optional timestamped trace, recorded regardless of doLogging
+    ExecTrace                       *pTrace{nullptr};
+
+    /// Optional rolling timing statistics, recorded regardless of doLogging
+    ExecStats                       *pStats{nullptr};
+
+    /// Optional record of run requests, signals and completed tasks, to replay frames exactly.
+    /// Recorded regardless of doLogging.
+    ExecRecording                   *pRecording{nullptr};
 }; // struct ExecLog
 
 /**
@@ -202,6 +255,10 @@ struct ExecContext : public ExecLog
     entt::basic_sparse_set<TaskId>              tasksQueuedRun;
     entt::basic_storage<BlockedTask, TaskId>    tasksQueuedBlocked;
 
+    /// Tasks with satisfied dependencies, but waiting for a semaphore to be released
+    entt::basic_sparse_set<TaskId>              tasksQueuedSema;
+    KeyedVec<SemaphoreId, unsigned int>         semaAcquired;
+
     BitVector_t                         plAdvance;
     BitVector_t                         plAdvanceNext;
     bool                                hasPlAdvanceOrLoop  {false};
@@ -212,14 +269,19 @@ struct ExecContext : public ExecLog
 
     int                                 pipelinesRunning {0};
 
-    // TODO: Consider multithreading. something something work stealing...
-    //  * Allow multiple threads to search for and execute tasks. Atomic access
-    //    for ExecContext? Might be messy to implement.
-    //  * Only allow one thread to search for tasks, assign tasks to other
-    //    threads if they're available before running own task. Another thread
-    //    can take over once it completes its task. May be faster as only one
-    //    thread is modifying ExecContext, and easier to implement.
-    //  * Plug into an existing work queue library?
+    /// Optional priority of each task; higher runs first. Left empty for no particular order.
+    /// Whatever policy fills this is up to the executor, eg. task_critical_paths. Must not
+    /// change while tasks are queued, as tasksQueuedRunHeap is ordered by it.
+    KeyedVec<TaskId, int64_t>           taskPriority;
+
+    /// Max-heap of tasks in tasksQueuedRun by taskPriority, only filled while taskPriority is
+    /// non-empty. Completed tasks stay in the heap until they reach the top. Executors that run
+    /// tasks before completing them take them off with exec_pop_task.
+    std::vector<TaskId>                 tasksQueuedRunHeap;
+
+    // NOTE: ExecContext is not thread-safe. Multithreaded executors only allow one thread at a
+    //       time to call exec_update/complete_task, and run the tasks themselves in parallel.
+    //       See WorkerPool.
 
 }; // struct ExecContext
 
@@ -229,6 +291,11 @@ inline void exec_request_run(ExecContext &rExec, PipelineId pipeline) noexcept
 {
     rExec.plRequestRun.set(std::size_t(pipeline));
     rExec.hasRequestRun = true;
+
+    if (rExec.pRecording != nullptr)
+    {
+        rExec.pRecording->events.push_back(ExecRecording::RunRequest{pipeline});
+    }
 }
 
 void exec_signal(ExecContext &rExec, PipelineId pipeline) noexcept;
@@ -237,6 +304,124 @@ void exec_update(Tasks const& tasks, TaskGraph const& graph, ExecContext &rExec)
 
 void complete_task(Tasks const& tasks, TaskGraph const& graph, ExecContext &rExec, TaskId task, TaskActions actions) noexcept;
 
+/**
+ * @brief Pick which task in ExecContext::tasksQueuedRun to run next, going by taskPriority
+ *
+ * O(1). Without priorities, this is just the first queued task.
+ *
+ * @return Queued task with the highest priority, or null if none are queued
+ */
+[[nodiscard]] TaskId exec_pick_task(ExecContext const& exec) noexcept;
+
+/**
+ * @brief Take the highest priority task off of ExecContext::tasksQueuedRunHeap
+ *
+ * O(log n). For executors that dispatch many tasks before completing them. The task stays in
+ * tasksQueuedRun until complete_task, but isn't returned again unless given back with
+ * exec_push_task.
+ *
+ * @return Queued task with the highest priority, or null if there's none left in the heap
+ */
+[[nodiscard]] TaskId exec_pop_task(ExecContext &rExec) noexcept;
+
+/**
+ * @brief Give a queued task taken by exec_pop_task back to ExecContext::tasksQueuedRunHeap
+ */
+void exec_push_task(ExecContext &rExec, TaskId task) noexcept;
+
+/**
+ * @brief Reason a running pipeline is unable to advance, see exec_find_stall
+ */
+struct ExecWait
+{
+    enum class EReason : uint8_t
+    {
+        TaskReqStage,   ///< task (on pipeline) is blocked until waitsFor reaches waitsForStage
+        StageReqTask,   ///< pipeline's current stage needs task (on waitsFor) to finish first
+        StageReqByTask, ///< task (on waitsFor) requires pipeline's current stage, but hasn't run yet
+        Semaphore       ///< task (on pipeline) is waiting for a semaphore that nothing will release
+    };
+
+    PipelineId  pipeline        { lgrn::id_null<PipelineId>() };
+    StageId     stage           { lgrn::id_null<StageId>() };
+    TaskId      task            { lgrn::id_null<TaskId>() };
+    PipelineId  waitsFor        { lgrn::id_null<PipelineId>() };
+    StageId     waitsForStage   { lgrn::id_null<StageId>() };
+    EReason     reason          { EReason::TaskReqStage };
+};
+
+/**
+ * @brief Pipelines that are stuck for good, see exec_find_stall
+ */
+struct ExecStall
+{
+    /// Each pipeline in the chain waits for the next one. Empty if nothing is stuck.
+    std::vector<ExecWait>   chain;
+
+    /// If true, the last pipeline in chain waits for the first, and none of them can advance.
+    /// Otherwise, chain ends with a pipeline waiting for something that will never happen.
+    bool                    cycle   { false };
+};
+
+/**
+ * @brief Buffers reused by exec_find_stall, so checking for stalls every frame doesn't allocate
+ */
+struct ExecStallScratch
+{
+    enum class EVisit : uint8_t { New, InStack, Done };
+
+    std::vector<ExecWait>                           waits;
+    std::vector<ExecWait>                           sorted;
+    std::vector<uint32_t>                           waitsFirst;
+    std::vector<uint32_t>                           next;
+    std::vector<EVisit>                             visit;
+    std::vector< std::pair<std::size_t, uint32_t> > stack;
+};
+
+/**
+ * @brief Find running pipelines that will never advance, no matter how many tasks are run
+ *
+ * Intended to be called when ExecContext::tasksQueuedRun is empty but pipelines are still
+ * running. Pipelines that are only waiting for an external signal (see exec_signal) are not
+ * considered stuck. If there is a cycle of pipelines waiting for each other, the shortest one is
+ * returned.
+ */
+[[nodiscard]] ExecStall exec_find_stall(Tasks const& tasks, TaskGraph const& graph, ExecContext const& exec, ExecStallScratch &rScratch);
+
+[[nodiscard]] inline ExecStall exec_find_stall(Tasks const& tasks, TaskGraph const& graph, ExecContext const& exec)
+{
+    ExecStallScratch scratch;
+    return exec_find_stall(tasks, graph, exec, scratch);
+}
+
+/**
+ * @brief Get the index of the oldest log record that is not overwritten yet, read or not
+ */
+[[nodiscard]] inline uint64_t exec_log_first_available(ExecLog const& log) noexcept
+{
+    return (log.logWritten > log.logRing.size()) ? (log.logWritten - log.logRing.size()) : 0;
+}
+
+/**
+ * @brief Get the index of the oldest log record that is not read yet and not overwritten
+ */
+[[nodiscard]] inline uint64_t exec_log_first_unread(ExecLog const& log) noexcept
+{
+    return std::max(log.logRead, exec_log_first_available(log));
+}
+
+inline void exec_log_mark_read(ExecLog &rLog) noexcept
+{
+    rLog.logRead = rLog.logWritten;
+}
+
+/**
+ * @brief Decode a log record back into a LogMsg_t
+ *
+ * @param index [in] Record index, from exec_log_first_available up to ExecLog::logWritten
+ */
+[[nodiscard]] ExecLog::LogMsg_t exec_log_decode(ExecLog const& log, uint64_t index) noexcept;
+
 
 
 } // namespace osp
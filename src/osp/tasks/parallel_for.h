@@ -0,0 +1,114 @@
+/**
+ * Open Space Program
+ * Copyright © 2019-2023 Open Space Program Project
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include "top_worker.h"
+#include "worker_pool.h"
+
+#include "../core/bitvector.h"
+
+#include <longeron/utility/asserts.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+
+namespace osp
+{
+
+/**
+ * @brief Call func(i) for each i in [0, count), split into chunks over the WorkerPool in ctx
+ *
+ * Returns once every call is done. Calls are made on the calling thread if ctx has no pool, or
+ * if everything fits in a single chunk. func must be safe to call from multiple threads at
+ * once; write to separate elements, not to shared containers.
+ *
+ * @param ctx       [in] WorkerContext passed to the task function
+ * @param count     [in] Number of indices
+ * @param grainSize [in] Number of indices per chunk. Should be large enough that each chunk
+ *                       takes at least a few microseconds.
+ * @param func      [in] Function called with each index
+ */
+template <typename FUNC_T>
+void parallel_for(WorkerContext const ctx, std::size_t const count, std::size_t const grainSize, FUNC_T &&func)
+{
+    LGRN_ASSERTM(grainSize != 0, "Grain size must be at least 1");
+
+    std::size_t const chunkCount = (count + grainSize - 1) / grainSize;
+
+    auto run_chunk = [count, grainSize, &func] (std::size_t const chunk)
+    {
+        std::size_t const first = chunk * grainSize;
+        std::size_t const last  = std::min(first + grainSize, count);
+        for (std::size_t i = first; i < last; ++i)
+        {
+            func(i);
+        }
+    };
+
+    if (ctx.pPool == nullptr || chunkCount <= 1)
+    {
+        for (std::size_t chunk = 0; chunk < chunkCount; ++chunk)
+        {
+            run_chunk(chunk);
+        }
+        return;
+    }
+
+    using RunChunk_t = decltype(run_chunk);
+
+    ctx.pPool->fork_join(ctx.worker, chunkCount, WorkerJob{
+        [] (void *pUser, uint64_t const chunk, WorkerId) noexcept
+        {
+            (*static_cast<RunChunk_t*>(pUser))(std::size_t(chunk));
+        },
+        &run_chunk, 0});
+}
+
+/**
+ * @brief Call func(i) for each set bit i in a BitVector_t, split into chunks over the WorkerPool
+ *        in ctx
+ *
+ * Same as parallel_for, but chunks are made of whole 64-bit words of the BitVector_t. Chunks
+ * with fewer bits set take less time, so grainSize should account for how sparse bits are.
+ *
+ * @param grainSize [in] Number of bits per chunk, rounded up to a multiple of 64
+ */
+template <typename FUNC_T>
+void parallel_for_bits(WorkerContext const ctx, BitVector_t const& bits, std::size_t const grainSize, FUNC_T &&func)
+{
+    auto const &ints = bits.ints();
+    std::size_t const wordsPerChunk = (grainSize + 63) / 64;
+
+    parallel_for(ctx, ints.size(), std::max<std::size_t>(wordsPerChunk, 1), [&ints, &func] (std::size_t const wordIndex)
+    {
+        for (bitint_t word = ints[wordIndex]; word != 0; word &= word - 1)
+        {
+            func(wordIndex * 64 + std::size_t(std::countr_zero(word)));
+        }
+    });
+}
+
+} // namespace osp
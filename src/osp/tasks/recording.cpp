@@ -0,0 +1,165 @@
+/**
+ * Open Space Program
+ * Copyright © 2019-2023 Open Space Program Project
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "recording.h"
+
+#include <algorithm>
+#include <array>
+#include <type_traits>
+
+namespace osp
+{
+
+// Each event is stored as a type byte followed by two 32-bit values, in native byte order
+static constexpr std::array<char, 8> gc_recordingMagic{'O', 'S', 'P', 'R', 'E', 'C', '0', '1'};
+
+struct RawEvent
+{
+    uint8_t     type;
+    uint32_t    a;
+    uint32_t    b;
+};
+
+static RawEvent to_raw(ExecRecording::Event_t const& event) noexcept
+{
+    using TaskActionInt_t = std::underlying_type_t<TaskAction>;
+
+    return std::visit([type = uint8_t(event.index())] (auto const& msg) noexcept -> RawEvent
+    {
+        using MSG_T = std::decay_t<decltype(msg)>;
+        if constexpr (std::is_same_v<MSG_T, ExecRecording::RunRequest> || std::is_same_v<MSG_T, ExecRecording::Signal>)
+        {
+            return {type, uint32_t(msg.pipeline), 0};
+        }
+        else if constexpr (std::is_same_v<MSG_T, ExecRecording::Complete>)
+        {
+            return {type, uint32_t(msg.task), uint32_t(TaskActionInt_t(msg.actions))};
+        }
+        else
+        {
+            return {type, 0, 0};
+        }
+    }, event);
+}
+
+static bool from_raw(RawEvent const raw, ExecRecording::Event_t &rOut) noexcept
+{
+    using TaskActionInt_t = std::underlying_type_t<TaskAction>;
+
+    switch (raw.type)
+    {
+    case 0:
+        rOut = ExecRecording::RunRequest{PipelineId(raw.a)};
+        return true;
+    case 1:
+        rOut = ExecRecording::Signal{PipelineId(raw.a)};
+        return true;
+    case 2:
+        rOut = ExecRecording::Complete{TaskId(raw.a), TaskActions{TaskAction(TaskActionInt_t(raw.b))}};
+        return true;
+    case 3:
+        rOut = ExecRecording::FrameEnd{};
+        return true;
+    default:
+        return false;
+    }
+}
+
+void exec_recording_write(std::ostream &rStream, ExecRecording const& recording)
+{
+    static_assert(std::variant_size_v<ExecRecording::Event_t> == 4, "Update to_raw and from_raw");
+
+    auto const count = uint64_t(recording.events.size());
+
+    rStream.write(gc_recordingMagic.data(), gc_recordingMagic.size());
+    rStream.write(reinterpret_cast<char const*>(&count), sizeof(count));
+
+    for (ExecRecording::Event_t const& event : recording.events)
+    {
+        RawEvent const raw = to_raw(event);
+        rStream.write(reinterpret_cast<char const*>(&raw.type), sizeof(raw.type));
+        rStream.write(reinterpret_cast<char const*>(&raw.a),    sizeof(raw.a));
+        rStream.write(reinterpret_cast<char const*>(&raw.b),    sizeof(raw.b));
+    }
+}
+
+bool exec_recording_read(std::istream &rStream, ExecRecording &rOut)
+{
+    std::array<char, 8> magic{};
+    uint64_t            count{0};
+
+    rStream.read(magic.data(), magic.size());
+    rStream.read(reinterpret_cast<char*>(&count), sizeof(count));
+
+    if ( ! rStream || magic != gc_recordingMagic )
+    {
+        return false;
+    }
+
+    rOut.events.clear();
+
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        RawEvent raw{};
+        rStream.read(reinterpret_cast<char*>(&raw.type), sizeof(raw.type));
+        rStream.read(reinterpret_cast<char*>(&raw.a),    sizeof(raw.a));
+        rStream.read(reinterpret_cast<char*>(&raw.b),    sizeof(raw.b));
+
+        if ( ! rStream || ! from_raw(raw, rOut.events.emplace_back()) )
+        {
+            rOut.events.clear();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool exec_recording_fits(Tasks const& tasks, ExecRecording const& recording) noexcept
+{
+    std::size_t const maxPipelines  = tasks.m_pipelineIds.capacity();
+    std::size_t const maxTasks      = tasks.m_taskIds.capacity();
+
+    return std::all_of(recording.events.begin(), recording.events.end(), [=] (ExecRecording::Event_t const& event) noexcept
+    {
+        return std::visit([=] (auto const& msg) noexcept -> bool
+        {
+            using MSG_T = std::decay_t<decltype(msg)>;
+            if constexpr (std::is_same_v<MSG_T, ExecRecording::RunRequest> || std::is_same_v<MSG_T, ExecRecording::Signal>)
+            {
+                return std::size_t(msg.pipeline) < maxPipelines;
+            }
+            else if constexpr (std::is_same_v<MSG_T, ExecRecording::Complete>)
+            {
+                return std::size_t(msg.task) < maxTasks;
+            }
+            else
+            {
+                return true;
+            }
+        }, event);
+    });
+}
+
+} // namespace osp
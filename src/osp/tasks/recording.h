@@ -0,0 +1,95 @@
+/**
+ * Open Space Program
+ * Copyright © 2019-2023 Open Space Program Project
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include "tasks.h"
+#include "worker.h"
+
+#include <istream>
+#include <ostream>
+#include <variant>
+#include <vector>
+
+namespace osp
+{
+
+/**
+ * @brief Everything that decides what an ExecContext does over a number of frames; run
+ *        requests, signals, and the order tasks complete in
+ *
+ * Replaying these against the same TaskGraph reproduces the exact same frames, see
+ * top_replay_frame. Recorded through ExecLog::pRecording, regardless of doLogging.
+ */
+struct ExecRecording
+{
+    struct RunRequest
+    {
+        PipelineId  pipeline;
+    };
+
+    struct Signal
+    {
+        PipelineId  pipeline;
+    };
+
+    struct Complete
+    {
+        TaskId      task;
+        TaskActions actions;
+    };
+
+    /// Added by the executor once a frame is done running
+    struct FrameEnd { };
+
+    using Event_t = std::variant<RunRequest, Signal, Complete, FrameEnd>;
+
+    std::vector<Event_t> events;
+
+}; // struct ExecRecording
+
+/**
+ * @brief Write an ExecRecording in a compact binary format
+ *
+ * Only meant to be read back by the same build, see exec_recording_read.
+ */
+void exec_recording_write(std::ostream &rStream, ExecRecording const& recording);
+
+/**
+ * @brief Read an ExecRecording written by exec_recording_write
+ *
+ * @return false if the stream doesn't contain a valid recording, leaving rOut empty
+ */
+[[nodiscard]] bool exec_recording_read(std::istream &rStream, ExecRecording &rOut);
+
+/**
+ * @brief Check that every TaskId and PipelineId in a recording fits within tasks
+ *
+ * A recording from another build or session layout can refer to IDs past the capacity of tasks,
+ * which would index past the end of an ExecContext. Check before replaying, see
+ * top_replay_frame.
+ */
+[[nodiscard]] bool exec_recording_fits(Tasks const& tasks, ExecRecording const& recording) noexcept;
+
+} // namespace osp
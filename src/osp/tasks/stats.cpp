@@ -0,0 +1,87 @@
+/**
+ * Open Space Program
+ * Copyright © 2019-2023 Open Space Program Project
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "stats.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace osp
+{
+
+void exec_stats_conform(Tasks const& tasks, ExecStats &rStats)
+{
+    rStats.tasks    .resize(tasks.m_taskIds.capacity());
+    rStats.pipelines.resize(tasks.m_pipelineIds.capacity());
+    rStats.plStartNs.resize(tasks.m_pipelineIds.capacity(), 0);
+
+    ids_for_each_changed(tasks.m_taskIds, rStats.tasksConformed, [&rStats] (TaskId const task)
+    {
+        if (std::size_t(task) < rStats.tasks.size())
+        {
+            rStats.tasks[task] = {};
+        }
+    });
+
+    ids_for_each_changed(tasks.m_pipelineIds, rStats.pipelinesConformed, [&rStats] (PipelineId const pipeline)
+    {
+        if (std::size_t(pipeline) < rStats.pipelines.size())
+        {
+            rStats.pipelines[pipeline] = {};
+            rStats.plStartNs[pipeline] = 0;
+        }
+    });
+}
+
+TimeSummary stats_summarize(TimeSamples const& samples) noexcept
+{
+    if (samples.count == 0)
+    {
+        return {};
+    }
+
+    std::size_t const windowSize = std::min<uint64_t>(samples.count, TimeSamples::sc_window);
+
+    // Copied so percentiles can be found with nth_element, without allocating
+    std::array<int64_t, TimeSamples::sc_window> sorted = samples.recentNs;
+    auto const first = sorted.begin();
+    auto const last  = sorted.begin() + windowSize;
+
+    auto const percentile = [first, last, windowSize] (std::size_t const percent) noexcept
+    {
+        auto const nth = first + (windowSize - 1) * percent / 100;
+        std::nth_element(first, nth, last);
+        return *nth;
+    };
+
+    return {
+        .count  = samples.count,
+        .meanNs = std::accumulate(first, last, int64_t(0)) / int64_t(windowSize),
+        .p50Ns  = percentile(50),
+        .p99Ns  = percentile(99),
+        .maxNs  = samples.maxNs
+    };
+}
+
+} // namespace osp
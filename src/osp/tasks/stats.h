@@ -0,0 +1,146 @@
+/**
+ * Open Space Program
+ * Copyright © 2019-2023 Open Space Program Project
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include "tasks.h"
+
+#include "../core/bitvector.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+namespace osp
+{
+
+/**
+ * @brief Rolling window of wall times, for a single task or pipeline
+ */
+struct TimeSamples
+{
+    static constexpr std::size_t sc_window = 128;
+
+    /// Most recent samples. Sample N is at recentNs[N % sc_window]
+    std::array<int64_t, sc_window>  recentNs    {};
+
+    /// Total number of samples ever added
+    uint64_t                        count       { 0 };
+
+    /// Longest sample ever added
+    int64_t                         maxNs       { 0 };
+};
+
+/**
+ * @brief Summary of a TimeSamples, see stats_summarize
+ *
+ * Count and max are over all samples, mean and percentiles are over the most recent window.
+ */
+struct TimeSummary
+{
+    uint64_t    count   { 0 };
+    int64_t     meanNs  { 0 };
+    int64_t     p50Ns   { 0 };
+    int64_t     p99Ns   { 0 };
+    int64_t     maxNs   { 0 };
+};
+
+/**
+ * @brief Rolling wall time statistics of each task and pipeline
+ *
+ * Executors add task samples as tasks complete. Pipeline samples are added by exec_update, and
+ * measure from when a pipeline starts running until it finishes, including all loop iterations.
+ *
+ * Times are in nanoseconds.
+ */
+struct ExecStats
+{
+    using Clock_t = std::chrono::steady_clock;
+
+    [[nodiscard]] int64_t now() const noexcept
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock_t::now() - epoch).count();
+    }
+
+    Clock_t::time_point                 epoch       { Clock_t::now() };
+
+    KeyedVec<TaskId, TimeSamples>       tasks;
+    KeyedVec<PipelineId, TimeSamples>   pipelines;
+
+    /// Time each running pipeline started, since epoch
+    KeyedVec<PipelineId, int64_t>       plStartNs;
+
+    /// Tasks and pipelines that existed as of the last exec_stats_conform
+    BitVector_t                         tasksConformed;
+    BitVector_t                         pipelinesConformed;
+
+}; // struct ExecStats
+
+/**
+ * @brief Call func(id) for each ID that was added or removed since the last call
+ *
+ * @param rExisted [ref] IDs that existed as of the last call, updated to the ones that exist now
+ */
+template <typename ID_T, typename FUNC_T>
+void ids_for_each_changed(lgrn::IdRegistryStl<ID_T> const& ids, BitVector_t &rExisted, FUNC_T &&func)
+{
+    bitvector_resize(rExisted, std::max(ids.capacity(), rExisted.size()));
+
+    for (std::size_t i = 0; i < rExisted.size(); ++i)
+    {
+        bool const exists = i < ids.capacity() && ids.exists(ID_T(i));
+        if (exists != rExisted.test(i))
+        {
+            func(ID_T(i));
+            if (exists)
+            {
+                rExisted.set(i);
+            }
+            else
+            {
+                rExisted.reset(i);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Resize ExecStats to fit all tasks and pipelines
+ *
+ * Samples of existing tasks and pipelines are kept. Ones added or removed since the last call are
+ * cleared, so a reused ID doesn't inherit samples of whatever had it before.
+ */
+void exec_stats_conform(Tasks const& tasks, ExecStats &rStats);
+
+inline void stats_add_sample(TimeSamples &rSamples, int64_t const ns) noexcept
+{
+    rSamples.recentNs[rSamples.count % TimeSamples::sc_window] = ns;
+    rSamples.maxNs = std::max(rSamples.maxNs, ns);
+    ++ rSamples.count;
+}
+
+[[nodiscard]] TimeSummary stats_summarize(TimeSamples const& samples) noexcept;
+
+} // namespace osp
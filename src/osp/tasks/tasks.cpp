@@ -26,7 +26,10 @@
 
 #include "../core/bitvector.h"
 
+#include <algorithm>
 #include <array>
+#include <map>
+#include <utility>
 
 namespace osp
 {
@@ -35,6 +38,7 @@ struct TaskCounts
 {
     uint16_t requiresStages     {0};
     uint16_t requiredByStages   {0};
+    uint16_t acquiresSemas      {0};
 };
 
 struct StageCounts
@@ -49,33 +53,59 @@ struct PipelineCounts
     std::array<StageCounts, gc_maxStages> stageCounts;
 
     uint8_t  stages             { 0 };
+};
 
+struct PipelineTreeLinks
+{
     PipelineId firstChild       { lgrn::id_null<PipelineId>() };
     PipelineId sibling          { lgrn::id_null<PipelineId>() };
 };
 
+static void build_pipeline_tree(Tasks const& tasks, TaskGraph &rOut);
+
+static void fuse_tasks(Tasks const& tasks, ArrayView<TaskEdges const* const> data, KeyedVec<TaskId, uint32_t> const& fuseGroups, BitVector_t const& candidates, TaskGraph &rOut, BitVector_t &rFollowers);
 
-TaskGraph make_exec_graph(Tasks const& tasks, ArrayView<TaskEdges const* const> const data)
+
+TaskGraph make_exec_graph(Tasks const& tasks, ArrayView<TaskEdges const* const> const data, KeyedVec<TaskId, uint32_t> const& fuseGroups)
 {
     TaskGraph out;
 
     std::size_t const maxPipelines  = tasks.m_pipelineIds.capacity();
     std::size_t const maxTasks      = tasks.m_taskIds.capacity();
+    std::size_t const maxSemas      = tasks.m_semaIds.capacity();
 
     KeyedVec<PipelineId, PipelineCounts>    plCounts;
     KeyedVec<TaskId, TaskCounts>            taskCounts;
-    BitVector_t                             plInTree;
+    KeyedVec<SemaphoreId, uint16_t>         semaAcquiredByCounts;
 
     out.pipelineToFirstAnystg .resize(maxPipelines);
-    bitvector_resize(plInTree, maxPipelines);
     plCounts        .resize(maxPipelines+1);
     taskCounts      .resize(maxTasks+1);
+    semaAcquiredByCounts.resize(maxSemas+1, 0);
 
     std::size_t totalTasksReqStage  = 0;
     std::size_t totalStageReqTasks  = 0;
+    std::size_t totalSemaAcquires   = 0;
     std::size_t totalRunTasks       = 0;
     std::size_t totalStages         = 0;
 
+    // 0. Fuse tasks. Followers are left out of the graph entirely, as they have the exact same
+    //    edges as the first task of their chain.
+
+    BitVector_t allTasks;
+    BitVector_t followers;
+    bitvector_resize(allTasks,  maxTasks);
+    bitvector_resize(followers, maxTasks);
+    for (TaskInt const taskInt : tasks.m_taskIds.bitview().zeros())
+    {
+        allTasks.set(taskInt);
+    }
+
+    out.taskFusedNext.resize(maxTasks, lgrn::id_null<TaskId>());
+    fuse_tasks(tasks, data, fuseGroups, allTasks, out, followers);
+
+    auto const is_follower = [&followers] (TaskId const task) noexcept { return followers.test(std::size_t(task)); };
+
     // 1. Count total number of stages
 
     auto const count_stage = [&plCounts] (PipelineId const pipeline, StageId const stage)
@@ -98,8 +128,11 @@ TaskGraph make_exec_graph(Tasks const& tasks, ArrayView<TaskEdges const* const>
 
         count_stage(runPipeline, runStage);
 
-        ++ plCounts[runPipeline].stageCounts[std::size_t(runStage)].runTasks;
-        ++ totalRunTasks;
+        if ( ! is_follower(task) )
+        {
+            ++ plCounts[runPipeline].stageCounts[std::size_t(runStage)].runTasks;
+            ++ totalRunTasks;
+        }
     }
 
     // Count stages from syncs
@@ -122,6 +155,11 @@ TaskGraph make_exec_graph(Tasks const& tasks, ArrayView<TaskEdges const* const>
     {
         for (auto const [task, pipeline, stage] : pEdges->m_syncWith)
         {
+            if (is_follower(task))
+            {
+                continue;
+            }
+
             StageCounts &rStageCounts = plCounts[pipeline].stageCounts[std::size_t(stage)];
             TaskCounts  &rTaskCounts  = taskCounts[task];
 
@@ -134,38 +172,24 @@ TaskGraph make_exec_graph(Tasks const& tasks, ArrayView<TaskEdges const* const>
             ++ rStageCounts.requiresTasks;
             ++ rTaskCounts .requiredByStages;
 
+            ++ totalTasksReqStage;
+            ++ totalStageReqTasks;
         }
-        totalTasksReqStage += pEdges->m_syncWith.size();
-        totalStageReqTasks += pEdges->m_syncWith.size();
     }
 
-    // 3. Map out children and siblings in tree
+    // 2.5. Count Semaphore acquires
 
-    for (PipelineInt const childPlInt : tasks.m_pipelineIds.bitview().zeros())
+    for (TaskEdges const* pEdges : data)
     {
-        PipelineId const child  = PipelineId(childPlInt);
-        PipelineId const parent = tasks.m_pipelineParents[child];
-
-        if (parent != lgrn::id_null<PipelineId>())
+        for (auto const [task, sema] : pEdges->m_semaphoreEdges)
         {
-            plInTree.set(std::size_t(parent));
-            plInTree.set(std::size_t(child));
-
-            PipelineCounts &rChildCounts  = plCounts[child];
-            PipelineCounts &rParentCounts = plCounts[parent];
-
-            if (rParentCounts.firstChild != lgrn::id_null<PipelineId>())
-            {
-                rChildCounts.sibling = rParentCounts.firstChild;
-            }
-
-            rParentCounts.firstChild = child;
+            ++ taskCounts[task].acquiresSemas;
+            ++ semaAcquiredByCounts[sema];
         }
+        totalSemaAcquires += pEdges->m_semaphoreEdges.size();
     }
 
-    std::size_t const treeSize = plInTree.count();
-
-    // 4. Allocate
+    // 3. Allocate
 
     // The +1 is needed for 1-to-many connections to store the total number of other elements they
     // index. This also simplifies logic in fanout_view(...)
@@ -182,12 +206,13 @@ TaskGraph make_exec_graph(Tasks const& tasks, ArrayView<TaskEdges const* const>
     out.taskreqstgData              .resize(totalTasksReqStage, {});
     out.anystgToFirstRevTaskreqstg  .resize(totalStages+1,      lgrn::id_null<ReverseTaskReqStageId>());
     out.revTaskreqstgToTask         .resize(totalTasksReqStage, lgrn::id_null<TaskId>());
-    out.pltreeDescendantCounts      .resize(treeSize,           0);
-    out.pltreeToPipeline            .resize(treeSize,           lgrn::id_null<PipelineId>());
-    out.pipelineToPltree            .resize(maxPipelines,       lgrn::id_null<PipelineTreePos_t>());
-    out.pipelineToLoopScope         .resize(maxPipelines,       lgrn::id_null<PipelineTreePos_t>());
+    out.taskToFirstConflict         .resize(maxTasks+1,         TaskConflictId(0));
+    out.taskToFirstSemaacq          .resize(maxTasks+1,         lgrn::id_null<SemaAcquireId>());
+    out.semaacqToSema               .resize(totalSemaAcquires,  lgrn::id_null<SemaphoreId>());
+    out.semaToFirstRevSemaacq       .resize(maxSemas+1,         lgrn::id_null<ReverseSemaAcquireId>());
+    out.revSemaacqToTask            .resize(totalSemaAcquires,  lgrn::id_null<TaskId>());
 
-    // 5. Calculate one-to-many partitions
+    // 4. Calculate one-to-many partitions
 
     fanout_partition(
         out.pipelineToFirstAnystg,
@@ -244,11 +269,25 @@ TaskGraph make_exec_graph(Tasks const& tasks, ArrayView<TaskEdges const* const>
         },
         [&out] (AnyStageId, ReverseTaskReqStageId) { });
 
-    // 6. Push
+    fanout_partition(
+        out.taskToFirstSemaacq,
+        [&taskCounts] (TaskId task)             { return taskCounts[task].acquiresSemas; },
+        [] (TaskId, SemaAcquireId) { });
+    fanout_partition(
+        out.semaToFirstRevSemaacq,
+        [&semaAcquiredByCounts] (SemaphoreId sema) { return semaAcquiredByCounts[sema]; },
+        [] (SemaphoreId, ReverseSemaAcquireId) { });
+
+    // 5. Push
 
     for (TaskInt const taskInt : tasks.m_taskIds.bitview().zeros())
     {
         auto const      task            = TaskId(taskInt);
+        if (is_follower(task))
+        {
+            continue;
+        }
+
         auto const      run             = tasks.m_taskRunOn[task];
         auto const      anystg          = anystg_from(out, run.pipeline, run.stage);
         StageCounts     &rStageCounts   = plCounts[run.pipeline].stageCounts[std::size_t(run.stage)];
@@ -263,6 +302,11 @@ TaskGraph make_exec_graph(Tasks const& tasks, ArrayView<TaskEdges const* const>
     {
         for (auto const [task, pipeline, stage] : pEdges->m_syncWith)
         {
+            if (is_follower(task))
+            {
+                continue;
+            }
+
             AnyStageId const            anystg          = anystg_from(out, pipeline, stage);
             StageCounts                 &rStageCounts   = plCounts[pipeline].stageCounts[std::size_t(stage)];
             TaskCounts                  &rTaskCounts    = taskCounts[task];
@@ -302,11 +346,31 @@ TaskGraph make_exec_graph(Tasks const& tasks, ArrayView<TaskEdges const* const>
         }
     }
 
+    for (TaskEdges const* pEdges : data)
+    {
+        for (auto const [task, sema] : pEdges->m_semaphoreEdges)
+        {
+            TaskCounts                  &rTaskCounts    = taskCounts[task];
+            uint16_t                    &rSemaCount     = semaAcquiredByCounts[sema];
+
+            SemaAcquireId const         semaacq         = id_from_count(out.taskToFirstSemaacq, task, rTaskCounts.acquiresSemas);
+            ReverseSemaAcquireId const  revSemaacq      = id_from_count(out.semaToFirstRevSemaacq, sema, rSemaCount);
+
+            out.semaacqToSema[semaacq]          = sema;
+            out.revSemaacqToTask[revSemaacq]    = task;
+
+            -- rTaskCounts.acquiresSemas;
+            -- rSemaCount;
+            -- totalSemaAcquires;
+        }
+    }
+
     // NOLINTBEGIN(readability-use-anyofallof)
     [[maybe_unused]] auto const all_counts_zero = [&] ()
     {
         if (   totalStageReqTasks   != 0
-            || totalTasksReqStage   != 0 )
+            || totalTasksReqStage   != 0
+            || totalSemaAcquires    != 0 )
         {
             return false;
         }
@@ -324,7 +388,15 @@ TaskGraph make_exec_graph(Tasks const& tasks, ArrayView<TaskEdges const* const>
         for (TaskCounts const& taskCount : taskCounts)
         {
             if (   taskCount.requiredByStages != 0
-                || taskCount.requiresStages != 0 )
+                || taskCount.requiresStages   != 0
+                || taskCount.acquiresSemas    != 0 )
+            {
+                return false;
+            }
+        }
+        for (uint16_t const semaCount : semaAcquiredByCounts)
+        {
+            if (semaCount != 0)
             {
                 return false;
             }
@@ -337,16 +409,587 @@ TaskGraph make_exec_graph(Tasks const& tasks, ArrayView<TaskEdges const* const>
     LGRN_ASSERTM(all_counts_zero(), "Counts repurposed as items remaining, and must all be zero by the end here");
 
 
-    // 7. Build Pipeline Tree
+    // 6. Build Pipeline Tree
+
+    build_pipeline_tree(tasks, out);
+
+    return out;
+}
+
+void update_exec_graph(TaskGraph &rGraph, Tasks const& tasks, ArrayView<TaskEdges const* const> const data, TaskGraphChanges const& changes, KeyedVec<TaskId, uint32_t> const& fuseGroups)
+{
+    std::size_t const maxPipelines  = tasks.m_pipelineIds.capacity();
+    std::size_t const maxTasks      = tasks.m_taskIds.capacity();
+    std::size_t const maxSemas      = tasks.m_semaIds.capacity();
+
+    // Sizes excluding the extra +1 element, or 0 if rGraph is empty
+    auto const key_count = [] (auto const& vec) -> std::size_t { return vec.empty() ? 0 : vec.size() - 1; };
+    std::size_t const oldMaxPipelines   = key_count(rGraph.pipelineToFirstAnystg);
+    std::size_t const oldMaxTasks       = key_count(rGraph.taskToFirstTaskreqstg);
+    std::size_t const oldMaxSemas       = key_count(rGraph.semaToFirstRevSemaacq);
+
+    BitVector_t plAdded;
+    BitVector_t plRemoved;
+    BitVector_t taskAdded;
+    BitVector_t taskRemoved;
+    bitvector_resize(plAdded,       std::max(maxPipelines, oldMaxPipelines));
+    bitvector_resize(plRemoved,     std::max(maxPipelines, oldMaxPipelines));
+    bitvector_resize(taskAdded,     std::max(maxTasks,     oldMaxTasks));
+    bitvector_resize(taskRemoved,   std::max(maxTasks,     oldMaxTasks));
+
+    for (PipelineId const pipeline : changes.pipelinesAdded)   { plAdded    .set(std::size_t(pipeline)); }
+    for (PipelineId const pipeline : changes.pipelinesRemoved) { plRemoved  .set(std::size_t(pipeline)); }
+    for (TaskId const task         : changes.tasksAdded)       { taskAdded  .set(std::size_t(task)); }
+    for (TaskId const task         : changes.tasksRemoved)     { taskRemoved.set(std::size_t(task)); }
+
+    // 0. Fix up fused chains. Removed tasks are unlinked. The rest of a chain that lost its first
+    //    task are re-added, as only the first task of each chain was in rGraph.
+
+    std::vector<TaskId> tasksAdded(changes.tasksAdded.begin(), changes.tasksAdded.end());
+
+    KeyedVec<TaskId, TaskId> &rFusedNext = rGraph.taskFusedNext;
+    rFusedNext.resize(oldMaxTasks, lgrn::id_null<TaskId>());
+
+    BitVector_t oldFollowers;
+    bitvector_resize(oldFollowers, oldMaxTasks);
+    for (TaskId const next : rFusedNext)
+    {
+        if (next != lgrn::id_null<TaskId>())
+        {
+            oldFollowers.set(std::size_t(next));
+        }
+    }
+
+    for (std::size_t first = 0; first < oldMaxTasks; ++first)
+    {
+        if (oldFollowers.test(first) || rFusedNext[TaskId(first)] == lgrn::id_null<TaskId>())
+        {
+            continue;
+        }
+
+        bool const  firstRemoved    = taskRemoved.test(first);
+        TaskId      prev            = TaskId(first);
+        TaskId      next            = std::exchange(rFusedNext[TaskId(first)], lgrn::id_null<TaskId>());
+
+        while (next != lgrn::id_null<TaskId>())
+        {
+            TaskId const task = next;
+            next = std::exchange(rFusedNext[task], lgrn::id_null<TaskId>());
+
+            if (taskRemoved.test(std::size_t(task)))
+            {
+                continue;
+            }
+
+            if (firstRemoved)
+            {
+                tasksAdded.push_back(task);
+                taskAdded.set(std::size_t(task));
+            }
+            else
+            {
+                rFusedNext[prev] = task;
+                prev = task;
+            }
+        }
+    }
+
+    rFusedNext.resize(maxTasks, lgrn::id_null<TaskId>());
+
+    BitVector_t followers;
+    bitvector_resize(followers, maxTasks);
+    fuse_tasks(tasks, data, fuseGroups, taskAdded, rGraph, followers);
+
+    auto const added_not_follower = [&taskAdded, &followers] (TaskId const task) noexcept
+    {
+        return taskAdded.test(std::size_t(task)) && ! followers.test(std::size_t(task));
+    };
+
+    // Kept if values from rGraph can be copied over
+    auto const pipeline_kept = [&] (PipelineId const pipeline) noexcept
+    {
+        return    std::size_t(pipeline) < oldMaxPipelines
+               && ! plRemoved.test(std::size_t(pipeline))
+               && ! plAdded  .test(std::size_t(pipeline));
+    };
+    auto const task_kept = [&] (TaskId const task) noexcept
+    {
+        return    std::size_t(task) < oldMaxTasks
+               && ! taskRemoved.test(std::size_t(task))
+               && ! taskAdded  .test(std::size_t(task));
+    };
+    auto const task_not_removed     = [&taskRemoved] (TaskId const task) noexcept      { return ! taskRemoved.test(std::size_t(task)); };
+    auto const pipeline_not_removed = [&plRemoved]   (PipelineId const pl) noexcept    { return ! plRemoved  .test(std::size_t(pl)); };
+
+    // 1. Count stages. Kept pipelines keep all their existing stages
+
+    KeyedVec<PipelineId, uint8_t> plStages;
+    plStages.resize(maxPipelines+1, 0);
+
+    for (PipelineInt const plInt : tasks.m_pipelineIds.bitview().zeros())
+    {
+        auto const pipeline = PipelineId(plInt);
+        plStages[pipeline] = pipeline_kept(pipeline)
+                           ? std::max<uint8_t>(uint8_t(fanout_size(rGraph.pipelineToFirstAnystg, pipeline)), 1)
+                           : 1;
+    }
+
+    auto const count_stage = [&plStages] (PipelineId const pipeline, StageId const stage)
+    {
+        uint8_t &rStageCount = plStages[pipeline];
+        rStageCount = std::max(rStageCount, uint8_t(uint8_t(stage) + 1));
+    };
+
+    for (TaskId const task : tasksAdded)
+    {
+        auto const [runPipeline, runStage] = tasks.m_taskRunOn[task];
+        count_stage(runPipeline, runStage);
+    }
+
+    for (TaskEdges const* pEdges : data)
+    {
+        for (auto const [task, pipeline, stage] : pEdges->m_syncWith)
+        {
+            if (taskAdded.test(std::size_t(task)))
+            {
+                count_stage(pipeline, stage);
+            }
+        }
+    }
+
+    // 2. Lay out new AnyStageIds
+
+    KeyedVec<PipelineId, AnyStageId> plToFirstAnystg;
+    KeyedVec<AnyStageId, PipelineId> anystgToPipeline;
+
+    std::size_t totalStages = 0;
+    for (uint8_t const stages : plStages)
+    {
+        totalStages += stages;
+    }
+
+    plToFirstAnystg .resize(maxPipelines+1, lgrn::id_null<AnyStageId>());
+    anystgToPipeline.resize(totalStages+1,  lgrn::id_null<PipelineId>());
+
+    fanout_partition(
+        plToFirstAnystg,
+        [&plStages] (PipelineId pl)                         { return plStages[pl]; },
+        [&anystgToPipeline] (PipelineId pl, AnyStageId stg) { anystgToPipeline[stg] = pl; });
+
+    auto const new_anystg = [&plToFirstAnystg] (PipelineId const pipeline, StageId const stage) noexcept
+    {
+        return AnyStageId(uint32_t(plToFirstAnystg[pipeline]) + uint32_t(stage));
+    };
+
+    // Map AnyStageIds of kept pipelines between rGraph and the new layout. Null if removed or new
+    KeyedVec<AnyStageId, AnyStageId> newToOldAnystg;
+    KeyedVec<AnyStageId, AnyStageId> oldToNewAnystg;
+    newToOldAnystg.resize(totalStages,                              lgrn::id_null<AnyStageId>());
+    oldToNewAnystg.resize(key_count(rGraph.anystgToFirstRuntask),   lgrn::id_null<AnyStageId>());
+
+    for (PipelineInt const plInt : tasks.m_pipelineIds.bitview().zeros())
+    {
+        auto const pipeline = PipelineId(plInt);
+        if ( ! pipeline_kept(pipeline) )
+        {
+            continue;
+        }
+
+        auto const oldFirst = uint32_t(rGraph.pipelineToFirstAnystg[pipeline]);
+        auto const newFirst = uint32_t(plToFirstAnystg[pipeline]);
+        for (uint32_t stg = 0; stg < fanout_size(rGraph.pipelineToFirstAnystg, pipeline); ++stg)
+        {
+            newToOldAnystg[AnyStageId(newFirst + stg)] = AnyStageId(oldFirst + stg);
+            oldToNewAnystg[AnyStageId(oldFirst + stg)] = AnyStageId(newFirst + stg);
+        }
+    }
+
+    auto const old_anystg = [&newToOldAnystg] (AnyStageId const anystg) noexcept
+    {
+        return newToOldAnystg[anystg];
+    };
+
+    // AnyStageId value in rGraph -> new AnyStageId, or false if it was removed
+    auto const remap_anystg = [&oldToNewAnystg] (AnyStageId &rAnystg) noexcept -> bool
+    {
+        rAnystg = oldToNewAnystg[rAnystg];
+        return rAnystg != lgrn::id_null<AnyStageId>();
+    };
+
+    auto const old_task = [&task_kept] (TaskId const task) noexcept
+    {
+        return task_kept(task) ? task : lgrn::id_null<TaskId>();
+    };
+
+    auto const old_sema = [oldMaxSemas] (SemaphoreId const sema) noexcept
+    {
+        return (std::size_t(sema) < oldMaxSemas) ? sema : lgrn::id_null<SemaphoreId>();
+    };
+
+    // 3. List values to add, from added tasks and their edges
+
+    std::vector< std::pair<AnyStageId,  TaskId> >               addRuntask;
+    std::vector< std::pair<AnyStageId,  StageRequiresTask> >    addStgreqtask;
+    std::vector< std::pair<TaskId,      AnyStageId> >           addRevStgreqtask;
+    std::vector< std::pair<TaskId,      TaskRequiresStage> >    addTaskreqstg;
+    std::vector< std::pair<AnyStageId,  TaskId> >               addRevTaskreqstg;
+    std::vector< std::pair<TaskId,      SemaphoreId> >          addSemaacq;
+    std::vector< std::pair<SemaphoreId, TaskId> >               addRevSemaacq;
+
+    for (TaskId const task : tasksAdded)
+    {
+        if (followers.test(std::size_t(task)))
+        {
+            continue;
+        }
+        auto const [runPipeline, runStage] = tasks.m_taskRunOn[task];
+        addRuntask.emplace_back(new_anystg(runPipeline, runStage), task);
+    }
+
+    for (TaskEdges const* pEdges : data)
+    {
+        for (auto const [task, pipeline, stage] : pEdges->m_syncWith)
+        {
+            if ( ! added_not_follower(task) )
+            {
+                continue;
+            }
+
+            AnyStageId const anystg = new_anystg(pipeline, stage);
+            auto const [taskPipeline, taskStage] = tasks.m_taskRunOn[task];
+
+            addStgreqtask   .emplace_back(anystg, StageRequiresTask{anystg, task, taskPipeline, taskStage});
+            addRevStgreqtask.emplace_back(task,   anystg);
+            addTaskreqstg   .emplace_back(task,   TaskRequiresStage{task, pipeline, stage});
+            addRevTaskreqstg.emplace_back(anystg, task);
+        }
+
+        for (auto const [task, sema] : pEdges->m_semaphoreEdges)
+        {
+            if (added_not_follower(task))
+            {
+                addSemaacq   .emplace_back(task, sema);
+                addRevSemaacq.emplace_back(sema, task);
+            }
+        }
+    }
+
+    auto const sort_by_key = [] (auto &rVec)
+    {
+        std::stable_sort(rVec.begin(), rVec.end(), [] (auto const& lhs, auto const& rhs) { return lhs.first < rhs.first; });
+    };
+    sort_by_key(addRuntask);
+    sort_by_key(addStgreqtask);
+    sort_by_key(addRevStgreqtask);
+    sort_by_key(addTaskreqstg);
+    sort_by_key(addRevTaskreqstg);
+    sort_by_key(addSemaacq);
+    sort_by_key(addRevSemaacq);
+
+    // 4. Splice. Needs the old AnyStageIds, so pipelineToFirstAnystg is replaced last
+
+    fanout_splice(rGraph.anystgToFirstRuntask, rGraph.runtaskToTask, totalStages, old_anystg,
+                  task_not_removed, addRuntask);
+
+    fanout_splice(rGraph.anystgToFirstStgreqtask, rGraph.stgreqtaskData, totalStages, old_anystg,
+                  [&] (StageRequiresTask &rStgreqtask) noexcept
+                  {
+                      return task_not_removed(rStgreqtask.reqTask) && remap_anystg(rStgreqtask.ownStage);
+                  }, addStgreqtask);
+    fanout_splice(rGraph.taskToFirstRevStgreqtask, rGraph.revStgreqtaskToStage, maxTasks, old_task,
+                  remap_anystg, addRevStgreqtask);
+
+    fanout_splice(rGraph.taskToFirstTaskreqstg, rGraph.taskreqstgData, maxTasks, old_task,
+                  [&] (TaskRequiresStage const &rTaskreqstg) noexcept
+                  {
+                      return pipeline_not_removed(rTaskreqstg.reqPipeline);
+                  }, addTaskreqstg);
+    fanout_splice(rGraph.anystgToFirstRevTaskreqstg, rGraph.revTaskreqstgToTask, totalStages, old_anystg,
+                  task_not_removed, addRevTaskreqstg);
+
+    fanout_splice(rGraph.taskToFirstSemaacq, rGraph.semaacqToSema, maxTasks, old_task,
+                  [] (SemaphoreId) noexcept { return true; }, addSemaacq);
+    fanout_splice(rGraph.semaToFirstRevSemaacq, rGraph.revSemaacqToTask, maxSemas, old_sema,
+                  task_not_removed, addRevSemaacq);
+
+    // Conflicts are only removed here. See the update_exec_graph overload that accepts TopTasks
+    fanout_splice(rGraph.taskToFirstConflict, rGraph.conflictToTask, maxTasks, old_task,
+                  task_not_removed, std::vector< std::pair<TaskId, TaskId> >{});
+
+    rGraph.pipelineToFirstAnystg    = std::move(plToFirstAnystg);
+    rGraph.anystgToPipeline         = std::move(anystgToPipeline);
+
+    // 5. Rebuild Pipeline Tree
+
+    build_pipeline_tree(tasks, rGraph);
+}
+
+void task_critical_paths(Tasks const& tasks, TaskGraph const& graph, KeyedVec<TaskId, int64_t> const& taskCosts, KeyedVec<TaskId, int64_t> &rOut)
+{
+    std::size_t const maxTasks      = tasks.m_taskIds.capacity();
+    std::size_t const stageCount    = graph.anystgToFirstRuntask.empty() ? 0 : graph.anystgToFirstRuntask.size() - 1;
+
+    // Stages and tasks are both nodes, stages are [0, stageCount) and tasks are after.
+    // A stage node's length is its longest child's, a task node adds its own cost on top.
+
+    enum class ENodeState : uint8_t { New, Visiting, Done };
+
+    std::vector<int64_t>        nodeLength  (stageCount + maxTasks, 0);
+    std::vector<ENodeState>     nodeState   (stageCount + maxTasks, ENodeState::New);
+
+    auto const task_node = [stageCount] (TaskId const task) noexcept { return stageCount + std::size_t(task); };
+
+    // Visits the stage a pipeline goes to after leaving anystg, if any
+    auto const next_stage = [&graph] (AnyStageId const anystg, auto &&visit)
+    {
+        PipelineId const pipeline = graph.anystgToPipeline[anystg];
+        if (auto const next = AnyStageId(uint32_t(anystg) + 1);
+            next < graph.pipelineToFirstAnystg[PipelineId(uint32_t(pipeline) + 1)])
+        {
+            visit(std::size_t(next));
+        }
+    };
+
+    auto const for_each_child = [&] (std::size_t const node, auto &&visit)
+    {
+        if (node < stageCount)
+        {
+            auto const anystg = AnyStageId(node);
+
+            // Tasks that run on or sync with this stage can only start once it's reached
+            for (TaskId const task : fanout_view(graph.anystgToFirstRuntask, graph.runtaskToTask, anystg))
+            {
+                visit(task_node(task));
+            }
+            for (TaskId const task : fanout_view(graph.anystgToFirstRevTaskreqstg, graph.revTaskreqstgToTask, anystg))
+            {
+                visit(task_node(task));
+            }
+            next_stage(anystg, visit);
+        }
+        else
+        {
+            auto const task = TaskId(node - stageCount);
+            auto const [pipeline, stage] = tasks.m_taskRunOn[task];
+
+            // Stages that can't be left until this task is complete
+            next_stage(anystg_from(graph, pipeline, stage), visit);
+            for (AnyStageId const anystg : fanout_view(graph.taskToFirstRevStgreqtask, graph.revStgreqtaskToStage, task))
+            {
+                next_stage(anystg, visit);
+            }
+        }
+    };
+
+    // Depth-first without recursion, as chains of stages can get very long. Nodes are pushed
+    // again once their children are, so they can be calculated on the way back up.
+    std::vector< std::pair<std::size_t, bool> > stack;
+
+    for (TaskInt const taskInt : tasks.m_taskIds.bitview().zeros())
+    {
+        stack.emplace_back(task_node(TaskId(taskInt)), false);
+
+        while ( ! stack.empty() )
+        {
+            auto const [node, childrenPushed] = stack.back();
+            stack.pop_back();
+
+            if ( ! childrenPushed )
+            {
+                if (nodeState[node] != ENodeState::New)
+                {
+                    continue;
+                }
+                nodeState[node] = ENodeState::Visiting;
+                stack.emplace_back(node, true);
+                for_each_child(node, [&] (std::size_t const child)
+                {
+                    if (nodeState[child] == ENodeState::New)
+                    {
+                        stack.emplace_back(child, false);
+                    }
+                });
+                continue;
+            }
+
+            // Children still being visited are part of a cycle, and are ignored
+            int64_t longestChild = 0;
+            for_each_child(node, [&] (std::size_t const child)
+            {
+                if (nodeState[child] == ENodeState::Done)
+                {
+                    longestChild = std::max(longestChild, nodeLength[child]);
+                }
+            });
+
+            if (node < stageCount)
+            {
+                nodeLength[node] = longestChild;
+            }
+            else
+            {
+                auto const task = TaskId(node - stageCount);
+                int64_t const cost = (std::size_t(task) < taskCosts.size()) ? taskCosts[task] : 0;
+                nodeLength[node] = std::max<int64_t>(cost, 1) + longestChild;
+            }
+            nodeState[node] = ENodeState::Done;
+        }
+    }
+
+    rOut.assign(maxTasks, 0);
+    for (TaskInt const taskInt : tasks.m_taskIds.bitview().zeros())
+    {
+        rOut[TaskId(taskInt)] = nodeLength[task_node(TaskId(taskInt))];
+    }
+}
+
+/**
+ * @brief Chain together fusable tasks that run on the same stage and sync with the same stages
+ *
+ * The first task of each chain is the one with the lowest ID. The rest are set in rFollowers,
+ * to be left out of the graph.
+ *
+ * @param fuseGroups    [in] Only tasks in the same group are fused, tasks past its end are group 0
+ * @param candidates    [in] Tasks allowed to be fused, fusable tasks outside of this are ignored
+ * @param rOut          [ref] Graph to write taskFusedNext of, already sized to maxTasks
+ * @param rFollowers    [ref] Set for each task that is not first in its chain
+ */
+static void fuse_tasks(Tasks const& tasks, ArrayView<TaskEdges const* const> const data, KeyedVec<TaskId, uint32_t> const& fuseGroups, BitVector_t const& candidates, TaskGraph &rOut, BitVector_t &rFollowers)
+{
+    std::size_t const maxTasks = tasks.m_taskIds.capacity();
+
+    BitVector_t fusable;
+    bitvector_resize(fusable, maxTasks);
+
+    for (TaskEdges const* pEdges : data)
+    {
+        for (TaskId const task : pEdges->m_fusable)
+        {
+            if (candidates.test(std::size_t(task)))
+            {
+                fusable.set(std::size_t(task));
+            }
+        }
+    }
+
+    // Semaphores and pipeline schedulers need the executor to see each task complete on its own
+    for (TaskEdges const* pEdges : data)
+    {
+        for (auto const [task, sema] : pEdges->m_semaphoreEdges)
+        {
+            fusable.reset(std::size_t(task));
+        }
+    }
+    for (PipelineInt const plInt : tasks.m_pipelineIds.bitview().zeros())
+    {
+        TaskId const scheduler = tasks.m_pipelineControl[PipelineId(plInt)].scheduler;
+        if (scheduler != lgrn::id_null<TaskId>())
+        {
+            fusable.reset(std::size_t(scheduler));
+        }
+    }
+
+    // Key each fusable task by its group and the stage it runs on, followed by stages it syncs
+    // with, sorted
+
+    auto const stage_key = [] (PipelineId const pipeline, StageId const stage) noexcept
+    {
+        return (uint64_t(pipeline) << 8) | uint64_t(stage);
+    };
+
+    std::vector< std::pair<TaskId, uint64_t> > syncs;
+    for (TaskEdges const* pEdges : data)
+    {
+        for (auto const [task, pipeline, stage] : pEdges->m_syncWith)
+        {
+            if (fusable.test(std::size_t(task)))
+            {
+                syncs.emplace_back(task, stage_key(pipeline, stage));
+            }
+        }
+    }
+    std::sort(syncs.begin(), syncs.end());
+
+    std::map<std::vector<uint64_t>, TaskId> lastInChain;
+    std::vector<uint64_t>                   key;
+    auto                                    syncIt = syncs.begin();
+
+    for (std::size_t const taskInt : fusable.ones())
+    {
+        auto const task = TaskId(taskInt);
+        auto const [runPipeline, runStage] = tasks.m_taskRunOn[task];
+
+        key.clear();
+        key.push_back((taskInt < fuseGroups.size()) ? fuseGroups[task] : 0);
+        key.push_back(stage_key(runPipeline, runStage));
+        for (; syncIt != syncs.end() && syncIt->first == task; ++syncIt)
+        {
+            key.push_back(syncIt->second);
+        }
+
+        auto const [it, isFirst] = lastInChain.try_emplace(key, task);
+        if ( ! isFirst )
+        {
+            rOut.taskFusedNext[it->second] = task;
+            it->second = task;
+            rFollowers.set(taskInt);
+        }
+    }
+}
+
+static void build_pipeline_tree(Tasks const& tasks, TaskGraph &rOut)
+{
+    std::size_t const maxPipelines = tasks.m_pipelineIds.capacity();
+
+    KeyedVec<PipelineId, PipelineTreeLinks> plLinks;
+    BitVector_t                             plInTree;
+
+    plLinks.resize(maxPipelines);
+    bitvector_resize(plInTree, maxPipelines);
+
+    // 1. Map out children and siblings in tree
+
+    for (PipelineInt const childPlInt : tasks.m_pipelineIds.bitview().zeros())
+    {
+        PipelineId const child  = PipelineId(childPlInt);
+        PipelineId const parent = tasks.m_pipelineParents[child];
+
+        if (parent != lgrn::id_null<PipelineId>())
+        {
+            plInTree.set(std::size_t(parent));
+            plInTree.set(std::size_t(child));
+
+            PipelineTreeLinks &rChildLinks  = plLinks[child];
+            PipelineTreeLinks &rParentLinks = plLinks[parent];
+
+            if (rParentLinks.firstChild != lgrn::id_null<PipelineId>())
+            {
+                rChildLinks.sibling = rParentLinks.firstChild;
+            }
+
+            rParentLinks.firstChild = child;
+        }
+    }
+
+    std::size_t const treeSize = plInTree.count();
+
+    // 2. Allocate
+
+    rOut.pltreeDescendantCounts .assign(treeSize,       0);
+    rOut.pltreeToPipeline       .assign(treeSize,       lgrn::id_null<PipelineId>());
+    rOut.pipelineToPltree       .assign(maxPipelines,   lgrn::id_null<PipelineTreePos_t>());
+    rOut.pipelineToLoopScope    .assign(maxPipelines,   lgrn::id_null<PipelineTreePos_t>());
+
+    // 3. Add each subtree
 
     auto const add_subtree = [&] (auto const& self, PipelineId const root, PipelineId const firstChild, PipelineTreePos_t const loopScope, PipelineTreePos_t const pos) -> uint32_t
     {
         bool const        rootLoops    = tasks.m_pipelineControl[root].isLoopScope;
         PipelineTreePos_t newLoopScope = rootLoops ? pos : loopScope;
 
-        out.pltreeToPipeline[pos]     = root;
-        out.pipelineToPltree[root]    = pos;
-        out.pipelineToLoopScope[root] = newLoopScope;
+        rOut.pltreeToPipeline[pos]     = root;
+        rOut.pipelineToPltree[root]    = pos;
+        rOut.pipelineToLoopScope[root] = newLoopScope;
 
         uint32_t descendantCount = 0;
 
@@ -356,16 +999,16 @@ TaskGraph make_exec_graph(Tasks const& tasks, ArrayView<TaskEdges const* const>
 
         while (child != lgrn::id_null<PipelineId>())
         {
-            PipelineCounts const&   rChildCounts    = plCounts[child];
+            PipelineTreeLinks const& rChildLinks = plLinks[child];
 
-            uint32_t const childDescendantCount = self(self, child, rChildCounts.firstChild, newLoopScope, childPos);
+            uint32_t const childDescendantCount = self(self, child, rChildLinks.firstChild, newLoopScope, childPos);
             descendantCount += 1 + childDescendantCount;
 
-            child = rChildCounts.sibling;
+            child = rChildLinks.sibling;
             childPos += 1 + childDescendantCount;
         }
 
-        out.pltreeDescendantCounts[pos] = descendantCount;
+        rOut.pltreeDescendantCounts[pos] = descendantCount;
 
         return descendantCount;
     };
@@ -382,14 +1025,10 @@ TaskGraph make_exec_graph(Tasks const& tasks, ArrayView<TaskEdges const* const>
 
         // For each root pipeline
 
-        PipelineCounts const& rRootCounts = plCounts[pipeline];
-
-        uint32_t const rootDescendantCount = add_subtree(add_subtree, pipeline, rRootCounts.firstChild, lgrn::id_null<PipelineTreePos_t>(), rootPos);
+        uint32_t const rootDescendantCount = add_subtree(add_subtree, pipeline, plLinks[pipeline].firstChild, lgrn::id_null<PipelineTreePos_t>(), rootPos);
 
         rootPos += 1 + rootDescendantCount;
     }
-
-    return out;
 }
 
 } // namespace osp
@@ -35,6 +35,7 @@
 #include <cstdint>
 #include <ostream>
 #include <string_view>
+#include <utility>
 #include <variant>
 #include <vector>
 
@@ -142,7 +143,11 @@ struct TaskEdges
 {
     std::vector<TplTaskPipelineStage>   m_syncWith;
 
-    //std::vector<TplTaskSemaphore>       m_semaphoreEdges;
+    std::vector<TplTaskSemaphore>       m_semaphoreEdges;
+
+    /// Tasks cheap enough to run back to back with others on the same stage, see
+    /// TaskGraph::taskFusedNext
+    std::vector<TaskId>                 m_fusable;
 };
 
 using PipelineTreePos_t = uint32_t;
@@ -158,6 +163,11 @@ enum class ReverseStageReqTaskId    : uint32_t { };
 enum class TaskReqStageId           : uint32_t { };
 enum class ReverseTaskReqStageId    : uint32_t { };
 
+enum class TaskConflictId           : uint32_t { };
+
+enum class SemaAcquireId            : uint32_t { };
+enum class ReverseSemaAcquireId     : uint32_t { };
+
 struct StageRequiresTask
 {
     AnyStageId  ownStage    { lgrn::id_null<AnyStageId>() };
@@ -218,18 +228,108 @@ struct TaskGraph
     KeyedVec<PipelineId, PipelineTreePos_t>         pipelineToPltree;
     KeyedVec<PipelineId, PipelineTreePos_t>         pipelineToLoopScope;
 
-    // not yet used
-    //lgrn::IntArrayMultiMap<TaskInt, SemaphoreId>    taskAcquire;      /// Tasks acquire (n) Semaphores
-    //lgrn::IntArrayMultiMap<SemaphoreInt, TaskId>    semaAcquiredBy;   /// Semaphores are acquired by (n) Tasks
+    // Tasks that must not run at the same time as each other, such as ones that access the same
+    // data where at least one of them writes to it. Symmetric. Only needed for running tasks in
+    // parallel, and left empty by the make_exec_graph overload that only accepts TaskEdges.
+    // TaskId --> TaskConflictId --> many TaskId
+    KeyedVec<TaskId, TaskConflictId>                taskToFirstConflict;
+    KeyedVec<TaskConflictId, TaskId>                conflictToTask;
+
+    // Tasks acquire semaphores before they're allowed to run, and release them once complete.
+    // TaskId --> SemaAcquireId --> many SemaphoreId
+    KeyedVec<TaskId, SemaAcquireId>                 taskToFirstSemaacq;
+    KeyedVec<SemaAcquireId, SemaphoreId>            semaacqToSema;
+    // Semaphores need to know which tasks acquire them, to wake them up once released
+    // SemaphoreId --> ReverseSemaAcquireId --> many TaskId
+    KeyedVec<SemaphoreId, ReverseSemaAcquireId>     semaToFirstRevSemaacq;
+    KeyedVec<ReverseSemaAcquireId, TaskId>          revSemaacqToTask;
+
+    // Fusable tasks that run on the same stage and sync with the same stages are chained into a
+    // single dispatch. Only the first task of each chain is in the graph, so only it is queued and
+    // completed. Executors run the whole chain back to back in its place, see top_run_fused.
+    // Tasks that acquire semaphores or schedule pipelines are never fused.
+    // TaskId --> next TaskId in the same chain, or null
+    KeyedVec<TaskId, TaskId>                        taskFusedNext;
 
 }; // struct TaskGraph
 
 
-TaskGraph make_exec_graph(Tasks const& tasks, ArrayView<TaskEdges const* const> data);
+/**
+ * @brief Make a TaskGraph from Tasks and the edges between them
+ *
+ * @param fuseGroups [in] Group of each task, only fusable tasks in the same group are fused
+ *                        together. Tasks past its end are group 0, so leave it empty to allow
+ *                        fusing any fusable tasks.
+ */
+TaskGraph make_exec_graph(Tasks const& tasks, ArrayView<TaskEdges const* const> data, KeyedVec<TaskId, uint32_t> const& fuseGroups = {});
+
+inline TaskGraph make_exec_graph(Tasks const& tasks, std::initializer_list<TaskEdges const* const> data, KeyedVec<TaskId, uint32_t> const& fuseGroups = {})
+{
+    return make_exec_graph(tasks, arrayView(data), fuseGroups);
+}
+
+/**
+ * @brief Tasks and Pipelines to add to or remove from an existing TaskGraph
+ *
+ * IDs can be both removed and added, in case they were reused.
+ */
+struct TaskGraphChanges
+{
+    ArrayView<TaskId const>     tasksAdded;
+    ArrayView<PipelineId const> pipelinesAdded;
+    ArrayView<TaskId const>     tasksRemoved;
+    ArrayView<PipelineId const> pipelinesRemoved;
+};
+
+/**
+ * @brief Add and remove Tasks and Pipelines from a TaskGraph, without rebuilding it from scratch
+ *
+ * Existing entries are copied over as-is, only edges of added tasks are read from data. This
+ * allows adding or closing a session without recounting every other TaskEdge. The pipeline
+ * tree is rebuilt, as it only depends on the number of pipelines.
+ *
+ * Edges of removed tasks must be erased from data before their TaskIds are reused.
+ *
+ * Pipelines never lose stages here, even if the tasks that needed them were removed. Empty
+ * stages are skipped over, so this only makes the graph slightly bigger than make_exec_graph's.
+ *
+ * Added tasks are only fused with each other. Existing fused chains are kept, minus removed
+ * tasks. If the first task of a chain is removed, the rest of it is re-added.
+ *
+ * @param rGraph    [ref] TaskGraph to update, may be empty to build a new one
+ * @param tasks     [in] Tasks, with added tasks and pipelines already created, and removed
+ *                       ones already removed
+ * @param data      [in] Edges to search for the edges of added tasks
+ * @param changes   [in] Tasks and pipelines added or removed since rGraph was made
+ * @param fuseGroups [in] Group of each task, see make_exec_graph
+ */
+void update_exec_graph(TaskGraph &rGraph, Tasks const& tasks, ArrayView<TaskEdges const* const> data, TaskGraphChanges const& changes, KeyedVec<TaskId, uint32_t> const& fuseGroups = {});
+
+inline void update_exec_graph(TaskGraph &rGraph, Tasks const& tasks, std::initializer_list<TaskEdges const* const> data, TaskGraphChanges const& changes, KeyedVec<TaskId, uint32_t> const& fuseGroups = {})
+{
+    update_exec_graph(rGraph, tasks, arrayView(data), changes, fuseGroups);
+}
+
+/**
+ * @brief Calculate the critical path length of each task; the longest chain of task costs that
+ *        has to run after the task starts, up until its pipelines finish
+ *
+ * A task holds back the next stage of the pipeline it runs on, and the next stages of pipelines
+ * it syncs with. Each of these stages then holds back its own tasks, and so on. Loops are not
+ * followed, so this only covers a single iteration.
+ *
+ * @param taskCosts [in] Measured cost of each task, eg. nanoseconds taken to run. Tasks without
+ *                       a cost count as 1, so chains of unmeasured tasks are compared by length.
+ * @param rOut      [out] Critical path length of each task, including its own cost
+ */
+void task_critical_paths(Tasks const& tasks, TaskGraph const& graph, KeyedVec<TaskId, int64_t> const& taskCosts, KeyedVec<TaskId, int64_t> &rOut);
 
-inline TaskGraph make_exec_graph(Tasks const& tasks, std::initializer_list<TaskEdges const* const> data)
+/**
+ * @return Next task fused after task, or null if it's the last of its chain or not fused
+ */
+[[nodiscard]] inline TaskId fused_next(TaskGraph const& graph, TaskId const task) noexcept
 {
-    return make_exec_graph(tasks, arrayView(data));
+    return (std::size_t(task) < graph.taskFusedNext.size()) ? graph.taskFusedNext[task] : lgrn::id_null<TaskId>();
 }
 
 template <typename KEY_T, typename VALUE_T, typename GETSIZE_T, typename CLAIM_T>
@@ -284,6 +384,70 @@ inline decltype(auto) fanout_view(KeyedVec<KEY_T, VALUE_T> const& vec, KeyedVec<
 }
 
 
+/**
+ * @brief Rebuild a one-to-many fanout with some values removed and others added
+ *
+ * @param rFirst    [ref] Key to first value ID, same as for fanout_partition
+ * @param rValues   [ref] Values
+ * @param keyCount  [in] New number of keys, excluding the extra one at the end
+ * @param old_key   [in] Function (KEY_T newKey) -> KEY_T, returns key of existing values to copy
+ *                       over, or null if newKey is new
+ * @param keep      [in] Function (VALUE_T& rValue) -> bool, returns false to remove a value.
+ *                       Can modify rValue to remap it.
+ * @param added     [in] Values to add, sorted by key
+ */
+template <typename KEY_T, typename ID_T, typename VALUE_T, typename OLDKEY_T, typename KEEP_T>
+void fanout_splice(
+        KeyedVec<KEY_T, ID_T>                           &rFirst,
+        KeyedVec<ID_T, VALUE_T>                         &rValues,
+        std::size_t const                               keyCount,
+        OLDKEY_T                                        &&old_key,
+        KEEP_T                                          &&keep,
+        std::vector< std::pair<KEY_T, VALUE_T> > const  &added)
+{
+    using key_int_t     = lgrn::underlying_int_type_t<KEY_T>;
+    using id_int_t      = lgrn::underlying_int_type_t<ID_T>;
+
+    KeyedVec<KEY_T, ID_T>   first;
+    KeyedVec<ID_T, VALUE_T> values;
+
+    first.resize(keyCount + 1);
+    values.reserve(rValues.size() + added.size());
+
+    auto addedIt = added.begin();
+
+    for (key_int_t i = 0; i < keyCount; ++i)
+    {
+        auto const key = KEY_T(i);
+
+        first[key] = ID_T(id_int_t(values.size()));
+
+        if (KEY_T const oldKey = old_key(key);
+            oldKey != lgrn::id_null<KEY_T>())
+        {
+            for (VALUE_T value : fanout_view(rFirst, rValues, oldKey))
+            {
+                if (keep(value))
+                {
+                    values.push_back(value);
+                }
+            }
+        }
+
+        for ( ; addedIt != added.end() && addedIt->first == key; ++addedIt)
+        {
+            values.push_back(addedIt->second);
+        }
+    }
+
+    first[KEY_T(key_int_t(keyCount))] = ID_T(id_int_t(values.size()));
+
+    LGRN_ASSERTM(addedIt == added.end(), "Added values must be sorted by key, and keys must be less than keyCount");
+
+    rFirst  = std::move(first);
+    rValues = std::move(values);
+}
+
 template <typename KEY_T, typename VALUE_T>
 inline VALUE_T id_from_count(KeyedVec<KEY_T, VALUE_T> const& vec, KEY_T const key, lgrn::underlying_int_type_t<VALUE_T> const count)
 {
@@ -0,0 +1,376 @@
+/**
+ * Open Space Program
+ * Copyright © 2019-2023 Open Space Program Project
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include "top_worker.h"
+#include "worker_pool.h"
+
+#include <longeron/utility/asserts.hpp>
+
+#include <atomic>
+#include <concepts>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <utility>
+
+namespace osp
+{
+
+/**
+ * @brief Coroutine that a task can step through over several frames
+ *
+ * Tasks can't block, as that would hold up the whole exec_update loop. Work that doesn't fit in
+ * one frame (loading files, compiling meshes, large spawns, ...) can instead be written as a
+ * coroutine that returns TopCoTask, and co_awaits one of:
+ *
+ * * co_next_step()             Continue the next time the coroutine is stepped
+ * * co_step_point(point)       Continue the next time the coroutine is stepped from point
+ * * co_until(pred)             Continue once pred() returns true
+ * * co_background(ctx, func)   Run func on the WorkerPool, and continue once it's done
+ *
+ * The coroutine itself is stored in TopData, and is stepped by tasks calling co_step. A task
+ * that keeps running every frame then resumes the coroutine once per frame. Multiple tasks on
+ * different pipelines can step the same coroutine from different points, which lets it continue
+ * on a stage of another pipeline through co_step_point.
+ *
+ * Owns the coroutine frame; move-only. An empty TopCoTask is not running anything.
+ */
+class TopCoTask
+{
+public:
+
+    struct promise_type
+    {
+        using ReadyFunc_t = bool(*)(void *pUser) noexcept;
+        using WaitFunc_t  = void(*)(void *pUser) noexcept;
+
+        TopCoTask get_return_object() noexcept
+        {
+            return TopCoTask{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+
+        void return_void() noexcept { }
+
+        // Tasks are noexcept
+        void unhandled_exception() noexcept { std::terminate(); }
+
+        /// Only resume once this returns true, if not null
+        ReadyFunc_t     readyFunc   { nullptr };
+        void            *pReadyUser { nullptr };
+
+        /// If not null, called with pReadyUser before the frame is destroyed, to cancel or wait
+        /// for work on other threads that still uses the frame
+        WaitFunc_t      waitFunc    { nullptr };
+
+        /// Only resume when stepped from this point
+        uint32_t        point       { 0 };
+    };
+
+    using Handle_t = std::coroutine_handle<promise_type>;
+
+    constexpr TopCoTask() noexcept = default;
+    explicit TopCoTask(Handle_t handle) noexcept : m_handle{handle} { }
+    TopCoTask(TopCoTask const& copy) = delete;
+    TopCoTask(TopCoTask&& move) noexcept : m_handle{std::exchange(move.m_handle, nullptr)} { }
+    TopCoTask& operator=(TopCoTask const& copy) = delete;
+    TopCoTask& operator=(TopCoTask&& move) noexcept
+    {
+        destroy();
+        m_handle = std::exchange(move.m_handle, nullptr);
+        return *this;
+    }
+    ~TopCoTask() { destroy(); }
+
+    /**
+     * @return true if a coroutine was started and has not finished yet
+     */
+    [[nodiscard]] bool running() const noexcept { return m_handle != nullptr; }
+
+    explicit operator bool() const noexcept { return running(); }
+
+    /**
+     * @brief Resume the coroutine if it's waiting on point and whatever it awaits is ready
+     *
+     * @return true if the coroutine finished, or wasn't running
+     */
+    bool step(uint32_t const point = 0) noexcept
+    {
+        if (m_handle == nullptr)
+        {
+            return true;
+        }
+
+        promise_type &rPromise = m_handle.promise();
+
+        if (rPromise.point != point)
+        {
+            return false;
+        }
+
+        if (rPromise.readyFunc != nullptr)
+        {
+            if ( ! rPromise.readyFunc(rPromise.pReadyUser) )
+            {
+                return false;
+            }
+            rPromise.readyFunc  = nullptr;
+            rPromise.pReadyUser = nullptr;
+            rPromise.waitFunc   = nullptr;
+        }
+
+        m_handle.resume();
+
+        if (m_handle.done())
+        {
+            destroy();
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief Destroy the coroutine frame, stopping the coroutine wherever it is suspended
+     *
+     * A pending co_background job is cancelled if no thread has started it yet. If it's already
+     * running, this blocks until it returns, as it may use variables in the coroutine frame.
+     */
+    void destroy() noexcept
+    {
+        if (m_handle != nullptr)
+        {
+            promise_type &rPromise = m_handle.promise();
+            if (rPromise.waitFunc != nullptr)
+            {
+                rPromise.waitFunc(rPromise.pReadyUser);
+            }
+            m_handle.destroy();
+            m_handle = nullptr;
+        }
+    }
+
+private:
+
+    Handle_t m_handle;
+
+}; // class TopCoTask
+
+/**
+ * @brief Step the coroutine in rCo, starting it with startFunc() first if it isn't running
+ *
+ * Intended to be called from a task function, once each time the task runs. A newly started
+ * coroutine runs right away until its first co_await, regardless of point.
+ *
+ * @param rCo       [ref] Coroutine, usually stored in TopData
+ * @param startFunc [in] Returns a new TopCoTask, only called if rCo isn't running
+ * @param point     [in] Resumes the coroutine only if it's waiting on this point
+ *
+ * @return true if the coroutine finished during this step
+ */
+template <std::invocable FUNC_T>
+bool co_step(TopCoTask &rCo, FUNC_T &&startFunc, uint32_t const point = 0) noexcept
+{
+    if ( ! rCo.running() )
+    {
+        rCo = startFunc();
+        return rCo.step(0);
+    }
+    return rCo.step(point);
+}
+
+/**
+ * @brief Step the coroutine in rCo from point, without starting a new one
+ *
+ * @return true if the coroutine finished during this step, or wasn't running
+ */
+inline bool co_step(TopCoTask &rCo, uint32_t const point = 0) noexcept
+{
+    return rCo.step(point);
+}
+
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Awaitable to continue from a certain step point, see co_step_point and co_next_step
+ */
+struct TopCoAwaitPoint
+{
+    constexpr bool await_ready() const noexcept { return false; }
+    void await_suspend(TopCoTask::Handle_t handle) const noexcept { handle.promise().point = point; }
+    constexpr void await_resume() const noexcept { }
+
+    uint32_t point;
+};
+
+/**
+ * @brief co_await to continue the next time the coroutine is stepped from point 0, usually the
+ *        next frame
+ */
+[[nodiscard]] constexpr TopCoAwaitPoint co_next_step() noexcept
+{
+    return {0};
+}
+
+/**
+ * @brief co_await to continue the next time the coroutine is stepped from point, usually by a
+ *        task on a stage of another pipeline
+ */
+[[nodiscard]] constexpr TopCoAwaitPoint co_step_point(uint32_t const point) noexcept
+{
+    return {point};
+}
+
+/**
+ * @brief Awaitable to continue once a predicate returns true, see co_until
+ */
+template <typename PRED_T>
+struct TopCoAwaitUntil
+{
+    bool await_ready() noexcept { return pred(); }
+
+    void await_suspend(TopCoTask::Handle_t handle) noexcept
+    {
+        TopCoTask::promise_type &rPromise = handle.promise();
+        rPromise.point      = 0;
+        rPromise.readyFunc  = [] (void *pUser) noexcept -> bool
+        {
+            return static_cast<TopCoAwaitUntil*>(pUser)->pred();
+        };
+        rPromise.pReadyUser = this;
+    }
+
+    constexpr void await_resume() const noexcept { }
+
+    PRED_T pred;
+};
+
+/**
+ * @brief co_await to continue once pred() returns true
+ *
+ * pred is checked right away, then each time the coroutine is stepped from point 0.
+ */
+template <typename PRED_T>
+[[nodiscard]] TopCoAwaitUntil<std::decay_t<PRED_T>> co_until(PRED_T &&pred) noexcept
+{
+    return {std::forward<PRED_T>(pred)};
+}
+
+/**
+ * @brief Awaitable to run a function on the WorkerPool, see co_background
+ */
+template <typename FUNC_T>
+struct TopCoAwaitBackground
+{
+    TopCoAwaitBackground(WorkerContext ctx_, FUNC_T func_) : ctx{ctx_}, func{std::move(func_)} { }
+    TopCoAwaitBackground(TopCoAwaitBackground const& copy) = delete;
+    TopCoAwaitBackground(TopCoAwaitBackground&& move) = delete;
+
+    ~TopCoAwaitBackground()
+    {
+        LGRN_ASSERTM(pDone->load(std::memory_order_acquire),
+                     "Coroutine destroyed while its background job is still running");
+    }
+
+    bool await_ready() noexcept
+    {
+        if (ctx.pPool == nullptr)
+        {
+            func(); // No pool to run on, just do it now
+            pDone->store(true, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+
+    void await_suspend(TopCoTask::Handle_t handle) noexcept
+    {
+        TopCoTask::promise_type &rPromise = handle.promise();
+        rPromise.point      = 0;
+        rPromise.readyFunc  = [] (void *pUser) noexcept -> bool
+        {
+            return static_cast<TopCoAwaitBackground*>(pUser)->pDone->load(std::memory_order_acquire);
+        };
+        rPromise.waitFunc   = &TopCoAwaitBackground::cancel_or_wait;
+        rPromise.pReadyUser = this;
+
+        ctx.pPool->push(ctx.worker, job());
+    }
+
+    constexpr void await_resume() const noexcept { }
+
+    WorkerJob job() noexcept
+    {
+        return {&TopCoAwaitBackground::run, this, 0};
+    }
+
+    static void run(void *pUser, uint64_t, WorkerId) noexcept
+    {
+        auto &rThis = *static_cast<TopCoAwaitBackground*>(pUser);
+
+        // The coroutine frame holding rThis may be destroyed as soon as done is set, so keep the
+        // flag alive on its own to notify waiters
+        std::shared_ptr<std::atomic<bool>> const pDone = rThis.pDone;
+        rThis.func();
+        pDone->store(true, std::memory_order_release);
+        pDone->notify_all();
+    }
+
+    static void cancel_or_wait(void *pUser) noexcept
+    {
+        auto &rThis = *static_cast<TopCoAwaitBackground*>(pUser);
+        if (rThis.ctx.pPool->try_cancel(rThis.ctx.worker, rThis.job()))
+        {
+            rThis.pDone->store(true, std::memory_order_relaxed); // Never started, nothing to wait for
+            return;
+        }
+        rThis.pDone->wait(false, std::memory_order_acquire);
+    }
+
+    WorkerContext                       ctx;
+    FUNC_T                              func;
+    std::shared_ptr<std::atomic<bool>>  pDone { std::make_shared<std::atomic<bool>>(false) };
+};
+
+/**
+ * @brief co_await to call func() on a thread of the WorkerPool in ctx, and continue once it
+ *        returns
+ *
+ * The job runs alongside tasks of the following frames, so func must not touch TopData that
+ * other tasks use. func is called right away if ctx has no pool.
+ *
+ * @param ctx   [in] WorkerContext passed to the task that started the coroutine
+ * @param func  [in] Function to call, noexcept
+ */
+template <typename FUNC_T>
+[[nodiscard]] TopCoAwaitBackground<std::decay_t<FUNC_T>> co_background(WorkerContext const ctx, FUNC_T &&func)
+{
+    return {ctx, std::forward<FUNC_T>(func)};
+}
+
+} // namespace osp
@@ -32,15 +32,229 @@
 
 #include <algorithm>
 #include <iomanip>
+#include <variant>
 #include <vector>
 
 namespace osp
 {
 
-void top_run_blocking(Tasks const& tasks, TaskGraph const& graph, TopTaskDataVec_t& rTaskData, ArrayView<entt::any> topData, ExecContext& rExec, WorkerContext worker)
+static void make_conflicts(Tasks const& tasks, TopTaskDataVec_t const& taskData, TaskGraph &rOut);
+
+static KeyedVec<TaskId, uint32_t> make_fuse_groups(TopTaskDataVec_t const& taskData);
+
+TaskGraph make_exec_graph(Tasks const& tasks, ArrayView<TaskEdges const* const> data, TopTaskDataVec_t const& taskData)
+{
+    TaskGraph out = make_exec_graph(tasks, data, make_fuse_groups(taskData));
+    make_conflicts(tasks, taskData, out);
+    return out;
+}
+
+void update_exec_graph(TaskGraph &rGraph, Tasks const& tasks, ArrayView<TaskEdges const* const> data, TopTaskDataVec_t const& taskData, TaskGraphChanges const& changes)
+{
+    update_exec_graph(rGraph, tasks, data, changes, make_fuse_groups(taskData));
+
+    // Conflicts only depend on which TopData each task accesses, not on edges. Any added task can
+    // conflict with any existing one, so just recalculate them all.
+    make_conflicts(tasks, taskData, rGraph);
+}
+
+static KeyedVec<TaskId, uint32_t> make_fuse_groups(TopTaskDataVec_t const& taskData)
 {
-    std::vector<entt::any> topDataRefs;
+    // A fused chain runs on whichever thread runs its first task, so only tasks that must run on
+    // the same thread are fused together. Lanes only matter for ETopAffinity::Lane.
+    KeyedVec<TaskId, uint32_t> out;
+    out.resize(taskData.size(), 0);
+    for (std::size_t i = 0; i < taskData.size(); ++i)
+    {
+        TopTask const &rTopTask = taskData[TaskId(i)];
+        uint32_t const lane     = (rTopTask.m_affinity == ETopAffinity::Lane) ? rTopTask.m_lane : 0;
+        out[TaskId(i)] = (uint32_t(rTopTask.m_affinity) << 8) | lane;
+    }
+    return out;
+}
+
+static void make_conflicts(Tasks const& tasks, TopTaskDataVec_t const& taskData, TaskGraph &rOut)
+{
+    std::size_t const maxTasks = tasks.m_taskIds.capacity();
+
+    // 1. List which tasks read and write each TopDataId
+
+    std::vector< std::vector<TaskId> > dataReaders;
+    std::vector< std::vector<TaskId> > dataWriters;
+
+    for (TaskInt const taskInt : tasks.m_taskIds.bitview().zeros())
+    {
+        auto const task = TaskId(taskInt);
+        if (taskInt >= taskData.size())
+        {
+            continue;
+        }
+
+        TopTask const &rTopTask = taskData[task];
+
+        for (std::size_t i = 0; i < rTopTask.m_dataUsed.size(); ++i)
+        {
+            TopDataId const dataId = rTopTask.m_dataUsed[i];
+            if (dataId == lgrn::id_null<TopDataId>())
+            {
+                continue;
+            }
+
+            if (dataId >= dataReaders.size())
+            {
+                dataReaders.resize(dataId + 1);
+                dataWriters.resize(dataId + 1);
+            }
+
+            auto &rTasks = (rTopTask.data_access(i) == ETopDataAccess::Write) ? dataWriters : dataReaders;
+            rTasks[dataId].push_back(task);
+        }
+    }
+
+    // 2. Fused tasks are dispatched as their first task of their chain, which takes on the
+    //    conflicts of the whole chain
+
+    KeyedVec<TaskId, TaskId> fusedFirst;
+    fusedFirst.resize(maxTasks, lgrn::id_null<TaskId>());
+
+    for (TaskInt const taskInt : tasks.m_taskIds.bitview().zeros())
+    {
+        auto const task = TaskId(taskInt);
+        if (fusedFirst[task] != lgrn::id_null<TaskId>())
+        {
+            continue; // Already visited as part of a chain
+        }
+        for (TaskId member = task; member != lgrn::id_null<TaskId>(); member = fused_next(rOut, member))
+        {
+            fusedFirst[member] = task;
+        }
+    }
+
+    // 3. Find conflicts for each task. Tasks are visited in order, so conflicts can be written
+    //    directly into conflictToTask in the same order fanout_partition assigns them in.
+
+    KeyedVec<TaskId, uint32_t>  conflictCounts;
+    std::vector<TaskId>         taskConflicts;
+
+    conflictCounts.resize(maxTasks+1, 0);
+    rOut.taskToFirstConflict.assign(maxTasks+1, TaskConflictId(0));
+    rOut.conflictToTask.clear();
+
+    for (TaskInt const taskInt : tasks.m_taskIds.bitview().zeros())
+    {
+        auto const task = TaskId(taskInt);
+        if (taskInt >= taskData.size() || fusedFirst[task] != task)
+        {
+            continue;
+        }
+
+        taskConflicts.clear();
+
+        for (TaskId member = task; member != lgrn::id_null<TaskId>(); member = fused_next(rOut, member))
+        {
+            TopTask const &rTopTask = taskData[member];
+
+            for (std::size_t i = 0; i < rTopTask.m_dataUsed.size(); ++i)
+            {
+                TopDataId const dataId = rTopTask.m_dataUsed[i];
+                if (dataId == lgrn::id_null<TopDataId>())
+                {
+                    continue;
+                }
+
+                // Everything conflicts with writers. Writers also conflict with readers.
+                taskConflicts.insert(taskConflicts.end(), dataWriters[dataId].begin(), dataWriters[dataId].end());
+                if (rTopTask.data_access(i) == ETopDataAccess::Write)
+                {
+                    taskConflicts.insert(taskConflicts.end(), dataReaders[dataId].begin(), dataReaders[dataId].end());
+                }
+            }
+        }
+
+        for (TaskId &rConflict : taskConflicts)
+        {
+            rConflict = fusedFirst[rConflict];
+        }
+
+        std::sort(taskConflicts.begin(), taskConflicts.end());
+        taskConflicts.erase(std::unique(taskConflicts.begin(), taskConflicts.end()), taskConflicts.end());
+        taskConflicts.erase(std::remove(taskConflicts.begin(), taskConflicts.end(), task), taskConflicts.end());
+
+        conflictCounts[task] = uint32_t(taskConflicts.size());
+        rOut.conflictToTask.insert(rOut.conflictToTask.end(), taskConflicts.begin(), taskConflicts.end());
+    }
+
+    // 4. Partition
+
+    fanout_partition(
+        rOut.taskToFirstConflict,
+        [&conflictCounts] (TaskId task) { return conflictCounts[task]; },
+        [] (TaskId, TaskConflictId) { });
+}
+
+void top_resolve_args(Tasks const& tasks, TopTaskDataVec_t const& taskData, ArrayView<entt::any> const topData, TopTaskArgs &rOut)
+{
+    std::size_t const maxTasks = tasks.m_taskIds.capacity();
+
+    auto const arg_count = [&taskData] (TaskId const task) -> uint32_t
+    {
+        return (std::size_t(task) < taskData.size()) ? uint32_t(taskData[task].m_dataUsed.size()) : 0;
+    };
+
+    rOut.taskToFirstArg.assign(maxTasks + 1, 0);
+    fanout_partition(rOut.taskToFirstArg, [&] (TaskId const task) { return (std::size_t(task) < maxTasks) ? arg_count(task) : 0; }, [] (TaskId, uint32_t) { });
+
+    rOut.argPtrs.assign(rOut.taskToFirstArg[TaskId(uint32_t(maxTasks))], nullptr);
+    rOut.pTopData       = topData.data();
+    rOut.topDataSize    = topData.size();
+
+    for (TaskInt const taskInt : tasks.m_taskIds.bitview().zeros())
+    {
+        auto const task = TaskId(taskInt);
+        if (arg_count(task) == 0)
+        {
+            continue;
+        }
 
+        TopTask const &rTopTask = taskData[task];
+        void          **pArgs   = &rOut.argPtrs[rOut.taskToFirstArg[task]];
+
+        for (std::size_t i = 0; i < rTopTask.m_dataUsed.size(); ++i)
+        {
+            TopDataId const dataId = rTopTask.m_dataUsed[i];
+            if (dataId == lgrn::id_null<TopDataId>())
+            {
+                continue;
+            }
+
+            entt::any &rData = topData[dataId];
+
+            [[maybe_unused]] entt::id_type const expectType = (i < rTopTask.m_dataTypes.size()) ? rTopTask.m_dataTypes[i] : 0;
+            LGRN_ASSERTMV(expectType == 0 || ! rData || rData.type().hash() == expectType,
+                          "TopData type does not match task argument", rTopTask.m_debugName, dataId, i);
+
+            pArgs[i] = rData.data();
+        }
+    }
+}
+
+TaskActions top_run_fused(TaskGraph const& graph, TopTaskDataVec_t const& taskData, TopTaskArgs const& args, TaskId const task, WorkerContext const worker) noexcept
+{
+    TaskActions status;
+    for (TaskId member = task; member != lgrn::id_null<TaskId>(); member = fused_next(graph, member))
+    {
+        TopTask const &rTopTask = taskData[member];
+        if (rTopTask.m_func != nullptr)
+        {
+            status |= rTopTask.m_func(worker, top_task_args(args, member));
+        }
+    }
+    return status;
+}
+
+template <typename RUN_TASK_T>
+static void run_blocking(Tasks const& tasks, TaskGraph const& graph, ExecContext& rExec, RUN_TASK_T&& runTask)
+{
     // Run until there's no tasks left to run
     while (true)
     {
@@ -49,22 +263,24 @@ void top_run_blocking(Tasks const& tasks, TaskGraph const& graph, TopTaskDataVec
 
         if (runTasksLeft != 0)
         {
-            TaskId const task = rExec.tasksQueuedRun[0];
-            TopTask &rTopTask = rTaskData[task];
+            TaskId const task = exec_pick_task(rExec);
 
-            topDataRefs.clear();
-            topDataRefs.reserve(rTopTask.m_dataUsed.size());
-            for (TopDataId const dataId : rTopTask.m_dataUsed)
+            int64_t const traceStart = (rExec.pTrace != nullptr) ? rExec.pTrace->now() : 0;
+            int64_t const statsStart = (rExec.pStats != nullptr) ? rExec.pStats->now() : 0;
+
+            // Task function is called here
+            TaskActions const status = runTask(task);
+
+            if (rExec.pTrace != nullptr)
             {
-                topDataRefs.push_back((dataId != lgrn::id_null<TopDataId>())
-                                       ? topData[dataId].as_ref()
-                                       : entt::any{});
+                LGRN_ASSERTM( ! rExec.pTrace->lanes.empty(), "ExecTrace needs at least one lane");
+                rExec.pTrace->lanes[0].push_back({task, traceStart, rExec.pTrace->now()});
             }
 
-            bool const shouldRun = (rTopTask.m_func != nullptr);
-
-            // Task function is called here
-            TaskActions const status = shouldRun ? rTopTask.m_func(worker, topDataRefs) : TaskActions{};
+            if (rExec.pStats != nullptr)
+            {
+                stats_add_sample(rExec.pStats->tasks[task], rExec.pStats->now() - statsStart);
+            }
 
             complete_task(tasks, graph, rExec, task, status);
         }
@@ -77,6 +293,107 @@ void top_run_blocking(Tasks const& tasks, TaskGraph const& graph, TopTaskDataVec
     }
 }
 
+void top_run_blocking(Tasks const& tasks, TaskGraph const& graph, TopTaskDataVec_t& rTaskData, ArrayView<entt::any> topData, ExecContext& rExec, WorkerContext worker)
+{
+    std::vector<void*> argPtrs;
+
+    // Only look up arguments of tasks that actually run
+    run_blocking(tasks, graph, rExec, [&] (TaskId const task) -> TaskActions
+    {
+        TaskActions status;
+        for (TaskId member = task; member != lgrn::id_null<TaskId>(); member = fused_next(graph, member))
+        {
+            TopTask const &rTopTask = rTaskData[member];
+            if (rTopTask.m_func == nullptr)
+            {
+                continue;
+            }
+
+            argPtrs.clear();
+            for (TopDataId const dataId : rTopTask.m_dataUsed)
+            {
+                argPtrs.push_back((dataId != lgrn::id_null<TopDataId>()) ? topData[dataId].data() : nullptr);
+            }
+
+            status |= rTopTask.m_func(worker, argPtrs);
+        }
+        return status;
+    });
+}
+
+void top_run_blocking(Tasks const& tasks, TaskGraph const& graph, TopTaskDataVec_t const& taskData, TopTaskArgs const& args, ExecContext& rExec, WorkerContext worker)
+{
+    run_blocking(tasks, graph, rExec, [&] (TaskId const task) -> TaskActions
+    {
+        return top_run_fused(graph, taskData, args, task, worker);
+    });
+}
+
+TopReplayStatus top_replay_frame(Tasks const& tasks, TaskGraph const& graph, TopTaskDataVec_t const& taskData, TopTaskArgs const& args, ExecContext& rExec, ExecRecording const& recording, std::size_t &rCursor, WorkerContext worker)
+{
+    TopReplayStatus status;
+
+    while (rCursor < recording.events.size())
+    {
+        ExecRecording::Event_t const &event = recording.events[rCursor];
+        ++ rCursor;
+
+        if (std::holds_alternative<ExecRecording::FrameEnd>(event))
+        {
+            break;
+        }
+
+        if (status.diverged)
+        {
+            continue; // Skip the rest of the frame
+        }
+
+        if (auto const *pRun = std::get_if<ExecRecording::RunRequest>(&event))
+        {
+            exec_request_run(rExec, pRun->pipeline);
+        }
+        else if (auto const *pSignal = std::get_if<ExecRecording::Signal>(&event))
+        {
+            exec_signal(rExec, pSignal->pipeline);
+        }
+        else if (auto const *pComplete = std::get_if<ExecRecording::Complete>(&event))
+        {
+            exec_update(tasks, graph, rExec);
+
+            TaskId const task = pComplete->task;
+            if ( ! rExec.tasksQueuedRun.contains(task) )
+            {
+                status.diverged = true;
+                continue;
+            }
+
+            int64_t const statsStart = (rExec.pStats != nullptr) ? rExec.pStats->now() : 0;
+
+            TaskActions const actions = top_run_fused(graph, taskData, args, task, worker);
+
+            if (rExec.pStats != nullptr)
+            {
+                stats_add_sample(rExec.pStats->tasks[task], rExec.pStats->now() - statsStart);
+            }
+
+            complete_task(tasks, graph, rExec, task, actions);
+            ++ status.tasksRun;
+
+            status.diverged = ! (actions == pComplete->actions);
+        }
+    }
+
+    exec_update(tasks, graph, rExec);
+
+    if (status.diverged)
+    {
+        // Finish whatever is left, as a regular frame
+        top_run_blocking(tasks, graph, taskData, args, rExec, worker);
+    }
+
+    return status;
+}
+
 static void write_task_requirements(std::ostream &rStream, Tasks const& tasks, TaskGraph const& graph, ExecContext const& exec, TaskId const task)
 {
     auto const taskreqstageView = ArrayView<const TaskRequiresStage>(fanout_view(graph.taskToFirstTaskreqstg, graph.taskreqstgData, task));
@@ -204,25 +521,114 @@ std::ostream& operator<<(std::ostream& rStream, TopExecWriteState const& write)
         write_task_requirements(rStream, tasks, graph, exec, task);
     }
 
+    for (TaskId const task : exec.tasksQueuedSema)
+    {
+        rStream << "Task Waiting for Semaphore: " << "TASK" << TaskInt(task) << " - " << taskData[task].m_debugName << "\n";
+    }
+
     return rStream;
 }
 
-std::ostream& operator<<(std::ostream& rStream, TopExecWriteLog const& write)
+std::ostream& operator<<(std::ostream& rStream, TopExecWriteStall const& write)
 {
-    auto const& [tasks, taskData, graph, exec] = write;
+    auto const& [tasks, taskData, stall] = write;
 
-    auto const stage_name = [&tasks=tasks] (PipelineId pl, StageId stg) -> std::string_view
+    auto const write_stage = [&rStream, &tasks=tasks] (PipelineId const pipeline, StageId const stage)
     {
-        if (stg != lgrn::id_null<StageId>())
+        rStream << "PL" << PipelineInt(pipeline);
+
+        PipelineInfo const& info = tasks.m_pipelineInfo[pipeline];
+        if (stage == lgrn::id_null<StageId>())
         {
-            PipelineInfo const& info        = tasks.m_pipelineInfo[pl];
-            auto const          stageNames  = ArrayView<std::string_view const>{PipelineInfo::sm_stageNames[info.stageType]};
-            return stageNames[std::size_t(stg)];
+            rStream << "[-]";
+        }
+        else if (info.stageType < PipelineInfo::sm_stageNames.size())
+        {
+            auto const stageNames = ArrayView<std::string_view const>{PipelineInfo::sm_stageNames[info.stageType]};
+            rStream << '[' << stageNames[std::size_t(stage)] << ']';
         }
         else
+        {
+            rStream << '[' << int(stage) << ']';
+        }
+    };
+
+    auto const write_task = [&rStream, &taskData=taskData] (TaskId const task)
+    {
+        rStream << "TASK" << TaskInt(task) << " '" << taskData[task].m_debugName << "'";
+    };
+
+    if (stall.chain.empty())
+    {
+        return rStream << "No stall";
+    }
+
+    rStream << (stall.cycle ? "Deadlock: " : "Stall: ");
+
+    for (ExecWait const& wait : stall.chain)
+    {
+        write_stage(wait.pipeline, wait.stage);
+        rStream << " (";
+        switch (wait.reason)
+        {
+        case ExecWait::EReason::TaskReqStage:
+            write_task(wait.task);
+            rStream << " needs ";
+            write_stage(wait.waitsFor, wait.waitsForStage);
+            break;
+        case ExecWait::EReason::StageReqTask:
+            rStream << "stage needs ";
+            write_task(wait.task);
+            rStream << " to finish";
+            break;
+        case ExecWait::EReason::StageReqByTask:
+            rStream << "stage held for ";
+            write_task(wait.task);
+            break;
+        case ExecWait::EReason::Semaphore:
+            write_task(wait.task);
+            rStream << " waits for a semaphore";
+            break;
+        }
+        rStream << ") -> ";
+    }
+
+    ExecWait const& last = stall.chain.back();
+    if (stall.cycle)
+    {
+        write_stage(stall.chain.front().pipeline, stall.chain.front().stage);
+    }
+    else if (last.reason == ExecWait::EReason::Semaphore)
+    {
+        rStream << "nothing left to release it";
+    }
+    else
+    {
+        rStream << "PL" << PipelineInt(last.waitsFor) << " already finished";
+    }
+
+    return rStream;
+}
+
+std::ostream& operator<<(std::ostream& rStream, TopExecWriteLog const& write)
+{
+    auto const& [tasks, taskData, graph, exec, history] = write;
+
+    auto const stage_name = [&tasks=tasks] (PipelineId pl, StageId stg) -> std::string_view
+    {
+        if (stg == lgrn::id_null<StageId>())
         {
             return "NULL";
         }
+
+        PipelineInfo const& info = tasks.m_pipelineInfo[pl];
+        if (info.stageType >= PipelineInfo::sm_stageNames.size())
+        {
+            return "?";
+        }
+
+        auto const stageNames = ArrayView<std::string_view const>{PipelineInfo::sm_stageNames[info.stageType]};
+        return (std::size_t(stg) < stageNames.size()) ? stageNames[std::size_t(stg)] : "?";
     };
 
     auto const visitMsg = [&rStream, &tasks=tasks, &taskData=taskData, &graph=graph, &stage_name] (auto&& msg)
@@ -283,6 +689,14 @@ std::ostream& operator<<(std::ostream& rStream, TopExecWriteLog const& write)
         {
             rStream << "    * Unblock TASK" << TaskInt(msg.task) << "\n";
         }
+        else if constexpr (std::is_same_v<MSG_T, ExecContext::SemaphoreWait>)
+        {
+            rStream << "    * Wait for semaphore TASK" << TaskInt(msg.task) << "\n";
+        }
+        else if constexpr (std::is_same_v<MSG_T, ExecContext::SemaphoreAcquire>)
+        {
+            rStream << "    * Acquire semaphore TASK" << TaskInt(msg.task) << "\n";
+        }
         else if constexpr (std::is_same_v<MSG_T, ExecContext::CompleteTask>)
         {
             rStream << "Complete TASK" << TaskInt(msg.task) << " - " << taskData[msg.task].m_debugName << "\n";
@@ -291,19 +705,213 @@ std::ostream& operator<<(std::ostream& rStream, TopExecWriteLog const& write)
         {
             rStream << "ExternalRunRequest PL" << std::setw(3) << std::left << PipelineInt(msg.pipeline) << "\n";
         }
-        else if constexpr (std::is_same_v<MSG_T, ExecContext::ExternalRunRequest>)
+        else if constexpr (std::is_same_v<MSG_T, ExecContext::ExternalSignal>)
         {
             rStream << "ExternalSignal PL" << std::setw(3) << std::left << PipelineInt(msg.pipeline) << (msg.ignored ? " IGNORED!" : " ") << "\n";
         }
     };
 
-    for (ExecContext::LogMsg_t const& msg : exec.logMsg)
+    uint64_t const first = history ? exec_log_first_available(exec) : exec_log_first_unread(exec);
+
+    if ( ! history && first != exec.logRead )
+    {
+        rStream << "... " << (first - exec.logRead) << " messages lost, log ring buffer is full\n";
+    }
+
+    for (uint64_t i = first; i < exec.logWritten; ++i)
     {
-        std::visit(visitMsg, msg);
+        std::visit(visitMsg, exec_log_decode(exec, i));
     }
 
     return rStream;
 }
 
+std::ostream& operator<<(std::ostream& rStream, TopExecWriteTrace const& write)
+{
+    auto const& [tasks, taskData, trace] = write;
+
+    // Chrome trace timestamps are in microseconds
+    auto const write_time = [&rStream] (int64_t const ns)
+    {
+        rStream << (ns / 1000) << '.' << std::setw(3) << std::setfill('0') << std::right << (ns % 1000) << std::setfill(' ');
+    };
+
+    auto const write_escaped = [&rStream] (std::string_view const str)
+    {
+        for (char const c : str)
+        {
+            if (c == '"' || c == '\\')
+            {
+                rStream << '\\' << c;
+            }
+            else if (static_cast<unsigned char>(c) >= 0x20)
+            {
+                rStream << c;
+            }
+        }
+    };
+
+    // Lanes are laid out as: [Frames] [Pipeline stages] [Worker 0] [Worker 1] ...
+    constexpr int frameTid          = 0;
+    constexpr int stageTid          = 1;
+    constexpr int firstWorkerTid    = 2;
+
+    bool first = true;
+    auto const next_event = [&rStream, &first] ()
+    {
+        rStream << (first ? "\n" : ",\n");
+        first = false;
+    };
+
+    auto const write_thread_name = [&] (int const tid, std::string_view const name)
+    {
+        next_event();
+        rStream << R"({"name":"thread_name","ph":"M","pid":0,"tid":)" << tid
+                << R"(,"args":{"name":")" << name << R"("}})";
+    };
+
+    rStream << R"({"displayTimeUnit":"ms","traceEvents":[)";
+
+    write_thread_name(frameTid, "Frames");
+    write_thread_name(stageTid, "Pipeline stages");
+    for (std::size_t i = 0; i < trace.lanes.size(); ++i)
+    {
+        next_event();
+        rStream << R"({"name":"thread_name","ph":"M","pid":0,"tid":)" << (firstWorkerTid + i)
+                << R"(,"args":{"name":"Worker )" << i << R"("}})";
+    }
+
+    for (std::size_t i = 0; i < trace.frames.size(); ++i)
+    {
+        ExecTrace::FrameSpan const& frame = trace.frames[i];
+        next_event();
+        rStream << R"({"name":"Frame )" << i << R"(","cat":"frame","ph":"X","pid":0,"tid":)" << frameTid << R"(,"ts":)";
+        write_time(frame.startNs);
+        rStream << R"(,"dur":)";
+        write_time(frame.endNs - frame.startNs);
+        rStream << "}";
+    }
+
+    for (ExecTrace::StageMark const& mark : trace.stageMarks)
+    {
+        PipelineInfo const& info = tasks.m_pipelineInfo[mark.pipeline];
+
+        next_event();
+        rStream << R"({"name":"PL)" << PipelineInt(mark.pipeline) << " ";
+        if (mark.stage == lgrn::id_null<StageId>())
+        {
+            rStream << "finish";
+        }
+        else if (info.stageType < PipelineInfo::sm_stageNames.size())
+        {
+            auto const stageNames = ArrayView<std::string_view const>{PipelineInfo::sm_stageNames[info.stageType]};
+            write_escaped((std::size_t(mark.stage) < stageNames.size()) ? stageNames[std::size_t(mark.stage)] : "?");
+        }
+        else
+        {
+            rStream << "stage " << int(mark.stage);
+        }
+        rStream << R"(","cat":"stage","ph":"i","s":"t","pid":0,"tid":)" << stageTid << R"(,"ts":)";
+        write_time(mark.timeNs);
+        rStream << R"(,"args":{"pipeline":")";
+        write_escaped(info.name);
+        rStream << R"("}})";
+    }
+
+    for (std::size_t i = 0; i < trace.lanes.size(); ++i)
+    {
+        for (ExecTrace::TaskSpan const& span : trace.lanes[i])
+        {
+            std::string_view const name = (TaskInt(span.task) < taskData.size())
+                                        ? std::string_view{taskData[span.task].m_debugName}
+                                        : std::string_view{};
+            next_event();
+            rStream << R"({"name":")";
+            write_escaped(name.empty() ? "untitled" : name);
+            rStream << R"(","cat":"task","ph":"X","pid":0,"tid":)" << (firstWorkerTid + i) << R"(,"ts":)";
+            write_time(span.startNs);
+            rStream << R"(,"dur":)";
+            write_time(span.endNs - span.startNs);
+            rStream << R"(,"args":{"task":)" << TaskInt(span.task) << "}}";
+        }
+    }
+
+    rStream << "\n]}\n";
+
+    return rStream;
+}
+
+std::ostream& operator<<(std::ostream& rStream, TopExecWriteStats const& write)
+{
+    auto const& [tasks, taskData, stats] = write;
+
+    auto const write_us = [&rStream] (int64_t const ns)
+    {
+        rStream << std::setw(10) << std::right << std::fixed << std::setprecision(1) << (double(ns) / 1000.0);
+    };
+
+    auto const write_table = [&] (auto const& samplesVec, auto const& ids, auto const& write_name)
+    {
+        using id_t = typename std::decay_t<decltype(ids)>::value_type;
+
+        std::vector< std::pair<id_t, TimeSummary> > rows;
+        for (id_t const id : ids)
+        {
+            if (std::size_t(id) < samplesVec.size() && samplesVec[id].count != 0)
+            {
+                rows.emplace_back(id, stats_summarize(samplesVec[id]));
+            }
+        }
+
+        std::sort(rows.begin(), rows.end(), [] (auto const& lhs, auto const& rhs)
+        {
+            return lhs.second.meanNs > rhs.second.meanNs;
+        });
+
+        rStream << "     Count |   Mean us |    p50 us |    p99 us |    Max us | Name\n"
+                << "__________________________________________________________________________\n";
+
+        for (auto const& [id, summary] : rows)
+        {
+            rStream << std::setw(10) << std::right << summary.count << " |";
+            write_us(summary.meanNs);   rStream << " |";
+            write_us(summary.p50Ns);    rStream << " |";
+            write_us(summary.p99Ns);    rStream << " |";
+            write_us(summary.maxNs);    rStream << " | ";
+            write_name(id);
+            rStream << "\n";
+        }
+    };
+
+    std::vector<TaskId> taskIds;
+    for (TaskInt const taskInt : tasks.m_taskIds.bitview().zeros())
+    {
+        taskIds.push_back(TaskId(taskInt));
+    }
+
+    std::vector<PipelineId> pipelineIds;
+    for (PipelineInt const plInt : tasks.m_pipelineIds.bitview().zeros())
+    {
+        pipelineIds.push_back(PipelineId(plInt));
+    }
+
+    rStream << "Tasks:\n";
+    write_table(stats.tasks, taskIds, [&rStream, &taskData=taskData] (TaskId const task)
+    {
+        rStream << "TASK" << TaskInt(task) << " - " << taskData[task].m_debugName;
+    });
+
+    rStream << "Pipelines:\n";
+    write_table(stats.pipelines, pipelineIds, [&rStream, &tasks=tasks] (PipelineId const pipeline)
+    {
+        std::string_view const name = tasks.m_pipelineInfo[pipeline].name;
+        rStream << "PL" << PipelineInt(pipeline) << " - " << (name.empty() ? "untitled" : name);
+    });
+
+    rStream << std::defaultfloat;
+
+    return rStream;
+}
+
 
 } // namespace testapp
@@ -33,8 +33,85 @@
 namespace osp
 {
 
+/**
+ * @brief Compile a TaskGraph, including conflicts between tasks that access the same TopData
+ *
+ * Two tasks conflict if they both use the same TopDataId and at least one of them writes to it.
+ */
+TaskGraph make_exec_graph(Tasks const& tasks, ArrayView<TaskEdges const* const> data, TopTaskDataVec_t const& taskData);
+
+inline TaskGraph make_exec_graph(Tasks const& tasks, std::initializer_list<TaskEdges const* const> data, TopTaskDataVec_t const& taskData)
+{
+    return make_exec_graph(tasks, arrayView(data), taskData);
+}
+
+/**
+ * @brief Add and remove Tasks and Pipelines from a TaskGraph, including conflicts between tasks
+ *
+ * See update_exec_graph in tasks.h. Conflicts are recalculated for all tasks.
+ */
+void update_exec_graph(TaskGraph &rGraph, Tasks const& tasks, ArrayView<TaskEdges const* const> data, TopTaskDataVec_t const& taskData, TaskGraphChanges const& changes);
+
+inline void update_exec_graph(TaskGraph &rGraph, Tasks const& tasks, std::initializer_list<TaskEdges const* const> data, TopTaskDataVec_t const& taskData, TaskGraphChanges const& changes)
+{
+    update_exec_graph(rGraph, tasks, arrayView(data), taskData, changes);
+}
+
+/**
+ * @brief Resolve pointers to the TopData used by each task, so they can be called without
+ *        looking up topData each time
+ *
+ * Must be called again once TopData slots used by tasks are emplaced, assigned, reset or moved
+ * (eg. by the container of TopData being reallocated), and once tasks are added. Resolve once
+ * when loading an executor rather than before every run. In debug builds, asserts that each
+ * TopData has the type its task function expects.
+ */
+void top_resolve_args(Tasks const& tasks, TopTaskDataVec_t const& taskData, ArrayView<entt::any> topData, TopTaskArgs &rOut);
+
+/**
+ * @brief Call the function of a queued task, followed by each task fused after it
+ *
+ * @return Actions returned by all of the task functions, combined
+ */
+TaskActions top_run_fused(TaskGraph const& graph, TopTaskDataVec_t const& taskData, TopTaskArgs const& args, TaskId task, WorkerContext worker) noexcept;
+
+/**
+ * @brief Run queued tasks on the calling thread until there's none left
+ *
+ * This overload looks up the arguments of each task as it runs. See the TopTaskArgs overload
+ * to resolve them once ahead of time instead.
+ */
 void top_run_blocking(Tasks const& tasks, TaskGraph const& graph, TopTaskDataVec_t& rTaskData, ArrayView<entt::any> topData, ExecContext& rExec, WorkerContext worker = {});
 
+void top_run_blocking(Tasks const& tasks, TaskGraph const& graph, TopTaskDataVec_t const& taskData, TopTaskArgs const& args, ExecContext& rExec, WorkerContext worker = {});
+
+/**
+ * @brief Result of replaying a frame, see top_replay_frame
+ */
+struct TopReplayStatus
+{
+    /// Number of tasks run in recorded order
+    std::size_t tasksRun    { 0 };
+
+    /// Set if a task returned different TaskActions from what was recorded, or if a recorded
+    /// task was not queued by the time it was its turn
+    bool        diverged    { false };
+};
+
+/**
+ * @brief Replay a frame of an ExecRecording on the calling thread
+ *
+ * Run requests and signals are replayed from the recording, and tasks run in the exact order
+ * they completed in. Once the frame diverges from the recording, the rest of its events are
+ * skipped, and remaining tasks run as they would in top_run_blocking. The ExecContext is left
+ * in a valid state either way, so it can carry on without the recording.
+ *
+ * IDs in recording must fit within tasks, see exec_recording_fits.
+ *
+ * @param rCursor   [ref] Index of the next event in recording. Moved past the end of the frame.
+ */
+TopReplayStatus top_replay_frame(Tasks const& tasks, TaskGraph const& graph, TopTaskDataVec_t const& taskData, TopTaskArgs const& args, ExecContext& rExec, ExecRecording const& recording, std::size_t &rCursor, WorkerContext worker = {});
+
 struct TopExecWriteState
 {
     Tasks const             &tasks;
@@ -43,16 +120,61 @@ struct TopExecWriteState
     ExecContext const       &exec;
 };
 
+/**
+ * @brief Write unread messages in an ExecContext's log
+ *
+ * Set history to write every message still in the log ring buffer instead, including ones
+ * already read. Useful for dumping the last few frames when execution gets stuck.
+ */
 struct TopExecWriteLog
 {
     Tasks const             &tasks;
     TopTaskDataVec_t const  &taskData;
     TaskGraph const         &graph;
     ExecContext const       &exec;
+    bool                    history{false};
 };
 
 std::ostream& operator<<(std::ostream& rStream, TopExecWriteState const& write);
 
+/**
+ * @brief Write an ExecStall from exec_find_stall as a single line
+ */
+struct TopExecWriteStall
+{
+    Tasks const             &tasks;
+    TopTaskDataVec_t const  &taskData;
+    ExecStall const         &stall;
+};
+
+/**
+ * @brief Writes an ExecTrace as Chrome trace event JSON, viewable in chrome://tracing or Perfetto
+ */
+struct TopExecWriteTrace
+{
+    Tasks const             &tasks;
+    TopTaskDataVec_t const  &taskData;
+    ExecTrace const         &trace;
+};
+
+/**
+ * @brief Writes a table of ExecStats for each task and pipeline that has samples
+ *
+ * Rows are sorted by mean time, slowest first. Times are in microseconds.
+ */
+struct TopExecWriteStats
+{
+    Tasks const             &tasks;
+    TopTaskDataVec_t const  &taskData;
+    ExecStats const         &stats;
+};
+
 std::ostream& operator<<(std::ostream& rStream, TopExecWriteLog const& write);
 
+std::ostream& operator<<(std::ostream& rStream, TopExecWriteStall const& write);
+
+std::ostream& operator<<(std::ostream& rStream, TopExecWriteTrace const& write);
+
+std::ostream& operator<<(std::ostream& rStream, TopExecWriteStats const& write);
+
 } // namespace testapp
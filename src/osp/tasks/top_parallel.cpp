@@ -0,0 +1,248 @@
+/**
+ * Open Space Program
+ * Copyright © 2019-2023 Open Space Program Project
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "top_parallel.h"
+#include "top_execute.h"
+
+#include <longeron/utility/asserts.hpp>
+
+#include <chrono>
+#include <cstdlib>
+
+namespace osp
+{
+
+/// How far a task's cost in nanoseconds may drift before priorities are recalculated, as a
+/// fraction of the cost used for the current priorities, plus a floor for tasks that cost nothing
+static constexpr int64_t gc_costDriftDivisor  = 4;
+static constexpr int64_t gc_costDriftMinNs    = 20'000;
+
+TopParallelExecutor::TopParallelExecutor(std::size_t const threadCount)
+ : m_pool{threadCount}
+{ }
+
+void TopParallelExecutor::load(Tasks const& tasks, TaskGraph const& graph, TopTaskDataVec_t const& taskData, ArrayView<entt::any> const topData)
+{
+    std::lock_guard<std::mutex> const lock(m_execMutex);
+
+    LGRN_ASSERTM(m_tasksInFlight == 0, "Tasks are still running");
+
+    m_pTasks    = &tasks;
+    m_pGraph    = &graph;
+    m_pTaskData = &taskData;
+
+    exec_conform(tasks, m_execContext);
+
+    m_taskHeld = {};
+    bitvector_resize(m_taskHeld, tasks.m_taskIds.capacity());
+    m_taskConflictsInFlight.assign(tasks.m_taskIds.capacity(), 0);
+
+    // Tasks keep their measured costs if the graph is updated. Added tasks start at zero, even if
+    // they reuse the ID of a removed one.
+    m_taskCosts.resize(tasks.m_taskIds.capacity(), 0);
+    ids_for_each_changed(tasks.m_taskIds, m_tasksLoaded, [this] (TaskId const task)
+    {
+        if (std::size_t(task) < m_taskCosts.size())
+        {
+            m_taskCosts[task] = 0;
+        }
+    });
+    update_priorities();
+
+    exec_stats_conform(tasks, m_stats);
+    m_execContext.pStats = &m_stats;
+
+    top_resolve_args(tasks, taskData, topData, m_args);
+}
+
+void TopParallelExecutor::request_run(PipelineId const pipeline)
+{
+    std::lock_guard<std::mutex> const lock(m_execMutex);
+    exec_request_run(m_execContext, pipeline);
+}
+
+void TopParallelExecutor::signal(PipelineId const pipeline)
+{
+    std::lock_guard<std::mutex> const lock(m_execMutex);
+    exec_signal(m_execContext, pipeline);
+}
+
+void TopParallelExecutor::run_frame()
+{
+    WorkerId const self = m_pool.external_worker();
+
+    std::unique_lock<std::mutex> lock(m_execMutex);
+
+    exec_update(*m_pTasks, *m_pGraph, m_execContext);
+    dispatch_ready_tasks(self);
+
+    // Help out running tasks until there's none left. Tasks dispatch other tasks as they
+    // complete, so nothing in flight means there's nothing left to run.
+    while (m_tasksInFlight != 0)
+    {
+        lock.unlock();
+        bool const ranTask = m_pool.try_run_one(self);
+        lock.lock();
+
+        // Tasks pinned to this thread are pushed with m_execMutex locked, so checking for them
+        // here can't miss one pushed right before going to sleep
+        if ( ! ranTask && m_tasksInFlight != 0 && ! m_pool.has_pinned(self) )
+        {
+            m_taskDoneCv.wait(lock);
+        }
+    }
+
+    // Walks the whole graph, so only done once it would actually reorder something
+    if (m_costsDrifted && m_execContext.tasksQueuedRun.empty())
+    {
+        update_priorities();
+    }
+}
+
+bool TopParallelExecutor::is_running()
+{
+    std::lock_guard<std::mutex> const lock(m_execMutex);
+    return m_execContext.hasRequestRun || (m_execContext.pipelinesRunning != 0);
+}
+
+void TopParallelExecutor::run_task_job(void *pUser, uint64_t const arg, WorkerId const worker) noexcept
+{
+    auto            &rThis      = *static_cast<TopParallelExecutor*>(pUser);
+    Tasks const     &tasks      = *rThis.m_pTasks;
+    TaskGraph const &graph      = *rThis.m_pGraph;
+    auto const      task        = TaskId(arg);
+
+    // pTrace may be changed while tasks are running, so it's only read under the lock
+    auto const traceStart = ExecTrace::Clock_t::now();
+
+    // Task function is called here
+    TaskActions const status = top_run_fused(graph, *rThis.m_pTaskData, rThis.m_args, task, WorkerContext{&rThis.m_pool, worker});
+
+    auto const traceEnd = ExecTrace::Clock_t::now();
+
+    std::lock_guard<std::mutex> const lock(rThis.m_execMutex);
+
+    if (ExecTrace *pTrace = rThis.m_execContext.pTrace;
+        pTrace != nullptr)
+    {
+        using std::chrono::duration_cast, std::chrono::nanoseconds;
+        pTrace->lanes[std::size_t(worker)].push_back({
+                task,
+                duration_cast<nanoseconds>(traceStart - pTrace->epoch).count(),
+                duration_cast<nanoseconds>(traceEnd   - pTrace->epoch).count() });
+    }
+
+    int64_t const durationNs = std::chrono::duration_cast<std::chrono::nanoseconds>(traceEnd - traceStart).count();
+
+    stats_add_sample(rThis.m_stats.tasks[task], durationNs);
+
+    // Smoothed over a few frames, so a single slow run doesn't reorder everything
+    int64_t &rCost = rThis.m_taskCosts[task];
+    rCost += (durationNs - rCost) / 8;
+
+    int64_t const prioritized = rThis.m_taskCostsPrioritized[task];
+    if (std::abs(rCost - prioritized) > prioritized / gc_costDriftDivisor + gc_costDriftMinNs)
+    {
+        rThis.m_costsDrifted = true;
+    }
+
+    for (TaskId const conflict : fanout_view(graph.taskToFirstConflict, graph.conflictToTask, task))
+    {
+        if (   -- rThis.m_taskConflictsInFlight[conflict] == 0
+            && rThis.m_taskHeld.test(std::size_t(conflict)) )
+        {
+            rThis.m_taskHeld.reset(std::size_t(conflict));
+            exec_push_task(rThis.m_execContext, conflict);
+        }
+    }
+    -- rThis.m_tasksInFlight;
+
+    complete_task(tasks, graph, rThis.m_execContext, task, status);
+    exec_update(tasks, graph, rThis.m_execContext);
+    rThis.dispatch_ready_tasks(worker);
+
+    // Notify with mutex locked, run_frame may return and the executor go away right after it's
+    // unlocked
+    rThis.m_taskDoneCv.notify_all();
+}
+
+void TopParallelExecutor::dispatch_ready_tasks(WorkerId const from)
+{
+    TaskGraph const &graph = *m_pGraph;
+
+    // Taken most critical first, so they win over tasks they conflict with
+    m_readyTasks.clear();
+    for (TaskId task = exec_pop_task(m_execContext);
+         task != lgrn::id_null<TaskId>();
+         task = exec_pop_task(m_execContext))
+    {
+        if (m_taskConflictsInFlight[task] != 0)
+        {
+            // Given back to the heap once the conflicting tasks complete, see run_task_job
+            m_taskHeld.set(std::size_t(task));
+            continue;
+        }
+
+        for (TaskId const conflict : fanout_view(graph.taskToFirstConflict, graph.conflictToTask, task))
+        {
+            ++ m_taskConflictsInFlight[conflict];
+        }
+        ++ m_tasksInFlight;
+
+        m_readyTasks.push_back(task);
+    }
+
+    // Pushed least critical first. This thread pops from the back of its own deque, so it picks
+    // up the most critical task next.
+    for (auto it = m_readyTasks.rbegin(); it != m_readyTasks.rend(); ++it)
+    {
+        TaskId const    task = *it;
+        WorkerJob const job{&run_task_job, this, uint64_t(task)};
+
+        TopTask const &rTopTask = (*m_pTaskData)[task];
+        switch (rTopTask.m_affinity)
+        {
+        case ETopAffinity::Any:
+            m_pool.push(from, job);
+            break;
+        case ETopAffinity::Main:
+            m_pool.push_pinned(m_pool.external_worker(), job);
+            break;
+        case ETopAffinity::Lane:
+            m_pool.push_pinned(WorkerId(rTopTask.m_lane % m_pool.thread_count()), job);
+            break;
+        }
+    }
+}
+
+void TopParallelExecutor::update_priorities()
+{
+    LGRN_ASSERTM(m_execContext.tasksQueuedRun.empty(), "taskPriority must not change while tasks are queued");
+
+    task_critical_paths(*m_pTasks, *m_pGraph, m_taskCosts, m_execContext.taskPriority);
+    m_taskCostsPrioritized = m_taskCosts;
+    m_costsDrifted = false;
+}
+
+} // namespace osp
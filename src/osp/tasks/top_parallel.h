@@ -0,0 +1,160 @@
+/**
+ * Open Space Program
+ * Copyright © 2019-2023 Open Space Program Project
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include "execute.h"
+#include "tasks.h"
+#include "top_tasks.h"
+#include "worker_pool.h"
+
+#include "../core/bitvector.h"
+
+#include <entt/core/fwd.hpp>
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace osp
+{
+
+/**
+ * @brief Runs ready TopTasks in parallel on a WorkerPool
+ *
+ * exec_update and complete_task remain the single source of truth for what can run; they are
+ * only ever called with the executor's mutex locked. Whichever thread completes a task also
+ * updates the ExecContext and dispatches newly queued tasks to its own deque, where idle threads
+ * can steal them from. The thread calling run_frame() participates in running tasks.
+ *
+ * Queued tasks are taken off of ExecContext::tasksQueuedRunHeap in priority order. Ones that
+ * conflict with a task in-flight (see TaskGraph::taskToFirstConflict) are held back, and given
+ * back to the heap once the conflicting tasks complete. The TaskGraph must be made with the
+ * make_exec_graph overload that accepts TopTaskDataVec_t.
+ *
+ * Tasks on the longest chain left in the frame are dispatched first, see task_critical_paths.
+ * Task durations are measured as they run. Priorities are recalculated at the end of a frame
+ * once a task's cost drifts far enough from the cost its priority was calculated with.
+ *
+ * TopTask::m_affinity is respected by pinning tasks to a worker: ETopAffinity::Main tasks only
+ * run on the thread calling run_frame(), and ETopAffinity::Lane tasks always run on the same
+ * pool thread.
+ */
+class TopParallelExecutor
+{
+public:
+
+    explicit TopParallelExecutor(std::size_t threadCount);
+
+    /**
+     * @brief Prepare to run tasks, must be called again once tasks, the graph or TopData change
+     *
+     * References to tasks, graph and taskData are kept until the next call. No tasks may be
+     * running.
+     */
+    void load(Tasks const& tasks, TaskGraph const& graph, TopTaskDataVec_t const& taskData, ArrayView<entt::any> topData);
+
+    void request_run(PipelineId pipeline);
+
+    void signal(PipelineId pipeline);
+
+    /**
+     * @brief Update the ExecContext and run tasks until there's none left
+     *
+     * The calling thread runs tasks too, including all ETopAffinity::Main tasks.
+     */
+    void run_frame();
+
+    [[nodiscard]] bool is_running();
+
+    /**
+     * @brief Lock to access m_execContext or m_stats from outside of run_frame
+     */
+    [[nodiscard]] std::unique_lock<std::mutex> lock() { return std::unique_lock<std::mutex>{m_execMutex}; }
+
+    [[nodiscard]] WorkerPool& pool() noexcept { return m_pool; }
+
+    /**
+     * @return Task arguments resolved by the last call to load()
+     */
+    [[nodiscard]] TopTaskArgs const& args() const noexcept { return m_args; }
+
+    ExecContext                     m_execContext;
+    ExecStats                       m_stats;
+
+private:
+
+    static void run_task_job(void *pUser, uint64_t arg, WorkerId worker) noexcept;
+
+    /**
+     * @brief Push queued tasks that aren't blocked by conflicts to the pool
+     *
+     * m_execMutex must be locked.
+     */
+    void dispatch_ready_tasks(WorkerId from);
+
+    /**
+     * @brief Recalculate ExecContext::taskPriority from m_taskCosts
+     *
+     * m_execMutex must be locked, and no tasks may be queued.
+     */
+    void update_priorities();
+
+    WorkerPool                      m_pool;
+
+    Tasks const                     *m_pTasks           { nullptr };
+    TaskGraph const                 *m_pGraph           { nullptr };
+    TopTaskDataVec_t const          *m_pTaskData        { nullptr };
+
+    std::mutex                      m_execMutex;
+    std::condition_variable         m_taskDoneCv;
+
+    /// Tasks taken off of the heap while conflicting with a task in-flight
+    BitVector_t                     m_taskHeld;
+    KeyedVec<TaskId, int>           m_taskConflictsInFlight;
+    int                             m_tasksInFlight     { 0 };
+
+    /// Smoothed time each task takes to run in nanoseconds, to find the critical path with
+    KeyedVec<TaskId, int64_t>       m_taskCosts;
+
+    /// m_taskCosts as of the last update_priorities, to tell how far they've drifted
+    KeyedVec<TaskId, int64_t>       m_taskCostsPrioritized;
+
+    /// Set once a cost drifts past gc_costDrift, see update_priorities
+    bool                            m_costsDrifted      { false };
+
+    /// Tasks that existed as of the last load, to reset m_taskCosts of added and removed ones
+    BitVector_t                     m_tasksLoaded;
+
+    /// Buffer for dispatch_ready_tasks, tasks to push ordered by priority
+    std::vector<TaskId>             m_readyTasks;
+
+    /// Resolved on load, as that's done after sessions create their TopData
+    TopTaskArgs                     m_args;
+
+}; // class TopParallelExecutor
+
+} // namespace osp
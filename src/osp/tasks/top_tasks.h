@@ -27,19 +27,84 @@
 #include "tasks.h"
 #include "top_worker.h"
 
+#include <entt/core/fwd.hpp>
+
 #include <string>
 #include <vector>
 
 namespace osp
 {
 
+enum class ETopDataAccess : uint8_t
+{
+    Read,
+    Write
+};
+
+/**
+ * @brief Which thread a TopTask is allowed to run on
+ */
+enum class ETopAffinity : uint8_t
+{
+    Any,    ///< Any thread of the executor
+    Main,   ///< Only the thread that waits on the executor, eg. the one that owns the GL context
+    Lane    ///< Only one particular worker thread, picked by TopTask::m_lane
+};
+
 struct TopTask
 {
-    std::string             m_debugName;
-    std::vector<TopDataId>  m_dataUsed;
-    TopTaskFunc_t           m_func              { nullptr };
+    /**
+     * @return How m_dataUsed[index] is accessed. Write if unspecified
+     */
+    [[nodiscard]] ETopDataAccess data_access(std::size_t const index) const noexcept
+    {
+        return (index < m_dataAccess.size()) ? m_dataAccess[index] : ETopDataAccess::Write;
+    }
+
+    std::string                 m_debugName;
+    std::vector<TopDataId>      m_dataUsed;
+    std::vector<ETopDataAccess> m_dataAccess;       ///< Parallel to m_dataUsed
+    std::vector<entt::id_type>  m_dataTypes;        ///< Parallel to m_dataUsed, type hash expected by m_func, or 0 if unknown
+    TopTaskFunc_t               m_func              { nullptr };
+    ETopAffinity                m_affinity          { ETopAffinity::Any };
+    uint8_t                     m_lane              { 0 };  ///< Tasks on the same lane run on the same thread
 };
 
 using TopTaskDataVec_t = KeyedVec<TaskId, TopTask>;
 
+/**
+ * @brief Pointers to the TopData used by each task, resolved ahead of time by top_resolve_args
+ *
+ * Pointers point into each entt::any's storage, which is inline for small types. They stay valid
+ * until a TopData slot they point to is emplaced, assigned, reset, or moved, which includes the
+ * container of TopData being reallocated. Resolve again after any of these, eg. when reloading
+ * an executor; top_args_resolved_from catches the container changing size or moving.
+ */
+struct TopTaskArgs
+{
+    // TaskId --> many pointers, parallel to TopTask::m_dataUsed
+    KeyedVec<TaskId, uint32_t>  taskToFirstArg;
+    std::vector<void*>          argPtrs;
+
+    /// TopData the pointers were resolved from
+    entt::any const             *pTopData       { nullptr };
+    std::size_t                 topDataSize     { 0 };
+};
+
+/**
+ * @return true if args were resolved from the same TopData container, and it hasn't been
+ *         reallocated or resized since
+ */
+[[nodiscard]] inline bool top_args_resolved_from(TopTaskArgs const& args, ArrayView<entt::any> const topData) noexcept
+{
+    return args.pTopData == topData.data() && args.topDataSize == topData.size();
+}
+
+[[nodiscard]] inline ArrayView<void* const> top_task_args(TopTaskArgs const& args, TaskId const task) noexcept
+{
+    uint32_t const first = args.taskToFirstArg[task];
+    uint32_t const last  = args.taskToFirstArg[TaskId(uint32_t(task) + 1)];
+    return arrayView(args.argPtrs.data(), args.argPtrs.size()).slice(first, last);
+}
+
 } // namespace osp
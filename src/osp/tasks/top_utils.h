@@ -30,6 +30,7 @@
 #include "top_worker.h"
 
 #include <entt/core/any.hpp>
+#include <entt/core/type_info.hpp>
 
 #include <Corrade/Containers/ArrayViewStl.h>
 
@@ -37,6 +38,7 @@
 #include <functional>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 namespace osp
 {
@@ -134,8 +136,9 @@ template <typename T>
 template<typename FUNCTOR_T>
 struct wrap_args_trait
 {
+    // Types are checked once by top_resolve_args, so args are cast without checking here
     template<typename T>
-    static constexpr decltype(auto) cast_arg(ArrayView<entt::any> topData, WorkerContext ctx, std::size_t const argIndex)
+    static constexpr decltype(auto) cast_arg(ArrayView<void* const> args, WorkerContext ctx, std::size_t const argIndex) noexcept
     {
         if constexpr (std::is_same_v<T, WorkerContext>)
         {
@@ -143,28 +146,28 @@ struct wrap_args_trait
         }
         else
         {
-            LGRN_ASSERTMV(topData.size() > argIndex, "Task function has more arguments than TopDataIds provided", topData.size(), argIndex);
-            return entt::any_cast<T&>(topData[argIndex]);
+            LGRN_ASSERTMV(args.size() > argIndex, "Task function has more arguments than TopDataIds provided", args.size(), argIndex);
+            return *static_cast<std::remove_reference_t<T>*>(args[argIndex]);
         }
     }
 
     template<typename ... ARGS_T, std::size_t ... INDEX_T>
-    static constexpr decltype(auto) cast_args(ArrayView<entt::any> topData, WorkerContext ctx, [[maybe_unused]] std::index_sequence<INDEX_T...> indices) noexcept
+    static constexpr decltype(auto) cast_args(ArrayView<void* const> args, WorkerContext ctx, [[maybe_unused]] std::index_sequence<INDEX_T...> indices) noexcept
     {
-        return FUNCTOR_T{}(cast_arg<ARGS_T>(topData, ctx, INDEX_T) ...);
+        return FUNCTOR_T{}(cast_arg<ARGS_T>(args, ctx, INDEX_T) ...);
     }
 
     template<typename RETURN_T, typename ... ARGS_T>
-    static TaskActions wrapped_task([[maybe_unused]] WorkerContext ctx, ArrayView<entt::any> topData) noexcept
+    static TaskActions wrapped_task([[maybe_unused]] WorkerContext ctx, ArrayView<void* const> args) noexcept
     {
         if constexpr (std::is_void_v<RETURN_T>)
         {
-            cast_args<ARGS_T ...>(topData, ctx, std::make_index_sequence<sizeof...(ARGS_T)>{});
+            cast_args<ARGS_T ...>(args, ctx, std::make_index_sequence<sizeof...(ARGS_T)>{});
             return {};
         }
         else if constexpr (std::is_same_v<RETURN_T, TaskActions>)
         {
-            return cast_args<ARGS_T ...>(topData, ctx, std::make_index_sequence<sizeof...(ARGS_T)>{});
+            return cast_args<ARGS_T ...>(args, ctx, std::make_index_sequence<sizeof...(ARGS_T)>{});
         }
     }
 
@@ -174,16 +177,49 @@ struct wrap_args_trait
     {
         return &wrapped_task<RETURN_T, ARGS_T ...>;
     }
+
+    // Only non-const references can write to TopData. Values and const references are read-only.
+    template<typename T>
+    static constexpr ETopDataAccess arg_access() noexcept
+    {
+        return (std::is_lvalue_reference_v<T> && ! std::is_const_v< std::remove_reference_t<T> >)
+                ? ETopDataAccess::Write : ETopDataAccess::Read;
+    }
+
+    template<typename RETURN_T, typename ... ARGS_T>
+    static std::vector<ETopDataAccess> unpack_access([[maybe_unused]] RETURN_T(*func)(ARGS_T...))
+    {
+        return { arg_access<ARGS_T>() ... };
+    }
+
+    template<typename T>
+    static constexpr entt::id_type arg_type() noexcept
+    {
+        if constexpr (std::is_same_v<std::remove_cvref_t<T>, WorkerContext>)
+        {
+            return 0; // Not TopData
+        }
+        else
+        {
+            return entt::type_hash< std::remove_cvref_t<T> >::value();
+        }
+    }
+
+    template<typename RETURN_T, typename ... ARGS_T>
+    static std::vector<entt::id_type> unpack_types([[maybe_unused]] RETURN_T(*func)(ARGS_T...))
+    {
+        return { arg_type<ARGS_T>() ... };
+    }
 };
 
 /**
  * @brief Wrap a function with arbitrary arguments into a TopTaskFunc_t
  *
- * A regular TopTaskFunc_t accepts a ArrayView<entt::any> for passing data of
+ * A regular TopTaskFunc_t accepts a ArrayView<void* const> for passing data of
  * arbitrary types. This needs to be manually casted.
  *
  * wrap_args creates a wrapper function that will automatically cast the
- * entt::anys and call the underlying function.
+ * pointers and call the underlying function.
  *
  * @param a[in]
  *
@@ -204,6 +240,28 @@ constexpr TopTaskFunc_t wrap_args(FUNC_T funcArg)
     return wrap_args_trait<FUNC_T>::unpack(functionPtr);
 }
 
+/**
+ * @brief Infer how each TopData argument is accessed by a function passed to wrap_args
+ *
+ * @return Access for each argument, in the same order as the function's parameters
+ */
+template<typename FUNC_T>
+std::vector<ETopDataAccess> wrap_args_access(FUNC_T funcArg)
+{
+    return wrap_args_trait<FUNC_T>::unpack_access(+funcArg);
+}
+
+/**
+ * @brief Get the type hash of each TopData argument of a function passed to wrap_args
+ *
+ * @return Type hash for each argument, or 0 for arguments that aren't TopData
+ */
+template<typename FUNC_T>
+std::vector<entt::id_type> wrap_args_types(FUNC_T funcArg)
+{
+    return wrap_args_trait<FUNC_T>::unpack_types(+funcArg);
+}
+
 //-----------------------------------------------------------------------------
 
 struct TopTaskBuilder;
@@ -247,6 +305,13 @@ struct TopTaskTaskRef : public TaskRefBase<TopTaskBuilderTraits>
 
     inline TopTaskTaskRef& important_deps_count(int value);
 
+    /**
+     * @brief Restrict which thread the task runs on, see ETopAffinity
+     *
+     * @param lane [in] Only used with ETopAffinity::Lane
+     */
+    inline TopTaskTaskRef& affinity(ETopAffinity value, uint8_t lane = 0);
+
     template<typename CONTAINER_T>
     TopTaskTaskRef& push_to(CONTAINER_T& rContainer);
 };
@@ -269,7 +334,9 @@ template<typename FUNC_T>
 TopTaskTaskRef& TopTaskTaskRef::func(FUNC_T&& funcArg)
 {
     m_rBuilder.m_rData.resize(m_rBuilder.m_rTasks.m_taskIds.capacity());
-    m_rBuilder.m_rData[m_taskId].m_func = wrap_args(funcArg);
+    m_rBuilder.m_rData[m_taskId].m_func         = wrap_args(funcArg);
+    m_rBuilder.m_rData[m_taskId].m_dataAccess   = wrap_args_access(funcArg);
+    m_rBuilder.m_rData[m_taskId].m_dataTypes    = wrap_args_types(funcArg);
     return *this;
 }
 
@@ -277,6 +344,16 @@ TopTaskTaskRef& TopTaskTaskRef::func_raw(TopTaskFunc_t func)
 {
     m_rBuilder.m_rData.resize(m_rBuilder.m_rTasks.m_taskIds.capacity());
     m_rBuilder.m_rData[m_taskId].m_func = func;
+    m_rBuilder.m_rData[m_taskId].m_dataAccess.clear(); // Access unknown, assume all writes
+    m_rBuilder.m_rData[m_taskId].m_dataTypes.clear();  // Types unknown, not checked
+    return *this;
+}
+
+TopTaskTaskRef& TopTaskTaskRef::affinity(ETopAffinity const value, uint8_t const lane)
+{
+    m_rBuilder.m_rData.resize(m_rBuilder.m_rTasks.m_taskIds.capacity());
+    m_rBuilder.m_rData[m_taskId].m_affinity = value;
+    m_rBuilder.m_rData[m_taskId].m_lane     = lane;
     return *this;
 }
 
@@ -43,11 +43,30 @@ using TopDataIds_t  = std::initializer_list<TopDataId>;
 
 struct Reserved {};
 
+class WorkerPool;
+
+/**
+ * @brief Passed to task functions, to access the thread running them
+ *
+ * See parallel_for.h for splitting work within a task across the pool.
+ */
 struct WorkerContext
 {
     //DependOnDirty_t m_dependOnDirty;
+
+    /// Pool of the executor running the task, or null if tasks run on a single thread
+    WorkerPool  *pPool  { nullptr };
+
+    /// Worker of the thread running the task, within pPool
+    WorkerId    worker  { };
 };
 
-using TopTaskFunc_t = TaskActions(*)(WorkerContext, ArrayView<entt::any>) noexcept;
+/**
+ * @brief Type-erased task function
+ *
+ * Arguments are pointers to each TopData value used by the task, in the same order as
+ * TopTask::m_dataUsed, see top_resolve_args. Null for null TopDataIds.
+ */
+using TopTaskFunc_t = TaskActions(*)(WorkerContext, ArrayView<void* const>) noexcept;
 
 } // namespace osp
@@ -0,0 +1,82 @@
+/**
+ * Open Space Program
+ * Copyright © 2019-2023 Open Space Program Project
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include "tasks.h"
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace osp
+{
+
+/**
+ * @brief Timestamped record of task execution, used to find what takes up a frame
+ *
+ * Each worker only ever appends to its own lane, so recording task spans needs no locks. Stage
+ * changes are recorded by whichever thread is updating the ExecContext.
+ *
+ * Times are in nanoseconds since epoch.
+ */
+struct ExecTrace
+{
+    using Clock_t = std::chrono::steady_clock;
+
+    struct TaskSpan
+    {
+        TaskId      task;
+        int64_t     startNs;
+        int64_t     endNs;
+    };
+
+    struct StageMark
+    {
+        PipelineId  pipeline;
+        StageId     stage;      ///< Null if pipeline finished running
+        int64_t     timeNs;
+    };
+
+    struct FrameSpan
+    {
+        int64_t     startNs;
+        int64_t     endNs;
+    };
+
+    [[nodiscard]] int64_t now() const noexcept
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock_t::now() - epoch).count();
+    }
+
+    Clock_t::time_point                     epoch       { Clock_t::now() };
+
+    /// Task spans for each worker
+    std::vector< std::vector<TaskSpan> >    lanes;
+    std::vector<StageMark>                  stageMarks;
+    std::vector<FrameSpan>                  frames;
+
+}; // struct ExecTrace
+
+} // namespace osp
@@ -25,6 +25,7 @@
 #pragma once
 
 #include <bitset>
+#include <cstdint>
 #include <Corrade/Containers/EnumSet.h>
 
 namespace osp
@@ -39,4 +40,11 @@ enum class TaskAction
 using TaskActions = Corrade::Containers::EnumSet<TaskAction>;
 CORRADE_ENUMSET_OPERATORS(TaskActions)
 
+using WorkerInt = uint32_t;
+
+/**
+ * @brief Identifies a thread of a WorkerPool, or threads outside of it
+ */
+enum class WorkerId : WorkerInt { };
+
 } // namespace osp
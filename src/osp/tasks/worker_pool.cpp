@@ -0,0 +1,284 @@
+/**
+ * Open Space Program
+ * Copyright © 2019-2023 Open Space Program Project
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "worker_pool.h"
+
+#include <longeron/utility/asserts.hpp>
+
+#include <algorithm>
+
+namespace osp
+{
+
+WorkerPool::WorkerPool(std::size_t const threadCount)
+ : m_deques{std::make_unique<JobDeque[]>(threadCount + 1)}
+{
+    m_threads.reserve(threadCount);
+    for (std::size_t i = 0; i < threadCount; ++i)
+    {
+        m_threads.emplace_back(&WorkerPool::thread_main, this, WorkerId(i));
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> const lock(m_sleepMutex);
+        m_stop.store(true);
+    }
+    m_sleepCv.notify_all();
+
+    for (std::thread &rThread : m_threads)
+    {
+        rThread.join();
+    }
+}
+
+void WorkerPool::push(WorkerId const from, WorkerJob const job)
+{
+    LGRN_ASSERTMV(WorkerInt(from) < worker_count(), "Invalid worker", WorkerInt(from), worker_count());
+
+    JobDeque &rDeque = m_deques[WorkerInt(from)];
+    {
+        std::lock_guard<std::mutex> const lock(rDeque.mutex);
+        rDeque.jobs.push_back(job);
+    }
+
+    {
+        // Lock prevents a thread from missing the notify between checking m_jobsPending and
+        // going to sleep
+        std::lock_guard<std::mutex> const lock(m_sleepMutex);
+        m_jobsPending.fetch_add(1);
+    }
+    m_sleepCv.notify_one();
+}
+
+void WorkerPool::push_pinned(WorkerId const to, WorkerJob const job)
+{
+    LGRN_ASSERTMV(WorkerInt(to) < worker_count(), "Invalid worker", WorkerInt(to), worker_count());
+
+    JobDeque &rDeque = m_deques[WorkerInt(to)];
+    {
+        std::lock_guard<std::mutex> const lock(rDeque.mutex);
+        rDeque.pinned.push_back(job);
+    }
+
+    {
+        std::lock_guard<std::mutex> const lock(m_sleepMutex);
+        rDeque.pinnedPending.fetch_add(1);
+    }
+
+    // No way to wake up a particular thread, so wake them all. Only the right one stays awake.
+    m_sleepCv.notify_all();
+}
+
+bool WorkerPool::has_pinned(WorkerId const worker) const noexcept
+{
+    return m_deques[WorkerInt(worker)].pinnedPending.load() != 0;
+}
+
+bool WorkerPool::try_run_one(WorkerId const worker)
+{
+    WorkerJob job;
+    if (try_pop(worker, job))
+    {
+        job.func(job.pUser, job.arg, worker);
+        return true;
+    }
+    return false;
+}
+
+bool WorkerPool::try_cancel(WorkerId const worker, WorkerJob const& job)
+{
+    JobDeque &rDeque = m_deques[WorkerInt(worker)];
+    std::lock_guard<std::mutex> const lock(rDeque.mutex);
+
+    auto const found = std::find_if(rDeque.jobs.begin(), rDeque.jobs.end(), [&job] (WorkerJob const& queued)
+    {
+        return queued.func == job.func && queued.pUser == job.pUser;
+    });
+    if (found == rDeque.jobs.end())
+    {
+        return false;
+    }
+
+    rDeque.jobs.erase(found);
+    m_jobsPending.fetch_sub(1);
+    return true;
+}
+
+bool WorkerPool::try_pop(WorkerId const worker, WorkerJob &rJobOut)
+{
+    JobDeque &rOwn = m_deques[WorkerInt(worker)];
+
+    // Pinned jobs first, since no other thread can take them
+    if (rOwn.pinnedPending.load() != 0)
+    {
+        std::lock_guard<std::mutex> const lock(rOwn.mutex);
+        if ( ! rOwn.pinned.empty() )
+        {
+            rJobOut = rOwn.pinned.front();
+            rOwn.pinned.pop_front();
+            rOwn.pinnedPending.fetch_sub(1);
+            return true;
+        }
+    }
+
+    if (m_jobsPending.load() == 0)
+    {
+        return false;
+    }
+
+    std::size_t const count = worker_count();
+
+    // Pop from back of own deque
+    {
+        std::lock_guard<std::mutex> const lock(rOwn.mutex);
+        if ( ! rOwn.jobs.empty() )
+        {
+            rJobOut = rOwn.jobs.back();
+            rOwn.jobs.pop_back();
+            m_jobsPending.fetch_sub(1);
+            return true;
+        }
+    }
+
+    // Steal from front of other deques, starting from the neighbor to spread out contention
+    for (std::size_t i = 1; i < count; ++i)
+    {
+        JobDeque &rVictim = m_deques[(WorkerInt(worker) + i) % count];
+        std::lock_guard<std::mutex> const lock(rVictim.mutex);
+        if ( ! rVictim.jobs.empty() )
+        {
+            rJobOut = rVictim.jobs.front();
+            rVictim.jobs.pop_front();
+            m_jobsPending.fetch_sub(1);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+namespace
+{
+
+struct ForkJoin
+{
+    WorkerJob               job;
+    uint64_t                count;
+
+    /// Next call to claim. Calls are claimed one at a time by any thread
+    std::atomic<uint64_t>   next        { 0 };
+
+    /// Number of pushed helper jobs that haven't finished or been taken back. Guarded by mutex
+    uint64_t                helpersLeft { 0 };
+    std::mutex              mutex       { };
+    std::condition_variable helpersDone { };
+};
+
+void fork_join_claim_all(ForkJoin &rForkJoin, WorkerId const worker) noexcept
+{
+    for (uint64_t i = rForkJoin.next.fetch_add(1); i < rForkJoin.count; i = rForkJoin.next.fetch_add(1))
+    {
+        rForkJoin.job.func(rForkJoin.job.pUser, i, worker);
+    }
+}
+
+void fork_join_helper(void *pUser, [[maybe_unused]] uint64_t arg, WorkerId const worker) noexcept
+{
+    auto &rForkJoin = *static_cast<ForkJoin*>(pUser);
+    fork_join_claim_all(rForkJoin, worker);
+
+    // ForkJoin is on the caller's stack, and is gone as soon as the caller sees helpersLeft reach
+    // 0. Notifying while holding the lock keeps it alive until this is done with it.
+    std::lock_guard<std::mutex> const lock(rForkJoin.mutex);
+    if (--rForkJoin.helpersLeft == 0)
+    {
+        rForkJoin.helpersDone.notify_one();
+    }
+}
+
+} // namespace
+
+void WorkerPool::fork_join(WorkerId const from, uint64_t const count, WorkerJob const job)
+{
+    LGRN_ASSERTMV(WorkerInt(from) < worker_count(), "Invalid worker", WorkerInt(from), worker_count());
+
+    if (count == 0)
+    {
+        return;
+    }
+
+    // No point pushing more helpers than there are threads to steal them
+    uint64_t const helperCount = std::min<uint64_t>(count - 1, thread_count());
+
+    ForkJoin forkJoin{.job = job, .count = count, .helpersLeft = helperCount};
+
+    WorkerJob const helper{&fork_join_helper, &forkJoin, 0};
+
+    for (uint64_t i = 0; i < helperCount; ++i)
+    {
+        push(from, helper);
+    }
+
+    fork_join_claim_all(forkJoin, from);
+
+    // Every call is claimed at this point. Take back helpers that no thread stole, as they'd
+    // have nothing left to do. The rest are already running, so sleep until they finish their
+    // last call instead of spinning.
+    uint64_t takenBack = 0;
+    while (takenBack < helperCount && try_cancel(from, helper))
+    {
+        ++takenBack;
+    }
+
+    std::unique_lock<std::mutex> lock(forkJoin.mutex);
+    forkJoin.helpersLeft -= takenBack;
+    forkJoin.helpersDone.wait(lock, [&forkJoin] { return forkJoin.helpersLeft == 0; });
+}
+
+void WorkerPool::thread_main(WorkerId const worker)
+{
+    while (true)
+    {
+        if (try_run_one(worker))
+        {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_sleepCv.wait(lock, [this, &rOwn = m_deques[WorkerInt(worker)]]
+        {
+            return m_stop.load() || m_jobsPending.load() != 0 || rOwn.pinnedPending.load() != 0;
+        });
+
+        if (m_stop.load())
+        {
+            return;
+        }
+    }
+}
+
+} // namespace osp
@@ -0,0 +1,179 @@
+/**
+ * Open Space Program
+ * Copyright © 2019-2023 Open Space Program Project
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include "worker.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace osp
+{
+
+/**
+ * @brief Type-erased unit of work that can be run by any thread of a WorkerPool
+ *
+ * Plain-old-data so that pushing and stealing jobs never allocates.
+ */
+struct WorkerJob
+{
+    using Func_t = void(*)(void *pUser, uint64_t arg, WorkerId worker) noexcept;
+
+    Func_t          func    { nullptr };
+    void            *pUser  { nullptr };
+    uint64_t        arg     { 0 };
+};
+
+/**
+ * @brief Fixed-size pool of threads, each with their own deque of jobs
+ *
+ * A thread pushes and pops jobs from the back of its own deque (LIFO, keeps recently touched data
+ * hot in cache), and steals from the front of other deques (FIFO, oldest jobs first) once its
+ * own deque runs dry. Idle threads sleep until new jobs are pushed.
+ *
+ * Threads outside of the pool (eg. the thread calling IExecutor::wait) can still participate
+ * through an extra deque reserved for them, see external_worker().
+ */
+class WorkerPool
+{
+public:
+
+    explicit WorkerPool(std::size_t threadCount);
+    WorkerPool(WorkerPool const& copy) = delete;
+    WorkerPool(WorkerPool&& move) = delete;
+    WorkerPool& operator=(WorkerPool const& copy) = delete;
+    WorkerPool& operator=(WorkerPool&& move) = delete;
+    ~WorkerPool();
+
+    /**
+     * @return Number of threads owned by the pool
+     */
+    [[nodiscard]] std::size_t thread_count() const noexcept { return m_threads.size(); }
+
+    /**
+     * @return Number of deques; pool threads plus one for external threads
+     */
+    [[nodiscard]] std::size_t worker_count() const noexcept { return m_threads.size() + 1; }
+
+    /**
+     * @return WorkerId used by threads that are not owned by the pool
+     */
+    [[nodiscard]] WorkerId external_worker() const noexcept { return WorkerId(m_threads.size()); }
+
+    /**
+     * @brief Push a job onto the back of a worker's deque and wake up a sleeping thread
+     *
+     * @param from  [in] Worker of the calling thread
+     * @param job   [in] Job to push
+     */
+    void push(WorkerId from, WorkerJob job);
+
+    /**
+     * @brief Push a job that only one particular worker is allowed to run
+     *
+     * Pinned jobs are never stolen. Jobs pinned to external_worker() only run once an external
+     * thread calls try_run_one with it.
+     *
+     * @param to    [in] Worker that runs the job
+     * @param job   [in] Job to push
+     */
+    void push_pinned(WorkerId to, WorkerJob job);
+
+    /**
+     * @return true if there are jobs pinned to a worker that haven't been popped yet
+     */
+    [[nodiscard]] bool has_pinned(WorkerId worker) const noexcept;
+
+    /**
+     * @brief Pop a job pinned to this worker, or from own deque, or steal one from another, and
+     *        run it
+     *
+     * @return true if a job was run
+     */
+    bool try_run_one(WorkerId worker);
+
+    /**
+     * @brief Remove a job from a worker's deque before any thread pops it
+     *
+     * @param worker    [in] Worker the job was pushed from
+     * @param job       [in] Job to remove, matched by func and pUser
+     *
+     * @return true if the job was removed, false if it was already popped
+     */
+    bool try_cancel(WorkerId worker, WorkerJob const& job);
+
+    /**
+     * @brief Call job.func count times across the pool, and wait until all calls are done
+     *
+     * job.func is called with arg going from 0 to count-1. The calling thread makes calls too,
+     * while copies of a helper job are pushed to its own deque for idle threads to steal.
+     * Helpers that aren't stolen by the time the caller runs out of calls are taken back, then
+     * the caller sleeps until stolen helpers finish their last call.
+     *
+     * Only calls of this job are made while waiting, so this is safe to call from inside
+     * another job without running unrelated work in the middle of it.
+     *
+     * @param from  [in] Worker of the calling thread
+     * @param count [in] Number of calls to make
+     * @param job   [in] Job to call, its arg is ignored
+     */
+    void fork_join(WorkerId from, uint64_t count, WorkerJob job);
+
+private:
+
+    struct alignas(64) JobDeque
+    {
+        std::mutex                  mutex;
+        std::deque<WorkerJob>       jobs;
+
+        /// Jobs only this worker can run, FIFO. Guarded by mutex too.
+        std::deque<WorkerJob>       pinned;
+        std::atomic<std::size_t>    pinnedPending   { 0 };
+    };
+
+    bool try_pop(WorkerId worker, WorkerJob &rJobOut);
+
+    void thread_main(WorkerId worker);
+
+    std::unique_ptr<JobDeque[]>     m_deques;
+    std::vector<std::thread>        m_threads;
+
+    std::mutex                      m_sleepMutex;
+    std::condition_variable         m_sleepCv;
+
+    /// Number of stealable jobs pushed that are not yet popped. Pinned jobs are not counted.
+    std::atomic<std::size_t>        m_jobsPending   { 0 };
+    std::atomic<bool>               m_stop          { false };
+
+}; // class WorkerPool
+
+} // namespace osp
@@ -0,0 +1,183 @@
+/**
+ * Open Space Program
+ * Copyright © 2019-2023 Open Space Program Project
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "coord_cache.h"
+
+#include <longeron/utility/asserts.hpp>
+
+#include <algorithm>
+
+namespace osp::universe
+{
+
+void coord_cache_mark_dirty(CoSpaceTransformCache &rCache, CoSpaceId const space)
+{
+    if (rCache.m_dirty.size() <= std::size_t(space))
+    {
+        bitvector_resize(rCache.m_dirty, std::size_t(space) + 1);
+    }
+    rCache.m_dirty.set(std::size_t(space));
+}
+
+void coord_cache_mark_sats_moved(CoSpaceTransformCache &rCache, Universe const& universe, CoSpaceId const satSpace)
+{
+    for (std::size_t const spaceInt : universe.m_coordIds.bitview().zeros())
+    {
+        CoSpaceCommon const &rSpace = universe.m_coordCommon[spaceInt];
+        if (rSpace.m_parent == satSpace && rSpace.m_parentSat != lgrn::id_null<SatId>())
+        {
+            coord_cache_mark_dirty(rCache, CoSpaceId(spaceInt));
+        }
+    }
+}
+
+/**
+ * @brief Recalculate a space's transforms if needed, after its parent's
+ *
+ * @return true if transforms of this space changed
+ */
+static bool update_space(CoSpaceTransformCache &rCache, Universe const& universe, CoSpaceId const space)
+{
+    if (rCache.m_visited.test(space))
+    {
+        return rCache.m_changed.test(space);
+    }
+    rCache.m_visited.set(space);
+
+    CoSpaceCommon const &rSpace  = universe.m_coordCommon[space];
+    CoSpaceId const     parent   = rSpace.m_parent;
+    bool const          isRoot   = (parent == lgrn::id_null<CoSpaceId>());
+
+    // Parents are updated first, so their ancestor transforms are valid to composite with
+    bool const parentChanged = ! isRoot && update_space(rCache, universe, parent);
+
+    CoSpaceCachedTfs &rTfs = rCache.m_spaces[space];
+
+    if ( ! (parentChanged || rCache.m_dirty.test(space) || rTfs.m_parent != parent) )
+    {
+        return false;
+    }
+
+    rCache.m_changed.set(space);
+    rTfs.m_parent = parent;
+
+    if (isRoot)
+    {
+        rTfs.m_toAncestor  .clear();
+        rTfs.m_fromAncestor.clear();
+        return true;
+    }
+
+    CoSpaceCommon const     &rParent    = universe.m_coordCommon[parent];
+    CoSpaceCachedTfs const  &rParentTfs = rCache.m_spaces[parent];
+
+    CoSpaceTransform const tf = coord_get_transform(rSpace, rParent);
+
+    std::size_t const depth = rParentTfs.m_toAncestor.size() + 1;
+    rTfs.m_toAncestor  .resize(depth);
+    rTfs.m_fromAncestor.resize(depth);
+
+    rTfs.m_toAncestor[0]   = coord_child_to_parent(rParent, tf);
+    rTfs.m_fromAncestor[0] = coord_parent_to_child(rParent, tf);
+
+    for (std::size_t i = 1; i < depth; ++i)
+    {
+        rTfs.m_toAncestor[i]   = coord_composite(rParentTfs.m_toAncestor[i - 1], rTfs.m_toAncestor[0]);
+        rTfs.m_fromAncestor[i] = coord_composite(rTfs.m_fromAncestor[0], rParentTfs.m_fromAncestor[i - 1]);
+    }
+
+    return true;
+}
+
+void coord_cache_update(CoSpaceTransformCache &rCache, Universe const& universe)
+{
+    std::size_t const capacity = universe.m_coordIds.capacity();
+
+    rCache.m_spaces.resize(std::max(rCache.m_spaces.size(), capacity));
+    bitvector_resize(rCache.m_dirty,   rCache.m_spaces.size());
+    bitvector_resize(rCache.m_visited, rCache.m_spaces.size());
+    bitvector_resize(rCache.m_changed, rCache.m_spaces.size());
+
+    for (std::size_t const spaceInt : universe.m_coordIds.bitview().zeros())
+    {
+        update_space(rCache, universe, CoSpaceId(spaceInt));
+    }
+
+    rCache.m_dirty  .reset();
+    rCache.m_visited.reset();
+    rCache.m_changed.reset();
+}
+
+CoordTransformer coord_cache_get(CoSpaceTransformCache const& cache, CoSpaceId const from, CoSpaceId const to)
+{
+    LGRN_ASSERTMV(std::size_t(from) < cache.m_spaces.size() && std::size_t(to) < cache.m_spaces.size(),
+                  "Coordinate space is not cached yet, call coord_cache_update first", from, to);
+
+    auto const depth_of = [&cache] (CoSpaceId const space) noexcept
+    {
+        return cache.m_spaces[space].m_toAncestor.size();
+    };
+
+    // Walk both spaces up to their lowest common ancestor, counting steps taken
+    CoSpaceId   fromAncestor = from;
+    CoSpaceId   toAncestor   = to;
+    std::size_t fromSteps    = 0;
+    std::size_t toSteps      = 0;
+
+    while (depth_of(fromAncestor) > depth_of(toAncestor))
+    {
+        fromAncestor = cache.m_spaces[fromAncestor].m_parent;
+        ++fromSteps;
+    }
+    while (depth_of(toAncestor) > depth_of(fromAncestor))
+    {
+        toAncestor = cache.m_spaces[toAncestor].m_parent;
+        ++toSteps;
+    }
+    while (fromAncestor != toAncestor)
+    {
+        LGRN_ASSERTMV(depth_of(fromAncestor) != 0, "Coordinate spaces are in separate hierarchies", from, to);
+        fromAncestor = cache.m_spaces[fromAncestor].m_parent;
+        toAncestor   = cache.m_spaces[toAncestor]  .m_parent;
+        ++fromSteps;
+        ++toSteps;
+    }
+
+    if (fromSteps == 0 && toSteps == 0)
+    {
+        return {}; // Same space
+    }
+    if (toSteps == 0)
+    {
+        return cache.m_spaces[from].m_toAncestor[fromSteps - 1];
+    }
+    if (fromSteps == 0)
+    {
+        return cache.m_spaces[to].m_fromAncestor[toSteps - 1];
+    }
+    return coord_composite(cache.m_spaces[to]  .m_fromAncestor[toSteps - 1],
+                           cache.m_spaces[from].m_toAncestor  [fromSteps - 1]);
+}
+
+} // namespace osp::universe
@@ -0,0 +1,95 @@
+/**
+ * Open Space Program
+ * Copyright © 2019-2023 Open Space Program Project
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include "coordinates.h"
+
+#include "../core/bitvector.h"
+
+#include <vector>
+
+namespace osp::universe
+{
+
+/**
+ * @brief Cached transforms between one coordinate space and each of its ancestors
+ */
+struct CoSpaceCachedTfs
+{
+    /// Parent these were calculated with. Reparenting a space invalidates its cache.
+    CoSpaceId                       m_parent{lgrn::id_null<CoSpaceId>()};
+
+    /// From this space to each ancestor; [0] is the parent, [1] the grandparent, ...
+    std::vector<CoordTransformer>   m_toAncestor;
+
+    /// From each ancestor to this space, same order as m_toAncestor
+    std::vector<CoordTransformer>   m_fromAncestor;
+};
+
+/**
+ * @brief Composited CoordTransformers across the hierarchy of coordinate spaces of a Universe
+ *
+ * Space transforms are only recalculated when marked dirty, or when an ancestor was, so deep
+ * hierarchies (star -> planet -> moon -> station) don't recomposite everything every frame.
+ *
+ * Mark a space dirty if its CoSpaceTransform changes or if it's (re)created. Spaces parented to a
+ * satellite also need to be marked when the satellite moves, see coord_cache_mark_sats_moved.
+ * Reparenting is detected automatically.
+ */
+struct CoSpaceTransformCache
+{
+    std::vector<CoSpaceCachedTfs>   m_spaces;   ///< Indexed by CoSpaceId
+
+    BitVector_t                     m_dirty;
+
+    // Scratch for coord_cache_update
+    BitVector_t                     m_visited;
+    BitVector_t                     m_changed;
+};
+
+void coord_cache_mark_dirty(CoSpaceTransformCache &rCache, CoSpaceId space);
+
+/**
+ * @brief Mark all spaces parented to a satellite of satSpace as dirty
+ *
+ * Call after satellites of satSpace move.
+ */
+void coord_cache_mark_sats_moved(CoSpaceTransformCache &rCache, Universe const& universe, CoSpaceId satSpace);
+
+/**
+ * @brief Recalculate transforms of dirty spaces and their descendants, then clear dirty bits
+ */
+void coord_cache_update(CoSpaceTransformCache &rCache, Universe const& universe);
+
+/**
+ * @brief Get a transform from one coordinate space to another through their lowest common
+ *        ancestor
+ *
+ * Spaces must be within the same hierarchy, and the cache must be up to date; call
+ * coord_cache_update after creating spaces, before any transforms between them are read.
+ */
+CoordTransformer coord_cache_get(CoSpaceTransformCache const& cache, CoSpaceId from, CoSpaceId to);
+
+} // namespace osp::universe
@@ -0,0 +1,223 @@
+/**
+ * Open Space Program
+ * Copyright © 2019-2023 Open Space Program Project
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "coordinates.h"
+#include "simd_convert.h"
+
+#include <longeron/utility/asserts.hpp>
+
+#include <algorithm>
+#include <array>
+
+namespace osp::universe
+{
+
+/// Positions are copied into contiguous blocks of this size, so each step runs over plain arrays.
+/// Reading a whole block before writing it makes transforming in-place safe.
+constexpr std::size_t gc_transformBlockSize = 64;
+
+using TransformBlock_t = std::array<spaceint_t, gc_transformBlockSize>;
+
+static void rotate_block(
+        Magnum::Math::Matrix3x3<double> const& mat,
+        TransformBlock_t &rX, TransformBlock_t &rY, TransformBlock_t &rZ,
+        std::size_t const count) noexcept
+{
+    // Matrix is column-major
+    double const m00 = mat[0][0], m01 = mat[1][0], m02 = mat[2][0];
+    double const m10 = mat[0][1], m11 = mat[1][1], m12 = mat[2][1];
+    double const m20 = mat[0][2], m21 = mat[1][2], m22 = mat[2][2];
+
+    auto const rotate_one = [&] (std::size_t const i) noexcept
+    {
+        double const x = double(rX[i]);
+        double const y = double(rY[i]);
+        double const z = double(rZ[i]);
+
+        // Truncate, same as converting Vector3d to Vector3g
+        rX[i] = spaceint_t(m00 * x + m01 * y + m02 * z);
+        rY[i] = spaceint_t(m10 * x + m11 * y + m12 * z);
+        rZ[i] = spaceint_t(m20 * x + m21 * y + m22 * z);
+    };
+
+    std::size_t i = 0;
+
+#if defined(OSP_UNIVERSE_AVX2)
+    // Compilers can't vectorize int64 <-> double conversions without AVX-512, so convert
+    // explicitly, see simd_convert.h. Rows of a rotation matrix are unit length, so outputs are
+    // at most sqrt(3) times larger than inputs. Inputs within gc_exactLimit stay under 2^51 and
+    // convert back exactly.
+    __m256d const v00 = _mm256_set1_pd(m00), v01 = _mm256_set1_pd(m01), v02 = _mm256_set1_pd(m02);
+    __m256d const v10 = _mm256_set1_pd(m10), v11 = _mm256_set1_pd(m11), v12 = _mm256_set1_pd(m12);
+    __m256d const v20 = _mm256_set1_pd(m20), v21 = _mm256_set1_pd(m21), v22 = _mm256_set1_pd(m22);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m256i const xInt = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(rX.data() + i));
+        __m256i const yInt = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(rY.data() + i));
+        __m256i const zInt = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(rZ.data() + i));
+
+        __m256i const outside = _mm256_or_si256(int64_outside_exact(xInt),
+                                                _mm256_or_si256(int64_outside_exact(yInt), int64_outside_exact(zInt)));
+        if ( ! _mm256_testz_si256(outside, outside) )
+        {
+            for (std::size_t j = i; j < i + 4; ++j)
+            {
+                rotate_one(j);
+            }
+            continue;
+        }
+
+        __m256d const x = int64_to_double(xInt);
+        __m256d const y = int64_to_double(yInt);
+        __m256d const z = int64_to_double(zInt);
+
+        // Same order of operations as rotate_one
+        auto const row = [x, y, z] (__m256d const a, __m256d const b, __m256d const c) noexcept
+        {
+            __m256d const sum = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(a, x), _mm256_mul_pd(b, y)), _mm256_mul_pd(c, z));
+            return double_to_int64(_mm256_round_pd(sum, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC));
+        };
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(rX.data() + i), row(v00, v01, v02));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(rY.data() + i), row(v10, v11, v12));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(rZ.data() + i), row(v20, v21, v22));
+    }
+#endif // defined(OSP_UNIVERSE_AVX2)
+
+    for (; i < count; ++i)
+    {
+        rotate_one(i);
+    }
+}
+
+/// rComp = rComp * 2^n + offset
+static void scale_offset_block(TransformBlock_t &rComp, int const n, spaceint_t const offset, std::size_t const count) noexcept
+{
+    using osp::math::int_2pow;
+
+    if (n >= 0)
+    {
+        // Shift instead of multiplying, as there's no packed 64-bit multiply before AVX-512.
+        // Shifts and adds vectorize with plain SSE2.
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            rComp[i] = (rComp[i] << n) + offset;
+        }
+        return;
+    }
+
+    // Divide by 2^-n rounding towards zero like mul_2pow does, but with shifts. Negative values
+    // are biased up by 2^-n - 1 first, as shifting alone rounds towards -infinity.
+    int const        shift = -n;
+    spaceint_t const bias  = int_2pow<spaceint_t>(shift) - 1;
+
+    std::size_t i = 0;
+
+#if defined(OSP_UNIVERSE_AVX2)
+    // AVX2 has no 64-bit arithmetic shift either. Shift logically, then fill in the sign bits.
+    __m256i const zero      = _mm256_setzero_si256();
+    __m256i const biasVec   = _mm256_set1_epi64x(bias);
+    __m256i const offsetVec = _mm256_set1_epi64x(offset);
+    __m128i const shiftVec  = _mm_cvtsi32_si128(shift);
+    __m128i const fillVec   = _mm_cvtsi32_si128(64 - shift);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m256i const value   = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(rComp.data() + i));
+        __m256i const biased  = _mm256_add_epi64(value, _mm256_and_si256(_mm256_cmpgt_epi64(zero, value), biasVec));
+        __m256i const sign    = _mm256_cmpgt_epi64(zero, biased);
+        __m256i const shifted = _mm256_or_si256(_mm256_srl_epi64(biased, shiftVec), _mm256_sll_epi64(sign, fillVec));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(rComp.data() + i), _mm256_add_epi64(shifted, offsetVec));
+    }
+#endif // defined(OSP_UNIVERSE_AVX2)
+
+    for (; i < count; ++i)
+    {
+        spaceint_t const value = rComp[i];
+        rComp[i] = ((value + ((value >> 63) & bias)) >> shift) + offset;
+    }
+}
+
+void CoordTransformer::transform_positions(
+        Corrade::Containers::StridedArrayView1D<spaceint_t const> const inX,
+        Corrade::Containers::StridedArrayView1D<spaceint_t const> const inY,
+        Corrade::Containers::StridedArrayView1D<spaceint_t const> const inZ,
+        Corrade::Containers::StridedArrayView1D<spaceint_t>       const outX,
+        Corrade::Containers::StridedArrayView1D<spaceint_t>       const outY,
+        Corrade::Containers::StridedArrayView1D<spaceint_t>       const outZ) const noexcept
+{
+    using osp::math::mul_2pow;
+    using Matrix3x3d = Magnum::Math::Matrix3x3<double>;
+
+    std::size_t const count = inX.size();
+    LGRN_ASSERTM(   inY.size()  == count && inZ.size()  == count
+                 && outX.size() == count && outY.size() == count && outZ.size() == count,
+                 "All views must be the same size");
+
+    bool const          hasRotIn    = quat_non_zero(m_rotIn);
+    bool const          hasRotOut   = quat_non_zero(m_rotOut);
+    Matrix3x3d const    matIn       = hasRotIn  ? m_rotIn.toMatrix()  : Matrix3x3d{};
+    Matrix3x3d const    matOut      = hasRotOut ? m_rotOut.toMatrix() : Matrix3x3d{};
+    Vector3g const      offset      = mul_2pow<Vector3g, spaceint_t>(m_c, m_m);
+
+    TransformBlock_t x;
+    TransformBlock_t y;
+    TransformBlock_t z;
+
+    for (std::size_t first = 0; first < count; first += gc_transformBlockSize)
+    {
+        std::size_t const size = std::min(gc_transformBlockSize, count - first);
+
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            x[i] = inX[first + i];
+            y[i] = inY[first + i];
+            z[i] = inZ[first + i];
+        }
+
+        if (hasRotIn)
+        {
+            rotate_block(matIn, x, y, z, size);
+        }
+
+        scale_offset_block(x, m_n, offset.x(), size);
+        scale_offset_block(y, m_n, offset.y(), size);
+        scale_offset_block(z, m_n, offset.z(), size);
+
+        if (hasRotOut)
+        {
+            rotate_block(matOut, x, y, z, size);
+        }
+
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            outX[first + i] = x[i];
+            outY[first + i] = y[i];
+            outZ[first + i] = z[i];
+        }
+    }
+}
+
+} // namespace osp::universe
@@ -127,6 +127,24 @@ struct CoordTransformer
         return out;
     }
 
+    /**
+     * @brief Transform many positions, same as calling transform_position on each
+     *
+     * Rotation matrices and offsets are calculated once, and positions are processed in blocks.
+     * When built with AVX2 (OSP_ENABLE_AVX2), four positions are rotated and scaled at a time.
+     * Rotations may round differently from transform_position by a unit.
+     *
+     * Outputs can be the same views as the inputs to transform in-place, but must not otherwise
+     * overlap them.
+     */
+    void transform_positions(
+            Corrade::Containers::StridedArrayView1D<spaceint_t const> inX,
+            Corrade::Containers::StridedArrayView1D<spaceint_t const> inY,
+            Corrade::Containers::StridedArrayView1D<spaceint_t const> inZ,
+            Corrade::Containers::StridedArrayView1D<spaceint_t>       outX,
+            Corrade::Containers::StridedArrayView1D<spaceint_t>       outY,
+            Corrade::Containers::StridedArrayView1D<spaceint_t>       outZ) const noexcept;
+
     Quaterniond rotation() const noexcept
     {
         return m_rotOut * m_rotIn;
@@ -0,0 +1,157 @@
+/**
+ * Open Space Program
+ * Copyright © 2019-2023 Open Space Program Project
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "sat_data.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace osp::universe
+{
+
+/**
+ * @brief Call func(descA, descB) for each pair of matching component arrays of a and b
+ */
+template <typename FUNC_T>
+static void for_each_component(CoSpaceSatData const& a, CoSpaceSatData const& b, FUNC_T&& func)
+{
+    for (std::size_t i = 0; i < 3; ++i)
+    {
+        func(a.m_satPositions[i],   b.m_satPositions[i]);
+        func(a.m_satVelocities[i],  b.m_satVelocities[i]);
+        func(a.m_satAngularVels[i], b.m_satAngularVels[i]);
+    }
+    for (std::size_t i = 0; i < 4; ++i)
+    {
+        func(a.m_satRotations[i], b.m_satRotations[i]);
+    }
+    func(a.m_satMasses, b.m_satMasses);
+}
+
+void sat_data_reserve(CoSpaceSatData &rData, uint32_t const capacity)
+{
+    if (capacity <= rData.m_satCapacity)
+    {
+        return;
+    }
+
+    std::size_t const count = rData.m_satCount;
+
+    CoSpaceSatData grown;
+    sat_data_allocate(grown, capacity);
+
+    if (count != 0) // Nothing allocated to copy from otherwise
+    {
+        for_each_component(rData, grown, [&rData, &grown, count] (auto const& src, auto const& dst)
+        {
+            auto const srcView = src.view(Corrade::Containers::arrayView(std::as_const(rData.m_data)), count);
+            auto const dstView = dst.view(Corrade::Containers::arrayView(grown.m_data), count);
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                dstView[i] = srcView[i];
+            }
+        });
+    }
+
+    grown.m_satCount     = rData.m_satCount;
+    grown.m_satIds       = std::move(rData.m_satIds);
+    grown.m_satIdToIndex = std::move(rData.m_satIdToIndex);
+    grown.m_satIndexToId = std::move(rData.m_satIndexToId);
+
+    rData = std::move(grown);
+}
+
+SatId sat_create(CoSpaceSatData &rData)
+{
+    if (rData.m_satCount == rData.m_satCapacity)
+    {
+        sat_data_reserve(rData, std::max<uint32_t>(16, rData.m_satCapacity * 2));
+    }
+
+    SatId const       sat   = rData.m_satIds.create();
+    std::size_t const index = rData.m_satCount;
+    ++rData.m_satCount;
+
+    rData.m_satIdToIndex.resize(rData.m_satIds.capacity(), lgrn::id_null<uint32_t>());
+    rData.m_satIdToIndex[sat] = uint32_t(index);
+    rData.m_satIndexToId.resize(rData.m_satCount);
+    rData.m_satIndexToId[index] = sat;
+
+    for_each_component(rData, rData, [&rData, index] (auto const& desc, auto const& /*unused*/)
+    {
+        desc.view(Corrade::Containers::arrayView(rData.m_data), index + 1)[index] = {};
+    });
+
+    rData.m_satRotations[3].view(Corrade::Containers::arrayView(rData.m_data), index + 1)[index] = 1.0;
+
+    return sat;
+}
+
+void sat_remove(CoSpaceSatData &rData, SatId const sat)
+{
+    std::size_t const index = sat_index(rData, sat);
+    std::size_t const last  = rData.m_satCount - 1;
+
+    if (index != last)
+    {
+        for_each_component(rData, rData, [&rData, index, last] (auto const& desc, auto const& /*unused*/)
+        {
+            auto const view = desc.view(Corrade::Containers::arrayView(rData.m_data), last + 1);
+            view[index] = view[last];
+        });
+
+        SatId const moved = rData.m_satIndexToId[last];
+        rData.m_satIndexToId[index] = moved;
+        rData.m_satIdToIndex[moved] = uint32_t(index);
+    }
+
+    rData.m_satIndexToId.pop_back();
+    rData.m_satIdToIndex[sat] = lgrn::id_null<uint32_t>();
+    rData.m_satIds.remove(sat);
+    --rData.m_satCount;
+}
+
+void sat_data_swap(CoSpaceSatData &rData, std::size_t const indexA, std::size_t const indexB) noexcept
+{
+    LGRN_ASSERTV(indexA < rData.m_satCount && indexB < rData.m_satCount, indexA, indexB, rData.m_satCount);
+
+    for_each_component(rData, rData, [&rData, indexA, indexB] (auto const& desc, auto const& /*unused*/)
+    {
+        auto const view = desc.view(Corrade::Containers::arrayView(rData.m_data), rData.m_satCount);
+        std::swap(view[indexA], view[indexB]);
+    });
+
+    // Satellites added by setting m_satCount directly have no IDs to update
+    if (rData.m_satIndexToId.size() == rData.m_satCount)
+    {
+        SatId const satA = rData.m_satIndexToId[indexA];
+        SatId const satB = rData.m_satIndexToId[indexB];
+        rData.m_satIndexToId[indexA] = satB;
+        rData.m_satIndexToId[indexB] = satA;
+        rData.m_satIdToIndex[satA]   = uint32_t(indexB);
+        rData.m_satIdToIndex[satB]   = uint32_t(indexA);
+    }
+}
+
+} // namespace osp::universe
@@ -0,0 +1,68 @@
+/**
+ * Open Space Program
+ * Copyright © 2019-2023 Open Space Program Project
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include "universe.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace osp::universe
+{
+
+/**
+ * @brief Grow capacity of satellite data, keeping existing satellites
+ *
+ * All component arrays are repartitioned into a single new allocation, see sat_data_allocate.
+ * Does nothing if capacity is already large enough.
+ */
+void sat_data_reserve(CoSpaceSatData &rData, uint32_t capacity);
+
+/**
+ * @brief Add a satellite to the end of the component arrays
+ *
+ * IDs of removed satellites are reused. Capacity doubles when full, so adding many satellites
+ * only reallocates a few times. The new satellite is zeroed, with no rotation.
+ *
+ * @return ID of the new satellite, see sat_index to access its components
+ */
+SatId sat_create(CoSpaceSatData &rData);
+
+/**
+ * @brief Remove a satellite, moving the last satellite into its place
+ *
+ * Component arrays stay dense and their capacity is kept. The index of the last satellite changes,
+ * but its ID does not. Coordinate spaces parented to the removed satellite are not modified.
+ */
+void sat_remove(CoSpaceSatData &rData, SatId sat);
+
+/**
+ * @brief Swap two satellites within the component arrays, keeping their IDs
+ *
+ * Used to reorder satellites, such as grouping ones that are processed the same way together.
+ */
+void sat_data_swap(CoSpaceSatData &rData, std::size_t indexA, std::size_t indexB) noexcept;
+
+} // namespace osp::universe
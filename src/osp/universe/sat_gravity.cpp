@@ -0,0 +1,314 @@
+/**
+ * Open Space Program
+ * Copyright © 2019-2023 Open Space Program Project
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "sat_gravity.h"
+
+#include <longeron/utility/asserts.hpp>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <numeric>
+
+namespace osp::universe
+{
+
+/// Bits per axis in a Morton code; 3 * 21 = 63 bits. Also the maximum depth of the octree.
+constexpr int           gc_mortonBits   = 21;
+
+/// Nodes with this many satellites or fewer are not split further
+constexpr uint32_t      gc_leafSize     = 8;
+
+/// Enough for a depth-first walk: up to 7 siblings left on the stack per level
+constexpr std::size_t   gc_walkStackSize = 8 * (gc_mortonBits + 1);
+
+/// Spread the low 21 bits of in, leaving two zero bits between each
+static constexpr uint64_t morton_spread(uint64_t in) noexcept
+{
+    in &= 0x1fffff;
+    in = (in | in << 32) & 0x1f00000000ffff;
+    in = (in | in << 16) & 0x1f0000ff0000ff;
+    in = (in | in << 8)  & 0x100f00f00f00f00f;
+    in = (in | in << 4)  & 0x10c30c30c30c30c3;
+    in = (in | in << 2)  & 0x1249249249249249;
+    return in;
+}
+
+/**
+ * @brief Sort satellites by Morton code, starting from the previous order
+ *
+ * Insertion sort is near-linear when few satellites changed places since the last build. If it's
+ * moving too much, it gives up and lets std::sort finish the job.
+ */
+static void sort_by_code(std::vector<uint32_t> &rOrder, std::vector<uint64_t> const& codes)
+{
+    std::size_t const count  = rOrder.size();
+    std::size_t       budget = 8 * count;
+
+    for (std::size_t i = 1; i < count; ++i)
+    {
+        uint32_t const sat  = rOrder[i];
+        uint64_t const code = codes[sat];
+
+        std::size_t j = i;
+        while (j != 0 && codes[rOrder[j - 1]] > code)
+        {
+            rOrder[j] = rOrder[j - 1];
+            --j;
+        }
+        rOrder[j] = sat;
+
+        if (i - j > budget)
+        {
+            std::sort(rOrder.begin(), rOrder.end(), [&codes] (uint32_t const lhs, uint32_t const rhs)
+            {
+                return codes[lhs] < codes[rhs];
+            });
+            return;
+        }
+        budget -= i - j;
+    }
+}
+
+/**
+ * @brief Split a node into children by the next 3 bits of its Morton codes, recursively, then
+ *        sum up its mass and center of mass
+ */
+static void build_node(SatOctree &rTree, uint32_t const nodeIdx, int const depth)
+{
+    // Copy, as m_nodes may reallocate while adding children
+    SatOctreeNode node = rTree.m_nodes[nodeIdx];
+
+    Vector3d weightedPos{0.0, 0.0, 0.0};
+    node.m_mass = 0.0;
+
+    if (node.m_last - node.m_first > gc_leafSize && depth < gc_mortonBits)
+    {
+        // Satellites within this node share the top 3*depth bits of their codes, and are sorted,
+        // so each child is a run of the same next 3 bits.
+        int const bitPos = 3 * (gc_mortonBits - 1 - depth);
+        auto const octant_of = [&rTree, bitPos] (uint32_t const orderIdx) noexcept
+        {
+            return (rTree.m_codes[rTree.m_order[orderIdx]] >> bitPos) & 7;
+        };
+
+        node.m_firstChild = uint32_t(rTree.m_nodes.size());
+
+        uint32_t runFirst = node.m_first;
+        while (runFirst != node.m_last)
+        {
+            uint64_t const octant  = octant_of(runFirst);
+            uint32_t       runLast = runFirst + 1;
+            while (runLast != node.m_last && octant_of(runLast) == octant)
+            {
+                ++runLast;
+            }
+
+            rTree.m_nodes.push_back({ .m_centerOfMass = {}, .m_size = node.m_size * 0.5, .m_first = runFirst, .m_last = runLast });
+            runFirst = runLast;
+        }
+
+        node.m_childCount = uint32_t(rTree.m_nodes.size()) - node.m_firstChild;
+
+        for (uint32_t child = node.m_firstChild; child < node.m_firstChild + node.m_childCount; ++child)
+        {
+            build_node(rTree, child, depth + 1);
+
+            SatOctreeNode const &rChild = rTree.m_nodes[child];
+            weightedPos += rChild.m_centerOfMass * rChild.m_mass;
+            node.m_mass += rChild.m_mass;
+        }
+    }
+    else
+    {
+        for (uint32_t i = node.m_first; i < node.m_last; ++i)
+        {
+            weightedPos += rTree.m_positions[i] * rTree.m_masses[i];
+            node.m_mass += rTree.m_masses[i];
+        }
+    }
+
+    // Massless nodes never pull on anything, any position inside them works
+    node.m_centerOfMass = (node.m_mass > 0.0) ? weightedPos / node.m_mass
+                                              : rTree.m_positions[node.m_first];
+
+    rTree.m_nodes[nodeIdx] = node;
+}
+
+void sat_octree_build(SatOctree &rTree, CoSpaceSatData const& data)
+{
+    std::size_t const count = data.m_satCount;
+
+    auto const pos  = sat_views(data.m_satPositions, data.m_data, count);
+    auto const mass = data.m_satMasses.view(Corrade::Containers::arrayView(data.m_data), count);
+
+    rTree.m_nodes.clear();
+
+    // Satellites were added or removed, the previous order is meaningless
+    if (rTree.m_order.size() != count)
+    {
+        rTree.m_order.resize(count);
+        std::iota(rTree.m_order.begin(), rTree.m_order.end(), 0u);
+    }
+
+    rTree.m_codes    .resize(count);
+    rTree.m_positions.resize(count);
+    rTree.m_masses   .resize(count);
+
+    if (count == 0)
+    {
+        return;
+    }
+
+    // Find a power-of-two sized root cube that fits all satellites. Differences are taken as
+    // unsigned, as positions on opposite ends of spaceint_t overflow a signed difference.
+    std::array<spaceint_t, 3> lower{pos[0][0], pos[1][0], pos[2][0]};
+    std::array<spaceint_t, 3> upper = lower;
+    for (std::size_t sat = 1; sat < count; ++sat)
+    {
+        for (std::size_t axis = 0; axis < 3; ++axis)
+        {
+            lower[axis] = std::min(lower[axis], pos[axis][sat]);
+            upper[axis] = std::max(upper[axis], pos[axis][sat]);
+        }
+    }
+
+    uint64_t span = 0;
+    for (std::size_t axis = 0; axis < 3; ++axis)
+    {
+        span = std::max(span, uint64_t(upper[axis]) - uint64_t(lower[axis]));
+    }
+
+    int const rootLevel = std::max(int(std::bit_width(span)), gc_mortonBits);
+    int const shift     = rootLevel - gc_mortonBits;
+
+    rTree.m_origin = Vector3g{lower[0], lower[1], lower[2]};
+
+    auto const offset = [&pos, &lower] (std::size_t const axis, std::size_t const sat) noexcept
+    {
+        return uint64_t(pos[axis][sat]) - uint64_t(lower[axis]);
+    };
+
+    for (std::size_t sat = 0; sat < count; ++sat)
+    {
+        rTree.m_codes[sat] =   morton_spread(offset(0, sat) >> shift)
+                             | morton_spread(offset(1, sat) >> shift) << 1
+                             | morton_spread(offset(2, sat) >> shift) << 2;
+    }
+
+    sort_by_code(rTree.m_order, rTree.m_codes);
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        uint32_t const sat = rTree.m_order[i];
+        rTree.m_positions[i] = Vector3d{double(offset(0, sat)), double(offset(1, sat)), double(offset(2, sat))};
+        rTree.m_masses[i]    = mass[sat];
+    }
+
+    rTree.m_nodes.push_back({ .m_centerOfMass = {}, .m_size = std::ldexp(1.0, rootLevel), .m_first = 0, .m_last = uint32_t(count) });
+    build_node(rTree, 0, 0);
+}
+
+void sat_gravity_apply(
+        SatOctree const&        tree,
+        CoSpaceSatData&         rData,
+        std::size_t const       first,
+        std::size_t const       last,
+        SatGravityParams const& params) noexcept
+{
+    LGRN_ASSERTV(last <= tree.m_order.size(), last, tree.m_order.size());
+
+    auto const [vx, vy, vz] = sat_views(rData.m_satVelocities, rData.m_data, rData.m_satCount);
+
+    // Work in position units: a = G*m*d / |d|^3 in meters becomes G*m*d / (metersPerUnit^2 |d|^3)
+    double const unitsSoftening = params.m_softening / params.m_metersPerUnit;
+    double const softening2     = unitsSoftening * unitsSoftening;
+    double const openingAngle2  = params.m_openingAngle * params.m_openingAngle;
+    double const velPerAccel    =   params.m_gravConstant * params.m_deltaTime
+                                  / (params.m_metersPerUnit * params.m_metersPerUnit);
+
+    std::array<uint32_t, gc_walkStackSize> stack;
+
+    for (std::size_t i = first; i < last; ++i)
+    {
+        Vector3d const  pos = tree.m_positions[i];
+        Vector3d        accel{0.0, 0.0, 0.0};
+
+        auto const pull = [&accel, pos, softening2] (Vector3d const other, double const mass) noexcept
+        {
+            Vector3d const diff = other - pos;
+            double const   r2   = Magnum::Math::dot(diff, diff) + softening2;
+
+            // Satellites at the same position pull in no particular direction. Without softening,
+            // this would divide by zero, and new satellites all start at the origin.
+            if (r2 == 0.0)
+            {
+                return;
+            }
+
+            accel += diff * (mass / (r2 * std::sqrt(r2)));
+        };
+
+        std::size_t stackSize = 0;
+        stack[stackSize++] = 0;
+
+        while (stackSize != 0)
+        {
+            SatOctreeNode const &rNode = tree.m_nodes[stack[--stackSize]];
+
+            if (rNode.m_childCount == 0)
+            {
+                for (uint32_t j = rNode.m_first; j < rNode.m_last; ++j)
+                {
+                    if (j != i)
+                    {
+                        pull(tree.m_positions[j], tree.m_masses[j]);
+                    }
+                }
+                continue;
+            }
+
+            Vector3d const diff = rNode.m_centerOfMass - pos;
+            if (rNode.m_size * rNode.m_size < openingAngle2 * Magnum::Math::dot(diff, diff))
+            {
+                pull(rNode.m_centerOfMass, rNode.m_mass);
+            }
+            else
+            {
+                for (uint32_t child = rNode.m_firstChild; child < rNode.m_firstChild + rNode.m_childCount; ++child)
+                {
+                    stack[stackSize++] = child;
+                }
+            }
+        }
+
+        uint32_t const sat = tree.m_order[i];
+        vx[sat] += accel.x() * velPerAccel;
+        vy[sat] += accel.y() * velPerAccel;
+        vz[sat] += accel.z() * velPerAccel;
+    }
+}
+
+} // namespace osp::universe
@@ -0,0 +1,112 @@
+/**
+ * Open Space Program
+ * Copyright © 2019-2023 Open Space Program Project
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include "universe.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace osp::universe
+{
+
+struct SatGravityParams
+{
+    double  m_deltaTime{0.0};
+
+    /// Size of one position unit in meters, 2^-precision of the coordinate space
+    double  m_metersPerUnit{1.0};
+
+    double  m_gravConstant{6.6743e-11};
+
+    /// Barnes-Hut opening angle. A node is used as a single point mass if its size divided by its
+    /// distance is smaller than this. 0 is exact (and slow), larger is faster but less accurate.
+    double  m_openingAngle{0.5};
+
+    /// Plummer softening length in meters, avoids huge accelerations between close satellites
+    double  m_softening{0.0};
+};
+
+struct SatOctreeNode
+{
+    Vector3d    m_centerOfMass;     ///< Position units, relative to SatOctree::m_origin
+    double      m_mass{0.0};
+    double      m_size{0.0};        ///< Edge length of this node's cube, position units
+
+    uint32_t    m_firstChild{0};    ///< Children are contiguous in SatOctree::m_nodes
+    uint32_t    m_childCount{0};    ///< 0 for leaves
+
+    /// Range of SatOctree::m_order within this node
+    uint32_t    m_first{0};
+    uint32_t    m_last{0};
+};
+
+/**
+ * @brief Octree over the satellites of a coordinate space, for Barnes-Hut N-body gravity
+ *
+ * Satellites are sorted along a Morton (Z-order) curve, and each node is a contiguous range of
+ * that order. The order is kept between builds; satellites move little each step, so re-sorting is
+ * nearly linear. Storage is reused too, so rebuilding every step doesn't allocate.
+ */
+struct SatOctree
+{
+    /// Minimum corner of the root node's cube
+    Vector3g                    m_origin;
+
+    std::vector<SatOctreeNode>  m_nodes;
+
+    /// Satellites sorted by Morton code
+    std::vector<uint32_t>       m_order;
+    std::vector<uint64_t>       m_codes;
+
+    // Positions and masses of satellites in m_order, copied for locality
+    std::vector<Vector3d>       m_positions; ///< Position units, relative to m_origin
+    std::vector<double>         m_masses;
+};
+
+/**
+ * @brief Rebuild an octree from the current positions and masses of satellites
+ *
+ * Not thread-safe; run this in a single task before sat_gravity_apply.
+ */
+void sat_octree_build(SatOctree &rTree, CoSpaceSatData const& data);
+
+/**
+ * @brief Accelerate satellites by the gravity of all others over one time step
+ *
+ * [first, last) indexes SatOctree::m_order rather than satellite IDs, so each range holds
+ * satellites close to each other that walk similar parts of the tree. Only velocities of
+ * satellites in the range are written, so [0, m_order.size()) can be split across threads,
+ * see parallel_for.
+ */
+void sat_gravity_apply(
+        SatOctree const&        tree,
+        CoSpaceSatData&         rData,
+        std::size_t             first,
+        std::size_t             last,
+        SatGravityParams const& params) noexcept;
+
+} // namespace osp::universe
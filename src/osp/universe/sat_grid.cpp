@@ -0,0 +1,147 @@
+/**
+ * Open Space Program
+ * Copyright © 2019-2023 Open Space Program Project
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "sat_grid.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace osp::universe
+{
+
+void sat_grid_build(SatGrid &rGrid, CoSpaceSatData const& data, int const cellLevel)
+{
+    std::size_t const count  = data.m_satCount;
+    bool const        hasIds = data.m_satIndexToId.size() == count;
+
+    auto const [x, y, z] = sat_views(data.m_satPositions, data.m_data, count);
+
+    // At least as many buckets as satellites keeps buckets short
+    std::size_t const bucketCount = std::bit_ceil(std::max<std::size_t>(count, 1));
+
+    rGrid.m_cellLevel = cellLevel;
+    rGrid.m_bucketStart.assign(bucketCount + 1, 0);
+    rGrid.m_sats     .resize(count);
+    rGrid.m_positions.resize(count);
+
+    auto const bucket_of = [&rGrid, cellLevel, &x = x, &y = y, &z = z] (std::size_t const sat) noexcept
+    {
+        return sat_grid_bucket(rGrid, sat_grid_cell(to_vec<Vector3g>(sat, x, y, z), cellLevel));
+    };
+
+    // Counting sort by bucket. Count, then turn counts into the end of each bucket, then fill
+    // each bucket from its end, leaving m_bucketStart as the start of each bucket.
+    for (std::size_t sat = 0; sat < count; ++sat)
+    {
+        ++ rGrid.m_bucketStart[bucket_of(sat)];
+    }
+
+    uint32_t total = 0;
+    for (uint32_t &rStart : rGrid.m_bucketStart)
+    {
+        total += rStart;
+        rStart = total;
+    }
+
+    for (std::size_t sat = count; sat-- != 0; )
+    {
+        uint32_t const i = -- rGrid.m_bucketStart[bucket_of(sat)];
+        rGrid.m_sats[i]      = hasIds ? data.m_satIndexToId[sat] : SatId(sat);
+        rGrid.m_positions[i] = to_vec<Vector3g>(sat, x, y, z);
+    }
+}
+
+SatGridHit sat_grid_nearest(SatGrid const& grid, Vector3g const pos, double const maxDistance) noexcept
+{
+    SatGridHit best{ .m_distance = maxDistance };
+
+    auto const check = [&grid, pos, &best] (std::size_t const i) noexcept
+    {
+        Vector3d const diff{grid.m_positions[i] - pos};
+        double const   dist = diff.length();
+        if (dist < best.m_distance)
+        {
+            best = { .m_sat = grid.m_sats[i], .m_distance = dist };
+        }
+    };
+
+    std::size_t const satCount = grid.m_sats.size();
+    if (satCount == 0)
+    {
+        return best;
+    }
+
+    // Search rings of cells around pos, where ring k is every cell k cells away from pos's cell
+    // along any axis. pos can be anywhere within its own cell, so satellites in ring k are at
+    // least k - 1 cells away.
+
+    double const    cellSize    = std::ldexp(1.0, grid.m_cellLevel);
+    Vector3g const  center      = sat_grid_cell(pos, grid.m_cellLevel);
+    std::size_t     cellsVisited = 0;
+
+    for (spaceint_t ring = 0; double(ring - 1) * cellSize < best.m_distance; ++ring)
+    {
+        std::size_t const side      = std::size_t(2 * ring + 1);
+        std::size_t const ringCells = side * side * side - ((ring == 0) ? 0 : (side - 2) * (side - 2) * (side - 2));
+
+        // Searching far out is slower than checking every satellite
+        cellsVisited += ringCells;
+        if (cellsVisited > satCount)
+        {
+            for (std::size_t i = 0; i < satCount; ++i)
+            {
+                check(i);
+            }
+            return best;
+        }
+
+        for (spaceint_t dz = -ring; dz <= ring; ++dz)
+        {
+            for (spaceint_t dy = -ring; dy <= ring; ++dy)
+            {
+                // Only the ring's shell; skip through the middle if not on a Y or Z face
+                bool const onFace = (std::abs(dz) == ring || std::abs(dy) == ring);
+                spaceint_t const step = (onFace || ring == 0) ? 1 : 2 * ring;
+
+                for (spaceint_t dx = -ring; dx <= ring; dx += step)
+                {
+                    Vector3g const cell     = center + Vector3g{dx, dy, dz};
+                    uint32_t const bucket   = sat_grid_bucket(grid, cell);
+                    for (uint32_t i = grid.m_bucketStart[bucket]; i < grid.m_bucketStart[bucket + 1]; ++i)
+                    {
+                        // Other cells may share this bucket, skip them
+                        if (sat_grid_cell(grid.m_positions[i], grid.m_cellLevel) == cell)
+                        {
+                            check(i);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return best;
+}
+
+} // namespace osp::universe
@@ -0,0 +1,167 @@
+/**
+ * Open Space Program
+ * Copyright © 2019-2023 Open Space Program Project
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include "universe.h"
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace osp::universe
+{
+
+/**
+ * @brief Uniform grid over the satellites of a coordinate space, for proximity queries
+ *
+ * Space is divided into cubic cells, which are hashed into a fixed number of buckets, so the
+ * grid covers all of spaceint_t without storing empty cells. Satellites are grouped by bucket
+ * with a counting sort; rebuilding each step is linear, and reuses storage.
+ *
+ * Queries take positions in the same coordinate space as the grid. To query from another space,
+ * transform the position with a CoordTransformer first, see coordinates.h.
+ */
+struct SatGrid
+{
+    /// Cells are 2^m_cellLevel position units wide
+    int                     m_cellLevel{0};
+
+    /// Satellites in bucket b are within [m_bucketStart[b], m_bucketStart[b + 1])
+    std::vector<uint32_t>   m_bucketStart;
+
+    // Satellites grouped by bucket, with positions copied for locality. IDs are copied too, so
+    // results stay correct after satellites are reordered or removed.
+    std::vector<SatId>      m_sats;
+    std::vector<Vector3g>   m_positions;
+};
+
+struct SatGridHit
+{
+    SatId   m_sat{lgrn::id_null<SatId>()};
+    double  m_distance{std::numeric_limits<double>::infinity()}; ///< Position units
+};
+
+constexpr Vector3g sat_grid_cell(Vector3g const pos, int const cellLevel) noexcept
+{
+    // Arithmetic shift rounds towards negative infinity, so cells don't double up around 0
+    return {pos.x() >> cellLevel, pos.y() >> cellLevel, pos.z() >> cellLevel};
+}
+
+constexpr uint32_t sat_grid_bucket(SatGrid const& grid, Vector3g const cell) noexcept
+{
+    uint64_t const hash =   uint64_t(cell.x()) * 0x9E3779B97F4A7C15ull
+                          ^ uint64_t(cell.y()) * 0xC2B2AE3D27D4EB4Full
+                          ^ uint64_t(cell.z()) * 0x165667B19E3779F9ull;
+
+    // Bucket count is a power of two
+    return uint32_t(hash >> 32) & uint32_t(grid.m_bucketStart.size() - 2);
+}
+
+/**
+ * @brief Rebuild a grid from the current positions of satellites
+ *
+ * Satellites are stored by their SatId from sat_create. If data has no IDs (m_satCount was set
+ * directly), each satellite's index is used as its SatId instead.
+ *
+ * @param cellLevel [in] Cells are 2^cellLevel position units wide. For best results, make cells
+ *                       about as large as the usual query radius.
+ */
+void sat_grid_build(SatGrid &rGrid, CoSpaceSatData const& data, int cellLevel);
+
+/**
+ * @brief Find the satellite closest to a position
+ *
+ * @param maxDistance [in] Only consider satellites closer than this, in position units
+ *
+ * @return Closest satellite, or a null m_sat if there are none within maxDistance
+ */
+SatGridHit sat_grid_nearest(
+        SatGrid const&  grid,
+        Vector3g        pos,
+        double          maxDistance = std::numeric_limits<double>::infinity()) noexcept;
+
+/**
+ * @brief Call func(SatId, double distance) for each satellite closer than radius to a position
+ *
+ * Satellites are visited in no particular order. Distances are in position units.
+ */
+template <typename FUNC_T>
+void sat_grid_query_radius(SatGrid const& grid, Vector3g const pos, double const radius, FUNC_T &&func)
+{
+    if (grid.m_sats.empty())
+    {
+        return;
+    }
+
+    double const radius2 = radius * radius;
+
+    auto const check = [&grid, pos, radius2, &func] (std::size_t const i)
+    {
+        Vector3d const diff{grid.m_positions[i] - pos};
+        double const   dist2 = Magnum::Math::dot(diff, diff);
+        if (dist2 < radius2)
+        {
+            func(grid.m_sats[i], std::sqrt(dist2));
+        }
+    };
+
+    auto const reach = spaceint_t(std::ceil(radius));
+    Vector3g const lower = sat_grid_cell(pos - Vector3g{reach}, grid.m_cellLevel);
+    Vector3g const upper = sat_grid_cell(pos + Vector3g{reach}, grid.m_cellLevel);
+    Vector3d const cells = Vector3d(upper - lower) + Vector3d{1.0};
+
+    // Visiting more cells than there are satellites is slower than checking all of them
+    if (cells.product() > double(grid.m_sats.size()))
+    {
+        for (std::size_t i = 0; i < grid.m_sats.size(); ++i)
+        {
+            check(i);
+        }
+        return;
+    }
+
+    for (spaceint_t cz = lower.z(); cz <= upper.z(); ++cz)
+    {
+        for (spaceint_t cy = lower.y(); cy <= upper.y(); ++cy)
+        {
+            for (spaceint_t cx = lower.x(); cx <= upper.x(); ++cx)
+            {
+                Vector3g const cell{cx, cy, cz};
+                uint32_t const bucket = sat_grid_bucket(grid, cell);
+                for (uint32_t i = grid.m_bucketStart[bucket]; i < grid.m_bucketStart[bucket + 1]; ++i)
+                {
+                    // Other cells may share this bucket. Skip them, as they're visited separately
+                    if (sat_grid_cell(grid.m_positions[i], grid.m_cellLevel) == cell)
+                    {
+                        check(i);
+                    }
+                }
+            }
+        }
+    }
+}
+
+} // namespace osp::universe
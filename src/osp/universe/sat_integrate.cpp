@@ -0,0 +1,388 @@
+/**
+ * Open Space Program
+ * Copyright © 2019-2023 Open Space Program Project
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "sat_integrate.h"
+#include "sat_data.h"
+#include "simd_convert.h"
+
+#include <longeron/utility/asserts.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace osp::universe
+{
+
+/**
+ * @brief Raw pointers to each component array of CoSpaceSatData
+ */
+struct SatColumns
+{
+    std::array<spaceint_t*, 3>  m_pos;
+    std::array<double*, 3>      m_vel;
+    std::array<double*, 3>      m_angVel;
+    double                      *m_rot; ///< XYZW interleaved
+};
+
+/**
+ * @brief Per-step constants derived from SatIntegrateParams
+ */
+struct SatStepConsts
+{
+    double m_unitsPerVel;   ///< Position units moved per m/s of velocity
+    double m_metersPerUnit;
+    double m_negGmDt;       ///< -GM * dt, for velocity change from gravity
+    double m_halfDt;        ///< dt/2, for quaternion derivative
+};
+
+template <typename T>
+static T* column(CoSpaceSatData &rData, TypedStrideDesc<T> const& desc) noexcept
+{
+    LGRN_ASSERTM(desc.m_stride == sizeof(T), "Expected satellite data laid out by sat_data_allocate");
+    return reinterpret_cast<T*>(&rData.m_data[desc.m_offset]);
+}
+
+static SatColumns sat_columns(CoSpaceSatData &rData) noexcept
+{
+    auto const &rot = rData.m_satRotations;
+    LGRN_ASSERTM(   rot[0].m_stride == 4 * sizeof(double)
+                 && rot[1].m_offset == rot[0].m_offset + sizeof(double)
+                 && rot[2].m_offset == rot[0].m_offset + 2 * sizeof(double)
+                 && rot[3].m_offset == rot[0].m_offset + 3 * sizeof(double),
+                 "Expected satellite rotations to be interleaved XYZW");
+
+    return {
+        .m_pos      = { column(rData, rData.m_satPositions[0]),
+                        column(rData, rData.m_satPositions[1]),
+                        column(rData, rData.m_satPositions[2]) },
+        .m_vel      = { column(rData, rData.m_satVelocities[0]),
+                        column(rData, rData.m_satVelocities[1]),
+                        column(rData, rData.m_satVelocities[2]) },
+        .m_angVel   = { column(rData, rData.m_satAngularVels[0]),
+                        column(rData, rData.m_satAngularVels[1]),
+                        column(rData, rData.m_satAngularVels[2]) },
+        .m_rot      = reinterpret_cast<double*>(&rData.m_data[rot[0].m_offset])
+    };
+}
+
+static SatStepConsts step_consts(SatIntegrateParams const& params) noexcept
+{
+    return {
+        .m_unitsPerVel   = params.m_deltaTime / params.m_metersPerUnit,
+        .m_metersPerUnit = params.m_metersPerUnit,
+        .m_negGmDt       = -params.m_gravParam * params.m_deltaTime,
+        .m_halfDt        = 0.5 * params.m_deltaTime
+    };
+}
+
+static void integrate_one(SatColumns const& c, std::size_t const i, SatStepConsts const& k) noexcept
+{
+    // Move. Round rather than truncate, or small substeps would bias positions towards zero.
+    for (std::size_t axis = 0; axis < 3; ++axis)
+    {
+        c.m_pos[axis][i] = spaceint_t(std::nearbyint(double(c.m_pos[axis][i]) + c.m_vel[axis][i] * k.m_unitsPerVel));
+    }
+
+    // Gravity towards origin
+    double const px     = double(c.m_pos[0][i]) * k.m_metersPerUnit;
+    double const py     = double(c.m_pos[1][i]) * k.m_metersPerUnit;
+    double const pz     = double(c.m_pos[2][i]) * k.m_metersPerUnit;
+    double const r2     = px*px + py*py + pz*pz;
+    double const accel  = k.m_negGmDt / (r2 * std::sqrt(r2));
+
+    c.m_vel[0][i] += px * accel;
+    c.m_vel[1][i] += py * accel;
+    c.m_vel[2][i] += pz * accel;
+
+    // Rotate: q += (dt/2) * q * (w, 0), then renormalize
+    double *pQ = &c.m_rot[i * 4];
+    double const qx = pQ[0];
+    double const qy = pQ[1];
+    double const qz = pQ[2];
+    double const qw = pQ[3];
+    double const wx = c.m_angVel[0][i] * k.m_halfDt;
+    double const wy = c.m_angVel[1][i] * k.m_halfDt;
+    double const wz = c.m_angVel[2][i] * k.m_halfDt;
+
+    double const nx = qx + qw*wx + qy*wz - qz*wy;
+    double const ny = qy + qw*wy + qz*wx - qx*wz;
+    double const nz = qz + qw*wz + qx*wy - qy*wx;
+    double const nw = qw - qx*wx - qy*wy - qz*wz;
+    double const invLen = 1.0 / std::sqrt(nx*nx + ny*ny + nz*nz + nw*nw);
+
+    pQ[0] = nx * invLen;
+    pQ[1] = ny * invLen;
+    pQ[2] = nz * invLen;
+    pQ[3] = nw * invLen;
+}
+
+void sat_integrate_scalar(CoSpaceSatData &rData, std::size_t const first, std::size_t const last, SatIntegrateParams const& params) noexcept
+{
+    LGRN_ASSERTV(last <= rData.m_satCapacity, last, rData.m_satCapacity);
+
+    SatColumns const    c = sat_columns(rData);
+    SatStepConsts const k = step_consts(params);
+
+    for (std::size_t i = first; i < last; ++i)
+    {
+        integrate_one(c, i, k);
+    }
+}
+
+#if defined(OSP_UNIVERSE_AVX2)
+
+/// Transpose 4x4; rows r0..r3 become columns. Converts between XYZW-interleaved and XXXX YYYY...
+static void transpose4(__m256d &r0, __m256d &r1, __m256d &r2, __m256d &r3) noexcept
+{
+    __m256d const t0 = _mm256_unpacklo_pd(r0, r1);
+    __m256d const t1 = _mm256_unpackhi_pd(r0, r1);
+    __m256d const t2 = _mm256_unpacklo_pd(r2, r3);
+    __m256d const t3 = _mm256_unpackhi_pd(r2, r3);
+    r0 = _mm256_permute2f128_pd(t0, t2, 0x20);
+    r1 = _mm256_permute2f128_pd(t1, t3, 0x20);
+    r2 = _mm256_permute2f128_pd(t0, t2, 0x31);
+    r3 = _mm256_permute2f128_pd(t1, t3, 0x31);
+}
+
+static void integrate_four(SatColumns const& c, std::size_t const i, SatStepConsts const& k) noexcept
+{
+    // Nothing is stored until all four satellites are known to be within exact conversion range,
+    // so falling back to the scalar path is always clean.
+    auto const fallback = [&c, i, &k] ()
+    {
+        for (std::size_t j = i; j < i + 4; ++j)
+        {
+            integrate_one(c, j, k);
+        }
+    };
+
+    __m256d const limitD    = _mm256_set1_pd(double(gc_exactLimit));
+    __m256d const signBit   = _mm256_set1_pd(-0.0);
+
+    __m256i posInt[3];
+    __m256i outside = _mm256_setzero_si256();
+    for (std::size_t axis = 0; axis < 3; ++axis)
+    {
+        posInt[axis] = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(c.m_pos[axis] + i));
+        outside = _mm256_or_si256(outside, int64_outside_exact(posInt[axis]));
+    }
+    if ( ! _mm256_testz_si256(outside, outside) )
+    {
+        fallback();
+        return;
+    }
+
+    // Move. Round to nearest, matching std::nearbyint in the scalar path
+    __m256d const unitsPerVel = _mm256_set1_pd(k.m_unitsPerVel);
+    __m256d vel[3];
+    __m256d moved[3];
+    int inRange = 0xF;
+    for (std::size_t axis = 0; axis < 3; ++axis)
+    {
+        vel[axis]   = _mm256_loadu_pd(c.m_vel[axis] + i);
+        moved[axis] = _mm256_round_pd(_mm256_add_pd(int64_to_double(posInt[axis]), _mm256_mul_pd(vel[axis], unitsPerVel)),
+                                      _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        inRange &= _mm256_movemask_pd(_mm256_cmp_pd(_mm256_andnot_pd(signBit, moved[axis]), limitD, _CMP_LT_OQ));
+    }
+    if (inRange != 0xF)
+    {
+        fallback();
+        return;
+    }
+
+    // Gravity towards origin
+    __m256d const metersPerUnit = _mm256_set1_pd(k.m_metersPerUnit);
+    __m256d pos[3];
+    for (std::size_t axis = 0; axis < 3; ++axis)
+    {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(c.m_pos[axis] + i), double_to_int64(moved[axis]));
+        pos[axis] = _mm256_mul_pd(moved[axis], metersPerUnit);
+    }
+
+    __m256d const r2    = _mm256_fmadd_pd(pos[0], pos[0], _mm256_fmadd_pd(pos[1], pos[1], _mm256_mul_pd(pos[2], pos[2])));
+    __m256d const accel = _mm256_div_pd(_mm256_set1_pd(k.m_negGmDt), _mm256_mul_pd(r2, _mm256_sqrt_pd(r2)));
+    for (std::size_t axis = 0; axis < 3; ++axis)
+    {
+        _mm256_storeu_pd(c.m_vel[axis] + i, _mm256_fmadd_pd(pos[axis], accel, vel[axis]));
+    }
+
+    // Rotate: q += (dt/2) * q * (w, 0), then renormalize
+    double *pQ = &c.m_rot[i * 4];
+    __m256d qx = _mm256_loadu_pd(pQ);
+    __m256d qy = _mm256_loadu_pd(pQ + 4);
+    __m256d qz = _mm256_loadu_pd(pQ + 8);
+    __m256d qw = _mm256_loadu_pd(pQ + 12);
+    transpose4(qx, qy, qz, qw);
+
+    __m256d const halfDt = _mm256_set1_pd(k.m_halfDt);
+    __m256d const wx = _mm256_mul_pd(_mm256_loadu_pd(c.m_angVel[0] + i), halfDt);
+    __m256d const wy = _mm256_mul_pd(_mm256_loadu_pd(c.m_angVel[1] + i), halfDt);
+    __m256d const wz = _mm256_mul_pd(_mm256_loadu_pd(c.m_angVel[2] + i), halfDt);
+
+    __m256d nx = _mm256_fmadd_pd(qw, wx, _mm256_fmadd_pd(qy, wz, _mm256_fnmadd_pd(qz, wy, qx)));
+    __m256d ny = _mm256_fmadd_pd(qw, wy, _mm256_fmadd_pd(qz, wx, _mm256_fnmadd_pd(qx, wz, qy)));
+    __m256d nz = _mm256_fmadd_pd(qw, wz, _mm256_fmadd_pd(qx, wy, _mm256_fnmadd_pd(qy, wx, qz)));
+    __m256d nw = _mm256_fnmadd_pd(qx, wx, _mm256_fnmadd_pd(qy, wy, _mm256_fnmadd_pd(qz, wz, qw)));
+
+    __m256d const len2   = _mm256_fmadd_pd(nx, nx, _mm256_fmadd_pd(ny, ny, _mm256_fmadd_pd(nz, nz, _mm256_mul_pd(nw, nw))));
+    __m256d const invLen = _mm256_div_pd(_mm256_set1_pd(1.0), _mm256_sqrt_pd(len2));
+    nx = _mm256_mul_pd(nx, invLen);
+    ny = _mm256_mul_pd(ny, invLen);
+    nz = _mm256_mul_pd(nz, invLen);
+    nw = _mm256_mul_pd(nw, invLen);
+
+    transpose4(nx, ny, nz, nw);
+    _mm256_storeu_pd(pQ,      nx);
+    _mm256_storeu_pd(pQ + 4,  ny);
+    _mm256_storeu_pd(pQ + 8,  nz);
+    _mm256_storeu_pd(pQ + 12, nw);
+}
+
+void sat_integrate(CoSpaceSatData &rData, std::size_t const first, std::size_t const last, SatIntegrateParams const& params) noexcept
+{
+    LGRN_ASSERTV(last <= rData.m_satCapacity, last, rData.m_satCapacity);
+
+    SatColumns const    c = sat_columns(rData);
+    SatStepConsts const k = step_consts(params);
+
+    std::size_t i = first;
+    for (; i + 4 <= last; i += 4)
+    {
+        integrate_four(c, i, k);
+    }
+
+    // Remainder; don't write past last, another thread may own those satellites
+    for (; i < last; ++i)
+    {
+        integrate_one(c, i, k);
+    }
+}
+
+#else
+
+void sat_integrate(CoSpaceSatData &rData, std::size_t const first, std::size_t const last, SatIntegrateParams const& params) noexcept
+{
+    sat_integrate_scalar(rData, first, last, params);
+}
+
+#endif // defined(OSP_UNIVERSE_AVX2)
+
+int sat_step_level(CoSpaceSatData const& data, std::size_t const index, SatIntegrateParams const& params, SatSubstepParams const& substep) noexcept
+{
+    std::size_t const count = data.m_satCount;
+
+    auto const [x, y, z]    = sat_views(data.m_satPositions,  data.m_data, count);
+    auto const [vx, vy, vz] = sat_views(data.m_satVelocities, data.m_data, count);
+
+    double const px = double(x[index]) * params.m_metersPerUnit;
+    double const py = double(y[index]) * params.m_metersPerUnit;
+    double const pz = double(z[index]) * params.m_metersPerUnit;
+    double const r2 = px*px + py*py + pz*pz;
+    double const r  = std::sqrt(r2);
+    double const v  = std::sqrt(vx[index]*vx[index] + vy[index]*vy[index] + vz[index]*vz[index]);
+
+    double timescale = std::numeric_limits<double>::infinity();
+    if (params.m_gravParam > 0.0)
+    {
+        timescale = std::sqrt(r2 * r / params.m_gravParam);
+    }
+    if (v > 0.0)
+    {
+        timescale = std::min(timescale, r / v);
+    }
+
+    double const ratio = params.m_deltaTime / (substep.m_accuracy * timescale);
+
+    if ( ! (ratio > 1.0) ) // also catches NaN, from not moving at the origin without gravity
+    {
+        return 0;
+    }
+    if (ratio >= std::ldexp(1.0, substep.m_maxLevel))
+    {
+        return substep.m_maxLevel;
+    }
+    return int(std::ceil(std::log2(ratio)));
+}
+
+void sat_step_group(SatStepGroups &rGroups, CoSpaceSatData &rData, BitVector_t const& skip, SatIntegrateParams const& params, SatSubstepParams const& substep)
+{
+    LGRN_ASSERTMV(substep.m_maxLevel >= 0 && substep.m_maxLevel < 255, "Levels must fit in uint8_t", substep.m_maxLevel);
+
+    std::size_t const count         = rData.m_satCount;
+    std::size_t const skipLevel     = std::size_t(substep.m_maxLevel) + 1;
+    bool const        hasIds        = rData.m_satIndexToId.size() == count;
+
+    rGroups.m_levels.resize(count);
+
+    bool sorted = true;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        SatId const sat     = hasIds ? rData.m_satIndexToId[i] : lgrn::id_null<SatId>();
+        bool const  skipped = hasIds && std::size_t(sat) < skip.size() && skip.test(sat);
+
+        std::size_t const level = skipped ? skipLevel : std::size_t(sat_step_level(rData, i, params, substep));
+
+        rGroups.m_levels[i] = uint8_t(level);
+        sorted = sorted && (i == 0 || rGroups.m_levels[i - 1] <= level);
+    }
+
+    // Counting sort. m_start[L + 1] first counts satellites of level L, then becomes where they end
+    rGroups.m_start.assign(skipLevel + 2, 0);
+    for (uint8_t const level : rGroups.m_levels)
+    {
+        ++rGroups.m_start[level + 1];
+    }
+    for (std::size_t level = 1; level < rGroups.m_start.size(); ++level)
+    {
+        rGroups.m_start[level] += rGroups.m_start[level - 1];
+    }
+
+    if (sorted)
+    {
+        return;
+    }
+
+    // Stable destination of each satellite, then follow permutation cycles swapping into place
+    rGroups.m_dest.resize(count);
+    std::vector<uint32_t> next(rGroups.m_start.begin(), rGroups.m_start.end() - 1);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        rGroups.m_dest[i] = next[rGroups.m_levels[i]] ++;
+    }
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        while (rGroups.m_dest[i] != i)
+        {
+            uint32_t const dest = rGroups.m_dest[i];
+            sat_data_swap(rData, i, dest);
+            std::swap(rGroups.m_dest[i], rGroups.m_dest[dest]);
+        }
+    }
+}
+
+} // namespace osp::universe
@@ -0,0 +1,112 @@
+/**
+ * Open Space Program
+ * Copyright © 2019-2023 Open Space Program Project
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include "universe.h"
+
+#include "../core/bitvector.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace osp::universe
+{
+
+struct SatIntegrateParams
+{
+    double  m_deltaTime{0.0};
+
+    /// Size of one position unit in meters, 2^-precision of the coordinate space
+    double  m_metersPerUnit{1.0};
+
+    /// Gravitational parameter (GM) of a point mass at the origin, in m^3/s^2
+    double  m_gravParam{0.0};
+};
+
+/**
+ * @brief Advance satellites [first, last) by one time step
+ *
+ * Positions move by velocity, then velocities accelerate towards the origin by gravity of a point
+ * mass at the new positions (symplectic Euler), and rotations turn by angular velocity
+ * (first-order, renormalized). Positions are rounded to the nearest unit.
+ *
+ * Expects rData to be laid out by sat_data_allocate. When built with AVX2 (OSP_ENABLE_AVX2), four
+ * satellites are processed at a time, otherwise this calls sat_integrate_scalar.
+ *
+ * Only touches satellites within [first, last), so disjoint ranges can be run in parallel.
+ */
+void sat_integrate(CoSpaceSatData &rData, std::size_t first, std::size_t last, SatIntegrateParams const& params) noexcept;
+
+/**
+ * @brief Portable one-at-a-time version of sat_integrate
+ *
+ * Used for remainders not handled by the AVX2 path, and as a reference for tests and benchmarks.
+ */
+void sat_integrate_scalar(CoSpaceSatData &rData, std::size_t first, std::size_t last, SatIntegrateParams const& params) noexcept;
+
+struct SatSubstepParams
+{
+    /// Largest substep as a fraction of a satellite's timescale; its orbital period over 2pi, or
+    /// the time to cross its distance to the origin, whichever is shorter
+    double  m_accuracy{0.01};
+
+    /// Satellites take at most 2^m_maxLevel substeps per step
+    int     m_maxLevel{10};
+};
+
+/**
+ * @brief Satellites grouped by how many substeps they need, see sat_step_group
+ */
+struct SatStepGroups
+{
+    /// Satellites that take 2^L substeps are within [m_start[L], m_start[L + 1]). Skipped ones
+    /// are last, within [m_start[m_maxLevel + 1], m_start[m_maxLevel + 2]).
+    std::vector<uint32_t>   m_start;
+
+    // Scratch for sat_step_group
+    std::vector<uint8_t>    m_levels;
+    std::vector<uint32_t>   m_dest;
+};
+
+/**
+ * @brief Get how many times params.m_deltaTime needs to be halved for a satellite to be accurate
+ *
+ * @return Level within [0, substep.m_maxLevel]; the satellite takes 2^level substeps
+ */
+int sat_step_level(CoSpaceSatData const& data, std::size_t index, SatIntegrateParams const& params, SatSubstepParams const& substep) noexcept;
+
+/**
+ * @brief Reorder satellites so ones that take the same number of substeps are contiguous
+ *
+ * Fast inner orbits can then substep with sat_integrate while slow outer ones take a single step.
+ * Satellites keep their SatIds, but their indices change. Nothing moves if satellites are already
+ * in order, which is usual from one step to the next.
+ *
+ * @param skip  [in] Satellites to put last instead of integrating, by SatId, such as ones on rails
+ */
+void sat_step_group(SatStepGroups &rGroups, CoSpaceSatData &rData, BitVector_t const& skip, SatIntegrateParams const& params, SatSubstepParams const& substep);
+
+} // namespace osp::universe
@@ -0,0 +1,417 @@
+/**
+ * Open Space Program
+ * Copyright © 2019-2023 Open Space Program Project
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "sat_kepler.h"
+#include "simd_convert.h"
+
+#include <longeron/utility/asserts.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+namespace osp::universe
+{
+
+/// Enough for 1e-15 at gc_keplerMaxEccentricity from Danby's starting guess
+constexpr int gc_keplerIterations = 5;
+
+/// Orbits closer to circular than this measure anomalies from the satellite's position on rails
+constexpr double gc_keplerCircular = 1e-9;
+
+static void rails_resize(SatKeplerRails &rRails, std::size_t const capacity)
+{
+    if (rRails.m_eccentricity.size() >= capacity)
+    {
+        return;
+    }
+
+    bitvector_resize(rRails.m_onRails, capacity);
+
+    rRails.m_semiMajorAxis  .resize(capacity);
+    rRails.m_eccentricity   .resize(capacity);
+    rRails.m_meanMotion     .resize(capacity);
+    rRails.m_meanAnomaly    .resize(capacity);
+    rRails.m_epoch          .resize(capacity);
+    for (std::vector<double> &rVec : rRails.m_periapsisDir) { rVec.resize(capacity); }
+    for (std::vector<double> &rVec : rRails.m_aheadDir)     { rVec.resize(capacity); }
+    for (std::vector<double> &rVec : rRails.m_rotation)     { rVec.resize(capacity); }
+}
+
+static double mean_anomaly_at(SatKeplerRails const& rails, SatId const sat, double const time) noexcept
+{
+    double const meanAnomaly = rails.m_meanAnomaly[sat] + rails.m_meanMotion[sat] * (time - rails.m_epoch[sat]);
+    return std::remainder(meanAnomaly, 2.0 * std::numbers::pi);
+}
+
+/**
+ * @brief Write position, velocity, and rotation of a satellite on rails, given its eccentric
+ *        anomaly at params.m_time
+ */
+static void write_state(
+        SatKeplerRails const&   rails,
+        CoSpaceSatData          &rData,
+        std::size_t const       index,
+        SatId const             sat,
+        double const            eccAnomaly,
+        SatKeplerParams const&  params) noexcept
+{
+    std::size_t const count = rData.m_satCount;
+
+    auto const [x, y, z]        = sat_views(rData.m_satPositions,   rData.m_data, count);
+    auto const [vx, vy, vz]     = sat_views(rData.m_satVelocities,  rData.m_data, count);
+    auto const [qx, qy, qz, qw] = sat_views(rData.m_satRotations,   rData.m_data, count);
+    auto const [wx, wy, wz]     = sat_views(rData.m_satAngularVels, rData.m_data, count);
+
+    // Position and velocity within the orbital plane, along periapsis and ahead of it
+    double const a      = rails.m_semiMajorAxis[sat];
+    double const e      = rails.m_eccentricity[sat];
+    double const b      = std::sqrt(1.0 - e * e);
+    double const cosE   = std::cos(eccAnomaly);
+    double const sinE   = std::sin(eccAnomaly);
+    double const posP   = a * (cosE - e);
+    double const posQ   = a * b * sinE;
+    double const speed  = rails.m_meanMotion[sat] * a / (1.0 - e * cosE);
+    double const velP   = -speed * sinE;
+    double const velQ   = speed * b * cosE;
+
+    auto const &P = rails.m_periapsisDir;
+    auto const &Q = rails.m_aheadDir;
+    double const toUnits = 1.0 / params.m_metersPerUnit;
+
+    x[index]  = std::llround((posP * P[0][sat] + posQ * Q[0][sat]) * toUnits);
+    y[index]  = std::llround((posP * P[1][sat] + posQ * Q[1][sat]) * toUnits);
+    z[index]  = std::llround((posP * P[2][sat] + posQ * Q[2][sat]) * toUnits);
+    vx[index] = velP * P[0][sat] + velQ * Q[0][sat];
+    vy[index] = velP * P[1][sat] + velQ * Q[1][sat];
+    vz[index] = velP * P[2][sat] + velQ * Q[2][sat];
+
+    // Spin at constant body frame angular velocity since epoch:
+    // q(t) = q0 * (w/|w| sin(t|w|/2), cos(t|w|/2))
+    auto const &q0 = rails.m_rotation;
+    double const angSpeed = std::sqrt(wx[index] * wx[index] + wy[index] * wy[index] + wz[index] * wz[index]);
+    if (angSpeed == 0.0)
+    {
+        qx[index] = q0[0][sat];
+        qy[index] = q0[1][sat];
+        qz[index] = q0[2][sat];
+        qw[index] = q0[3][sat];
+        return;
+    }
+
+    double const halfAngle = 0.5 * angSpeed * (params.m_time - rails.m_epoch[sat]);
+    double const s  = std::sin(halfAngle) / angSpeed;
+    double const rx = wx[index] * s;
+    double const ry = wy[index] * s;
+    double const rz = wz[index] * s;
+    double const rw = std::cos(halfAngle);
+
+    qx[index] = q0[3][sat] * rx + q0[0][sat] * rw + q0[1][sat] * rz - q0[2][sat] * ry;
+    qy[index] = q0[3][sat] * ry + q0[1][sat] * rw + q0[2][sat] * rx - q0[0][sat] * rz;
+    qz[index] = q0[3][sat] * rz + q0[2][sat] * rw + q0[0][sat] * ry - q0[1][sat] * rx;
+    qw[index] = q0[3][sat] * rw - q0[0][sat] * rx - q0[1][sat] * ry - q0[2][sat] * rz;
+}
+
+static double kepler_solve_one(double const M, double const e) noexcept
+{
+    // Danby's starting guess, good for any eccentricity
+    double E = M + std::copysign(0.85 * e, M);
+
+    for (int iter = 0; iter < gc_keplerIterations; ++iter)
+    {
+        double const eSinE  = e * std::sin(E);
+        double const f      = E - eSinE - M;
+        double const df     = 1.0 - e * std::cos(E);
+        E -= f / (df - 0.5 * f * eSinE / df);
+    }
+
+    return E;
+}
+
+void kepler_solve_scalar(double const *meanAnomaly, double const *eccentricity, double *eccAnomaly, std::size_t const count) noexcept
+{
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        eccAnomaly[i] = kepler_solve_one(meanAnomaly[i], eccentricity[i]);
+    }
+}
+
+#if defined(OSP_UNIVERSE_AVX2)
+
+// pi/2 split in three, so multiples of it can be subtracted exactly (Cody-Waite reduction)
+constexpr double gc_piHalf1 = 1.57079625129699707031e+00;
+constexpr double gc_piHalf2 = 7.54978941586159635336e-08;
+constexpr double gc_piHalf3 = 5.39030285815811905290e-15;
+
+/**
+ * @brief sin and cos of four angles, accurate to about 1e-16 for angles within a few turns
+ *
+ * Angles are reduced to [-pi/4, pi/4] and a quadrant, then evaluated with the minimax polynomials
+ * from Cephes. Kepler's equation is solved to the precision of these, not of std::sin.
+ */
+static void sin_cos4(__m256d const x, __m256d &rSin, __m256d &rCos) noexcept
+{
+    __m256d const quadrant = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(2.0 / std::numbers::pi)),
+                                             _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256d r = _mm256_fnmadd_pd(quadrant, _mm256_set1_pd(gc_piHalf1), x);
+    r         = _mm256_fnmadd_pd(quadrant, _mm256_set1_pd(gc_piHalf2), r);
+    r         = _mm256_fnmadd_pd(quadrant, _mm256_set1_pd(gc_piHalf3), r);
+
+    __m256d const z = _mm256_mul_pd(r, r);
+
+    // sin(r) = r + r*z*P(z)
+    __m256d p = _mm256_set1_pd(1.58962301576546568060e-10);
+    p = _mm256_fmadd_pd(p, z, _mm256_set1_pd(-2.50507477628578072866e-08));
+    p = _mm256_fmadd_pd(p, z, _mm256_set1_pd( 2.75573136213857245213e-06));
+    p = _mm256_fmadd_pd(p, z, _mm256_set1_pd(-1.98412698295895385996e-04));
+    p = _mm256_fmadd_pd(p, z, _mm256_set1_pd( 8.33333333332211858878e-03));
+    p = _mm256_fmadd_pd(p, z, _mm256_set1_pd(-1.66666666666666307295e-01));
+    __m256d const sinR = _mm256_fmadd_pd(_mm256_mul_pd(r, z), p, r);
+
+    // cos(r) = 1 - z/2 + z*z*Q(z)
+    __m256d q = _mm256_set1_pd(-1.13585365213876817300e-11);
+    q = _mm256_fmadd_pd(q, z, _mm256_set1_pd( 2.08757008419747316778e-09));
+    q = _mm256_fmadd_pd(q, z, _mm256_set1_pd(-2.75573141792967388112e-07));
+    q = _mm256_fmadd_pd(q, z, _mm256_set1_pd( 2.48015872888517045348e-05));
+    q = _mm256_fmadd_pd(q, z, _mm256_set1_pd(-1.38888888888730564116e-03));
+    q = _mm256_fmadd_pd(q, z, _mm256_set1_pd( 4.16666666666665929218e-02));
+    __m256d const cosR = _mm256_fmadd_pd(_mm256_mul_pd(z, z), q, _mm256_fnmadd_pd(_mm256_set1_pd(0.5), z, _mm256_set1_pd(1.0)));
+
+    // Odd quadrants swap sin and cos. sin is negative in quadrants 2 and 3, cos in 1 and 2.
+    __m256i const quadInt = double_to_int64(quadrant);
+    __m256i const one     = _mm256_set1_epi64x(1);
+    __m256i const two     = _mm256_set1_epi64x(2);
+    __m256d const swap    = _mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_and_si256(quadInt, one), one));
+    __m256d const sinSign = _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_and_si256(quadInt, two), 62));
+    __m256d const cosSign = _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_and_si256(_mm256_add_epi64(quadInt, one), two), 62));
+
+    rSin = _mm256_xor_pd(_mm256_blendv_pd(sinR, cosR, swap), sinSign);
+    rCos = _mm256_xor_pd(_mm256_blendv_pd(cosR, sinR, swap), cosSign);
+}
+
+static __m256d kepler_solve_four(__m256d const M, __m256d const e) noexcept
+{
+    __m256d const signBit = _mm256_set1_pd(-0.0);
+    __m256d const half    = _mm256_set1_pd(0.5);
+    __m256d const one     = _mm256_set1_pd(1.0);
+
+    // Danby's starting guess, M + copysign(0.85 * e, M)
+    __m256d E = _mm256_add_pd(M, _mm256_or_pd(_mm256_and_pd(M, signBit), _mm256_mul_pd(_mm256_set1_pd(0.85), e)));
+
+    for (int iter = 0; iter < gc_keplerIterations; ++iter)
+    {
+        __m256d sinE;
+        __m256d cosE;
+        sin_cos4(E, sinE, cosE);
+
+        __m256d const eSinE = _mm256_mul_pd(e, sinE);
+        __m256d const f     = _mm256_sub_pd(_mm256_sub_pd(E, eSinE), M);
+        __m256d const df    = _mm256_fnmadd_pd(e, cosE, one);
+        __m256d const denom = _mm256_sub_pd(df, _mm256_div_pd(_mm256_mul_pd(_mm256_mul_pd(half, f), eSinE), df));
+        E = _mm256_sub_pd(E, _mm256_div_pd(f, denom));
+    }
+
+    return E;
+}
+
+void kepler_solve(double const *meanAnomaly, double const *eccentricity, double *eccAnomaly, std::size_t const count) noexcept
+{
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        _mm256_storeu_pd(eccAnomaly + i, kepler_solve_four(_mm256_loadu_pd(meanAnomaly + i), _mm256_loadu_pd(eccentricity + i)));
+    }
+
+    for (; i < count; ++i)
+    {
+        eccAnomaly[i] = kepler_solve_one(meanAnomaly[i], eccentricity[i]);
+    }
+}
+
+#else
+
+void kepler_solve(double const *meanAnomaly, double const *eccentricity, double *eccAnomaly, std::size_t const count) noexcept
+{
+    kepler_solve_scalar(meanAnomaly, eccentricity, eccAnomaly, count);
+}
+
+#endif // defined(OSP_UNIVERSE_AVX2)
+
+bool sat_kepler_rail(SatKeplerRails &rRails, CoSpaceSatData const& data, SatId const sat, SatKeplerParams const& params)
+{
+    double const mu = params.m_gravParam;
+    if (mu <= 0.0)
+    {
+        return false;
+    }
+
+    std::size_t const index = sat_index(data, sat);
+    std::size_t const count = data.m_satCount;
+
+    auto const [x, y, z]        = sat_views(data.m_satPositions,   data.m_data, count);
+    auto const [vx, vy, vz]     = sat_views(data.m_satVelocities,  data.m_data, count);
+    auto const [qx, qy, qz, qw] = sat_views(data.m_satRotations,   data.m_data, count);
+
+    Vector3d const pos = Vector3d(Vector3g{x[index], y[index], z[index]}) * params.m_metersPerUnit;
+    Vector3d const vel{vx[index], vy[index], vz[index]};
+
+    double const r      = pos.length();
+    double const v2     = vel.dot();
+    Vector3d const h    = Magnum::Math::cross(pos, vel);
+    double const hLen   = h.length();
+
+    // Radial or stationary orbits have no plane
+    if (r == 0.0 || hLen <= 1e-12 * r * std::sqrt(v2))
+    {
+        return false;
+    }
+
+    double const energy = 0.5 * v2 - mu / r;
+    if (energy >= 0.0)
+    {
+        return false; // Escaping
+    }
+
+    Vector3d const eccVec = ((v2 - mu / r) * pos - Magnum::Math::dot(pos, vel) * vel) / mu;
+    double const   e      = eccVec.length();
+    if (e >= gc_keplerMaxEccentricity)
+    {
+        return false;
+    }
+
+    double const   a = -mu / (2.0 * energy);
+    Vector3d const P = (e > gc_keplerCircular) ? eccVec / e : pos / r;
+    Vector3d const Q = Magnum::Math::cross(h / hLen, P).normalized();
+
+    // Eccentric anomaly from position within the orbital plane
+    double const b          = std::sqrt(1.0 - e * e);
+    double const eccAnomaly = std::atan2(Magnum::Math::dot(pos, Q) / (a * b), Magnum::Math::dot(pos, P) / a + e);
+
+    rails_resize(rRails, data.m_satIds.capacity());
+
+    rRails.m_semiMajorAxis[sat] = a;
+    rRails.m_eccentricity[sat]  = e;
+    rRails.m_meanMotion[sat]    = std::sqrt(mu / (a * a * a));
+    rRails.m_meanAnomaly[sat]   = eccAnomaly - e * std::sin(eccAnomaly);
+    rRails.m_epoch[sat]         = params.m_time;
+
+    for (std::size_t axis = 0; axis < 3; ++axis)
+    {
+        rRails.m_periapsisDir[axis][sat] = P[axis];
+        rRails.m_aheadDir[axis][sat]     = Q[axis];
+    }
+
+    rRails.m_rotation[0][sat] = qx[index];
+    rRails.m_rotation[1][sat] = qy[index];
+    rRails.m_rotation[2][sat] = qz[index];
+    rRails.m_rotation[3][sat] = qw[index];
+
+    rRails.m_onRails.set(sat);
+    return true;
+}
+
+void sat_kepler_derail(SatKeplerRails &rRails, CoSpaceSatData &rData, SatId const sat, SatKeplerParams const& params) noexcept
+{
+    if ( ! sat_kepler_on_rails(rRails, sat) )
+    {
+        return;
+    }
+
+    double const meanAnomaly  = mean_anomaly_at(rRails, sat, params.m_time);
+    double       eccAnomaly;
+    kepler_solve(&meanAnomaly, &rRails.m_eccentricity[sat], &eccAnomaly, 1);
+
+    write_state(rRails, rData, sat_index(rData, sat), sat, eccAnomaly, params);
+
+    rRails.m_onRails.reset(sat);
+}
+
+void sat_kepler_propagate(SatKeplerRails const& rails, CoSpaceSatData &rData, std::size_t first, std::size_t last, SatKeplerParams const& params) noexcept
+{
+    LGRN_ASSERTV(last <= rData.m_satCount, last, rData.m_satCount);
+
+    // Only satellites with IDs can be on rails
+    last = std::min(last, rData.m_satIndexToId.size());
+
+    // Gather satellites on rails into blocks, so Kepler's equation is solved for many at once
+    constexpr std::size_t blockSize = 64;
+
+    std::array<std::size_t, blockSize>  indices;
+    std::array<double, blockSize>       meanAnomalies;
+    std::array<double, blockSize>       eccentricities;
+    std::array<double, blockSize>       eccAnomalies;
+
+    std::size_t i = first;
+    while (i < last)
+    {
+        std::size_t count = 0;
+        for (; i < last && count < blockSize; ++i)
+        {
+            SatId const sat = rData.m_satIndexToId[i];
+            if (sat_kepler_on_rails(rails, sat))
+            {
+                indices[count]        = i;
+                meanAnomalies[count]  = mean_anomaly_at(rails, sat, params.m_time);
+                eccentricities[count] = rails.m_eccentricity[sat];
+                ++count;
+            }
+        }
+
+        kepler_solve(meanAnomalies.data(), eccentricities.data(), eccAnomalies.data(), count);
+
+        for (std::size_t j = 0; j < count; ++j)
+        {
+            write_state(rails, rData, indices[j], rData.m_satIndexToId[indices[j]], eccAnomalies[j], params);
+        }
+    }
+}
+
+void sat_kepler_update_modes(SatKeplerRails &rRails, CoSpaceSatData &rData, Vector3g const nearPos, double const numericRadius, SatKeplerParams const& params)
+{
+    std::size_t const count     = rData.m_satIndexToId.size();
+    double const      railsDist = numericRadius * gc_keplerRailsHysteresis;
+
+    auto const [x, y, z] = sat_views(rData.m_satPositions, rData.m_data, rData.m_satCount);
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        SatId const    sat      = rData.m_satIndexToId[i];
+        Vector3d const offset   = Vector3d(Vector3g{x[i], y[i], z[i]} - nearPos) * params.m_metersPerUnit;
+        double const   distance = offset.length();
+
+        if (sat_kepler_on_rails(rRails, sat))
+        {
+            if (distance < numericRadius)
+            {
+                sat_kepler_derail(rRails, rData, sat, params);
+            }
+        }
+        else if (distance > railsDist)
+        {
+            sat_kepler_rail(rRails, rData, sat, params);
+        }
+    }
+}
+
+} // namespace osp::universe
@@ -0,0 +1,145 @@
+/**
+ * Open Space Program
+ * Copyright © 2019-2023 Open Space Program Project
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include "universe.h"
+
+#include "../core/bitvector.h"
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+namespace osp::universe
+{
+
+/// Satellites on more eccentric orbits stay numerically integrated
+constexpr double gc_keplerMaxEccentricity = 0.99;
+
+/// Satellites only go on rails past this multiple of the numeric radius, so ones hovering around
+/// it don't switch every frame, see sat_kepler_update_modes
+constexpr double gc_keplerRailsHysteresis = 1.5;
+
+struct SatKeplerParams
+{
+    /// Time to evaluate orbits at, in seconds. Epochs of orbits are on the same timeline.
+    double  m_time{0.0};
+
+    /// Size of one position unit in meters, 2^-precision of the coordinate space
+    double  m_metersPerUnit{1.0};
+
+    /// Gravitational parameter (GM) of a point mass at the origin, in m^3/s^2
+    double  m_gravParam{0.0};
+};
+
+/**
+ * @brief Elliptic orbits of satellites "on rails", evaluated analytically instead of integrated
+ *
+ * Each orbit is a semi-major axis, eccentricity, and mean anomaly at epoch. Its orientation is
+ * stored as the perifocal basis: unit vectors towards periapsis, and 90 degrees ahead of it in
+ * the direction of motion. This is equivalent to inclination, longitude of ascending node, and
+ * argument of periapsis, but without their singularities for circular or equatorial orbits.
+ *
+ * Indexed by SatId, so orbits don't move when satellites are removed. Take satellites off rails
+ * (m_onRails) before removing them.
+ */
+struct SatKeplerRails
+{
+    BitVector_t                         m_onRails;
+
+    std::vector<double>                 m_semiMajorAxis;    ///< Meters
+    std::vector<double>                 m_eccentricity;
+    std::vector<double>                 m_meanMotion;       ///< Radians per second
+    std::vector<double>                 m_meanAnomaly;      ///< Radians, at m_epoch
+    std::vector<double>                 m_epoch;            ///< Seconds
+
+    std::array<std::vector<double>, 3>  m_periapsisDir;
+    std::array<std::vector<double>, 3>  m_aheadDir;
+
+    /// Rotation at m_epoch, XYZW. Satellites keep spinning at their angular velocity on rails.
+    std::array<std::vector<double>, 4>  m_rotation;
+};
+
+inline bool sat_kepler_on_rails(SatKeplerRails const& rails, SatId const sat) noexcept
+{
+    return std::size_t(sat) < rails.m_eccentricity.size() && rails.m_onRails.test(sat);
+}
+
+/**
+ * @brief Solve Kepler's equation M = E - e*sin(E) for the eccentric anomalies of many orbits
+ *
+ * A fixed number of Halley iterations are done without branches. Converges to about 1e-15 for
+ * eccentricities up to gc_keplerMaxEccentricity.
+ *
+ * When built with AVX2 (OSP_ENABLE_AVX2), four orbits are solved at a time using polynomial sin
+ * and cos, otherwise this calls kepler_solve_scalar.
+ *
+ * @param meanAnomaly   [in] Mean anomalies, within [-pi, pi]
+ * @param eccentricity  [in] Eccentricities, within [0, gc_keplerMaxEccentricity]
+ * @param eccAnomaly    [out] Eccentric anomalies
+ */
+void kepler_solve(double const *meanAnomaly, double const *eccentricity, double *eccAnomaly, std::size_t count) noexcept;
+
+/**
+ * @brief Portable one-at-a-time version of kepler_solve, using std::sin and std::cos
+ *
+ * Used for remainders not handled by the AVX2 path, and as a reference for tests and benchmarks.
+ */
+void kepler_solve_scalar(double const *meanAnomaly, double const *eccentricity, double *eccAnomaly, std::size_t count) noexcept;
+
+/**
+ * @brief Put a satellite on rails, following the orbit of its current position and velocity
+ *
+ * @return false if the satellite isn't on a bound orbit with eccentricity below
+ *         gc_keplerMaxEccentricity, and stays numerically integrated
+ */
+bool sat_kepler_rail(SatKeplerRails &rRails, CoSpaceSatData const& data, SatId sat, SatKeplerParams const& params);
+
+/**
+ * @brief Take a satellite off rails, setting its position, velocity, and rotation at params.m_time
+ */
+void sat_kepler_derail(SatKeplerRails &rRails, CoSpaceSatData &rData, SatId sat, SatKeplerParams const& params) noexcept;
+
+/**
+ * @brief Set position, velocity, and rotation of satellites on rails within [first, last) at
+ *        params.m_time
+ *
+ * Satellites not on rails are not touched. Only touches satellites within [first, last), so
+ * disjoint ranges can be run in parallel.
+ */
+void sat_kepler_propagate(SatKeplerRails const& rails, CoSpaceSatData &rData, std::size_t first, std::size_t last, SatKeplerParams const& params) noexcept;
+
+/**
+ * @brief Take satellites near a position off rails, and put far away ones back on
+ *
+ * Satellites closer than numericRadius are numerically integrated, so they can interact with
+ * whatever is there. Ones further than numericRadius * gc_keplerRailsHysteresis go on rails.
+ *
+ * @param nearPos       [in] Position in space units, usually of a SceneFrame
+ * @param numericRadius [in] Distance in meters
+ */
+void sat_kepler_update_modes(SatKeplerRails &rRails, CoSpaceSatData &rData, Vector3g nearPos, double numericRadius, SatKeplerParams const& params);
+
+} // namespace osp::universe
@@ -0,0 +1,68 @@
+/**
+ * Open Space Program
+ * Copyright © 2019-2023 Open Space Program Project
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#pragma once
+
+#include "universetypes.h"
+
+// Vectorized paths need FMA too. MSVC's /arch:AVX2 implies FMA but doesn't define __FMA__
+#if defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+    #define OSP_UNIVERSE_AVX2
+    #include <immintrin.h>
+#endif
+
+#if defined(OSP_UNIVERSE_AVX2)
+
+namespace osp::universe
+{
+
+// AVX2 has no packed int64 <-> double conversion. Instead, adding 2^52 + 2^51 to a double shifts
+// its integer part into the mantissa bits, which is exact for magnitudes under 2^51. Callers take
+// a scalar path for values further than gc_exactLimit units out.
+constexpr double        gc_magic        = 6755399441055744.0; // 2^52 + 2^51
+constexpr spaceint_t    gc_exactLimit   = spaceint_t(1) << 50;
+
+inline __m256d int64_to_double(__m256i const in) noexcept
+{
+    __m256i const magic = _mm256_castpd_si256(_mm256_set1_pd(gc_magic));
+    return _mm256_sub_pd(_mm256_castsi256_pd(_mm256_add_epi64(in, magic)), _mm256_set1_pd(gc_magic));
+}
+
+/// Expects integral inputs, see _mm256_round_pd
+inline __m256i double_to_int64(__m256d const in) noexcept
+{
+    __m256d const magic = _mm256_set1_pd(gc_magic);
+    return _mm256_sub_epi64(_mm256_castpd_si256(_mm256_add_pd(in, magic)), _mm256_castpd_si256(magic));
+}
+
+/// @return Mask of lanes outside of [-gc_exactLimit, gc_exactLimit]
+inline __m256i int64_outside_exact(__m256i const in) noexcept
+{
+    return _mm256_or_si256(_mm256_cmpgt_epi64(in, _mm256_set1_epi64x(gc_exactLimit)),
+                           _mm256_cmpgt_epi64(_mm256_set1_epi64x(-gc_exactLimit), in));
+}
+
+} // namespace osp::universe
+
+#endif // defined(OSP_UNIVERSE_AVX2)
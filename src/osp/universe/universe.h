@@ -28,16 +28,24 @@
 #include "universetypes.h"
 
 #include <longeron/id_management/registry_stl.hpp>
+#include <longeron/utility/asserts.hpp>
 
 #include <Corrade/Containers/Array.h>
 #include <Corrade/Containers/StridedArrayView.h>
+#include <Corrade/Utility/Memory.h>
 
 #include <array>
+#include <bit>
 #include <cstdint>
+#include <vector>
 
 namespace osp::universe
 {
 
+/// Alignment of each component array in CoSpaceSatData::m_data; a cache line, and wide enough
+/// for any SIMD register
+constexpr std::size_t gc_satDataAlignment = 64;
+
 struct StrideDesc
 {
     constexpr bool not_used() const noexcept { return m_stride == 0; }
@@ -89,15 +97,24 @@ struct CoSpaceTransform
 
 struct CoSpaceSatData
 {
-    uint32_t        m_satCount;
-    uint32_t        m_satCapacity;
+    uint32_t        m_satCount{0};
+    uint32_t        m_satCapacity{0};
+
+    /// Satellites are kept dense within m_data, so their index can change as others are removed.
+    /// SatIds from sat_create stay the same, see sat_index.
+    lgrn::IdRegistryStl<SatId>                  m_satIds;
+    std::vector<uint32_t>                       m_satIdToIndex;
+    std::vector<SatId>                          m_satIndexToId;
 
+    /// Allocated by sat_data_allocate, aligned to gc_satDataAlignment
     Corrade::Containers::Array<unsigned char>   m_data;
 
     // Describes m_data
     StrideDescArray_t<spaceint_t, 3>            m_satPositions;
     StrideDescArray_t<double, 3>                m_satVelocities;
     StrideDescArray_t<double, 4>                m_satRotations;
+    StrideDescArray_t<double, 3>                m_satAngularVels; ///< Body frame, radians per second
+    TypedStrideDesc<double>                     m_satMasses;      ///< Kilograms
 };
 
 
@@ -130,16 +147,80 @@ constexpr void aux_partition(std::size_t const pos, TypedStrideDesc<FIRST_T>& rI
     }
 }
 
-template <typename ... T>
+constexpr std::size_t align_up(std::size_t const pos, std::size_t const alignment) noexcept
+{
+    return (pos + alignment - 1) & ~(alignment - 1);
+}
+
+/**
+ * @brief Lay out an array of count interleaved elements within a buffer, starting from rPos
+ *
+ * The array starts on an ALIGNMENT_T boundary, and rPos is moved past its end, padded up to the
+ * next boundary. Vectorized loops can load and store whole registers past count without leaving
+ * the array.
+ */
+template <std::size_t ALIGNMENT_T = gc_satDataAlignment, typename ... T>
 constexpr void partition(std::size_t& rPos, std::size_t count, TypedStrideDesc<T>& ... rInterleve)
 {
+    static_assert(std::has_single_bit(ALIGNMENT_T), "Alignment must be a power of two");
+
     constexpr std::size_t stride = (sizeof(T) + ...);
 
     (rInterleve.m_stride = ... = stride);
 
+    rPos = align_up(rPos, ALIGNMENT_T);
+
     aux_partition(rPos, rInterleve ...);
 
-    rPos += stride * count;
+    rPos = align_up(rPos + stride * count, ALIGNMENT_T);
+}
+
+/**
+ * @brief Lay out and allocate CoSpaceSatData::m_data to fit a number of satellites
+ *
+ * Positions, velocities, and angular velocities are arranged as XXXX... YYYY... ZZZZ..., and
+ * rotations as XYZWXYZWXYZW.... Masses are in their own array. Each of these arrays are aligned
+ * and padded to ALIGNMENT_T, see partition.
+ *
+ * Existing data and satellite IDs are discarded, and m_satCount is set to zero. Satellites can
+ * then be added with sat_create, or by setting m_satCount directly if IDs are not needed.
+ */
+template <std::size_t ALIGNMENT_T = gc_satDataAlignment>
+void sat_data_allocate(CoSpaceSatData &rData, uint32_t const capacity)
+{
+    std::size_t bytesUsed = 0;
+
+    partition<ALIGNMENT_T>(bytesUsed, capacity, rData.m_satPositions[0]);
+    partition<ALIGNMENT_T>(bytesUsed, capacity, rData.m_satPositions[1]);
+    partition<ALIGNMENT_T>(bytesUsed, capacity, rData.m_satPositions[2]);
+    partition<ALIGNMENT_T>(bytesUsed, capacity, rData.m_satVelocities[0]);
+    partition<ALIGNMENT_T>(bytesUsed, capacity, rData.m_satVelocities[1]);
+    partition<ALIGNMENT_T>(bytesUsed, capacity, rData.m_satVelocities[2]);
+    partition<ALIGNMENT_T>(bytesUsed, capacity, rData.m_satRotations[0],
+                                                rData.m_satRotations[1],
+                                                rData.m_satRotations[2],
+                                                rData.m_satRotations[3]);
+    partition<ALIGNMENT_T>(bytesUsed, capacity, rData.m_satAngularVels[0]);
+    partition<ALIGNMENT_T>(bytesUsed, capacity, rData.m_satAngularVels[1]);
+    partition<ALIGNMENT_T>(bytesUsed, capacity, rData.m_satAngularVels[2]);
+    partition<ALIGNMENT_T>(bytesUsed, capacity, rData.m_satMasses);
+
+    rData.m_data        = Corrade::Utility::allocateAligned<unsigned char, ALIGNMENT_T>(Corrade::NoInit, bytesUsed);
+    rData.m_satCapacity = capacity;
+    rData.m_satCount    = 0;
+
+    rData.m_satIds       = {};
+    rData.m_satIdToIndex.clear();
+    rData.m_satIndexToId.clear();
+}
+
+/**
+ * @brief Get the index of a satellite created by sat_create within its component arrays
+ */
+inline std::size_t sat_index(CoSpaceSatData const& data, SatId const sat) noexcept
+{
+    LGRN_ASSERTMV(data.m_satIds.exists(sat), "Satellite does not exist", sat);
+    return data.m_satIdToIndex[sat];
 }
 
 // INDEX_T is a template parameter to allow passing in "strong typedef" types,
@@ -182,22 +263,26 @@ constexpr auto sat_views(
 }
 
 /**
- * @brief Get transform of a coordinate space, but if a parent satellite exists,
- *        use parent satellite's transform instead.
+ * @brief Get transform of a coordinate space, using its parent satellite's transform if it has
+ *        one, looked up by ID within parentData.
  */
-template<typename POSVIEW_T, typename ROTVIEW_T>
-constexpr CoSpaceTransform coord_get_transform(
-        CoSpaceHierarchy coordHier, CoSpaceTransform coordOrig,
-        POSVIEW_T const& x,  POSVIEW_T const& y,  POSVIEW_T const& z,
-        ROTVIEW_T const& qx, ROTVIEW_T const& qy, ROTVIEW_T const& qz, ROTVIEW_T const& qw) noexcept
-{
-    SatId const sat = coordHier.m_parentSat;
-    return (sat == lgrn::id_null<SatId>())
-        ? coordOrig
-        : CoSpaceTransform{
-            .m_rotation = {to_vec<Vector3d>(sat, qx, qy, qz), qw[std::size_t(sat)]},
-            .m_position = to_vec<Vector3g>(sat, x, y, z),
-            .m_precision = coordOrig.m_precision };
+inline CoSpaceTransform coord_get_transform(CoSpaceCommon const& space, CoSpaceSatData const& parentData) noexcept
+{
+    if (space.m_parentSat == lgrn::id_null<SatId>())
+    {
+        return space;
+    }
+
+    std::size_t const i         = sat_index(parentData, space.m_parentSat);
+    std::size_t const satCount  = parentData.m_satCount;
+
+    auto const [x, y, z]        = sat_views(parentData.m_satPositions, parentData.m_data, satCount);
+    auto const [qx, qy, qz, qw] = sat_views(parentData.m_satRotations, parentData.m_data, satCount);
+
+    return CoSpaceTransform{
+        .m_rotation  = {{qx[i], qy[i], qz[i]}, qw[i]},
+        .m_position  = {x[i], y[i], z[i]},
+        .m_precision = space.m_precision };
 }
 
 } // namespace osp::universe
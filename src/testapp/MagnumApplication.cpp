@@ -159,6 +159,7 @@ const std::map<std::string_view, button_pair_t, std::less<>> gc_buttonMap = {
     {"Backspace", {sc_keyboard, (int)Key_t::Backspace }},
     {"Backslash", {sc_keyboard, (int)Key_t::Backslash  }},
     {"Comma", {sc_keyboard, (int)Key_t::Comma  }},
+    {"Period", {sc_keyboard, (int)Key_t::Period }},
     {"Delete", {sc_keyboard, (int)Key_t::Delete }},
     {"Enter", {sc_keyboard, (int)Key_t::Enter }},
     {"Equal", {sc_keyboard, (int)Key_t::Equal }},
@@ -313,8 +313,8 @@ struct PlNewton
 
 // Universe sessions
 
-#define TESTAPP_DATA_UNI_CORE 2, \
-    idUniverse,         tgUniDeltaTimeIn
+#define TESTAPP_DATA_UNI_CORE 3, \
+    idUniverse,         tgUniDeltaTimeIn,   idCoordTfCache
 struct PlUniCore
 {
     PipelineDef<EStgOptn> update            {"update            - Universe update"};
@@ -328,8 +328,8 @@ struct PlUniSceneFrame
     PipelineDef<EStgCont> sceneFrame        {"sceneFrame"};
 };
 
-#define TESTAPP_DATA_UNI_PLANETS 2, \
-    idPlanetMainSpace, idSatSurfaceSpaces
+#define TESTAPP_DATA_UNI_PLANETS 7, \
+    idPlanetMainSpace, idSatSurfaceSpaces, idSatGrid, idSatRails, idUniTime, idUniTimeWarp, idSatStepGroups
 
 //-----------------------------------------------------------------------------
 
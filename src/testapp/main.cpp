@@ -59,6 +59,7 @@
 #include <fstream>
 #include <iostream>
 #include <memory>
+#include <optional>
 #include <string_view>
 #include <thread>
 #include <unordered_map>
@@ -98,6 +99,8 @@ void print_resources();
 TestApp g_testApp;
 
 SingleThreadedExecutor g_executor;
+std::optional<MultiThreadedExecutor> g_multiThreadedExecutor;
+ReplayExecutor g_replayExecutor;
 
 std::thread g_magnumThread;
 
@@ -115,6 +118,12 @@ int main(int argc, char** argv)
         .addOption("config")                .setHelp("config",      "path to configuration file to use")
         .addBooleanOption("norepl")         .setHelp("norepl",      "don't enter read, evaluate, print, loop.")
         .addBooleanOption("log-exec")       .setHelp("log-exec",    "Log Task/Pipeline Execution (Extremely chatty!)")
+        .addOption("threads", "0")          .setHelp("threads",     "Number of worker threads to run tasks on. 0 runs tasks on the calling thread")
+        .addOption("trace-exec")            .setHelp("trace-exec",  "Write a Chrome trace (chrome://tracing or ui.perfetto.dev) JSON file of task execution to this path")
+        .addOption("trace-frames", "60")    .setHelp("trace-frames","Number of frames to record with --trace-exec")
+        .addOption("record-exec")           .setHelp("record-exec", "Record task execution order to this path, to replay with --replay-exec")
+        .addOption("record-frames", "60")   .setHelp("record-frames","Number of frames to record with --record-exec")
+        .addOption("replay-exec")           .setHelp("replay-exec", "Run tasks in the order recorded with --record-exec, instead of running them normally")
         // TODO .addBooleanOption('v', "verbose")   .setHelp("verbose",     "log verbosely")
         .setGlobalHelp("Helptext goes here.")
         .parse(argc, argv);
@@ -129,11 +138,51 @@ int main(int argc, char** argv)
     // Set thread-local logger used by OSP_LOG_* macros
     osp::set_thread_logger(g_mainThreadLogger);
 
-    g_testApp.m_pExecutor = &g_executor;
+    auto const threadCount = args.value<unsigned int>("threads");
+    if ( ! args.value("replay-exec").empty() )
+    {
+        // Replays run on the calling thread, as that's the only way to follow a recorded order
+        if ( ! g_replayExecutor.open(args.value("replay-exec")) )
+        {
+            OSP_LOG_ERROR("Could not read execution recording: {}", args.value("replay-exec"));
+            return 1;
+        }
+        g_testApp.m_pExecutor = &g_replayExecutor;
+    }
+    else if (threadCount != 0)
+    {
+        MultiThreadedExecutor &rExecutor = g_multiThreadedExecutor.emplace(threadCount);
+        g_testApp.m_pExecutor = &rExecutor;
 
-    if (args.isSet("log-exec"))
+        if (args.isSet("log-exec"))
+        {
+            rExecutor.m_log = g_logExecutor;
+        }
+        if ( ! args.value("trace-exec").empty() )
+        {
+            rExecutor.m_traceRecorder.request(args.value("trace-exec"), args.value<int>("trace-frames"));
+        }
+        if ( ! args.value("record-exec").empty() )
+        {
+            rExecutor.m_recorder.request(rExecutor.m_parallel.m_execContext, args.value("record-exec"), args.value<int>("record-frames"));
+        }
+    }
+    else
     {
-        g_executor.m_log = g_logExecutor;
+        g_testApp.m_pExecutor = &g_executor;
+
+        if (args.isSet("log-exec"))
+        {
+            g_executor.m_log = g_logExecutor;
+        }
+        if ( ! args.value("trace-exec").empty() )
+        {
+            g_executor.m_traceRecorder.request(args.value("trace-exec"), args.value<int>("trace-frames"));
+        }
+        if ( ! args.value("record-exec").empty() )
+        {
+            g_executor.m_recorder.request(g_executor.m_execContext, args.value("record-exec"), args.value<int>("record-frames"));
+        }
     }
 
     g_testApp.m_topData.resize(64);
@@ -204,6 +253,8 @@ void cli_loop(int argc, char** argv)
                     g_testApp.close_sessions(g_testApp.m_scene.m_sessions);
                     g_testApp.m_scene.m_sessions.clear();
                     g_testApp.m_scene.m_edges.m_syncWith.clear();
+                    g_testApp.m_scene.m_edges.m_semaphoreEdges.clear();
+                    g_testApp.m_scene.m_edges.m_fusable.clear();
                 }
 
                 g_testApp.m_rendererSetup = it->second.m_setup(g_testApp);
@@ -235,6 +286,10 @@ void cli_loop(int argc, char** argv)
             {
                 print_resources();
             }
+            else if (command == "stats")
+            {
+                g_testApp.m_pExecutor->write_stats(std::cout, g_testApp);
+            }
             else if (command == "exit") 
             {
                 if (magnumOpen)
@@ -277,8 +332,8 @@ void start_magnum_async(int argc, char** argv)
 
         g_testApp.m_rendererSetup(g_testApp);
 
-        g_testApp.m_graph = osp::make_exec_graph(g_testApp.m_tasks, {&g_testApp.m_renderer.m_edges, &g_testApp.m_scene.m_edges});
-        g_executor.load(g_testApp);
+        // Adds sessions made since the last update to the TaskGraph, instead of rebuilding it
+        g_testApp.update_graph();
 
         // Starts the main loop. This function is blocking, and will only return
         // once the window is closed. See MagnumApplication::drawEvent
@@ -293,6 +348,8 @@ void start_magnum_async(int argc, char** argv)
         g_testApp.close_sessions(g_testApp.m_renderer.m_sessions);
         g_testApp.m_renderer.m_sessions.clear();
         g_testApp.m_renderer.m_edges.m_syncWith.clear();
+        g_testApp.m_renderer.m_edges.m_semaphoreEdges.clear();
+        g_testApp.m_renderer.m_edges.m_fusable.clear();
 
         g_testApp.close_session(g_testApp.m_magnum);
         g_testApp.close_session(g_testApp.m_windowApp);
@@ -416,6 +473,7 @@ void print_help()
     std::cout
         << "Other commands:\n"
         << "* list_pkg  - List Packages and Resources\n"
+        << "* stats     - Show time taken by each Task and Pipeline\n"
         << "* help      - Show this again\n"
         << "* reopen    - Re-open Magnum Application\n"
         << "* exit      - Deallocate everything and return memory to OS\n";
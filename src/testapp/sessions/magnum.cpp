@@ -92,6 +92,7 @@ Session setup_magnum(
 
     rBuilder.task()
         .name       ("Clean up Magnum renderer")
+        .affinity   (ETopAffinity::Main)
         .run_on     ({tgWin.cleanup(Run_)})
         .push_to    (out.m_tasks)
         .args       ({      idResources,          idRenderGl})
@@ -145,6 +146,7 @@ Session setup_magnum_scene(
 
     rBuilder.task()
         .name       ("Resize ACtxSceneRenderGL (OpenGL) to fit all DrawEnts")
+        .affinity   (ETopAffinity::Main)
         .run_on     ({tgScnRdr.drawEntResized(Run)})
         .sync_with  ({})
         .push_to    (out.m_tasks)
@@ -158,6 +160,7 @@ Session setup_magnum_scene(
 
     rBuilder.task()
         .name       ("Compile Resource Meshes to GL")
+        .affinity   (ETopAffinity::Main)
         .run_on     ({tgScnRdr.meshResDirty(UseOrRun)})
         .sync_with  ({tgScnRdr.mesh(Ready), tgMgn.meshGL(New), tgScnRdr.entMeshDirty(UseOrRun)})
         .push_to    (out.m_tasks)
@@ -169,6 +172,7 @@ Session setup_magnum_scene(
 
     rBuilder.task()
         .name       ("Compile Resource Textures to GL")
+        .affinity   (ETopAffinity::Main)
         .run_on     ({tgScnRdr.textureResDirty(UseOrRun)})
         .sync_with  ({tgScnRdr.texture(Ready), tgMgn.textureGL(New)})
         .push_to    (out.m_tasks)
@@ -180,6 +184,7 @@ Session setup_magnum_scene(
 
     rBuilder.task()
         .name       ("Sync GL textures to entities with scene textures")
+        .affinity   (ETopAffinity::Main)
         .run_on     ({tgScnRdr.entTextureDirty(UseOrRun)})
         .sync_with  ({tgScnRdr.texture(Ready), tgScnRdr.entTexture(Ready), tgMgn.textureGL(Ready), tgMgn.entTextureGL(Modify), tgScnRdr.drawEntResized(Done)})
         .push_to    (out.m_tasks)
@@ -197,6 +202,7 @@ Session setup_magnum_scene(
 
     rBuilder.task()
         .name       ("Resync GL textures")
+        .affinity   (ETopAffinity::Main)
         .run_on     ({tgWin.resync(Run)})
         .sync_with  ({tgScnRdr.texture(Ready), tgMgn.textureGL(Ready), tgMgn.entTextureGL(Modify), tgScnRdr.drawEntResized(Done)})
         .push_to    (out.m_tasks)
@@ -216,6 +222,7 @@ Session setup_magnum_scene(
 
     rBuilder.task()
         .name       ("Sync GL meshes to entities with scene meshes")
+        .affinity   (ETopAffinity::Main)
         .run_on     ({tgScnRdr.entMeshDirty(UseOrRun)})
         .sync_with  ({tgScnRdr.mesh(Ready), tgScnRdr.entMesh(Ready), tgMgn.meshGL(Ready), tgMgn.entMeshGL(Modify), tgScnRdr.drawEntResized(Done)})
         .push_to    (out.m_tasks)
@@ -233,6 +240,7 @@ Session setup_magnum_scene(
 
     rBuilder.task()
         .name       ("Resync GL meshes")
+        .affinity   (ETopAffinity::Main)
         .run_on     ({tgWin.resync(Run)})
         .sync_with  ({tgScnRdr.mesh(Ready), tgMgn.meshGL(Ready), tgMgn.entMeshGL(Modify), tgScnRdr.drawEntResized(Done)})
         .push_to    (out.m_tasks)
@@ -252,6 +260,7 @@ Session setup_magnum_scene(
 
     rBuilder.task()
         .name       ("Bind and display off-screen FBO")
+        .affinity   (ETopAffinity::Main)
         .run_on     ({tgScnRdr.render(Run)})
         .sync_with  ({tgMgnScn.fbo(EStgFBO::Bind)})
         .push_to    (out.m_tasks)
@@ -273,6 +282,7 @@ Session setup_magnum_scene(
 
     rBuilder.task()
         .name       ("Render Entities")
+        .affinity   (ETopAffinity::Main)
         .run_on     ({tgScnRdr.render(Run)})
         .sync_with  ({tgScnRdr.group(Ready), tgScnRdr.groupEnts(Ready), tgMgnScn.camera(Ready), tgScnRdr.drawTransforms(UseOrRun), tgScnRdr.entMesh(Ready), tgScnRdr.entTexture(Ready),
                       tgMgn.entMeshGL(Ready), tgMgn.entTextureGL(Ready),
@@ -289,6 +299,7 @@ Session setup_magnum_scene(
 
     rBuilder.task()
         .name       ("Delete entities from render groups")
+        .affinity   (ETopAffinity::Main)
         .run_on     ({tgScnRdr.drawEntDelete(UseOrRun)})
         .sync_with  ({tgScnRdr.groupEnts(Delete)})
         .push_to    (out.m_tasks)
@@ -346,8 +357,10 @@ Session setup_shader_visualizer(
 
     rBuilder.task()
         .name       ("Sync MeshVisualizer shader DrawEnts")
+        .affinity   (ETopAffinity::Main)
         .run_on     ({tgWin.sync(Run)})
         .sync_with  ({tgScnRdr.groupEnts(Modify), tgScnRdr.group(Modify), tgScnRdr.materialDirty(UseOrRun)})
+        .fusable    ()
         .push_to    (out.m_tasks)
         .args       ({            idScnRender,             idGroupFwd,                        idDrawShVisual})
         .func([] (ACtxSceneRender& rScnRender, RenderGroup& rGroupFwd, ACtxDrawMeshVisualizer& rDrawShVisual) noexcept
@@ -358,6 +371,7 @@ Session setup_shader_visualizer(
 
     rBuilder.task()
         .name       ("Resync MeshVisualizer shader DrawEnts")
+        .affinity   (ETopAffinity::Main)
         .run_on     ({tgWin.resync(Run)})
         .sync_with  ({tgScnRdr.groupEnts(Modify), tgScnRdr.group(Modify)})
         .push_to    (out.m_tasks)
@@ -412,8 +426,10 @@ Session setup_shader_flat(
 
     rBuilder.task()
         .name       ("Sync Flat shader DrawEnts")
+        .affinity   (ETopAffinity::Main)
         .run_on     ({tgWin.sync(Run)})
         .sync_with  ({tgScnRdr.groupEnts(Modify), tgScnRdr.group(Modify), tgScnRdr.materialDirty(UseOrRun)})
+        .fusable    ()
         .push_to    (out.m_tasks)
         .args       ({            idScnRender,             idGroupFwd,                         idScnRenderGl,              idDrawShFlat})
         .func([] (ACtxSceneRender& rScnRender, RenderGroup& rGroupFwd, ACtxSceneRenderGL const& rScnRenderGl, ACtxDrawFlat& rDrawShFlat) noexcept
@@ -433,6 +449,7 @@ Session setup_shader_flat(
 
     rBuilder.task()
         .name       ("Resync Flat shader DrawEnts")
+        .affinity   (ETopAffinity::Main)
         .run_on     ({tgWin.resync(Run)})
         .sync_with  ({tgScnRdr.groupEnts(Modify), tgScnRdr.group(Modify)})
         .push_to    (out.m_tasks)
@@ -497,8 +514,10 @@ Session setup_shader_phong(
 
     rBuilder.task()
         .name       ("Sync Phong shader DrawEnts")
+        .affinity   (ETopAffinity::Main)
         .run_on     ({tgWin.sync(Run)})
         .sync_with  ({tgScnRdr.groupEnts(Modify), tgScnRdr.group(Modify), tgScnRdr.materialDirty(UseOrRun)})
+        .fusable    ()
         .push_to    (out.m_tasks)
         .args       ({            idScnRender,             idGroupFwd,                         idScnRenderGl,               idDrawShPhong})
         .func([] (ACtxSceneRender& rScnRender, RenderGroup& rGroupFwd, ACtxSceneRenderGL const& rScnRenderGl, ACtxDrawPhong& rDrawShPhong) noexcept
@@ -518,6 +537,7 @@ Session setup_shader_phong(
 
     rBuilder.task()
         .name       ("Resync Phong shader DrawEnts")
+        .affinity   (ETopAffinity::Main)
         .run_on     ({tgWin.resync(Run)})
         .sync_with  ({tgScnRdr.groupEnts(Modify), tgScnRdr.group(Modify)})
         .push_to    (out.m_tasks)
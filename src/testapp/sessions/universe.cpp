@@ -30,10 +30,20 @@
 
 #include <osp/core/math_2pow.h>
 #include <osp/drawing/drawing.h>
+#include <osp/tasks/parallel_for.h>
+#include <osp/universe/coord_cache.h>
 #include <osp/universe/coordinates.h>
+#include <osp/universe/sat_data.h>
+#include <osp/universe/sat_grid.h>
+#include <osp/universe/sat_integrate.h>
+#include <osp/universe/sat_kepler.h>
 #include <osp/universe/universe.h>
 #include <osp/util/logging.h>
 
+#include <Corrade/Containers/ArrayViewStl.h>
+
+#include <algorithm>
+#include <bit>
 #include <random>
 
 using namespace adera;
@@ -52,7 +62,8 @@ Session setup_uni_core(
     Session out;
     OSP_DECLARE_CREATE_DATA_IDS(out, topData, TESTAPP_DATA_UNI_CORE);
 
-    top_emplace< Universe > (topData, idUniverse);
+    top_emplace< Universe >              (topData, idUniverse);
+    top_emplace< CoSpaceTransformCache > (topData, idCoordTfCache);
 
     auto const tgUCore = out.create_pipelines<PlUniCore>(rBuilder);
 
@@ -119,45 +130,27 @@ Session setup_uni_testplanets(
     rUniverse.m_coordCommon.resize(rUniverse.m_coordIds.capacity());
 
     CoSpaceCommon &rMainSpaceCommon = rUniverse.m_coordCommon[mainSpace];
-    rMainSpaceCommon.m_satCount     = planetCount;
-    rMainSpaceCommon.m_satCapacity  = planetCount;
 
-    // Associate each planet satellite with their surface coordinate space
-    for (SatId satId = 0; satId < planetCount; ++satId)
+    // Coordinate space data is a single allocation partitioned to hold positions, velocities, and
+    // rotations, aligned for SIMD. sat_create grows it if needed.
+    sat_data_allocate(rMainSpaceCommon, planetCount);
+
+    // Create a planet satellite for each surface coordinate space. Planets are never removed, so
+    // their SatIds count up from 0 and index satSurfaceSpaces. Their indices in the component
+    // arrays start out the same, but change once sat_step_group reorders them; use sat_index
+    // to find a planet after setup.
+    for (CoSpaceId const surfaceSpaceId : satSurfaceSpaces)
     {
-        CoSpaceId const surfaceSpaceId = satSurfaceSpaces[satId];
         CoSpaceCommon &rCommon = rUniverse.m_coordCommon[surfaceSpaceId];
         rCommon.m_parent    = mainSpace;
-        rCommon.m_parentSat = satId;
+        rCommon.m_parentSat = sat_create(rMainSpaceCommon);
     }
 
-    // Coordinate space data is a single allocation partitioned to hold positions, velocities, and
-    // rotations.
-    // TODO: Alignment is needed for SIMD (not yet implemented). see Corrade alignedAlloc
-
-    std::size_t bytesUsed = 0;
-
-    // Positions and velocities are arranged as XXXX... YYYY... ZZZZ...
-    partition(bytesUsed, planetCount, rMainSpaceCommon.m_satPositions[0]);
-    partition(bytesUsed, planetCount, rMainSpaceCommon.m_satPositions[1]);
-    partition(bytesUsed, planetCount, rMainSpaceCommon.m_satPositions[2]);
-    partition(bytesUsed, planetCount, rMainSpaceCommon.m_satVelocities[0]);
-    partition(bytesUsed, planetCount, rMainSpaceCommon.m_satVelocities[1]);
-    partition(bytesUsed, planetCount, rMainSpaceCommon.m_satVelocities[2]);
-
-    // Rotations use XYZWXYZWXYZWXYZW...
-    partition(bytesUsed, planetCount, rMainSpaceCommon.m_satRotations[0],
-                                      rMainSpaceCommon.m_satRotations[1],
-                                      rMainSpaceCommon.m_satRotations[2],
-                                      rMainSpaceCommon.m_satRotations[3]);
-
-    // Allocate data for all planets
-    rMainSpaceCommon.m_data = Array<unsigned char>{Corrade::NoInit, bytesUsed};
-
     // Create easily accessible array views for each component
     auto const [x, y, z]        = sat_views(rMainSpaceCommon.m_satPositions,  rMainSpaceCommon.m_data, planetCount);
     auto const [vx, vy, vz]     = sat_views(rMainSpaceCommon.m_satVelocities, rMainSpaceCommon.m_data, planetCount);
     auto const [qx, qy, qz, qw] = sat_views(rMainSpaceCommon.m_satRotations,  rMainSpaceCommon.m_data, planetCount);
+    auto const [wx, wy, wz]     = sat_views(rMainSpaceCommon.m_satAngularVels, rMainSpaceCommon.m_data, planetCount);
 
     std::mt19937 gen(seed);
     std::uniform_int_distribution<spaceint_t> posDist(-maxDist, maxDist);
@@ -178,8 +171,19 @@ Session setup_uni_testplanets(
         qy[i] = 0.0;
         qz[i] = 0.0;
         qw[i] = 1.0;
+
+        // Spin based on i, semi-random
+        Vector3d const axis = Vector3d{std::sin(i), std::cos(i), double(i % 8 - 4)}.normalized();
+        double const speed  = (i % 16) / 16.0;
+        wx[i] = axis.x() * speed;
+        wy[i] = axis.y() * speed;
+        wz[i] = axis.z() * speed;
     }
 
+    // Fill the transform cache now, as tasks that draw or read it may run before the first
+    // "Update planets"
+    coord_cache_update(top_get<CoSpaceTransformCache>(topData, idCoordTfCache), rUniverse);
+
     // Set initial scene frame
 
     auto &rScnFrame      = top_get<SceneFrame>(topData, idScnFrame);
@@ -192,54 +196,110 @@ Session setup_uni_testplanets(
     top_emplace< CoSpaceId >        (topData, idPlanetMainSpace, mainSpace);
     top_emplace< float >            (topData, tgUniDeltaTimeIn, 1.0f / 60.0f);
     top_emplace< CoSpaceIdVec_t >   (topData, idSatSurfaceSpaces, std::move(satSurfaceSpaces));
+    top_emplace< SatGrid >          (topData, idSatGrid);
+    top_emplace< SatKeplerRails >   (topData, idSatRails);
+    top_emplace< double >           (topData, idUniTime, 0.0);
+    top_emplace< double >           (topData, idUniTimeWarp, 1.0);
+    top_emplace< SatStepGroups >    (topData, idSatStepGroups);
 
     rBuilder.task()
         .name       ("Update planets")
         .run_on     (tgUCore.update(Run))
         .sync_with  ({tgUSFrm.sceneFrame(Modify)})
         .push_to    (out.m_tasks)
-        .args       ({     idUniverse,               idPlanetMainSpace,            idScnFrame,                      idSatSurfaceSpaces,           tgUniDeltaTimeIn })
-        .func([] (Universe& rUniverse, CoSpaceId const planetMainSpace, SceneFrame &rScnFrame, CoSpaceIdVec_t const& rSatSurfaceSpaces, float const uniDeltaTimeIn) noexcept
+        .args       ({     idUniverse,               idPlanetMainSpace,            idScnFrame,                      idSatSurfaceSpaces,           tgUniDeltaTimeIn,          idSatGrid,                        idCoordTfCache,                 idSatRails,           idUniTime,         idUniTimeWarp,             idSatStepGroups })
+        .func([] (Universe& rUniverse, CoSpaceId const planetMainSpace, SceneFrame &rScnFrame, CoSpaceIdVec_t const& rSatSurfaceSpaces, float const uniDeltaTimeIn, SatGrid &rSatGrid, CoSpaceTransformCache &rCoordTfCache, SatKeplerRails &rSatRails, double &rUniTime, double const uniTimeWarp, SatStepGroups &rSatStepGroups, WorkerContext ctx) noexcept
     {
         CoSpaceCommon &rMainSpaceCommon = rUniverse.m_coordCommon[planetMainSpace];
 
         auto const scale = osp::math::mul_2pow<double, int>(1.0, -rMainSpaceCommon.m_precision);
-        double const scaleDelta = uniDeltaTimeIn / scale;
 
-        auto const [x, y, z]        = sat_views(rMainSpaceCommon.m_satPositions,  rMainSpaceCommon.m_data, rMainSpaceCommon.m_satCount);
-        auto const [vx, vy, vz]     = sat_views(rMainSpaceCommon.m_satVelocities, rMainSpaceCommon.m_data, rMainSpaceCommon.m_satCount);
-        auto const [qx, qy, qz, qw] = sat_views(rMainSpaceCommon.m_satRotations,  rMainSpaceCommon.m_data, rMainSpaceCommon.m_satCount);
+        // Phase 1: Move satellites, apply arbitrary inverse-square gravity towards origin, and
+        //          spin them. Each satellite only touches its own elements, so this can be split
+        //          across threads in chunks. sat_integrate processes a few satellites at a time
+        //          with SIMD, so chunks are a multiple of that. Satellites far from the scene
+        //          frame are on rails, and follow their Kepler orbits for the same gravity
+        //          instead of being integrated.
+        //
+        //          Time warp makes steps longer. Satellites are grouped by how many substeps
+        //          they need to stay accurate, so only fast inner orbits take many.
+
+        constexpr double gravParam = 10000000000.0;
 
-        // Phase 1: Move satellites
+        double const deltaTime = uniDeltaTimeIn * uniTimeWarp;
+        rUniTime += deltaTime;
 
-        for (std::size_t i = 0; i < rMainSpaceCommon.m_satCount; ++i)
+        SatIntegrateParams const params
         {
-            x[i] += vx[i] * scaleDelta;
-            y[i] += vy[i] * scaleDelta;
-            z[i] += vz[i] * scaleDelta;
-
-            // Apply arbitrary inverse-square gravity towards origin
-            Vector3d const pos       = Vector3d( Vector3g( x[i], y[i], z[i] ) ) * scale;
-            double const r           = pos.length();
-            double const c_gm        = 10000000000.0;
-            Vector3d const accel     = -pos * uniDeltaTimeIn * c_gm / (r * r * r);
-
-            vx[i] += accel.x();
-            vy[i] += accel.y();
-            vz[i] += accel.z();
-
-            // Rotate based on i, semi-random
-            Vector3d const axis = Vector3d{std::sin(i), std::cos(i), double(i % 8 - 4)}.normalized();
-            Radd const speed{(i % 16) / 16.0};
-
-            Quaterniond const rot =   Quaterniond{{qx[i], qy[i], qz[i]}, qw[i]}
-                                    * Quaterniond::rotation(speed * uniDeltaTimeIn, axis);
-            qx[i] = rot.vector().x();
-            qy[i] = rot.vector().y();
-            qz[i] = rot.vector().z();
-            qw[i] = rot.scalar();
+            .m_deltaTime     = deltaTime,
+            .m_metersPerUnit = scale,
+            .m_gravParam     = gravParam
+        };
+
+        SatSubstepParams const substep
+        {
+            .m_accuracy = 0.01,
+            .m_maxLevel = 10
+        };
+
+        SatKeplerParams const railsParams
+        {
+            .m_time          = rUniTime,
+            .m_metersPerUnit = scale,
+            .m_gravParam     = gravParam
+        };
+
+        // Satellites on rails are grouped last
+        sat_step_group(rSatStepGroups, rMainSpaceCommon, rSatRails.m_onRails, params, substep);
+
+        constexpr std::size_t satsPerChunk = 256;
+
+        auto const for_each_chunk = [ctx] (std::size_t const first, std::size_t const last, auto&& func)
+        {
+            std::size_t const chunkCount = (last - first + satsPerChunk - 1) / satsPerChunk;
+            parallel_for(ctx, chunkCount, 1, [first, last, &func] (std::size_t const chunk)
+            {
+                std::size_t const chunkFirst = first + chunk * satsPerChunk;
+                func(chunkFirst, std::min(chunkFirst + satsPerChunk, last));
+            });
+        };
+
+        for (int level = 0; level <= substep.m_maxLevel; ++level)
+        {
+            int const substeps = 1 << level;
+
+            SatIntegrateParams levelParams = params;
+            levelParams.m_deltaTime = deltaTime / substeps;
+
+            // Each chunk takes all of its substeps at once, as satellites don't affect each other
+            for_each_chunk(rSatStepGroups.m_start[level], rSatStepGroups.m_start[level + 1],
+                           [&rMainSpaceCommon, &levelParams, substeps] (std::size_t const first, std::size_t const last)
+            {
+                for (int i = 0; i < substeps; ++i)
+                {
+                    sat_integrate(rMainSpaceCommon, first, last, levelParams);
+                }
+            });
         }
 
+        std::size_t const railsLevel = std::size_t(substep.m_maxLevel) + 1;
+        for_each_chunk(rSatStepGroups.m_start[railsLevel], rSatStepGroups.m_start[railsLevel + 1],
+                       [&rSatRails, &rMainSpaceCommon, &railsParams] (std::size_t const first, std::size_t const last)
+        {
+            sat_kepler_propagate(rSatRails, rMainSpaceCommon, first, last, railsParams);
+        });
+
+        // Surface spaces follow their planets
+        coord_cache_mark_sats_moved(rCoordTfCache, rUniverse, planetMainSpace);
+        coord_cache_update(rCoordTfCache, rUniverse);
+
+        // Satellites near the scene frame come off rails, so they can interact with what's there
+        constexpr double numericRadius = 2000.0;
+
+        CoordTransformer const frameToMain = coord_cache_get(rCoordTfCache, rScnFrame.m_parent, planetMainSpace);
+        sat_kepler_update_modes(rSatRails, rMainSpaceCommon, frameToMain.transform_position(rScnFrame.m_position),
+                                numericRadius, railsParams);
+
         // Phase 2: Transfers and stuff
 
         constexpr float captureDist = 500.0f;
@@ -251,28 +311,22 @@ Session setup_uni_testplanets(
 
         if (notInPlanet)
         {
-            // Find a planet to enter
-            std::size_t nearbyPlanet = rMainSpaceCommon.m_satCount;
-            for (std::size_t i = 0; i < rMainSpaceCommon.m_satCount; ++i)
-            {
-                Vector3 const diff = (Vector3( x[i], y[i], z[i] ) - Vector3(areaPos)) * scale;
-                if (diff.length() < captureDist)
-                {
-                    nearbyPlanet = i;
-                    break;
-                }
-            }
+            // Find the nearest planet to enter. Cells about as large as the capture distance
+            // keep the search to a few cells around the scene frame.
+            double const captureUnits = captureDist / scale;
+            sat_grid_build(rSatGrid, rMainSpaceCommon, int(std::bit_width(uint64_t(captureUnits))));
+
+            SatGridHit const nearest = sat_grid_nearest(rSatGrid, areaPos, captureUnits);
 
-            if (nearbyPlanet < rMainSpaceCommon.m_satCount)
+            if (nearest.m_sat != lgrn::id_null<SatId>())
             {
+                SatId const nearbyPlanet = nearest.m_sat;
+
                 OSP_LOG_INFO("Captured into Satellite {} under CoordSpace {}",
                              nearbyPlanet, int(rSatSurfaceSpaces[nearbyPlanet]));
 
-                CoSpaceId const surface         = rSatSurfaceSpaces[nearbyPlanet];
-                CoSpaceCommon  &rSurfaceCommon  = rUniverse.m_coordCommon[surface];
-
-                CoSpaceTransform const surfaceTf     = coord_get_transform(rSurfaceCommon, rSurfaceCommon, x, y, z, qx, qy, qz, qw);
-                CoordTransformer const mainToSurface = coord_parent_to_child(rMainSpaceCommon, surfaceTf);
+                CoSpaceId const        surface       = rSatSurfaceSpaces[nearbyPlanet];
+                CoordTransformer const mainToSurface = coord_cache_get(rCoordTfCache, planetMainSpace, surface);
 
                 // Transfer scene frame from Main to Surface coordinate space
                 rScnFrame.m_parent   = surface;
@@ -289,11 +343,8 @@ Session setup_uni_testplanets(
             {
                 OSP_LOG_INFO("Leaving planet");
 
-                CoSpaceId const surface       = rScnFrame.m_parent;
-                CoSpaceCommon &rSurfaceCommon = rUniverse.m_coordCommon[surface];
-
-                CoSpaceTransform const surfaceTf     = coord_get_transform(rSurfaceCommon, rSurfaceCommon, x, y, z, qx, qy, qz, qw);
-                CoordTransformer const surfaceToMain = coord_child_to_parent(rMainSpaceCommon, surfaceTf);
+                CoSpaceId const        surface       = rScnFrame.m_parent;
+                CoordTransformer const surfaceToMain = coord_cache_get(rCoordTfCache, surface, planetMainSpace);
 
                 // Transfer scene frame from Surface to Main coordinate space
                 rScnFrame.m_parent   = planetMainSpace;
@@ -311,11 +362,14 @@ Session setup_uni_testplanets(
 
 struct PlanetDraw
 {
-    DrawEntVec_t            drawEnts;
-    std::array<DrawEnt, 3>  axis;
-    DrawEnt                 attractor;
-    MaterialId              matPlanets;
-    MaterialId              matAxis;
+    DrawEntVec_t                            drawEnts;
+    std::array<std::vector<spaceint_t>, 3>  relativePos; ///< Planet positions in scene space, reused each frame
+    std::array<DrawEnt, 3>                  axis;
+    DrawEnt                                 attractor;
+    MaterialId                              matPlanets;
+    MaterialId                              matAxis;
+    input::EButtonControlIndex              btnWarpFaster;
+    input::EButtonControlIndex              btnWarpSlower;
 };
 
 Session setup_testplanets_draw(
@@ -352,6 +406,37 @@ Session setup_testplanets_draw(
     rPlanetDraw.matPlanets = matPlanets;
     rPlanetDraw.matAxis    = matAxis;
 
+    auto &rCamCtrl = top_get<ACtxCameraController>(topData, idCamCtrl);
+    rPlanetDraw.btnWarpFaster = rCamCtrl.m_controls.button_subscribe("ui_timewarp_faster");
+    rPlanetDraw.btnWarpSlower = rCamCtrl.m_controls.button_subscribe("ui_timewarp_slower");
+
+    rBuilder.task()
+        .name       ("Change time warp with keyboard controls")
+        .run_on     ({tgWin.inputs(Run)})
+        .sync_with  ({tgCmCt.camCtrl(Ready), tgUSFrm.sceneFrame(Modify)})
+        .push_to    (out.m_tasks)
+        .args       ({                 idCamCtrl,            idPlanetDraw,              idUniTimeWarp })
+        .func([] (ACtxCameraController& rCamCtrl, PlanetDraw& rPlanetDraw, double& rUniTimeWarp) noexcept
+    {
+        constexpr double maxWarp = 10000.0;
+
+        double const prevWarp = rUniTimeWarp;
+
+        if (rCamCtrl.m_controls.button_triggered(rPlanetDraw.btnWarpFaster))
+        {
+            rUniTimeWarp = std::min(rUniTimeWarp * 10.0, maxWarp);
+        }
+        if (rCamCtrl.m_controls.button_triggered(rPlanetDraw.btnWarpSlower))
+        {
+            rUniTimeWarp = std::max(rUniTimeWarp / 10.0, 1.0);
+        }
+
+        if (rUniTimeWarp != prevWarp)
+        {
+            OSP_LOG_INFO("Time warp: {}x", rUniTimeWarp);
+        }
+    });
+
     rBuilder.task()
         .name       ("Position SceneFrame center to Camera Controller target")
         .run_on     ({tgWin.inputs(Run)})
@@ -407,21 +492,17 @@ Session setup_testplanets_draw(
         .run_on     ({tgWin.resync(Run)})
         .sync_with  ({tgScnRdr.drawEntResized(Done), tgScnRdr.materialDirty(Modify_), tgScnRdr.entMeshDirty(Modify_)})
         .push_to    (out.m_tasks)
-        .args       ({           idDrawing,                 idScnRender,             idNMesh,            idPlanetDraw,          idUniverse,               idPlanetMainSpace})
-        .func([]    (ACtxDrawing& rDrawing, ACtxSceneRender& rScnRender, NamedMeshes& rNMesh, PlanetDraw& rPlanetDraw, Universe& rUniverse, CoSpaceId const planetMainSpace) noexcept
+        .args       ({           idDrawing,                 idScnRender,             idNMesh,            idPlanetDraw})
+        .func([]    (ACtxDrawing& rDrawing, ACtxSceneRender& rScnRender, NamedMeshes& rNMesh, PlanetDraw& rPlanetDraw) noexcept
     {
-        CoSpaceCommon &rMainSpace = rUniverse.m_coordCommon[planetMainSpace];
-
         Material &rMatPlanet = rScnRender.m_materials[rPlanetDraw.matPlanets];
         Material &rMatAxis   = rScnRender.m_materials[rPlanetDraw.matAxis];
 
         MeshId const sphereMeshId = rNMesh.m_shapeToMesh.at(EShape::Sphere);
         MeshId const cubeMeshId   = rNMesh.m_shapeToMesh.at(EShape::Box);
 
-        for (std::size_t i = 0; i < rMainSpace.m_satCount; ++i)
+        for (DrawEnt const drawEnt : rPlanetDraw.drawEnts)
         {
-            DrawEnt const drawEnt = rPlanetDraw.drawEnts[i];
-
             rScnRender.m_mesh[drawEnt] = rDrawing.m_meshRefCounts.ref_add(sphereMeshId);
             rScnRender.m_meshDirty.push_back(drawEnt);
             rScnRender.m_visible.set(std::size_t(drawEnt));
@@ -457,34 +538,21 @@ Session setup_testplanets_draw(
         .run_on     ({tgScnRdr.render(Run)})
         .sync_with  ({tgScnRdr.drawTransforms(Modify_), tgScnRdr.drawEntResized(Done), tgCmCt.camCtrl(Ready), tgUSFrm.sceneFrame(Modify)})
         .push_to    (out.m_tasks)
-        .args       ({        idDrawing,                 idScnRender,            idPlanetDraw,          idUniverse,                  idScnFrame,               idPlanetMainSpace})
-        .func([] (ACtxDrawing& rDrawing, ACtxSceneRender& rScnRender, PlanetDraw& rPlanetDraw, Universe& rUniverse, SceneFrame const& rScnFrame, CoSpaceId const planetMainSpace) noexcept
+        .args       ({        idDrawing,                 idScnRender,            idPlanetDraw,          idUniverse,                  idScnFrame,               idPlanetMainSpace,                            idCoordTfCache})
+        .func([] (ACtxDrawing& rDrawing, ACtxSceneRender& rScnRender, PlanetDraw& rPlanetDraw, Universe& rUniverse, SceneFrame const& rScnFrame, CoSpaceId const planetMainSpace, CoSpaceTransformCache const& rCoordTfCache) noexcept
     {
 
         CoSpaceCommon &rMainSpace = rUniverse.m_coordCommon[planetMainSpace];
         auto const [x, y, z]        = sat_views(rMainSpace.m_satPositions, rMainSpace.m_data, rMainSpace.m_satCount);
         auto const [qx, qy, qz, qw] = sat_views(rMainSpace.m_satRotations, rMainSpace.m_data, rMainSpace.m_satCount);
 
-        // Calculate transform from universe to area/local-space for rendering.
-        // This can be generalized by finding a common ancestor within the tree
-        // of coordinate spaces. Since there's only two possibilities, an if
-        // statement works.
-        CoordTransformer mainToArea;
-        if (rScnFrame.m_parent == planetMainSpace)
-        {
-            mainToArea = coord_parent_to_child(rMainSpace, rScnFrame);
-        }
-        else
-        {
-            CoSpaceId const landedId = rScnFrame.m_parent;
-            CoSpaceCommon &rLanded = rUniverse.m_coordCommon[landedId];
+        // Calculate transform from universe to area/local-space for rendering, through whichever
+        // coordinate space the scene frame is in.
+        CoSpaceId const        areaParent   = rScnFrame.m_parent;
+        CoordTransformer const mainToParent = coord_cache_get(rCoordTfCache, planetMainSpace, areaParent);
+        CoordTransformer const parentToArea = coord_parent_to_child(rUniverse.m_coordCommon[areaParent], rScnFrame);
+        CoordTransformer const mainToArea   = coord_composite(parentToArea, mainToParent);
 
-            CoSpaceTransform const landedTf     = coord_get_transform(rLanded, rLanded, x, y, z, qx, qy, qz, qw);
-            CoordTransformer const mainToLanded = coord_parent_to_child(rMainSpace, landedTf);
-            CoordTransformer const landedToArea = coord_parent_to_child(landedTf, rScnFrame);
-
-            mainToArea = coord_composite(landedToArea, mainToLanded);
-        }
         Quaternion const mainToAreaRot{mainToArea.rotation()};
 
         float const scale = math::mul_2pow<float, int>(1.0f, -rMainSpace.m_precision);
@@ -510,10 +578,20 @@ Session setup_testplanets_draw(
             * Matrix4{mainToAreaRot.toMatrix()}
             * Matrix4::scaling({10, 10, 500000});
 
-        for (std::size_t i = 0; i < rMainSpace.m_satCount; ++i)
+        auto &[relX, relY, relZ] = rPlanetDraw.relativePos;
+        relX.resize(rMainSpace.m_satCount);
+        relY.resize(rMainSpace.m_satCount);
+        relZ.resize(rMainSpace.m_satCount);
+        mainToArea.transform_positions(x, y, z, Corrade::Containers::arrayView(relX),
+                                                Corrade::Containers::arrayView(relY),
+                                                Corrade::Containers::arrayView(relZ));
+
+        // DrawEnts are only made on resync, satellites added since then aren't drawn yet
+        std::size_t const drawCount = std::min<std::size_t>(rPlanetDraw.drawEnts.size(), rMainSpace.m_satCount);
+
+        for (std::size_t i = 0; i < drawCount; ++i)
         {
-            Vector3g const relative = mainToArea.transform_position({x[i], y[i], z[i]});
-            Vector3 const relativeMeters = Vector3(relative) * scale;
+            Vector3 const relativeMeters = Vector3(to_vec<Vector3g>(i, relX, relY, relZ)) * scale;
 
             Quaterniond const rot{{qx[i], qy[i], qz[i]}, qw[i]};
 
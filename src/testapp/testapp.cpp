@@ -32,6 +32,12 @@
 #include <osp/vehicles/ImporterData.h>
 #include <spdlog/fmt/ostr.h>
 
+#include <Corrade/Containers/ArrayViewStl.h>
+
+#include <algorithm>
+#include <fstream>
+#include <variant>
+
 namespace testapp
 {
 
@@ -71,6 +77,8 @@ void TestApp::close_sessions(osp::ArrayView<osp::Session> const sessions)
             TopTask &rCurrTaskData = m_taskData[task];
             rCurrTaskData.m_debugName.clear();
             rCurrTaskData.m_dataUsed.clear();
+            rCurrTaskData.m_dataAccess.clear();
+            rCurrTaskData.m_dataTypes.clear();
             rCurrTaskData.m_func = nullptr;
         }
         rSession.m_tasks.clear();
@@ -84,6 +92,8 @@ void TestApp::close_sessions(osp::ArrayView<osp::Session> const sessions)
         }
         rSession.m_pipelines.clear();
     }
+
+    update_graph();
 }
 
 
@@ -92,6 +102,47 @@ void TestApp::close_session(osp::Session &rSession)
     close_sessions(osp::ArrayView<osp::Session>(&rSession, 1));
 }
 
+void TestApp::update_graph()
+{
+    using namespace osp;
+
+    std::vector<TaskId>     tasksAdded;
+    std::vector<TaskId>     tasksRemoved;
+    std::vector<PipelineId> pipelinesAdded;
+    std::vector<PipelineId> pipelinesRemoved;
+
+    // Compare IDs that currently exist with the ones that existed last time
+    auto const diff = [] <typename ID_T> (lgrn::IdRegistryStl<ID_T> const& ids, BitVector_t &rInGraph, std::vector<ID_T> &rAdded, std::vector<ID_T> &rRemoved)
+    {
+        bitvector_resize(rInGraph, std::max(ids.capacity(), rInGraph.size()));
+
+        for (std::size_t i = 0; i < rInGraph.size(); ++i)
+        {
+            bool const exists  = i < ids.capacity() && ids.exists(ID_T(i));
+            bool const inGraph = rInGraph.test(i);
+
+            if (exists && ! inGraph)
+            {
+                rAdded.push_back(ID_T(i));
+                rInGraph.set(i);
+            }
+            else if ( ! exists && inGraph )
+            {
+                rRemoved.push_back(ID_T(i));
+                rInGraph.reset(i);
+            }
+        }
+    };
+
+    diff(m_tasks.m_taskIds,     m_graphTasks,     tasksAdded,     tasksRemoved);
+    diff(m_tasks.m_pipelineIds, m_graphPipelines, pipelinesAdded, pipelinesRemoved);
+
+    update_exec_graph(m_graph, m_tasks, {&m_applicationGroup.m_edges, &m_scene.m_edges, &m_renderer.m_edges}, m_taskData,
+                      {tasksAdded, pipelinesAdded, tasksRemoved, pipelinesRemoved});
+
+    m_pExecutor->load(*this);
+}
+
 
 template<typename FUNC_T>
 static void resource_for_each_type(osp::ResTypeId const type, osp::Resources& rResources, FUNC_T&& do_thing)
@@ -155,10 +206,105 @@ void TestApp::clear_resource_owners()
 //-----------------------------------------------------------------------------
 
 
+void ExecTraceRecorder::request(std::string path, int const frames)
+{
+    m_path              = std::move(path);
+    m_framesRequested   = frames;
+}
+
+void ExecTraceRecorder::frame_begin(osp::ExecContext &rExec, std::size_t const laneCount)
+{
+    if (m_framesRequested != 0)
+    {
+        m_framesLeft        = std::exchange(m_framesRequested, 0);
+        m_trace             = {};
+        m_trace.lanes.resize(laneCount);
+        rExec.pTrace        = &m_trace;
+    }
+
+    if (m_framesLeft != 0)
+    {
+        m_trace.frames.push_back({m_trace.now(), 0});
+    }
+}
+
+void ExecTraceRecorder::frame_end(TestAppTasks const& appTasks, osp::ExecContext &rExec)
+{
+    if (m_framesLeft == 0)
+    {
+        return;
+    }
+
+    m_trace.frames.back().endNs = m_trace.now();
+
+    -- m_framesLeft;
+    if (m_framesLeft == 0)
+    {
+        rExec.pTrace = nullptr;
+
+        std::ofstream file{m_path};
+        file << osp::TopExecWriteTrace{appTasks.m_tasks, appTasks.m_taskData, m_trace};
+
+        OSP_LOG_INFO("Wrote execution trace of {} frames to {}", m_trace.frames.size(), m_path);
+    }
+}
+
+void ExecStallReporter::frame_end(TestAppTasks const& appTasks, osp::ExecContext const& exec)
+{
+    osp::ExecStall const stall = osp::exec_find_stall(appTasks.m_tasks, appTasks.m_graph, exec, m_scratch);
+    if (stall.chain.empty())
+    {
+        m_reported = false;
+    }
+    else if ( ! std::exchange(m_reported, true) )
+    {
+        OSP_LOG_ERROR("{}", osp::TopExecWriteStall{appTasks.m_tasks, appTasks.m_taskData, stall});
+    }
+}
+
+void ExecRecordingRecorder::request(osp::ExecContext &rExec, std::string path, int const frames)
+{
+    m_path              = std::move(path);
+    m_framesLeft        = frames;
+    m_recording         = {};
+    rExec.pRecording    = (frames != 0) ? &m_recording : nullptr;
+}
+
+void ExecRecordingRecorder::frame_end(osp::ExecContext &rExec)
+{
+    if (m_framesLeft == 0)
+    {
+        return;
+    }
+
+    m_recording.events.emplace_back(osp::ExecRecording::FrameEnd{});
+
+    -- m_framesLeft;
+    if (m_framesLeft == 0)
+    {
+        rExec.pRecording = nullptr;
+
+        std::ofstream file{m_path, std::ios::binary};
+        osp::exec_recording_write(file, m_recording);
+
+        OSP_LOG_INFO("Wrote execution recording of {} events to {}", m_recording.events.size(), m_path);
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+
 void SingleThreadedExecutor::load(TestAppTasks& rAppTasks)
 {
+    std::lock_guard<std::mutex> const lock(m_statsMutex);
+
     osp::exec_conform(rAppTasks.m_tasks, m_execContext);
     m_execContext.doLogging = m_log != nullptr;
+
+    osp::exec_stats_conform(rAppTasks.m_tasks, m_stats);
+    m_execContext.pStats = &m_stats;
+
+    osp::top_resolve_args(rAppTasks.m_tasks, rAppTasks.m_taskData, rAppTasks.m_topData, m_args);
 }
 
 void SingleThreadedExecutor::run(TestAppTasks& rAppTasks, osp::PipelineId pipeline)
@@ -173,23 +319,35 @@ void SingleThreadedExecutor::signal(TestAppTasks& rAppTasks, osp::PipelineId pip
 
 void SingleThreadedExecutor::wait(TestAppTasks& rAppTasks)
 {
+    std::lock_guard<std::mutex> const lock(m_statsMutex);
+
+    LGRN_ASSERTM(osp::top_args_resolved_from(m_args, rAppTasks.m_topData),
+                 "TopData was resized or reallocated without reloading the executor");
+
+    m_traceRecorder.frame_begin(m_execContext, 1);
+
     if (m_log != nullptr)
     {
         m_log->info("\n>>>>>>>>>> Previous State Changes\n{}\n>>>>>>>>>> Current State\n{}\n",
                     osp::TopExecWriteLog  {rAppTasks.m_tasks, rAppTasks.m_taskData, rAppTasks.m_graph, m_execContext},
                     osp::TopExecWriteState{rAppTasks.m_tasks, rAppTasks.m_taskData, rAppTasks.m_graph, m_execContext} );
-        m_execContext.logMsg.clear();
+        osp::exec_log_mark_read(m_execContext);
     }
 
     osp::exec_update(rAppTasks.m_tasks, rAppTasks.m_graph, m_execContext);
-    osp::top_run_blocking(rAppTasks.m_tasks, rAppTasks.m_graph, rAppTasks.m_taskData, rAppTasks.m_topData, m_execContext);
+    osp::top_run_blocking(rAppTasks.m_tasks, rAppTasks.m_graph, rAppTasks.m_taskData, m_args, m_execContext);
+
+    m_stallReporter.frame_end(rAppTasks, m_execContext);
 
     if (m_log != nullptr)
     {
         m_log->info("\n>>>>>>>>>> New State Changes\n{}",
                     osp::TopExecWriteLog{rAppTasks.m_tasks, rAppTasks.m_taskData, rAppTasks.m_graph, m_execContext} );
-        m_execContext.logMsg.clear();
+        osp::exec_log_mark_read(m_execContext);
     }
+
+    m_traceRecorder.frame_end(rAppTasks, m_execContext);
+    m_recorder.frame_end(m_execContext);
 }
 
 bool SingleThreadedExecutor::is_running(TestAppTasks const& appTasks)
@@ -197,5 +355,224 @@ bool SingleThreadedExecutor::is_running(TestAppTasks const& appTasks)
     return m_execContext.hasRequestRun || (m_execContext.pipelinesRunning != 0);
 }
 
+void SingleThreadedExecutor::write_stats(std::ostream& rStream, TestAppTasks const& appTasks)
+{
+    std::lock_guard<std::mutex> const lock(m_statsMutex);
+    rStream << osp::TopExecWriteStats{appTasks.m_tasks, appTasks.m_taskData, m_stats};
+}
+
+//-----------------------------------------------------------------------------
+
+bool ReplayExecutor::open(std::string const& path)
+{
+    std::ifstream file{path, std::ios::binary};
+    if ( ! osp::exec_recording_read(file, m_recording) )
+    {
+        return false;
+    }
+
+    m_cursor    = 0;
+    m_replaying = ! m_recording.events.empty();
+    return true;
+}
+
+void ReplayExecutor::load(TestAppTasks& rAppTasks)
+{
+    std::lock_guard<std::mutex> const lock(m_statsMutex);
+
+    osp::exec_conform(rAppTasks.m_tasks, m_execContext);
+
+    osp::exec_stats_conform(rAppTasks.m_tasks, m_stats);
+    m_execContext.pStats = &m_stats;
+
+    osp::top_resolve_args(rAppTasks.m_tasks, rAppTasks.m_taskData, rAppTasks.m_topData, m_args);
+
+    if (m_replaying && ! osp::exec_recording_fits(rAppTasks.m_tasks, m_recording))
+    {
+        stop_replay("recording doesn't match tasks");
+    }
+}
+
+template <typename EVENT_T>
+bool ReplayExecutor::in_current_frame(osp::PipelineId const pipeline) const
+{
+    for (std::size_t i = m_cursor; i < m_recording.events.size(); ++i)
+    {
+        osp::ExecRecording::Event_t const &event = m_recording.events[i];
+
+        if (std::holds_alternative<osp::ExecRecording::FrameEnd>(event))
+        {
+            return false;
+        }
+
+        auto const *pEvent = std::get_if<EVENT_T>(&event);
+        if (pEvent != nullptr && pEvent->pipeline == pipeline)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ReplayExecutor::stop_replay(char const* reason)
+{
+    m_replaying = false;
+
+    double const avgFrameMs = (m_framesReplayed != 0)
+                            ? double(m_replayNs) / double(m_framesReplayed) / 1000000.0
+                            : 0.0;
+
+    OSP_LOG_INFO("Stopped replay ({}) after {} frames and {} tasks, {:.3f}ms per frame on average",
+                 reason, m_framesReplayed, m_tasksReplayed, avgFrameMs);
+}
+
+void ReplayExecutor::run(TestAppTasks& rAppTasks, osp::PipelineId pipeline)
+{
+    if (m_replaying)
+    {
+        if (in_current_frame<osp::ExecRecording::RunRequest>(pipeline))
+        {
+            return; // Replayed on wait()
+        }
+        stop_replay("unrecorded run request");
+    }
+
+    osp::exec_request_run(m_execContext, pipeline);
+}
+
+void ReplayExecutor::signal(TestAppTasks& rAppTasks, osp::PipelineId pipeline)
+{
+    if (m_replaying)
+    {
+        if (in_current_frame<osp::ExecRecording::Signal>(pipeline))
+        {
+            return; // Replayed on wait()
+        }
+        stop_replay("unrecorded signal");
+    }
+
+    osp::exec_signal(m_execContext, pipeline);
+}
+
+void ReplayExecutor::wait(TestAppTasks& rAppTasks)
+{
+    std::lock_guard<std::mutex> const lock(m_statsMutex);
+
+    LGRN_ASSERTM(osp::top_args_resolved_from(m_args, rAppTasks.m_topData),
+                 "TopData was resized or reallocated without reloading the executor");
+
+    if (m_replaying)
+    {
+        int64_t const start = m_stats.now();
+
+        osp::TopReplayStatus const status = osp::top_replay_frame(
+                rAppTasks.m_tasks, rAppTasks.m_graph, rAppTasks.m_taskData, m_args, m_execContext, m_recording, m_cursor);
+
+        m_replayNs += m_stats.now() - start;
+        ++ m_framesReplayed;
+        m_tasksReplayed += status.tasksRun;
+
+        if (status.diverged)
+        {
+            stop_replay("diverged from recording");
+        }
+        else if (m_cursor == m_recording.events.size())
+        {
+            stop_replay("end of recording");
+        }
+    }
+    else
+    {
+        osp::exec_update(rAppTasks.m_tasks, rAppTasks.m_graph, m_execContext);
+        osp::top_run_blocking(rAppTasks.m_tasks, rAppTasks.m_graph, rAppTasks.m_taskData, m_args, m_execContext);
+    }
+
+    m_stallReporter.frame_end(rAppTasks, m_execContext);
+}
+
+bool ReplayExecutor::is_running(TestAppTasks const& appTasks)
+{
+    return m_execContext.hasRequestRun || (m_execContext.pipelinesRunning != 0);
+}
+
+void ReplayExecutor::write_stats(std::ostream& rStream, TestAppTasks const& appTasks)
+{
+    std::lock_guard<std::mutex> const lock(m_statsMutex);
+    rStream << osp::TopExecWriteStats{appTasks.m_tasks, appTasks.m_taskData, m_stats};
+}
+
+//-----------------------------------------------------------------------------
+
+MultiThreadedExecutor::MultiThreadedExecutor(std::size_t const threadCount)
+ : m_parallel{threadCount}
+{ }
+
+void MultiThreadedExecutor::load(TestAppTasks& rAppTasks)
+{
+    m_parallel.load(rAppTasks.m_tasks, rAppTasks.m_graph, rAppTasks.m_taskData, rAppTasks.m_topData);
+
+    auto const lock = m_parallel.lock();
+    m_parallel.m_execContext.doLogging = m_log != nullptr;
+}
+
+void MultiThreadedExecutor::run(TestAppTasks& rAppTasks, osp::PipelineId pipeline)
+{
+    m_parallel.request_run(pipeline);
+}
+
+void MultiThreadedExecutor::signal(TestAppTasks& rAppTasks, osp::PipelineId pipeline)
+{
+    m_parallel.signal(pipeline);
+}
+
+void MultiThreadedExecutor::wait(TestAppTasks& rAppTasks)
+{
+    LGRN_ASSERTM(osp::top_args_resolved_from(m_parallel.args(), rAppTasks.m_topData),
+                 "TopData was resized or reallocated without reloading the executor");
+
+    osp::ExecContext &rExec = m_parallel.m_execContext;
+
+    {
+        auto const lock = m_parallel.lock();
+
+        m_traceRecorder.frame_begin(rExec, m_parallel.pool().worker_count());
+
+        if (m_log != nullptr)
+        {
+            m_log->info("\n>>>>>>>>>> Previous State Changes\n{}\n>>>>>>>>>> Current State\n{}\n",
+                        osp::TopExecWriteLog  {rAppTasks.m_tasks, rAppTasks.m_taskData, rAppTasks.m_graph, rExec},
+                        osp::TopExecWriteState{rAppTasks.m_tasks, rAppTasks.m_taskData, rAppTasks.m_graph, rExec} );
+            osp::exec_log_mark_read(rExec);
+        }
+    }
+
+    m_parallel.run_frame();
+
+    auto const lock = m_parallel.lock();
+
+    m_stallReporter.frame_end(rAppTasks, rExec);
+
+    if (m_log != nullptr)
+    {
+        m_log->info("\n>>>>>>>>>> New State Changes\n{}",
+                    osp::TopExecWriteLog{rAppTasks.m_tasks, rAppTasks.m_taskData, rAppTasks.m_graph, rExec} );
+        osp::exec_log_mark_read(rExec);
+    }
+
+    m_traceRecorder.frame_end(rAppTasks, rExec);
+    m_recorder.frame_end(rExec);
+}
+
+bool MultiThreadedExecutor::is_running(TestAppTasks const& appTasks)
+{
+    return m_parallel.is_running();
+}
+
+void MultiThreadedExecutor::write_stats(std::ostream& rStream, TestAppTasks const& appTasks)
+{
+    auto const lock = m_parallel.lock();
+    rStream << osp::TopExecWriteStats{appTasks.m_tasks, appTasks.m_taskData, m_parallel.m_stats};
+}
+
 
 } // namespace testapp
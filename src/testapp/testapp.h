@@ -24,16 +24,21 @@
  */
 #pragma once
 
+#include <osp/core/bitvector.h>
 #include <osp/core/keyed_vector.h>
 #include <osp/core/resourcetypes.h>
 #include <osp/tasks/tasks.h>
 #include <osp/tasks/top_execute.h>
+#include <osp/tasks/top_parallel.h>
 #include <osp/tasks/top_session.h>
 #include <osp/util/logging.h>
 
 #include <entt/core/any.hpp>
 
+#include <mutex>
 #include <optional>
+#include <ostream>
+#include <string>
 
 namespace testapp
 {
@@ -58,6 +63,14 @@ struct TestApp : TestAppTasks
 
     void close_session(osp::Session &rSession);
 
+    /**
+     * @brief Add tasks and pipelines created since the last call to m_graph, and remove ones
+     *        that were removed, then reload the executor
+     *
+     * This doesn't rebuild the whole TaskGraph, so opening or closing a few sessions is cheap.
+     */
+    void update_graph();
+
     /**
      * @brief Deal with resource reference counts for a clean termination
      */
@@ -74,11 +87,74 @@ struct TestApp : TestAppTasks
 
     RendererSetupFunc_t             m_rendererSetup { nullptr };
 
+    /// Tasks and pipelines currently in m_graph, see update_graph
+    osp::BitVector_t                m_graphTasks;
+    osp::BitVector_t                m_graphPipelines;
+
     IExecutor                       *m_pExecutor { nullptr };
 
     osp::PkgId                      m_defaultPkg    { lgrn::id_null<osp::PkgId>() };
 };
 
+/**
+ * @brief Records an ExecTrace over a number of frames, then writes it to a Chrome trace JSON file
+ *
+ * A frame is one call to IExecutor::wait.
+ */
+struct ExecTraceRecorder
+{
+    /**
+     * @brief Start recording on the next frame
+     */
+    void request(std::string path, int frames);
+
+    /**
+     * @param laneCount [in] Number of workers that record task spans
+     */
+    void frame_begin(osp::ExecContext &rExec, std::size_t laneCount);
+
+    void frame_end(TestAppTasks const& appTasks, osp::ExecContext &rExec);
+
+    osp::ExecTrace                  m_trace;
+    std::string                     m_path;
+    int                             m_framesRequested   { 0 };
+    int                             m_framesLeft        { 0 };
+};
+
+/**
+ * @brief Records run requests, signals, and task completions over a number of frames, then
+ *        writes them to a file that ReplayExecutor can read
+ *
+ * Recording starts right away rather than on the next frame, since a replay has to start from
+ * the same state the recording did.
+ */
+struct ExecRecordingRecorder
+{
+    void request(osp::ExecContext &rExec, std::string path, int frames);
+
+    void frame_end(osp::ExecContext &rExec);
+
+    osp::ExecRecording              m_recording;
+    std::string                     m_path;
+    int                             m_framesLeft        { 0 };
+};
+
+/**
+ * @brief Logs a single line explaining which pipelines are stuck, once for each new stall
+ */
+struct ExecStallReporter
+{
+    /**
+     * @brief Check for a stall after a frame, exec must not be modified by other threads meanwhile
+     */
+    void frame_end(TestAppTasks const& appTasks, osp::ExecContext const& exec);
+
+    osp::ExecStallScratch           m_scratch;
+
+    /// Set once a stall is logged, so it's only logged once
+    bool                            m_reported          { false };
+};
+
 class IExecutor
 {
 public:
@@ -92,6 +168,11 @@ public:
     virtual void wait(TestAppTasks& rAppTasks) = 0;
 
     virtual bool is_running(TestAppTasks const& rAppTasks) = 0;
+
+    /**
+     * @brief Write timing statistics of each task and pipeline, safe to call from any thread
+     */
+    virtual void write_stats(std::ostream& rStream, TestAppTasks const& appTasks) = 0;
 };
 
 //-----------------------------------------------------------------------------
@@ -109,8 +190,117 @@ public:
 
     bool is_running(TestAppTasks const& rAppTasks) override;
 
+    void write_stats(std::ostream& rStream, TestAppTasks const& appTasks) override;
+
+    osp::ExecContext                m_execContext;
+    std::shared_ptr<spdlog::logger> m_log;
+    ExecTraceRecorder               m_traceRecorder;
+    ExecRecordingRecorder           m_recorder;
+    ExecStallReporter               m_stallReporter;
+    osp::ExecStats                  m_stats;
+
+private:
+
+    /// Locked while running a frame, so stats aren't read while they're being written
+    std::mutex                      m_statsMutex;
+
+    /// Resolved on load, as that's done after sessions create their TopData
+    osp::TopTaskArgs                m_args;
+};
+
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Runs tasks on the calling thread in the exact order of an ExecRecording
+ *
+ * Each wait() replays one recorded frame with top_replay_frame. Calls to run() and signal()
+ * that are already part of the recorded frame are ignored, as the recording replays them.
+ *
+ * Once the app does something the recording didn't (a different run request or signal, or a
+ * task returning different TaskActions), the replay stops and this continues as a
+ * SingleThreadedExecutor would, so the app can still exit cleanly.
+ */
+class ReplayExecutor final : public IExecutor
+{
+public:
+
+    /**
+     * @brief Read a recording written by ExecRecordingRecorder
+     *
+     * @return false if the file could not be read
+     */
+    bool open(std::string const& path);
+
+    void load(TestAppTasks& rAppTasks) override;
+
+    void run(TestAppTasks& rAppTasks, osp::PipelineId pipeline) override;
+
+    void signal(TestAppTasks& rAppTasks, osp::PipelineId pipeline) override;
+
+    void wait(TestAppTasks& rAppTasks) override;
+
+    bool is_running(TestAppTasks const& rAppTasks) override;
+
+    void write_stats(std::ostream& rStream, TestAppTasks const& appTasks) override;
+
     osp::ExecContext                m_execContext;
+    osp::ExecStats                  m_stats;
+    ExecStallReporter               m_stallReporter;
+
+private:
+
+    /**
+     * @brief Check if a run request or signal is part of the frame about to be replayed
+     */
+    template <typename EVENT_T>
+    bool in_current_frame(osp::PipelineId pipeline) const;
+
+    void stop_replay(char const* reason);
+
+    /// Locked while running a frame, so stats aren't read while they're being written
+    std::mutex                      m_statsMutex;
+
+    osp::TopTaskArgs                m_args;
+
+    osp::ExecRecording              m_recording;
+    std::size_t                     m_cursor            { 0 };
+    bool                            m_replaying         { false };
+
+    int64_t                         m_replayNs          { 0 };
+    std::size_t                     m_framesReplayed    { 0 };
+    std::size_t                     m_tasksReplayed     { 0 };
+};
+
+//-----------------------------------------------------------------------------
+
+/**
+ * @brief Runs tasks in parallel with an osp::TopParallelExecutor
+ *
+ * Adds logging, tracing, recording, and stall reports on top. See TopParallelExecutor for how
+ * tasks are scheduled.
+ */
+class MultiThreadedExecutor final : public IExecutor
+{
+public:
+    explicit MultiThreadedExecutor(std::size_t threadCount);
+
+    void load(TestAppTasks& rAppTasks) override;
+
+    void run(TestAppTasks& rAppTasks, osp::PipelineId pipeline) override;
+
+    void signal(TestAppTasks& rAppTasks, osp::PipelineId pipeline) override;
+
+    void wait(TestAppTasks& rAppTasks) override;
+
+    bool is_running(TestAppTasks const& rAppTasks) override;
+
+    void write_stats(std::ostream& rStream, TestAppTasks const& appTasks) override;
+
+    osp::TopParallelExecutor        m_parallel;
     std::shared_ptr<spdlog::logger> m_log;
+    ExecTraceRecorder               m_traceRecorder;
+    ExecRecordingRecorder           m_recorder;
+    ExecStallReporter               m_stallReporter;
 };
 
 } // namespace testapp
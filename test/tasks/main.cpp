@@ -25,13 +25,25 @@
 #include <osp/tasks/tasks.h>
 #include <osp/tasks/builder.h>
 #include <osp/tasks/execute.h>
+#include <osp/tasks/parallel_for.h>
+#include <osp/tasks/top_coroutine.h>
+#include <osp/tasks/top_execute.h>
+#include <osp/tasks/top_parallel.h>
+#include <osp/tasks/top_utils.h>
+#include <osp/tasks/worker_pool.h>
+
+#include <testapp/identifiers.h>
 
 #include <gtest/gtest.h>
 
+#include <array>
+#include <atomic>
 #include <functional>
 #include <numeric>
 #include <random>
 #include <set>
+#include <sstream>
+#include <thread>
 
 using namespace osp;
 
@@ -730,5 +742,1620 @@ TEST(Tasks, BasicSingleThreadedGameWorld)
 }
 
 
-// TODO: Multi-threaded test with limits. Actual multithreading isn't needed;
-//       as long as task_start/finish are called at the right times
+//-----------------------------------------------------------------------------
+
+namespace test_mt
+{
+
+struct World
+{
+    // Mutable, as adder tasks only take a const reference so they can run in parallel
+    mutable std::atomic<int>    sum         { 0 };
+    mutable std::atomic<int>    running     { 0 };
+    int                         checksRun   { 0 };
+};
+
+/**
+ * @brief Counts how many tasks are accessing it at once
+ */
+struct Guard
+{
+    mutable std::atomic<int>    readers     { 0 };
+    mutable std::atomic<int>    writers     { 0 };
+    mutable std::atomic<int>    overlaps    { 0 };
+};
+
+/**
+ * @brief Which threads tasks are expected to run on
+ */
+struct Threads
+{
+    std::thread::id                 main;
+    std::array<std::thread::id, 2>  lanes;
+    mutable std::atomic<int>        wrongThread { 0 };
+};
+
+enum class Stages { Fill, Use, Clear };
+
+struct Pipelines
+{
+    osp::PipelineDef<Stages> sum;
+};
+
+} // namespace test_mt
+
+// Multi-threaded test with many independent tasks in the same stage
+TEST(Tasks, BasicMultiThreadedParallelTasks)
+{
+    using namespace test_mt;
+    using enum Stages;
+
+    constexpr int           sc_repetitions      = 64;
+    static constexpr int    sc_adderTaskCount   = 48;
+    constexpr int           sc_threadCount      = 4;
+
+    Tasks               tasks;
+    TaskEdges           edges;
+    TopTaskDataVec_t    taskData;
+    TopTaskBuilder      builder{tasks, edges, taskData};
+
+    auto const pl = builder.create_pipelines<Pipelines>();
+
+    std::vector<entt::any> topData;
+    topData.emplace_back(std::in_place_type<World>);
+
+    for (int i = 0; i < sc_adderTaskCount; ++i)
+    {
+        builder.task().run_on(pl.sum(Fill)).args({0}).func([] (World const& world) noexcept
+        {
+            ++ world.running;
+            world.sum += 1;
+            -- world.running;
+        });
+    }
+
+    builder.task().run_on(pl.sum(Use)).args({0}).func([] (World& rWorld) noexcept
+    {
+        // Fill tasks must all be done before Use
+        EXPECT_EQ(rWorld.sum.load(), int(sc_adderTaskCount));
+        EXPECT_EQ(rWorld.running.load(), 0);
+        ++ rWorld.checksRun;
+    });
+
+    builder.task().run_on(pl.sum(Clear)).args({0}).func([] (World& rWorld) noexcept
+    {
+        rWorld.sum = 0;
+    });
+
+    TaskGraph const graph = make_exec_graph(tasks, {&edges}, taskData);
+
+    TopParallelExecutor executor{sc_threadCount};
+    executor.load(tasks, graph, taskData, topData);
+    executor.m_execContext.doLogging = false;
+
+    for (int i = 0; i < sc_repetitions; ++i)
+    {
+        executor.request_run(pl.sum);
+        executor.run_frame();
+
+        ASSERT_FALSE(executor.is_running());
+        ASSERT_EQ(executor.m_execContext.tasksQueuedRun.size(), 0);
+    }
+
+    ASSERT_EQ(entt::any_cast<World&>(topData[0]).checksRun, sc_repetitions);
+}
+
+// Test that TopParallelExecutor never runs a task that writes to TopData alongside another task
+// that accesses the same TopData
+TEST(Tasks, TopParallelExecutorConflicts)
+{
+    using namespace test_mt;
+    using enum Stages;
+
+    constexpr int sc_repetitions    = 64;
+    constexpr int sc_taskCount      = 32;
+
+    Tasks               tasks;
+    TaskEdges           edges;
+    TopTaskDataVec_t    taskData;
+    TopTaskBuilder      builder{tasks, edges, taskData};
+
+    auto const pl = builder.create_pipelines<Pipelines>();
+
+    std::vector<entt::any> topData;
+    topData.emplace_back(std::in_place_type<Guard>);
+
+    // Every third task writes, the rest only read
+    for (int i = 0; i < sc_taskCount; ++i)
+    {
+        if (i % 3 == 0)
+        {
+            builder.task().run_on(pl.sum(Fill)).args({0}).func([] (Guard& rGuard) noexcept
+            {
+                if (rGuard.writers.fetch_add(1) != 0 || rGuard.readers.load() != 0)
+                {
+                    rGuard.overlaps.fetch_add(1);
+                }
+                std::this_thread::yield();
+                rGuard.writers.fetch_sub(1);
+            });
+        }
+        else
+        {
+            builder.task().run_on(pl.sum(Fill)).args({0}).func([] (Guard const& guard) noexcept
+            {
+                guard.readers.fetch_add(1);
+                if (guard.writers.load() != 0)
+                {
+                    guard.overlaps.fetch_add(1);
+                }
+                std::this_thread::yield();
+                guard.readers.fetch_sub(1);
+            });
+        }
+    }
+
+    TaskGraph const graph = make_exec_graph(tasks, {&edges}, taskData);
+
+    TopParallelExecutor executor{4};
+    executor.load(tasks, graph, taskData, topData);
+    executor.m_execContext.doLogging = false;
+
+    for (int i = 0; i < sc_repetitions; ++i)
+    {
+        executor.request_run(pl.sum);
+        executor.run_frame();
+        ASSERT_FALSE(executor.is_running());
+    }
+
+    EXPECT_EQ(entt::any_cast<Guard&>(topData[0]).overlaps.load(), 0);
+    EXPECT_EQ(executor.m_stats.tasks[TaskId(0)].count, sc_repetitions);
+}
+
+// Test that TopParallelExecutor runs Main tasks on the thread calling run_frame, and each Lane's
+// tasks on the same pool thread every time
+TEST(Tasks, TopParallelExecutorAffinity)
+{
+    using namespace test_mt;
+    using enum Stages;
+
+    constexpr int sc_repetitions    = 32;
+    constexpr int sc_tasksEach      = 8;
+
+    Tasks               tasks;
+    TaskEdges           edges;
+    TopTaskDataVec_t    taskData;
+    TopTaskBuilder      builder{tasks, edges, taskData};
+
+    auto const pl = builder.create_pipelines<Pipelines>();
+
+    std::vector<entt::any> topData;
+    topData.emplace_back(std::in_place_type<Threads>);
+
+    // Tasks only read Threads, so none of them conflict and they could otherwise run anywhere
+    for (int i = 0; i < sc_tasksEach; ++i)
+    {
+        builder.task().run_on(pl.sum(Use)).args({0}).affinity(ETopAffinity::Main).func([] (Threads const& threads) noexcept
+        {
+            if (std::this_thread::get_id() != threads.main)
+            {
+                threads.wrongThread.fetch_add(1);
+            }
+        });
+        builder.task().run_on(pl.sum(Use)).args({0}).affinity(ETopAffinity::Lane, 0).func([] (Threads const& threads) noexcept
+        {
+            if (std::this_thread::get_id() != threads.lanes[0])
+            {
+                threads.wrongThread.fetch_add(1);
+            }
+        });
+        builder.task().run_on(pl.sum(Use)).args({0}).affinity(ETopAffinity::Lane, 1).func([] (Threads const& threads) noexcept
+        {
+            if (std::this_thread::get_id() != threads.lanes[1])
+            {
+                threads.wrongThread.fetch_add(1);
+            }
+        });
+    }
+
+    // Record which thread each lane ends up on, before the rest of the tasks run
+    builder.task().run_on(pl.sum(Fill)).args({0}).affinity(ETopAffinity::Lane, 0).func([] (Threads& rThreads) noexcept
+    {
+        rThreads.lanes[0] = std::this_thread::get_id();
+    });
+    builder.task().run_on(pl.sum(Fill)).args({0}).affinity(ETopAffinity::Lane, 1).func([] (Threads& rThreads) noexcept
+    {
+        rThreads.lanes[1] = std::this_thread::get_id();
+    });
+
+    TaskGraph const graph = make_exec_graph(tasks, {&edges}, taskData);
+
+    TopParallelExecutor executor{3};
+    executor.load(tasks, graph, taskData, topData);
+    executor.m_execContext.doLogging = false;
+
+    auto &rThreads = entt::any_cast<Threads&>(topData[0]);
+    rThreads.main = std::this_thread::get_id();
+
+    std::set<std::thread::id> laneThreads;
+    for (int i = 0; i < sc_repetitions; ++i)
+    {
+        executor.request_run(pl.sum);
+        executor.run_frame();
+        ASSERT_FALSE(executor.is_running());
+
+        laneThreads.insert(rThreads.lanes[0]);
+        laneThreads.insert(rThreads.lanes[1]);
+    }
+
+    EXPECT_EQ(rThreads.wrongThread.load(), 0);
+
+    // Each lane stays on one pool thread, never the main one
+    EXPECT_EQ(laneThreads.size(), 2);
+    EXPECT_FALSE(laneThreads.contains(rThreads.main));
+}
+
+
+//-----------------------------------------------------------------------------
+
+namespace test_conflicts
+{
+
+enum class Stages { Run };
+
+struct Pipelines
+{
+    osp::PipelineDef<Stages> pl;
+};
+
+} // namespace test_conflicts
+
+// Test that TopTasks accessing the same data conflict only if one of them writes to it
+TEST(Tasks, TopTaskDataConflicts)
+{
+    using namespace test_conflicts;
+    using enum Stages;
+
+    Tasks               tasks;
+    TaskEdges           edges;
+    TopTaskDataVec_t    taskData;
+    TopTaskBuilder      builder{tasks, edges, taskData};
+
+    auto const pl = builder.create_pipelines<Pipelines>();
+
+    TopDataId const idA = 0;
+    TopDataId const idB = 1;
+
+    TaskId const readA0 = builder.task().run_on(pl.pl(Run)).args({idA})
+        .func([] (int const& a) noexcept { }).m_taskId;
+    TaskId const readA1 = builder.task().run_on(pl.pl(Run)).args({idA})
+        .func([] (int const& a) noexcept { }).m_taskId;
+    TaskId const writeA = builder.task().run_on(pl.pl(Run)).args({idA})
+        .func([] (int& a) noexcept { }).m_taskId;
+    TaskId const copyAWriteB = builder.task().run_on(pl.pl(Run)).args({idA, idB})
+        .func([] (int a, int& b, WorkerContext ctx) noexcept { }).m_taskId;
+    TaskId const rawB = builder.task().run_on(pl.pl(Run)).args({idB})
+        .func_raw([] (WorkerContext, ArrayView<void* const>) noexcept -> TaskActions { return {}; }).m_taskId;
+
+    TaskGraph const graph = make_exec_graph(tasks, {&edges}, taskData);
+
+    auto const conflicts_of = [&graph] (TaskId const task)
+    {
+        auto const view = fanout_view(graph.taskToFirstConflict, graph.conflictToTask, task);
+        return std::set<TaskId>(view.begin(), view.end());
+    };
+
+    EXPECT_EQ(conflicts_of(readA0),       (std::set<TaskId>{writeA}));
+    EXPECT_EQ(conflicts_of(readA1),       (std::set<TaskId>{writeA}));
+    EXPECT_EQ(conflicts_of(writeA),       (std::set<TaskId>{readA0, readA1, copyAWriteB}));
+    EXPECT_EQ(conflicts_of(copyAWriteB),  (std::set<TaskId>{writeA, rawB}));
+    EXPECT_EQ(conflicts_of(rawB),         (std::set<TaskId>{copyAWriteB}));
+}
+
+
+//-----------------------------------------------------------------------------
+
+namespace test_semaphore
+{
+
+enum class Stages { Run, Done };
+
+struct Pipelines
+{
+    osp::PipelineDef<Stages> pl;
+};
+
+} // namespace test_semaphore
+
+// Test with semaphore limits. Actual multithreading isn't needed; tasks are started and finished
+// in random order, as if they were running in parallel.
+TEST(Tasks, BasicSemaphoreLimits)
+{
+    using namespace test_semaphore;
+    using enum Stages;
+
+    using BasicTraits_t     = BasicBuilderTraits<TaskActions(*)()>;
+    using Builder_t         = BasicTraits_t::Builder;
+    using TaskFuncVec_t     = BasicTraits_t::FuncVec_t;
+
+    constexpr int           sc_repetitions  = 32;
+    constexpr int           sc_taskCount    = 16;
+    constexpr unsigned int  sc_limitA       = 3;
+    constexpr unsigned int  sc_limitB       = 1;
+    std::mt19937 randGen(69);
+
+    Tasks           tasks;
+    TaskEdges       edges;
+    TaskFuncVec_t   functions;
+    Builder_t       builder{tasks, edges, functions};
+
+    auto const pl = builder.create_pipelines<Pipelines>();
+
+    SemaphoreId const semaA = builder.create_semaphore(sc_limitA);
+    SemaphoreId const semaB = builder.create_semaphore(sc_limitB);
+
+    std::vector<TaskId> acquireA;
+    std::vector<TaskId> acquireB;
+
+    for (int i = 0; i < sc_taskCount; ++i)
+    {
+        // Every task acquires A, and every 4th task acquires B too
+        if (i % 4 == 0)
+        {
+            acquireB.push_back(builder.task().run_on(pl.pl(Run)).acquires({semaA, semaB}));
+        }
+        acquireA.push_back(builder.task().run_on(pl.pl(Run)).acquires({semaA}));
+    }
+
+    TaskGraph const graph = make_exec_graph(tasks, {&edges});
+
+    ExecContext exec;
+    exec_conform(tasks, exec);
+
+    for (int i = 0; i < sc_repetitions; ++i)
+    {
+        exec_request_run(exec, pl.pl);
+        exec_update(tasks, graph, exec);
+
+        std::vector<TaskId> started;
+        int                 completed = 0;
+
+        while (true)
+        {
+            std::vector<TaskId> notStarted;
+            for (TaskId const task : exec.tasksQueuedRun)
+            {
+                if ( ! contains(started, task) )
+                {
+                    notStarted.push_back(task);
+                }
+            }
+
+            if (notStarted.empty() && started.empty())
+            {
+                break;
+            }
+
+            // Randomly start or finish a task
+            if ( ! notStarted.empty() && (started.empty() || randGen() % 2 == 0) )
+            {
+                started.push_back(notStarted[randGen() % notStarted.size()]);
+            }
+            else
+            {
+                auto const it = started.begin() + std::ptrdiff_t(randGen() % started.size());
+                TaskId const task = *it;
+                started.erase(it);
+                complete_task(tasks, graph, exec, task, {});
+                exec_update(tasks, graph, exec);
+                ++ completed;
+            }
+
+            auto const count_running = [&started] (std::vector<TaskId> const& acquiring)
+            {
+                return std::count_if(started.begin(), started.end(), [&acquiring] (TaskId task)
+                {
+                    return contains(acquiring, task);
+                });
+            };
+
+            ASSERT_LE(count_running(acquireA) + count_running(acquireB), sc_limitA);
+            ASSERT_LE(count_running(acquireB), sc_limitB);
+            ASSERT_LE(exec.tasksQueuedRun.size(), sc_limitA);
+        }
+
+        ASSERT_EQ(completed, int(acquireA.size() + acquireB.size()));
+        ASSERT_EQ(exec.pipelinesRunning, 0);
+        ASSERT_EQ(exec.tasksQueuedSema.size(), 0);
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+namespace test_trace
+{
+
+enum class Stages { Fill, Use };
+
+struct Pipelines
+{
+    osp::PipelineDef<Stages> pl {"pl"};
+};
+
+} // namespace test_trace
+
+// Test that running TopTasks with an ExecTrace records task spans and writes Chrome trace JSON
+TEST(Tasks, TopTaskTrace)
+{
+    using namespace test_trace;
+    using enum Stages;
+
+    Tasks               tasks;
+    TaskEdges           edges;
+    TopTaskDataVec_t    taskData;
+    TopTaskBuilder      builder{tasks, edges, taskData};
+
+    auto const pl = builder.create_pipelines<Pipelines>();
+
+    std::vector<entt::any> topData;
+    topData.emplace_back(std::in_place_type<int>, 0);
+
+    builder.task().name("Fill \"quoted\"").run_on(pl.pl(Fill)).args({0}).func([] (int& rValue) noexcept { rValue = 42; });
+    builder.task().name("Use").run_on(pl.pl(Use)).args({0}).func([] (int const& value) noexcept { EXPECT_EQ(value, 42); });
+
+    TaskGraph const graph = make_exec_graph(tasks, {&edges}, taskData);
+
+    ExecTrace   trace;
+    ExecContext exec;
+    exec_conform(tasks, exec);
+    exec.doLogging = false;
+    exec.pTrace = &trace;
+    trace.lanes.resize(1);
+
+    exec_request_run(exec, pl.pl);
+    exec_update(tasks, graph, exec);
+    top_run_blocking(tasks, graph, taskData, topData, exec);
+
+    ASSERT_EQ(trace.lanes[0].size(), 2);
+    EXPECT_LE(trace.lanes[0][0].endNs, trace.lanes[0][1].startNs);
+
+    // Fill, Use, then finish
+    ASSERT_EQ(trace.stageMarks.size(), 3);
+    EXPECT_EQ(trace.stageMarks[2].stage, lgrn::id_null<StageId>());
+
+    std::ostringstream stream;
+    stream << TopExecWriteTrace{tasks, taskData, trace};
+    std::string const json = stream.str();
+
+    EXPECT_TRUE(json.starts_with(R"({"displayTimeUnit":"ms","traceEvents":[)"));
+    EXPECT_NE(json.find(R"("name":"Fill \"quoted\"")"), std::string::npos);
+    EXPECT_NE(json.find(R"("name":"Use")"), std::string::npos);
+    EXPECT_TRUE(json.ends_with("]}\n"));
+}
+
+// Test that the ExecContext log ring buffer overwrites its oldest records once full
+TEST(Tasks, ExecLogRingBuffer)
+{
+    using namespace test_trace;
+    using enum Stages;
+
+    Tasks               tasks;
+    TaskEdges           edges;
+    TopTaskDataVec_t    taskData;
+    TopTaskBuilder      builder{tasks, edges, taskData};
+
+    auto const pl = builder.create_pipelines<Pipelines>();
+
+    builder.task().name("Fill").run_on(pl.pl(Fill)).func([] () noexcept { });
+    builder.task().name("Use") .run_on(pl.pl(Use)) .func([] () noexcept { });
+
+    TaskGraph const graph = make_exec_graph(tasks, {&edges}, taskData);
+
+    std::vector<entt::any> topData;
+
+    ExecContext exec;
+    exec.logCapacity = 6; // rounded up to 8
+    exec_conform(tasks, exec);
+    ASSERT_EQ(exec.logRing.size(), 8);
+
+    exec_request_run(exec, pl.pl);
+    exec_update(tasks, graph, exec);
+    top_run_blocking(tasks, graph, taskData, topData, exec);
+
+    ASSERT_GT(exec.logWritten, 8);
+    EXPECT_EQ(exec_log_first_available(exec), exec.logWritten - 8);
+    EXPECT_EQ(exec_log_first_unread(exec),    exec.logWritten - 8);
+
+    // Last update after the final CompleteTask
+    EXPECT_TRUE(std::holds_alternative<ExecLog::UpdateEnd>(exec_log_decode(exec, exec.logWritten - 1)));
+
+    std::ostringstream unread;
+    unread << TopExecWriteLog{tasks, taskData, graph, exec};
+    EXPECT_TRUE(unread.str().starts_with("... "));
+
+    exec_log_mark_read(exec);
+
+    std::ostringstream empty;
+    empty << TopExecWriteLog{tasks, taskData, graph, exec};
+    EXPECT_TRUE(empty.str().empty());
+
+    std::ostringstream history;
+    history << TopExecWriteLog{tasks, taskData, graph, exec, true};
+    EXPECT_NE(history.str().find("Complete TASK1 - Use"), std::string::npos);
+}
+
+//-----------------------------------------------------------------------------
+
+namespace test_incremental
+{
+
+enum class Stages { Schedule, Process, Done, Clear };
+
+struct PipelinesA
+{
+    osp::PipelineDef<Stages> main;
+    osp::PipelineDef<Stages> loop;
+    osp::PipelineDef<Stages> step;
+};
+
+struct PipelinesB
+{
+    osp::PipelineDef<Stages> child;
+    osp::PipelineDef<Stages> other;
+};
+
+using GraphFacts_t = std::set< std::array<uint32_t, 6> >;
+
+/**
+ * @brief Describe everything in a TaskGraph in a way that doesn't depend on the order of values
+ */
+GraphFacts_t graph_facts(Tasks const& tasks, TaskGraph const& graph)
+{
+    GraphFacts_t out;
+
+    auto const stage_of = [&graph] (AnyStageId const anystg) -> std::array<uint32_t, 2>
+    {
+        return {uint32_t(graph.anystgToPipeline[anystg]), uint32_t(stage_from(graph, anystg))};
+    };
+
+    for (PipelineInt const plInt : tasks.m_pipelineIds.bitview().zeros())
+    {
+        auto const pipeline = PipelineId(plInt);
+        out.insert({0, plInt, fanout_size(graph.pipelineToFirstAnystg, pipeline),
+                    uint32_t(graph.pipelineToPltree[pipeline]), uint32_t(graph.pipelineToLoopScope[pipeline])});
+
+        for (uint32_t stg = 0; stg < fanout_size(graph.pipelineToFirstAnystg, pipeline); ++stg)
+        {
+            AnyStageId const anystg = anystg_from(graph, pipeline, StageId(stg));
+            for (TaskId const task : fanout_view(graph.anystgToFirstRuntask, graph.runtaskToTask, anystg))
+            {
+                out.insert({1, plInt, stg, uint32_t(task)});
+            }
+            for (StageRequiresTask const& req : fanout_view(graph.anystgToFirstStgreqtask, graph.stgreqtaskData, anystg))
+            {
+                EXPECT_EQ(req.ownStage, anystg);
+                out.insert({2, plInt, stg, uint32_t(req.reqTask), uint32_t(req.reqPipeline), uint32_t(req.reqStage)});
+            }
+            for (TaskId const task : fanout_view(graph.anystgToFirstRevTaskreqstg, graph.revTaskreqstgToTask, anystg))
+            {
+                out.insert({3, plInt, stg, uint32_t(task)});
+            }
+        }
+    }
+
+    for (TaskInt const taskInt : tasks.m_taskIds.bitview().zeros())
+    {
+        auto const task = TaskId(taskInt);
+        for (AnyStageId const anystg : fanout_view(graph.taskToFirstRevStgreqtask, graph.revStgreqtaskToStage, task))
+        {
+            auto const [pl, stg] = stage_of(anystg);
+            out.insert({4, taskInt, pl, stg});
+        }
+        for (TaskRequiresStage const& req : fanout_view(graph.taskToFirstTaskreqstg, graph.taskreqstgData, task))
+        {
+            EXPECT_EQ(req.ownTask, task);
+            out.insert({5, taskInt, uint32_t(req.reqPipeline), uint32_t(req.reqStage)});
+        }
+        for (SemaphoreId const sema : fanout_view(graph.taskToFirstSemaacq, graph.semaacqToSema, task))
+        {
+            out.insert({6, taskInt, uint32_t(sema)});
+        }
+    }
+
+    for (SemaphoreInt const semaInt : tasks.m_semaIds.bitview().zeros())
+    {
+        for (TaskId const task : fanout_view(graph.semaToFirstRevSemaacq, graph.revSemaacqToTask, SemaphoreId(semaInt)))
+        {
+            out.insert({7, semaInt, uint32_t(task)});
+        }
+    }
+
+    for (std::size_t pos = 0; pos < graph.pltreeToPipeline.size(); ++pos)
+    {
+        out.insert({8, uint32_t(pos), uint32_t(graph.pltreeToPipeline[pos]), graph.pltreeDescendantCounts[pos]});
+    }
+
+    return out;
+}
+
+} // namespace test_incremental
+
+// Test that adding and removing tasks with update_exec_graph gives the same graph as
+// make_exec_graph
+TEST(Tasks, IncrementalGraphUpdate)
+{
+    using namespace test_incremental;
+    using enum Stages;
+
+    using BasicTraits_t     = BasicBuilderTraits<TaskActions(*)()>;
+    using Builder_t         = BasicTraits_t::Builder;
+    using TaskFuncVec_t     = BasicTraits_t::FuncVec_t;
+
+    Tasks           tasks;
+    TaskEdges       edgesA;
+    TaskEdges       edgesB;
+    TaskFuncVec_t   functions;
+
+    auto const ids_since = [] <typename ID_T> (lgrn::IdRegistryStl<ID_T> const& ids, std::set<ID_T> const& before)
+    {
+        std::vector<ID_T> out;
+        for (auto const idInt : ids.bitview().zeros())
+        {
+            if ( ! before.contains(ID_T(idInt)) )
+            {
+                out.push_back(ID_T(idInt));
+            }
+        }
+        return out;
+    };
+
+    // Session A: a looping pipeline with a child
+    Builder_t builderA{tasks, edgesA, functions};
+    auto const plA = builderA.create_pipelines<PipelinesA>();
+    builderA.pipeline(plA.loop).parent(plA.main).loops(true);
+    builderA.pipeline(plA.step).parent(plA.loop);
+
+    builderA.task().run_on({plA.loop(Schedule)}).sync_with({plA.main(Process), plA.step(Schedule)});
+    builderA.task().run_on({plA.step(Process)}) .sync_with({plA.main(Process), plA.loop(Process)});
+    builderA.task().run_on({plA.main(Clear)});
+
+    std::vector<TaskId>     const tasksA        = ids_since(tasks.m_taskIds,     {});
+    std::vector<PipelineId> const pipelinesA    = ids_since(tasks.m_pipelineIds, {});
+
+    TaskGraph graph;
+    update_exec_graph(graph, tasks, {&edgesA, &edgesB}, {.tasksAdded = tasksA, .pipelinesAdded = pipelinesA});
+    EXPECT_EQ(graph_facts(tasks, graph), graph_facts(tasks, make_exec_graph(tasks, {&edgesA, &edgesB})));
+
+    // Session B: adds a child pipeline to session A, tasks that run on A's pipelines, and a
+    // semaphore
+    auto const add_session_b = [&] ()
+    {
+        std::vector<TaskId>     const tasksNow      = ids_since(tasks.m_taskIds,     {});
+        std::vector<PipelineId> const pipelinesNow  = ids_since(tasks.m_pipelineIds, {});
+        std::set<TaskId>        const tasksBefore     {tasksNow.begin(),     tasksNow.end()};
+        std::set<PipelineId>    const pipelinesBefore {pipelinesNow.begin(), pipelinesNow.end()};
+
+        Builder_t builderB{tasks, edgesB, functions};
+        auto const plB = builderB.create_pipelines<PipelinesB>();
+        builderB.pipeline(plB.child).parent(plA.loop);
+
+        SemaphoreId const sema = builderB.create_semaphore(1);
+
+        builderB.task().run_on({plB.child(Process)}).sync_with({plA.main(Process), plA.loop(Process)}).acquires({sema});
+        builderB.task().run_on({plA.step(Process)}) .sync_with({plB.child(Done)}).acquires({sema});
+        builderB.task().run_on({plB.other(Done)})   .sync_with({plA.main(Clear)});
+
+        return std::pair{ids_since(tasks.m_taskIds, tasksBefore), ids_since(tasks.m_pipelineIds, pipelinesBefore)};
+    };
+
+    auto const [tasksB, pipelinesB] = add_session_b();
+
+    update_exec_graph(graph, tasks, {&edgesA, &edgesB}, {.tasksAdded = tasksB, .pipelinesAdded = pipelinesB});
+    EXPECT_EQ(graph_facts(tasks, graph), graph_facts(tasks, make_exec_graph(tasks, {&edgesA, &edgesB})));
+
+    // Remove session B
+    for (TaskId const task : tasksB)
+    {
+        tasks.m_taskIds.remove(task);
+    }
+    for (PipelineId const pipeline : pipelinesB)
+    {
+        tasks.m_pipelineIds.remove(pipeline);
+        tasks.m_pipelineParents[pipeline] = lgrn::id_null<PipelineId>();
+    }
+    edgesB.m_syncWith.clear();
+    edgesB.m_semaphoreEdges.clear();
+    edgesB.m_fusable.clear();
+
+    update_exec_graph(graph, tasks, {&edgesA, &edgesB}, {.tasksRemoved = tasksB, .pipelinesRemoved = pipelinesB});
+    EXPECT_EQ(graph_facts(tasks, graph), graph_facts(tasks, make_exec_graph(tasks, {&edgesA, &edgesB})));
+
+    // Add session B again, which reuses the IDs it had before
+    auto const [tasksB2, pipelinesB2] = add_session_b();
+    EXPECT_EQ(tasksB2, tasksB);
+
+    update_exec_graph(graph, tasks, {&edgesA, &edgesB}, {.tasksAdded = tasksB2, .pipelinesAdded = pipelinesB2});
+    EXPECT_EQ(graph_facts(tasks, graph), graph_facts(tasks, make_exec_graph(tasks, {&edgesA, &edgesB})));
+}
+
+//-----------------------------------------------------------------------------
+
+namespace test_critical_path
+{
+
+enum class ChainStages { Step0, Step1, Step2 };
+enum class SingleStage { Run };
+
+struct Pipelines
+{
+    osp::PipelineDef<ChainStages> chain {"chain"};
+    osp::PipelineDef<SingleStage> other {"other"};
+    osp::PipelineDef<SingleStage> side  {"side"};
+};
+
+} // namespace test_critical_path
+
+// Test that tasks at the start of the longest chain are picked first
+TEST(Tasks, CriticalPathPriority)
+{
+    using namespace test_critical_path;
+    using enum ChainStages;
+    using enum SingleStage;
+
+    Tasks               tasks;
+    TaskEdges           edges;
+    TopTaskDataVec_t    taskData;
+    TopTaskBuilder      builder{tasks, edges, taskData};
+
+    auto const pl = builder.create_pipelines<Pipelines>();
+
+    auto const add_task = [&] (TplPipelineStage const runOn)
+    {
+        return builder.task().run_on(runOn).func([] () noexcept { }).m_taskId;
+    };
+
+    TaskId const chain0 = add_task(pl.chain(Step0));
+    TaskId const chain1 = add_task(pl.chain(Step1));
+    TaskId const chain2 = add_task(pl.chain(Step2));
+    TaskId const side   = add_task(pl.side(Run));
+
+    // Holds the chain back at Step0
+    TaskId const other  = builder.task().run_on(pl.other(Run)).sync_with({pl.chain(Step0)}).func([] () noexcept { }).m_taskId;
+
+    TaskGraph const graph = make_exec_graph(tasks, {&edges}, taskData);
+
+    KeyedVec<TaskId, int64_t> costs;
+    costs.resize(tasks.m_taskIds.capacity(), 0);
+    costs[chain0] = 10;
+    costs[chain1] = 10;
+    costs[chain2] = 10;
+    costs[other]  = 3;
+    costs[side]   = 5;
+
+    ExecContext exec;
+    exec_conform(tasks, exec);
+    task_critical_paths(tasks, graph, costs, exec.taskPriority);
+
+    EXPECT_EQ(exec.taskPriority[chain0], 30);
+    EXPECT_EQ(exec.taskPriority[chain1], 20);
+    EXPECT_EQ(exec.taskPriority[chain2], 10);
+    EXPECT_EQ(exec.taskPriority[other],  23); // 3 + chain from Step1
+    EXPECT_EQ(exec.taskPriority[side],   5);
+
+    exec_request_run(exec, pl.chain);
+    exec_request_run(exec, pl.other);
+    exec_request_run(exec, pl.side);
+    exec_update(tasks, graph, exec);
+
+    std::vector<TaskId> ran;
+    while ( ! exec.tasksQueuedRun.empty() )
+    {
+        TaskId const task = exec_pick_task(exec);
+        ran.push_back(task);
+        complete_task(tasks, graph, exec, task, {});
+        exec_update(tasks, graph, exec);
+    }
+
+    EXPECT_EQ(ran, (std::vector<TaskId>{chain0, other, chain1, chain2, side}));
+
+    // Tasks taken off with exec_pop_task stay queued, and are only taken again once given back
+    exec_request_run(exec, pl.chain);
+    exec_request_run(exec, pl.other);
+    exec_request_run(exec, pl.side);
+    exec_update(tasks, graph, exec);
+
+    EXPECT_EQ(exec_pop_task(exec), chain0);
+    EXPECT_EQ(exec_pop_task(exec), other);
+    exec_push_task(exec, chain0);
+    EXPECT_EQ(exec_pop_task(exec), chain0);
+    EXPECT_EQ(exec_pop_task(exec), side);
+    EXPECT_EQ(exec_pop_task(exec), lgrn::id_null<TaskId>());
+    EXPECT_EQ(exec.tasksQueuedRun.size(), 3);
+
+    for (TaskId const task : {chain0, other, side})
+    {
+        complete_task(tasks, graph, exec, task, {});
+    }
+
+    // Unmeasured tasks count as 1 each
+    task_critical_paths(tasks, graph, {}, exec.taskPriority);
+    EXPECT_EQ(exec.taskPriority[chain0], 3);
+    EXPECT_EQ(exec.taskPriority[other],  3);
+    EXPECT_EQ(exec.taskPriority[side],   1);
+}
+
+// Test that running TopTasks with ExecStats records samples for each task and pipeline
+TEST(Tasks, ExecStatsSamples)
+{
+    using namespace test_trace;
+    using enum Stages;
+
+    // Summaries of a known set of samples, more than fits in the window
+    TimeSamples samples;
+    for (int64_t i = 1; i <= 1000; ++i)
+    {
+        stats_add_sample(samples, (i <= 500) ? 100000 : i);
+    }
+
+    TimeSummary const summary = stats_summarize(samples);
+    EXPECT_EQ(summary.count, 1000);
+    EXPECT_EQ(summary.maxNs, 100000);                           // All-time, from the first half
+    EXPECT_EQ(summary.p50Ns, 1000 - TimeSamples::sc_window/2);  // Only the most recent window
+    EXPECT_EQ(summary.p99Ns, 998);
+    EXPECT_EQ(stats_summarize(TimeSamples{}).count, 0);
+
+    // Recorded while running
+    Tasks               tasks;
+    TaskEdges           edges;
+    TopTaskDataVec_t    taskData;
+    TopTaskBuilder      builder{tasks, edges, taskData};
+
+    auto const pl = builder.create_pipelines<Pipelines>();
+
+    TaskId const fill = builder.task().name("Fill").run_on(pl.pl(Fill)).func([] () noexcept { }).m_taskId;
+    TaskId const use  = builder.task().name("Use") .run_on(pl.pl(Use)) .func([] () noexcept { }).m_taskId;
+
+    TaskGraph const graph = make_exec_graph(tasks, {&edges}, taskData);
+
+    std::vector<entt::any> topData;
+
+    ExecStats   stats;
+    ExecContext exec;
+    exec_conform(tasks, exec);
+    exec_stats_conform(tasks, stats);
+    exec.pStats = &stats;
+
+    constexpr int sc_runs = 3;
+    for (int i = 0; i < sc_runs; ++i)
+    {
+        exec_request_run(exec, pl.pl);
+        exec_update(tasks, graph, exec);
+        top_run_blocking(tasks, graph, taskData, topData, exec);
+    }
+
+    EXPECT_EQ(stats.tasks[fill].count,      sc_runs);
+    EXPECT_EQ(stats.tasks[use].count,       sc_runs);
+    EXPECT_EQ(stats.pipelines[pl.pl].count, sc_runs);
+    EXPECT_GE(stats.pipelines[pl.pl].maxNs, stats.tasks[fill].maxNs);
+
+    std::ostringstream stream;
+    stream << TopExecWriteStats{tasks, taskData, stats};
+    EXPECT_NE(stream.str().find("Use"), std::string::npos);
+    EXPECT_NE(stream.str().find("pl"),  std::string::npos);
+
+    // A task that reuses the ID of a removed one starts with no samples
+    tasks.m_taskIds.remove(use);
+    exec_stats_conform(tasks, stats);
+    ASSERT_EQ(tasks.m_taskIds.create(), use);
+    exec_stats_conform(tasks, stats);
+
+    EXPECT_EQ(stats.tasks[use].count,       0);
+    EXPECT_EQ(stats.tasks[fill].count,      sc_runs);
+}
+
+// Test that parallel_for and parallel_for_bits make every call exactly once, with and without a
+// WorkerPool, and when nested inside a job already running on the pool
+TEST(Tasks, ParallelFor)
+{
+    constexpr std::size_t sc_count      = 10000;
+    constexpr int         sc_threads    = 4;
+
+    WorkerPool pool{sc_threads};
+
+    std::vector< std::atomic<int> > calls(sc_count);
+
+    auto const expect_each_called_once = [&calls] (auto &&is_expected)
+    {
+        for (std::size_t i = 0; i < calls.size(); ++i)
+        {
+            ASSERT_EQ(calls[i].exchange(0), is_expected(i) ? 1 : 0) << "index " << i;
+        }
+    };
+
+    auto const count_call = [&calls] (std::size_t const i) { calls[i].fetch_add(1); };
+
+    // Single-threaded
+    parallel_for(WorkerContext{}, sc_count, 64, count_call);
+    expect_each_called_once([] (std::size_t) { return true; });
+
+    // Split over pool, including a partial last chunk
+    WorkerContext const ctx{&pool, pool.external_worker()};
+    parallel_for(ctx, sc_count, 7, count_call);
+    expect_each_called_once([] (std::size_t) { return true; });
+
+    // Bits
+    BitVector_t bits;
+    bitvector_resize(bits, sc_count);
+    for (std::size_t i = 0; i < sc_count; i += 3)
+    {
+        bits.set(i);
+    }
+    parallel_for_bits(ctx, bits, 128, count_call);
+    expect_each_called_once([] (std::size_t const i) { return i % 3 == 0; });
+
+    // Nested, from inside jobs running on the pool
+    std::atomic<int> outerDone{0};
+    struct Outer
+    {
+        WorkerPool          *pPool;
+        decltype(count_call) const *pCountCall;
+        std::atomic<int>    *pDone;
+    } outer{&pool, &count_call, &outerDone};
+
+    constexpr int sc_outerJobs = 10;
+    for (int i = 0; i < sc_outerJobs; ++i)
+    {
+        pool.push(pool.external_worker(), WorkerJob{
+            [] (void *pUser, uint64_t const arg, WorkerId const worker) noexcept
+            {
+                auto &rOuter = *static_cast<Outer*>(pUser);
+                std::size_t const first = arg * (sc_count / sc_outerJobs);
+
+                parallel_for(WorkerContext{rOuter.pPool, worker}, sc_count / sc_outerJobs, 16, [&rOuter, first] (std::size_t const i)
+                {
+                    (*rOuter.pCountCall)(first + i);
+                });
+                rOuter.pDone->fetch_add(1);
+            }, &outer, uint64_t(i)});
+    }
+
+    while (outerDone.load() != sc_outerJobs)
+    {
+        pool.try_run_one(pool.external_worker());
+    }
+    expect_each_called_once([] (std::size_t) { return true; });
+}
+
+// Test that pinned jobs only run on the worker they're pinned to, including the external worker
+TEST(Tasks, WorkerPoolPinnedJobs)
+{
+    constexpr int sc_threads    = 3;
+    constexpr int sc_jobsEach   = 200;
+
+    WorkerPool pool{sc_threads};
+
+    struct Pinned
+    {
+        std::atomic<int>    wrongWorker { 0 };
+        std::atomic<int>    done        { 0 };
+    } pinned;
+
+    auto const job = [] (void *pUser, uint64_t const arg, WorkerId const worker) noexcept
+    {
+        auto &rPinned = *static_cast<Pinned*>(pUser);
+        if (uint64_t(worker) != arg)
+        {
+            rPinned.wrongWorker.fetch_add(1);
+        }
+        rPinned.done.fetch_add(1);
+    };
+
+    for (int i = 0; i < sc_jobsEach; ++i)
+    {
+        for (WorkerInt worker = 0; worker < pool.worker_count(); ++worker)
+        {
+            pool.push_pinned(WorkerId(worker), WorkerJob{job, &pinned, worker});
+        }
+    }
+
+    int const poolJobs = sc_jobsEach * sc_threads;
+    while (pinned.done.load() != poolJobs)
+    {
+        std::this_thread::yield();
+    }
+
+    // Jobs pinned to the external worker wait for an external thread
+    EXPECT_TRUE(pool.has_pinned(pool.external_worker()));
+    while (pool.try_run_one(pool.external_worker())) { }
+
+    EXPECT_FALSE(pool.has_pinned(pool.external_worker()));
+    EXPECT_EQ(pinned.done.load(), poolJobs + sc_jobsEach);
+    EXPECT_EQ(pinned.wrongWorker.load(), 0);
+}
+
+//-----------------------------------------------------------------------------
+
+// Test that top_resolve_args points each task argument directly at its TopData
+TEST(Tasks, TopTaskArgsResolve)
+{
+    using namespace test_trace;
+    using enum Stages;
+
+    Tasks               tasks;
+    TaskEdges           edges;
+    TopTaskDataVec_t    taskData;
+    TopTaskBuilder      builder{tasks, edges, taskData};
+
+    auto const pl = builder.create_pipelines<Pipelines>();
+
+    std::vector<entt::any> topData;
+    topData.emplace_back(std::in_place_type<int>, 0);
+    topData.emplace_back(std::in_place_type<float>, 0.0f);
+
+    TaskId const fill   = builder.task().run_on(pl.pl(Fill)).args({0, 1}).func([] (int& rInt, float& rFloat) noexcept { rInt = 42; rFloat = 4.2f; }).m_taskId;
+    TaskId const none   = builder.task().run_on(pl.pl(Use)).func([] () noexcept { }).m_taskId;
+    TaskId const use    = builder.task().run_on(pl.pl(Use)).args({1}).func([] (float const& value) noexcept { EXPECT_EQ(value, 4.2f); }).m_taskId;
+
+    TopTaskArgs args;
+    top_resolve_args(tasks, taskData, topData, args);
+
+    ASSERT_EQ(top_task_args(args, fill).size(), 2);
+    EXPECT_EQ(top_task_args(args, fill)[0], topData[0].data());
+    EXPECT_EQ(top_task_args(args, fill)[1], topData[1].data());
+    EXPECT_EQ(top_task_args(args, none).size(), 0);
+    ASSERT_EQ(top_task_args(args, use).size(), 1);
+    EXPECT_EQ(top_task_args(args, use)[0], topData[1].data());
+
+    TaskGraph const graph = make_exec_graph(tasks, {&edges}, taskData);
+
+    ExecContext exec;
+    exec_conform(tasks, exec);
+    exec.doLogging = false;
+
+    exec_request_run(exec, pl.pl);
+    exec_update(tasks, graph, exec);
+    top_run_blocking(tasks, graph, taskData, args, exec);
+
+    EXPECT_EQ(entt::any_cast<int>(topData[0]), 42);
+
+    // Growing topData can move every entt::any, so args must be resolved again
+    EXPECT_TRUE(top_args_resolved_from(args, topData));
+    topData.emplace_back();
+    EXPECT_FALSE(top_args_resolved_from(args, topData));
+}
+
+//-----------------------------------------------------------------------------
+
+namespace test_coroutine
+{
+
+TopCoTask steps(std::vector<int> &rLog, int const &flag)
+{
+    rLog.push_back(1);
+    co_await co_next_step();
+    rLog.push_back(2);
+    co_await co_step_point(1);
+    rLog.push_back(3);
+    co_await co_until([&flag] { return flag != 0; });
+    rLog.push_back(4);
+}
+
+TopCoTask background(WorkerContext const ctx, std::atomic<int> &rValue)
+{
+    co_await co_background(ctx, [&rValue] () noexcept { rValue.store(42); });
+    EXPECT_EQ(rValue.load(), 42);
+    rValue.store(43);
+}
+
+TopCoTask blocking_background(WorkerContext const ctx, std::atomic<bool> &rStarted, std::atomic<bool> &rRelease, std::atomic<bool> &rFinished)
+{
+    co_await co_background(ctx, [&rStarted, &rRelease, &rFinished] () noexcept
+    {
+        rStarted.store(true);
+        rStarted.notify_all();
+        rRelease.wait(false);
+        rFinished.store(true);
+    });
+}
+
+} // namespace test_coroutine
+
+// Test that coroutine tasks suspend across runs, and resume from the right task and condition
+TEST(Tasks, TopCoroutine)
+{
+    using namespace test_trace;
+    using namespace test_coroutine;
+    using enum Stages;
+
+    Tasks               tasks;
+    TaskEdges           edges;
+    TopTaskDataVec_t    taskData;
+    TopTaskBuilder      builder{tasks, edges, taskData};
+
+    auto const pl = builder.create_pipelines<Pipelines>();
+
+    std::vector<entt::any> topData;
+    topData.emplace_back(std::in_place_type<TopCoTask>);
+    topData.emplace_back(std::in_place_type<std::vector<int>>);
+    topData.emplace_back(std::in_place_type<int>, 0);
+
+    builder.task().run_on(pl.pl(Fill)).args({0, 1, 2}).func([] (TopCoTask &rCo, std::vector<int> &rLog, int const &flag) noexcept
+    {
+        co_step(rCo, [&rLog, &flag] { return steps(rLog, flag); });
+    });
+    builder.task().run_on(pl.pl(Use)).args({0}).func([] (TopCoTask &rCo) noexcept
+    {
+        co_step(rCo, 1);
+    });
+
+    TaskGraph const graph = make_exec_graph(tasks, {&edges}, taskData);
+
+    ExecContext exec;
+    exec_conform(tasks, exec);
+    exec.doLogging = false;
+
+    auto const run_frame = [&] ()
+    {
+        exec_request_run(exec, pl.pl);
+        exec_update(tasks, graph, exec);
+        top_run_blocking(tasks, graph, taskData, topData, exec);
+    };
+
+    auto const &rLog = entt::any_cast<std::vector<int>&>(topData[1]);
+
+    run_frame(); // Started, waits for next step
+    EXPECT_EQ(rLog, (std::vector<int>{1}));
+    run_frame(); // Continues in Fill, then in Use, then waits for flag
+    EXPECT_EQ(rLog, (std::vector<int>{1, 2, 3}));
+    run_frame(); // Flag not set yet
+    EXPECT_EQ(rLog, (std::vector<int>{1, 2, 3}));
+    EXPECT_TRUE(entt::any_cast<TopCoTask&>(topData[0]).running());
+
+    entt::any_cast<int&>(topData[2]) = 1;
+    run_frame(); // Finishes
+    EXPECT_EQ(rLog, (std::vector<int>{1, 2, 3, 4}));
+    EXPECT_FALSE(entt::any_cast<TopCoTask&>(topData[0]).running());
+
+    run_frame(); // Starts again
+    EXPECT_EQ(rLog, (std::vector<int>{1, 2, 3, 4, 1}));
+
+    // co_background without a pool runs right away
+    std::atomic<int> value{0};
+    TopCoTask inlineCo;
+    EXPECT_TRUE(co_step(inlineCo, [&value] { return background(WorkerContext{}, value); }));
+    EXPECT_EQ(value.load(), 43);
+
+    // co_background with a pool continues once the job is done
+    value.store(0);
+    WorkerPool pool{2};
+    WorkerContext const ctx{&pool, pool.external_worker()};
+    TopCoTask poolCo;
+    bool done = co_step(poolCo, [ctx, &value] { return background(ctx, value); });
+    while ( ! done )
+    {
+        pool.try_run_one(ctx.worker);
+        done = co_step(poolCo);
+    }
+    EXPECT_EQ(value.load(), 43);
+
+    // Destroying a coroutine cancels its background job if it hasn't started yet
+    WorkerPool idlePool{0};
+    WorkerContext const idleCtx{&idlePool, idlePool.external_worker()};
+    value.store(0);
+    TopCoTask cancelledCo;
+    EXPECT_FALSE(co_step(cancelledCo, [idleCtx, &value] { return background(idleCtx, value); }));
+    cancelledCo.destroy();
+    EXPECT_FALSE(idlePool.try_run_one(idleCtx.worker));
+    EXPECT_EQ(value.load(), 0);
+
+    // ...and waits for it to return if it's already running
+    std::atomic<bool> started{false};
+    std::atomic<bool> release{false};
+    std::atomic<bool> finished{false};
+    TopCoTask runningCo;
+    EXPECT_FALSE(co_step(runningCo, [ctx, &started, &release, &finished] () -> TopCoTask
+    {
+        return blocking_background(ctx, started, release, finished);
+    }));
+    started.wait(false);
+    std::thread releaser{[&release] { release.store(true); release.notify_all(); }};
+    runningCo.destroy();
+    EXPECT_TRUE(finished.load());
+    releaser.join();
+}
+
+//-----------------------------------------------------------------------------
+
+namespace test_fusion
+{
+
+enum class Stages { Fill, Use };
+
+struct Pipelines
+{
+    osp::PipelineDef<Stages> pl     {"pl"};
+    osp::PipelineDef<Stages> other  {"other"};
+};
+
+} // namespace test_fusion
+
+// Test that fusable tasks with the same run-on and sync-with stages are dispatched as one
+TEST(Tasks, TaskFusion)
+{
+    using namespace test_fusion;
+    using enum Stages;
+
+    Tasks               tasks;
+    TaskEdges           edges;
+    TopTaskDataVec_t    taskData;
+    TopTaskBuilder      builder{tasks, edges, taskData};
+
+    auto const pl = builder.create_pipelines<Pipelines>();
+
+    std::vector<entt::any> topData;
+    topData.emplace_back(std::in_place_type<int>, 0);
+
+    auto const count = [] (int &rCount) noexcept { ++rCount; };
+
+    TaskId const a = builder.task().run_on(pl.pl(Fill)).fusable().args({0}).func(count).m_taskId;
+    TaskId const b = builder.task().run_on(pl.pl(Fill)).fusable().args({0}).func(count).m_taskId;
+    TaskId const c = builder.task().run_on(pl.pl(Fill)).fusable().args({0}).func(count).m_taskId;
+    TaskId const d = builder.task().run_on(pl.pl(Fill))           .args({0}).func(count).m_taskId;
+    TaskId const e = builder.task().run_on(pl.pl(Fill)).sync_with({pl.other(Fill)}).fusable().args({0}).func(count).m_taskId;
+    TaskId const f = builder.task().run_on(pl.pl(Fill)).sync_with({pl.other(Fill)}).fusable().args({0}).func(count).m_taskId;
+    TaskId const g = builder.task().run_on(pl.other(Fill)).fusable().args({0}).func(count).m_taskId;
+
+    TaskGraph graph = make_exec_graph(tasks, {&edges}, taskData);
+
+    auto const run_tasks = [&graph] (PipelineId const pipeline, StageId const stage)
+    {
+        auto const view = fanout_view(graph.anystgToFirstRuntask, graph.runtaskToTask, anystg_from(graph, pipeline, stage));
+        return std::set<TaskId>(view.begin(), view.end());
+    };
+    auto const conflicts = [&graph] (TaskId const task)
+    {
+        auto const view = fanout_view(graph.taskToFirstConflict, graph.conflictToTask, task);
+        return std::set<TaskId>(view.begin(), view.end());
+    };
+
+    EXPECT_EQ(fused_next(graph, a), b);
+    EXPECT_EQ(fused_next(graph, b), c);
+    EXPECT_EQ(fused_next(graph, c), lgrn::id_null<TaskId>());
+    EXPECT_EQ(fused_next(graph, d), lgrn::id_null<TaskId>());
+    EXPECT_EQ(fused_next(graph, e), f);
+    EXPECT_EQ(run_tasks(pl.pl, StageId(0)), (std::set<TaskId>{a, d, e}));
+    EXPECT_EQ(fanout_size(graph.taskToFirstTaskreqstg, f), 0);
+
+    // Conflicts of followers are taken on by the first task of their chain
+    EXPECT_EQ(conflicts(a), (std::set<TaskId>{d, e, g}));
+    EXPECT_TRUE(conflicts(b).empty());
+
+    ExecContext exec;
+    auto const run_frame = [&] ()
+    {
+        exec_conform(tasks, exec);
+        exec.doLogging = false;
+        exec_request_run(exec, pl.pl);
+        exec_request_run(exec, pl.other);
+        exec_update(tasks, graph, exec);
+        top_run_blocking(tasks, graph, taskData, topData, exec);
+        EXPECT_EQ(exec.pipelinesRunning, 0);
+    };
+
+    run_frame();
+    EXPECT_EQ(entt::any_cast<int>(topData[0]), 7);
+
+    // Removing the first task of a chain leaves the rest still fused together
+    tasks.m_taskIds.remove(a);
+    taskData[a] = {};
+    std::erase(edges.m_fusable, a);
+
+    std::array<TaskId, 1> const removed{a};
+    update_exec_graph(graph, tasks, {&edges}, taskData, {.tasksRemoved = removed});
+
+    EXPECT_EQ(fused_next(graph, b), c);
+    EXPECT_EQ(fused_next(graph, e), f);
+    EXPECT_EQ(run_tasks(pl.pl, StageId(0)), (std::set<TaskId>{b, d, e}));
+
+    run_frame();
+    EXPECT_EQ(entt::any_cast<int>(topData[0]), 13);
+}
+
+// Test that fusable tasks are only fused with ones that run on the same thread
+TEST(Tasks, TaskFusionAffinity)
+{
+    using namespace test_fusion;
+    using enum Stages;
+
+    Tasks               tasks;
+    TaskEdges           edges;
+    TopTaskDataVec_t    taskData;
+    TopTaskBuilder      builder{tasks, edges, taskData};
+
+    auto const pl = builder.create_pipelines<Pipelines>();
+
+    auto const count = [] (int &rCount) noexcept { ++rCount; };
+
+    TaskId const a = builder.task().run_on(pl.pl(Fill)).fusable().args({0}).func(count).m_taskId;
+    TaskId const b = builder.task().run_on(pl.pl(Fill)).fusable().args({0}).affinity(ETopAffinity::Main).func(count).m_taskId;
+    TaskId const c = builder.task().run_on(pl.pl(Fill)).fusable().args({0}).func(count).m_taskId;
+    TaskId const d = builder.task().run_on(pl.pl(Fill)).fusable().args({0}).affinity(ETopAffinity::Main).func(count).m_taskId;
+    TaskId const e = builder.task().run_on(pl.pl(Fill)).fusable().args({0}).affinity(ETopAffinity::Lane, 0).func(count).m_taskId;
+    TaskId const f = builder.task().run_on(pl.pl(Fill)).fusable().args({0}).affinity(ETopAffinity::Lane, 1).func(count).m_taskId;
+
+    TaskGraph const graph = make_exec_graph(tasks, {&edges}, taskData);
+
+    EXPECT_EQ(fused_next(graph, a), c);
+    EXPECT_EQ(fused_next(graph, b), d);
+    EXPECT_EQ(fused_next(graph, c), lgrn::id_null<TaskId>());
+    EXPECT_EQ(fused_next(graph, d), lgrn::id_null<TaskId>());
+    EXPECT_EQ(fused_next(graph, e), lgrn::id_null<TaskId>());
+    EXPECT_EQ(fused_next(graph, f), lgrn::id_null<TaskId>());
+}
+
+// Test that the testapp's per-shader "Sync DrawEnts" tasks fuse, using the real renderer pipelines
+TEST(Tasks, TaskFusionRendererSync)
+{
+    using namespace testapp;
+    using enum EStgOptn;
+    using enum EStgCont;
+    using enum EStgIntr;
+
+    Tasks               tasks;
+    TaskEdges           edges;
+    TopTaskDataVec_t    taskData;
+    TopTaskBuilder      builder{tasks, edges, taskData};
+
+    auto const tgWin    = builder.create_pipelines<PlWindowApp>();
+    auto const tgScnRdr = builder.create_pipelines<PlSceneRenderer>();
+
+    builder.pipeline(tgScnRdr.group)        .parent(tgWin.sync);
+    builder.pipeline(tgScnRdr.groupEnts)    .parent(tgWin.sync);
+    builder.pipeline(tgScnRdr.materialDirty).parent(tgWin.sync);
+
+    std::vector<entt::any> topData;
+    topData.emplace_back(std::in_place_type<int>, 0);
+
+    // Same stages as setup_shader_visualizer, setup_shader_flat, and setup_shader_phong
+    for (int i = 0; i < 3; ++i)
+    {
+        builder.task()
+            .affinity   (ETopAffinity::Main)
+            .run_on     ({tgWin.sync(Run)})
+            .sync_with  ({tgScnRdr.groupEnts(Modify), tgScnRdr.group(Modify), tgScnRdr.materialDirty(UseOrRun)})
+            .fusable    ()
+            .args       ({0})
+            .func([] (int &rCount) noexcept { ++rCount; });
+    }
+
+    TaskEdges unfusedEdges = edges;
+    unfusedEdges.m_fusable.clear();
+
+    // Number of tasks the executor completes in a frame, one per dispatch
+    auto const count_dispatches = [&] (TaskEdges const& frameEdges)
+    {
+        TaskGraph const graph = make_exec_graph(tasks, {&frameEdges}, taskData);
+
+        ExecRecording recording;
+        ExecContext exec;
+        exec_conform(tasks, exec);
+        exec.doLogging  = false;
+        exec.pRecording = &recording;
+
+        exec_request_run(exec, tgWin.sync);
+        exec_update(tasks, graph, exec);
+        top_run_blocking(tasks, graph, taskData, topData, exec);
+        EXPECT_EQ(exec.pipelinesRunning, 0);
+
+        return std::count_if(recording.events.begin(), recording.events.end(), [] (ExecRecording::Event_t const& event)
+        {
+            return std::holds_alternative<ExecRecording::Complete>(event);
+        });
+    };
+
+    EXPECT_EQ(count_dispatches(unfusedEdges), 3);
+    EXPECT_EQ(count_dispatches(edges), 1);
+
+    // Every task still runs
+    EXPECT_EQ(entt::any_cast<int>(topData[0]), 6);
+}
+
+// Test that a recorded frame replays with the same run requests and task order
+TEST(Tasks, ExecRecordReplay)
+{
+    using namespace test_fusion;
+    using enum Stages;
+
+    Tasks               tasks;
+    TaskEdges           edges;
+    TopTaskDataVec_t    taskData;
+    TopTaskBuilder      builder{tasks, edges, taskData};
+
+    auto const pl = builder.create_pipelines<Pipelines>();
+
+    std::vector<entt::any> topData;
+    topData.emplace_back(std::in_place_type<std::vector<int>>);
+
+    auto &rOrder = entt::any_cast<std::vector<int>&>(topData[0]);
+
+    builder.task().run_on(pl.pl(Fill))   .args({0}).func([] (std::vector<int> &rOrder) noexcept { rOrder.push_back(0); });
+    builder.task().run_on(pl.pl(Fill))   .args({0}).func([] (std::vector<int> &rOrder) noexcept { rOrder.push_back(1); });
+    builder.task().run_on(pl.pl(Use))    .args({0}).func([] (std::vector<int> &rOrder) noexcept { rOrder.push_back(2); })
+                  .sync_with({pl.other(Use)});
+    builder.task().run_on(pl.other(Fill)).args({0}).func([] (std::vector<int> &rOrder) noexcept { rOrder.push_back(3); });
+    builder.task().run_on(pl.other(Use)) .args({0}).func([] (std::vector<int> &rOrder) noexcept { rOrder.push_back(4); });
+
+    TaskGraph const graph = make_exec_graph(tasks, {&edges}, taskData);
+
+    TopTaskArgs args;
+    top_resolve_args(tasks, taskData, topData, args);
+
+    // Record a frame, picking tasks in reverse order so it differs from what a replay would pick
+    ExecRecording recording;
+    {
+        ExecContext exec;
+        exec_conform(tasks, exec);
+        exec.doLogging = false;
+        exec.pRecording = &recording;
+
+        exec_request_run(exec, pl.pl);
+        exec_request_run(exec, pl.other);
+        exec_update(tasks, graph, exec);
+        while ( ! exec.tasksQueuedRun.empty() )
+        {
+            TaskId const task = exec.tasksQueuedRun[exec.tasksQueuedRun.size() - 1];
+            complete_task(tasks, graph, exec, task, top_run_fused(graph, taskData, args, task, {}));
+            exec_update(tasks, graph, exec);
+        }
+        recording.events.push_back(ExecRecording::FrameEnd{});
+        ASSERT_EQ(exec.pipelinesRunning, 0);
+    }
+
+    std::vector<int> const recordedOrder = rOrder;
+    ASSERT_EQ(recordedOrder.size(), 5);
+
+    // Write and read back
+    std::stringstream stream;
+    exec_recording_write(stream, recording);
+    ExecRecording readBack;
+    ASSERT_TRUE(exec_recording_read(stream, readBack));
+    ASSERT_EQ(readBack.events.size(), recording.events.size());
+
+    rOrder.clear();
+
+    ExecContext exec;
+    exec_conform(tasks, exec);
+    exec.doLogging = false;
+
+    std::size_t cursor = 0;
+    TopReplayStatus const status = top_replay_frame(tasks, graph, taskData, args, exec, readBack, cursor);
+
+    EXPECT_FALSE(status.diverged);
+    EXPECT_EQ(status.tasksRun, 5);
+    EXPECT_EQ(cursor, readBack.events.size());
+    EXPECT_EQ(exec.pipelinesRunning, 0);
+    EXPECT_EQ(rOrder, recordedOrder);
+
+    // A recording that no longer matches still finishes the frame
+    std::erase_if(readBack.events, [] (ExecRecording::Event_t const& event)
+    {
+        auto const *pComplete = std::get_if<ExecRecording::Complete>(&event);
+        return pComplete != nullptr && pComplete->task == TaskId(0);
+    });
+    readBack.events.insert(readBack.events.begin() + 2, ExecRecording::Complete{TaskId(2), {}});
+
+    rOrder.clear();
+    cursor = 0;
+    TopReplayStatus const diverged = top_replay_frame(tasks, graph, taskData, args, exec, readBack, cursor);
+
+    EXPECT_TRUE(diverged.diverged);
+    EXPECT_EQ(cursor, readBack.events.size());
+    EXPECT_EQ(exec.pipelinesRunning, 0);
+    EXPECT_EQ(rOrder.size(), 5);
+
+    // Garbage is rejected
+    std::stringstream garbage{"not a recording"};
+    EXPECT_FALSE(exec_recording_read(garbage, readBack));
+
+    // Truncated recordings are rejected, without leaving any events behind
+    std::string const written = stream.str();
+    std::stringstream truncated{written.substr(0, written.size() - 4)};
+    EXPECT_FALSE(exec_recording_read(truncated, readBack));
+    EXPECT_TRUE(readBack.events.empty());
+
+    // IDs past the capacity of tasks don't fit, such as from a different session layout
+    EXPECT_TRUE(exec_recording_fits(tasks, recording));
+    recording.events.push_back(ExecRecording::Complete{TaskId(tasks.m_taskIds.capacity()), {}});
+    EXPECT_FALSE(exec_recording_fits(tasks, recording));
+    recording.events.pop_back();
+    recording.events.push_back(ExecRecording::Signal{PipelineId(tasks.m_pipelineIds.capacity())});
+    EXPECT_FALSE(exec_recording_fits(tasks, recording));
+}
+
+//-----------------------------------------------------------------------------
+
+namespace test_stall
+{
+
+enum class Stages { First, Second };
+
+struct Pipelines
+{
+    osp::PipelineDef<Stages> a      {"a"};
+    osp::PipelineDef<Stages> b      {"b"};
+    osp::PipelineDef<Stages> parked {"parked"};
+};
+
+} // namespace test_stall
+
+// Test that pipelines waiting on each other are reported, but waiting for a signal is not
+TEST(Tasks, StallDetection)
+{
+    using namespace test_stall;
+    using enum Stages;
+
+    Tasks               tasks;
+    TaskEdges           edges;
+    TopTaskDataVec_t    taskData;
+    TopTaskBuilder      builder{tasks, edges, taskData};
+
+    auto const pl = builder.create_pipelines<Pipelines>();
+
+    builder.pipeline(pl.parked).wait_for_signal(First);
+
+    auto const nothing = [] () noexcept { };
+
+    // Each task needs the other pipeline to move on to Second, which can't happen until the
+    // task itself is done
+    TaskId const taskA = builder.task().name("taskA").run_on(pl.a(First)).sync_with({pl.b(Second)}).func(nothing).m_taskId;
+    TaskId const taskB = builder.task().name("taskB").run_on(pl.b(First)).sync_with({pl.a(Second)}).func(nothing).m_taskId;
+    builder.task().name("afterSignal").run_on(pl.parked(Second)).func(nothing);
+
+    TaskGraph const graph = make_exec_graph(tasks, {&edges}, taskData);
+
+    std::vector<entt::any> topData;
+
+    ExecContext exec;
+    exec_conform(tasks, exec);
+
+    // Waiting for a signal is fine
+    exec_request_run(exec, pl.parked);
+    exec_update(tasks, graph, exec);
+
+    EXPECT_TRUE(exec.tasksQueuedRun.empty());
+    EXPECT_EQ(exec.pipelinesRunning, 1);
+    // Scratch buffers are reused by every check below
+    ExecStallScratch scratch;
+    EXPECT_TRUE(exec_find_stall(tasks, graph, exec, scratch).chain.empty());
+
+    exec_signal(exec, pl.parked);
+    exec_update(tasks, graph, exec);
+    top_run_blocking(tasks, graph, taskData, topData, exec);
+    ASSERT_EQ(exec.pipelinesRunning, 0);
+
+    // Now deadlock a and b
+    exec_request_run(exec, pl.a);
+    exec_request_run(exec, pl.b);
+    exec_update(tasks, graph, exec);
+
+    EXPECT_TRUE(exec.tasksQueuedRun.empty());
+
+    ExecStall const stall = exec_find_stall(tasks, graph, exec, scratch);
+
+    ASSERT_EQ(stall.chain.size(), 2);
+    EXPECT_TRUE(stall.cycle);
+    EXPECT_EQ(stall.chain[0].waitsFor, stall.chain[1].pipeline);
+    EXPECT_EQ(stall.chain[1].waitsFor, stall.chain[0].pipeline);
+
+    std::set<TaskId> const stallTasks{stall.chain[0].task, stall.chain[1].task};
+    EXPECT_EQ(stallTasks, (std::set<TaskId>{taskA, taskB}));
+
+    std::ostringstream line;
+    line << TopExecWriteStall{tasks, taskData, stall};
+    EXPECT_EQ(line.str().rfind("Deadlock: ", 0), 0);
+    EXPECT_EQ(line.str().find('\n'), std::string::npos);
+    EXPECT_NE(line.str().find("taskA"), std::string::npos);
+
+    // Same result without reusing buffers
+    EXPECT_EQ(exec_find_stall(tasks, graph, exec).chain.size(), 2);
+}
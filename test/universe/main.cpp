@@ -23,13 +23,29 @@
  * SOFTWARE.
  */
 #include <osp/universe/universe.h>
+#include <osp/universe/coord_cache.h>
 #include <osp/universe/coordinates.h>
+#include <osp/universe/sat_data.h>
+#include <osp/universe/sat_gravity.h>
+#include <osp/universe/sat_grid.h>
+#include <osp/universe/sat_integrate.h>
+#include <osp/universe/sat_kepler.h>
 #include <osp/core/math_2pow.h>
 
 #include <Magnum/Math/Functions.h>
 
+#include <Corrade/Containers/ArrayViewStl.h>
+
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <set>
+#include <vector>
+
 using namespace osp;
 using namespace osp::universe;
 
@@ -205,4 +221,898 @@ TEST(Universe, CoordTransformerRotations)
     expect_near_vec(moonToSun.transform_position(moonRay), planet.m_position, 4);
 }
 
+// Test that transforming many positions at once matches transforming them one at a time
+TEST(Universe, CoordTransformerBatched)
+{
+    CoSpaceTransform sun
+    {
+        .m_precision = 10
+    };
+    CoSpaceTransform planet
+    {
+        .m_rotation  = Quaterniond::rotation(30.0_deg, Vector3d{1.0, 2.0, 3.0}.normalized()),
+        .m_position  = {sci64(150, 9, 10), -sci64(150, 9, 10), sci64(42, 0, 10)},
+        .m_precision = 13
+    };
+    CoSpaceTransform moon
+    {
+        .m_rotation  = Quaterniond::rotation(-70.0_deg, Vector3d{0.0, 0.0, 1.0}),
+        .m_position  = {sci64(160, 9, 10), sci64(170, 9, 10), sci64(69, 3, 10)},
+        .m_precision = 7
+    };
+
+    std::array<CoordTransformer, 5> const transformers
+    {
+        coord_parent_to_child(sun, planet),
+        coord_child_to_parent(sun, planet),
+        coord_parent_to_child(sun, moon),
+        coord_child_to_parent(sun, moon),
+        coord_composite(coord_parent_to_child(sun, moon), coord_child_to_parent(sun, planet))
+    };
+
+    // Not a multiple of the internal block size
+    constexpr std::size_t sc_count = 150;
+
+    std::mt19937 gen(99);
+    std::uniform_int_distribution<spaceint_t> posDist(-sci64(1, 11, 10), sci64(1, 11, 10));
+
+    std::array<std::vector<spaceint_t>, 3> in;
+    for (std::vector<spaceint_t> &rComp : in)
+    {
+        rComp.resize(sc_count);
+        std::generate(rComp.begin(), rComp.end(), [&gen, &posDist] { return posDist(gen); });
+    }
+
+    for (CoordTransformer const& transformer : transformers)
+    {
+        std::array<std::vector<spaceint_t>, 3> out{std::vector<spaceint_t>(sc_count),
+                                                   std::vector<spaceint_t>(sc_count),
+                                                   std::vector<spaceint_t>(sc_count)};
+
+        transformer.transform_positions(
+                Corrade::Containers::arrayView(in[0]),  Corrade::Containers::arrayView(in[1]),  Corrade::Containers::arrayView(in[2]),
+                Corrade::Containers::arrayView(out[0]), Corrade::Containers::arrayView(out[1]), Corrade::Containers::arrayView(out[2]));
+
+        // In-place
+        std::array<std::vector<spaceint_t>, 3> inPlace = in;
+        transformer.transform_positions(
+                Corrade::Containers::arrayView(inPlace[0]), Corrade::Containers::arrayView(inPlace[1]), Corrade::Containers::arrayView(inPlace[2]),
+                Corrade::Containers::arrayView(inPlace[0]), Corrade::Containers::arrayView(inPlace[1]), Corrade::Containers::arrayView(inPlace[2]));
+
+        EXPECT_EQ(out, inPlace);
+
+        for (std::size_t i = 0; i < sc_count; ++i)
+        {
+            Vector3g const expected = transformer.transform_position(to_vec<Vector3g>(i, in[0], in[1], in[2]));
+
+            // Rotating with a matrix may round differently, by a few units per rotation. Errors
+            // from the inner rotation are scaled by 2^n, and doubles lose integer precision
+            // for large positions.
+            double const     scaledError = 4.0 * std::max(mul_2pow<double, int>(1.0, transformer.m_n), 1.0);
+            spaceint_t const maxError    = spaceint_t(scaledError + Vector3d(expected).length() * 1.0e-15);
+            expect_near_vec(to_vec<Vector3g>(i, out[0], out[1], out[2]), expected, maxError);
+        }
+    }
+}
+
+// Test cached transforms across a star -> planet -> moon -> station hierarchy
+TEST(Universe, CoordTransformCache)
+{
+    Universe universe;
+
+    CoSpaceId const star    = universe.m_coordIds.create();
+    CoSpaceId const planet  = universe.m_coordIds.create();
+    CoSpaceId const moon    = universe.m_coordIds.create();
+    CoSpaceId const station = universe.m_coordIds.create();
+    CoSpaceId const comet   = universe.m_coordIds.create();
+    universe.m_coordCommon.resize(universe.m_coordIds.capacity());
+
+    // Star and planet each have one satellite, which the planet and moon are parented to
+    auto const add_sat = [&universe] (CoSpaceId const space, Vector3g const pos, Quaterniond const rot)
+    {
+        CoSpaceCommon &rCommon = universe.m_coordCommon[space];
+        SatId const sat = sat_create(rCommon);
+        std::size_t const i = sat_index(rCommon, sat);
+
+        auto const [x, y, z]        = sat_views(rCommon.m_satPositions, rCommon.m_data, rCommon.m_satCount);
+        auto const [qx, qy, qz, qw] = sat_views(rCommon.m_satRotations, rCommon.m_data, rCommon.m_satCount);
+        x[i]  = pos.x();
+        y[i]  = pos.y();
+        z[i]  = pos.z();
+        qx[i] = rot.vector().x();
+        qy[i] = rot.vector().y();
+        qz[i] = rot.vector().z();
+        qw[i] = rot.scalar();
+        return sat;
+    };
+
+    SatId const planetSat = add_sat(star,   {sci64(150, 9, 10), 0, 0}, Quaterniond::rotation(20.0_deg, Vector3d{0.0, 0.0, 1.0}));
+    SatId const moonSat   = add_sat(planet, {0, sci64(384, 6, 12), 0}, Quaterniond::rotation(45.0_deg, Vector3d{1.0, 0.0, 0.0}));
+
+    universe.m_coordCommon[star]   .m_precision = 10;
+    universe.m_coordCommon[planet] .m_precision = 12;
+    universe.m_coordCommon[planet] .m_parent    = star;
+    universe.m_coordCommon[planet] .m_parentSat = planetSat;
+    universe.m_coordCommon[moon]   .m_precision = 14;
+    universe.m_coordCommon[moon]   .m_parent    = planet;
+    universe.m_coordCommon[moon]   .m_parentSat = moonSat;
+    universe.m_coordCommon[station].m_precision = 16;
+    universe.m_coordCommon[station].m_parent    = moon;
+    universe.m_coordCommon[station].m_position  = {sci64(2, 6, 14), 0, 0};
+    universe.m_coordCommon[comet]  .m_precision = 10;
+    universe.m_coordCommon[comet]  .m_parent    = star;
+    universe.m_coordCommon[comet]  .m_position  = {-sci64(80, 9, 10), sci64(10, 9, 10), 0};
+    universe.m_coordCommon[comet]  .m_rotation  = Quaterniond::rotation(-60.0_deg, Vector3d{0.0, 1.0, 0.0});
+
+    // Transform to parent, calculated by hand
+    auto const to_parent = [&universe] (CoSpaceId const space)
+    {
+        CoSpaceCommon const &rSpace  = universe.m_coordCommon[space];
+        CoSpaceCommon const &rParent = universe.m_coordCommon[rSpace.m_parent];
+        CoSpaceTransform const tf = coord_get_transform(rSpace, rParent);
+        return std::pair{coord_child_to_parent(rParent, tf), coord_parent_to_child(rParent, tf)};
+    };
+
+    auto const expect_same = [] (CoordTransformer const& a, CoordTransformer const& b)
+    {
+        for (Vector3g const pos : {Vector3g{0, 0, 0}, Vector3g{sci64(5, 6, 10), -sci64(3, 5, 10), sci64(7, 4, 10)}})
+        {
+            EXPECT_EQ(a.transform_position(pos), b.transform_position(pos));
+        }
+    };
+
+    // Composited in the same order as the cache, as rounding makes this not quite associative
+    auto const station_to_star = [&to_parent, station, moon, planet] ()
+    {
+        return coord_composite(coord_composite(to_parent(planet).first, to_parent(moon).first), to_parent(station).first);
+    };
+
+    CoSpaceTransformCache cache;
+    coord_cache_update(cache, universe);
+
+    EXPECT_EQ(cache.m_spaces[station].m_toAncestor.size(), 3);
+    EXPECT_TRUE(cache.m_spaces[star].m_toAncestor.empty());
+
+    expect_same(coord_cache_get(cache, station, station), CoordTransformer{});
+    expect_same(coord_cache_get(cache, station, moon),    to_parent(station).first);
+    expect_same(coord_cache_get(cache, moon, station),    to_parent(station).second);
+    expect_same(coord_cache_get(cache, station, star),    station_to_star());
+    expect_same(coord_cache_get(cache, station, comet),   coord_composite(to_parent(comet).second, station_to_star()));
+
+    // Move the star's satellite without marking anything; the cache is stale on purpose
+    CoordTransformer const before = station_to_star();
+    auto const [starX, starY, starZ] = sat_views(universe.m_coordCommon[star].m_satPositions, universe.m_coordCommon[star].m_data, 1);
+    starX[sat_index(universe.m_coordCommon[star], planetSat)] += sci64(1, 6, 10);
+    coord_cache_update(cache, universe);
+    expect_same(coord_cache_get(cache, station, star), before);
+
+    // Marking satellites moved updates the planet and all of its descendants
+    coord_cache_mark_sats_moved(cache, universe, star);
+    coord_cache_update(cache, universe);
+    expect_same(coord_cache_get(cache, station, star), station_to_star());
+    expect_same(coord_cache_get(cache, star, moon),
+                coord_composite(to_parent(moon).second, to_parent(planet).second));
+
+    // Reparenting is detected without marking
+    universe.m_coordCommon[station].m_parent = planet;
+    coord_cache_update(cache, universe);
+    EXPECT_EQ(cache.m_spaces[station].m_toAncestor.size(), 2);
+    expect_same(coord_cache_get(cache, station, planet), to_parent(station).first);
+}
+
+// Test that satellite component arrays are aligned and padded for SIMD
+TEST(Universe, SatDataAlignment)
+{
+    constexpr uint32_t sc_capacity = 5;
+
+    CoSpaceSatData data{};
+    sat_data_allocate(data, sc_capacity);
+
+    EXPECT_EQ(data.m_satCapacity, sc_capacity);
+    EXPECT_EQ(data.m_satCount, 0);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(data.m_data.data()) % gc_satDataAlignment, 0);
+
+    auto const expect_aligned_padded = [&data] (StrideDesc const& desc)
+    {
+        EXPECT_EQ(desc.m_offset % gc_satDataAlignment, 0);
+
+        // Padding is enough to load/store a whole SIMD register past the last satellite
+        std::size_t const padded = align_up(desc.m_offset + std::size_t(desc.m_stride) * sc_capacity, gc_satDataAlignment);
+        EXPECT_LE(padded, data.m_data.size());
+    };
+
+    for (StrideDesc const& desc : data.m_satPositions)  { expect_aligned_padded(desc); }
+    for (StrideDesc const& desc : data.m_satVelocities) { expect_aligned_padded(desc); }
+    for (StrideDesc const& desc : data.m_satAngularVels){ expect_aligned_padded(desc); }
+    expect_aligned_padded(data.m_satRotations[0]);
+    expect_aligned_padded(data.m_satMasses);
+
+    // Rotations are interleaved
+    EXPECT_EQ(data.m_satRotations[1].m_offset, data.m_satRotations[0].m_offset + sizeof(double));
+    EXPECT_EQ(data.m_satRotations[0].m_stride, 4 * sizeof(double));
+
+    // Component arrays don't overlap
+    EXPECT_GE(data.m_satPositions[1].m_offset, data.m_satPositions[0].m_offset + sizeof(spaceint_t) * sc_capacity);
+
+    auto const [x, y, z] = sat_views(data.m_satPositions, data.m_data, sc_capacity);
+    for (std::size_t i = 0; i < sc_capacity; ++i)
+    {
+        x[i] = spaceint_t(i);
+        y[i] = spaceint_t(i * 2);
+        z[i] = spaceint_t(i * 3);
+    }
+    EXPECT_EQ(x[4], 4);
+    EXPECT_EQ(y[4], 8);
+    EXPECT_EQ(z[4], 12);
+}
+
+// Test adding and removing satellites, with IDs that stay the same while their data moves
+TEST(Universe, SatCreateRemove)
+{
+    constexpr uint32_t sc_count = 1000;
+
+    CoSpaceSatData data{};
+
+    // Mark each satellite's data with its ID, positions and masses are enough to follow them
+    auto const mark = [&data] (SatId const sat)
+    {
+        std::size_t const i = sat_index(data, sat);
+        auto const [x, y, z] = sat_views(data.m_satPositions, data.m_data, data.m_satCount);
+        x[i] = spaceint_t(sat);
+        y[i] = -spaceint_t(sat);
+        data.m_satMasses.view(Corrade::Containers::arrayView(data.m_data), data.m_satCount)[i] = double(sat) * 0.5;
+    };
+
+    auto const expect_marked = [&data] (SatId const sat)
+    {
+        std::size_t const i = sat_index(data, sat);
+        auto const [x, y, z]        = sat_views(data.m_satPositions, data.m_data, data.m_satCount);
+        auto const [qx, qy, qz, qw] = sat_views(data.m_satRotations, data.m_data, data.m_satCount);
+        EXPECT_EQ(x[i], spaceint_t(sat));
+        EXPECT_EQ(y[i], -spaceint_t(sat));
+        EXPECT_EQ(z[i], 0);
+        EXPECT_EQ(qw[i], 1.0);
+        EXPECT_EQ(data.m_satMasses.view(Corrade::Containers::arrayView(data.m_data), data.m_satCount)[i], double(sat) * 0.5);
+        EXPECT_EQ(data.m_satIndexToId[i], sat);
+    };
+
+    std::vector<SatId> sats;
+    int reallocs = 0;
+    for (uint32_t i = 0; i < sc_count; ++i)
+    {
+        unsigned char const *pPrevData = data.m_data.data();
+        sats.push_back(sat_create(data));
+        mark(sats.back());
+        reallocs += (data.m_data.data() != pPrevData);
+    }
+
+    EXPECT_EQ(data.m_satCount, sc_count);
+    EXPECT_GE(data.m_satCapacity, sc_count);
+    EXPECT_LE(reallocs, 8);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(data.m_data.data()) % gc_satDataAlignment, 0);
+    EXPECT_EQ(data.m_satPositions[2].m_offset % gc_satDataAlignment, 0);
+    EXPECT_EQ(data.m_satMasses.m_offset % gc_satDataAlignment, 0);
+
+    for (SatId const sat : sats)
+    {
+        expect_marked(sat);
+    }
+
+    // Remove every third satellite
+    std::vector<SatId> kept;
+    std::set<SatId> removed;
+    for (std::size_t i = 0; i < sats.size(); ++i)
+    {
+        if (i % 3 == 0)
+        {
+            sat_remove(data, sats[i]);
+            removed.insert(sats[i]);
+        }
+        else
+        {
+            kept.push_back(sats[i]);
+        }
+    }
+
+    uint32_t const capacity = data.m_satCapacity;
+    EXPECT_EQ(data.m_satCount, kept.size());
+    for (SatId const sat : kept)
+    {
+        expect_marked(sat);
+    }
+    for (SatId const sat : removed)
+    {
+        EXPECT_FALSE(data.m_satIds.exists(sat));
+    }
+
+    // Removed IDs are reused, without growing capacity
+    for (std::size_t i = 0; i < removed.size(); ++i)
+    {
+        SatId const sat = sat_create(data);
+        EXPECT_TRUE(removed.contains(sat));
+        mark(sat);
+        kept.push_back(sat);
+    }
+
+    EXPECT_EQ(data.m_satCapacity, capacity);
+    EXPECT_EQ(data.m_satCount, sc_count);
+    for (SatId const sat : kept)
+    {
+        expect_marked(sat);
+    }
+
+    // Remove the last one too
+    SatId const last = data.m_satIndexToId.back();
+    sat_remove(data, last);
+    EXPECT_EQ(data.m_satCount, sc_count - 1);
+    EXPECT_FALSE(data.m_satIds.exists(last));
+}
+
+// Test that the vectorized satellite integrator matches the scalar one, and that it moves,
+// accelerates, and rotates satellites as expected
+TEST(Universe, SatIntegrate)
+{
+    // Not a multiple of 4, to exercise the scalar remainder
+    constexpr uint32_t sc_count = 23;
+
+    CoSpaceSatData dataA{};
+    sat_data_allocate(dataA, sc_count);
+    dataA.m_satCount = sc_count;
+
+    auto const [x, y, z]        = sat_views(dataA.m_satPositions,   dataA.m_data, sc_count);
+    auto const [vx, vy, vz]     = sat_views(dataA.m_satVelocities,  dataA.m_data, sc_count);
+    auto const [qx, qy, qz, qw] = sat_views(dataA.m_satRotations,   dataA.m_data, sc_count);
+    auto const [wx, wy, wz]     = sat_views(dataA.m_satAngularVels, dataA.m_data, sc_count);
+
+    for (std::size_t i = 0; i < sc_count; ++i)
+    {
+        x[i]  = sci64(1 + spaceint_t(i), 6, 10);
+        y[i]  = -sci64(2 * spaceint_t(i) - 7, 5, 10);
+        z[i]  = sci64(3, 6, 10);
+        vx[i] = 100.0 * double(i % 5);
+        vy[i] = -50.0;
+        vz[i] = 10.0 * double(i);
+        qx[i] = 0.0;
+        qy[i] = 0.0;
+        qz[i] = 0.0;
+        qw[i] = 1.0;
+        wx[i] = 0.0;
+        wy[i] = 0.0;
+        wz[i] = (i % 3) * 0.5;
+    }
+
+    // Too far for the SIMD path's exact int64 <-> double conversion, must fall back to scalar
+    x[5] = int_2pow<spaceint_t>(55);
+
+    CoSpaceSatData dataB{};
+    sat_data_allocate(dataB, sc_count);
+    dataB.m_satCount = sc_count;
+    std::copy(dataA.m_data.begin(), dataA.m_data.end(), dataB.m_data.begin());
+
+    SatIntegrateParams const params
+    {
+        .m_deltaTime     = 1.0 / 60.0,
+        .m_metersPerUnit = mul_2pow<double, int>(1.0, -10),
+        .m_gravParam     = 1.0e14
+    };
+
+    for (int step = 0; step < 120; ++step)
+    {
+        sat_integrate       (dataA, 0, sc_count, params);
+        sat_integrate_scalar(dataB, 0, sc_count, params);
+    }
+
+    auto const [xB, yB, zB]         = sat_views(dataB.m_satPositions,  dataB.m_data, sc_count);
+    auto const [vxB, vyB, vzB]      = sat_views(dataB.m_satVelocities, dataB.m_data, sc_count);
+    auto const [qxB, qyB, qzB, qwB] = sat_views(dataB.m_satRotations,  dataB.m_data, sc_count);
+
+    for (std::size_t i = 0; i < sc_count; ++i)
+    {
+        // FMA may round differently, allow off-by-one position units
+        EXPECT_NEAR(x[i], xB[i], 1);
+        EXPECT_NEAR(y[i], yB[i], 1);
+        EXPECT_NEAR(z[i], zB[i], 1);
+        EXPECT_NEAR(vx[i], vxB[i], 1e-9);
+        EXPECT_NEAR(vy[i], vyB[i], 1e-9);
+        EXPECT_NEAR(vz[i], vzB[i], 1e-9);
+        EXPECT_NEAR(qx[i], qxB[i], 1e-12);
+        EXPECT_NEAR(qy[i], qyB[i], 1e-12);
+        EXPECT_NEAR(qz[i], qzB[i], 1e-12);
+        EXPECT_NEAR(qw[i], qwB[i], 1e-12);
+
+        // Rotations stay normalized, and turn about Z by 2 seconds * angular velocity
+        Quaterniond const rot{{qx[i], qy[i], qz[i]}, qw[i]};
+        EXPECT_NEAR(rot.length(), 1.0, 1e-12);
+        EXPECT_NEAR(double(rot.angle()), 2.0 * wz[i], 1e-3);
+    }
+
+    // Gravity points towards the origin; satellite 10 started with no X velocity and positive X
+    EXPECT_LT(vx[10], 0.0);
+}
+
+// Test grouping satellites by substep level, and that substepping keeps a fast orbit stable
+TEST(Universe, SatStepGroups)
+{
+    constexpr uint32_t sc_count = 300;
+
+    SatIntegrateParams params
+    {
+        .m_deltaTime     = 1000.0 / 60.0, // 1000x time warp
+        .m_metersPerUnit = mul_2pow<double, int>(1.0, -10),
+        .m_gravParam     = 1.0e10
+    };
+    SatSubstepParams const substep{ .m_accuracy = 0.01, .m_maxLevel = 10 };
+
+    CoSpaceSatData data{};
+    std::vector<SatId> sats;
+
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<double> distDist(3.0, 6.0); // 1km to 1000km, log scale
+    std::uniform_real_distribution<double> dirDist(-1.0, 1.0);
+    std::uniform_real_distribution<double> velDist(-500.0, 500.0);
+
+    for (uint32_t i = 0; i < sc_count; ++i)
+    {
+        SatId const       sat = sat_create(data);
+        std::size_t const idx = sat_index(data, sat);
+
+        Vector3d const pos = Vector3d{dirDist(gen), dirDist(gen), dirDist(gen)}.normalized()
+                           * std::pow(10.0, distDist(gen)) / params.m_metersPerUnit;
+
+        auto const [x, y, z]    = sat_views(data.m_satPositions,  data.m_data, data.m_satCount);
+        auto const [vx, vy, vz] = sat_views(data.m_satVelocities, data.m_data, data.m_satCount);
+        x[idx]  = spaceint_t(pos.x());
+        y[idx]  = spaceint_t(pos.y());
+        z[idx]  = spaceint_t(pos.z());
+        vx[idx] = velDist(gen);
+        vy[idx] = velDist(gen);
+        vz[idx] = velDist(gen);
+
+        // Masses follow each satellite around, to check that their data moves with their IDs
+        data.m_satMasses.view(Corrade::Containers::arrayView(data.m_data), data.m_satCount)[idx] = double(sat);
+        sats.push_back(sat);
+    }
+
+    BitVector_t skip;
+    bitvector_resize(skip, sc_count);
+    for (SatId const sat : sats)
+    {
+        if (sat % 7 == 0)
+        {
+            skip.set(sat);
+        }
+    }
+
+    SatStepGroups groups;
+    sat_step_group(groups, data, skip, params, substep);
+
+    auto const masses = data.m_satMasses.view(Corrade::Containers::arrayView(data.m_data), data.m_satCount);
+
+    ASSERT_EQ(groups.m_start.size(), std::size_t(substep.m_maxLevel) + 3);
+    EXPECT_EQ(groups.m_start.front(), 0);
+    EXPECT_EQ(groups.m_start.back(), sc_count);
+    EXPECT_TRUE(std::is_sorted(groups.m_start.begin(), groups.m_start.end()));
+
+    int levelsUsed = 0;
+    for (int level = 0; level <= substep.m_maxLevel + 1; ++level)
+    {
+        levelsUsed += (groups.m_start[level] != groups.m_start[level + 1]);
+        for (std::size_t i = groups.m_start[level]; i < groups.m_start[level + 1]; ++i)
+        {
+            SatId const sat = data.m_satIndexToId[i];
+            EXPECT_EQ(sat_index(data, sat), i);
+            EXPECT_EQ(masses[i], double(sat));
+
+            if (level == substep.m_maxLevel + 1)
+            {
+                EXPECT_TRUE(skip.test(sat));
+            }
+            else
+            {
+                EXPECT_FALSE(skip.test(sat));
+                EXPECT_EQ(sat_step_level(data, i, params, substep), level);
+            }
+        }
+    }
+    EXPECT_GE(levelsUsed, 3);
+
+    // Already grouped, nothing moves
+    std::vector<SatId> const order = data.m_satIndexToId;
+    sat_step_group(groups, data, skip, params, substep);
+    EXPECT_EQ(data.m_satIndexToId, order);
+
+    // Circular orbit with a period of 8 warped steps; stays circular only with substeps
+    constexpr double sc_radius = 10000.0;
+
+    auto const run_orbit = [&params, &substep] (bool const useSubsteps)
+    {
+        CoSpaceSatData orbit{};
+        SatId const sat = sat_create(orbit);
+        std::size_t const idx = sat_index(orbit, sat);
+
+        double const speed  = std::sqrt(params.m_gravParam / sc_radius);
+        double const period = 2.0 * Magnum::Math::Constants<double>::pi() * sc_radius / speed;
+
+        auto const [x, y, z]    = sat_views(orbit.m_satPositions,  orbit.m_data, orbit.m_satCount);
+        auto const [vx, vy, vz] = sat_views(orbit.m_satVelocities, orbit.m_data, orbit.m_satCount);
+        x[idx]  = spaceint_t(sc_radius / params.m_metersPerUnit);
+        vy[idx] = speed;
+
+        SatIntegrateParams stepParams = params;
+        stepParams.m_deltaTime = period / 8.0;
+
+        int const level = useSubsteps ? sat_step_level(orbit, idx, stepParams, substep) : 0;
+        SatIntegrateParams substepParams = stepParams;
+        substepParams.m_deltaTime = stepParams.m_deltaTime / double(1 << level);
+
+        for (int step = 0; step < 8 << level; ++step)
+        {
+            sat_integrate(orbit, 0, 1, substepParams);
+        }
+        return Vector3d(Vector3g{x[idx], y[idx], z[idx]}).length() * params.m_metersPerUnit;
+    };
+
+    EXPECT_NEAR(run_orbit(true), sc_radius, sc_radius * 0.01);
+    EXPECT_GT(std::abs(run_orbit(false) - sc_radius), sc_radius * 0.1);
+}
+
+// Test Kepler orbits on rails against known orbits, and switching satellites on and off rails
+TEST(Universe, SatKeplerRails)
+{
+    // Kepler's equation solves for any mean anomaly and eccentricity in range
+    std::vector<double> meanAnomalies;
+    std::vector<double> eccentricities;
+    for (int i = 0; i <= 100; ++i)
+    {
+        for (int j = -100; j <= 100; ++j)
+        {
+            eccentricities.push_back(gc_keplerMaxEccentricity * i / 100.0);
+            meanAnomalies .push_back(Magnum::Math::Constants<double>::pi() * j / 100.0);
+        }
+    }
+    std::vector<double> eccAnomalies(meanAnomalies.size());
+    std::vector<double> eccAnomaliesScalar(meanAnomalies.size());
+    kepler_solve       (meanAnomalies.data(), eccentricities.data(), eccAnomalies.data(),       eccAnomalies.size());
+    kepler_solve_scalar(meanAnomalies.data(), eccentricities.data(), eccAnomaliesScalar.data(), eccAnomalies.size());
+    for (std::size_t i = 0; i < eccAnomalies.size(); ++i)
+    {
+        double const E = eccAnomalies[i];
+        EXPECT_NEAR(E - eccentricities[i] * std::sin(E), meanAnomalies[i], 1e-12);
+
+        // Vectorized sin and cos are slightly off from std::sin and std::cos
+        EXPECT_NEAR(E, eccAnomaliesScalar[i], 1e-12);
+    }
+
+    constexpr double sc_gravParam   = 4.0e14;
+    constexpr double sc_radius      = 7.0e6;
+    constexpr int    sc_precision   = 10;
+
+    double const metersPerUnit  = osp::math::mul_2pow<double, int>(1.0, -sc_precision);
+    double const circularSpeed  = std::sqrt(sc_gravParam / sc_radius);
+    double const period         = 2.0 * Magnum::Math::Constants<double>::pi() * sc_radius / circularSpeed;
+
+    CoSpaceSatData data{};
+
+    auto const add_sat = [&data, metersPerUnit] (Vector3d const pos, Vector3d const vel)
+    {
+        SatId const       sat = sat_create(data);
+        std::size_t const i   = sat_index(data, sat);
+        auto const [x, y, z]    = sat_views(data.m_satPositions,  data.m_data, data.m_satCount);
+        auto const [vx, vy, vz] = sat_views(data.m_satVelocities, data.m_data, data.m_satCount);
+        x[i]  = std::llround(pos.x() / metersPerUnit);
+        y[i]  = std::llround(pos.y() / metersPerUnit);
+        z[i]  = std::llround(pos.z() / metersPerUnit);
+        vx[i] = vel.x();
+        vy[i] = vel.y();
+        vz[i] = vel.z();
+        return sat;
+    };
+
+    auto const get_pos = [&data, metersPerUnit] (SatId const sat)
+    {
+        std::size_t const i = sat_index(data, sat);
+        auto const [x, y, z] = sat_views(data.m_satPositions, data.m_data, data.m_satCount);
+        return Vector3d(Vector3g{x[i], y[i], z[i]}) * metersPerUnit;
+    };
+
+    auto const get_vel = [&data] (SatId const sat)
+    {
+        std::size_t const i = sat_index(data, sat);
+        auto const [vx, vy, vz] = sat_views(data.m_satVelocities, data.m_data, data.m_satCount);
+        return Vector3d{vx[i], vy[i], vz[i]};
+    };
+
+    SatId const circular = add_sat({sc_radius, 0.0, 0.0}, {0.0, circularSpeed, 0.0});
+    SatId const elliptic = add_sat({0.0, 0.0, sc_radius}, {circularSpeed * 1.2, 0.0, 0.0});
+    SatId const escaping = add_sat({sc_radius, 0.0, 0.0}, {0.0, 0.0, circularSpeed * 1.5});
+
+    // Spin the elliptic one a quarter turn per period
+    {
+        std::size_t const i = sat_index(data, elliptic);
+        auto const [wx, wy, wz] = sat_views(data.m_satAngularVels, data.m_data, data.m_satCount);
+        wz[i] = 0.5 * Magnum::Math::Constants<double>::pi() / period;
+    }
+
+    SatKeplerRails rails;
+    SatKeplerParams params{ .m_time = 100.0, .m_metersPerUnit = metersPerUnit, .m_gravParam = sc_gravParam };
+
+    EXPECT_TRUE (sat_kepler_rail(rails, data, circular, params));
+    EXPECT_TRUE (sat_kepler_rail(rails, data, elliptic, params));
+    EXPECT_FALSE(sat_kepler_rail(rails, data, escaping, params));
+    EXPECT_FALSE(sat_kepler_on_rails(rails, escaping));
+
+    Vector3d const ellipticPos0 = get_pos(elliptic);
+    Vector3d const ellipticVel0 = get_vel(elliptic);
+
+    // A quarter period later, the circular orbit is a quarter turn ahead
+    params.m_time += period * 0.25;
+    sat_kepler_propagate(rails, data, 0, data.m_satCount, params);
+
+    EXPECT_NEAR(get_pos(circular).x(), 0.0,       1e-2);
+    EXPECT_NEAR(get_pos(circular).y(), sc_radius, 1e-2);
+    EXPECT_NEAR(get_vel(circular).x(), -circularSpeed, 1e-4);
+    EXPECT_NEAR(get_vel(circular).y(), 0.0,            1e-4);
+
+    // Escaping satellite is not on rails, so it isn't touched
+    EXPECT_EQ(get_pos(escaping).x(), sc_radius);
+
+    // Elliptic orbit stays in its plane and conserves energy
+    double const energy0 = 0.5 * ellipticVel0.dot() - sc_gravParam / ellipticPos0.length();
+    double const energy1 = 0.5 * get_vel(elliptic).dot() - sc_gravParam / get_pos(elliptic).length();
+    EXPECT_NEAR(get_pos(elliptic).y(), 0.0, 1e-2);
+    EXPECT_NEAR(energy1 / energy0, 1.0, 1e-9);
+
+    // ...and returns to where it started after a whole period of its own
+    double const a = rails.m_semiMajorAxis[elliptic];
+    params.m_time = 100.0 + 2.0 * Magnum::Math::Constants<double>::pi() * std::sqrt(a * a * a / sc_gravParam);
+    sat_kepler_propagate(rails, data, 0, data.m_satCount, params);
+    EXPECT_NEAR((get_pos(elliptic) - ellipticPos0).length(), 0.0, 1e-2);
+    EXPECT_NEAR((get_vel(elliptic) - ellipticVel0).length(), 0.0, 1e-4);
+
+    // Rotations keep spinning on rails
+    {
+        std::size_t const i = sat_index(data, elliptic);
+        auto const [qx, qy, qz, qw] = sat_views(data.m_satRotations, data.m_data, data.m_satCount);
+        double const angle = 0.5 * Magnum::Math::Constants<double>::pi() * (params.m_time - 100.0) / period;
+        EXPECT_NEAR(qz[i], std::sin(0.5 * angle), 1e-9);
+        EXPECT_NEAR(qw[i], std::cos(0.5 * angle), 1e-9);
+    }
+
+    // Satellites near the circular one come off rails, far ones go on
+    Vector3g const nearCircular = Vector3g(get_pos(circular) / metersPerUnit);
+    sat_kepler_update_modes(rails, data, nearCircular, 1000.0, params);
+    EXPECT_FALSE(sat_kepler_on_rails(rails, circular));
+    EXPECT_TRUE (sat_kepler_on_rails(rails, elliptic));
+
+    params.m_time += 10.0;
+    sat_kepler_update_modes(rails, data, {0, 0, 0}, 1000.0, params);
+    EXPECT_TRUE (sat_kepler_on_rails(rails, circular));
+    EXPECT_FALSE(sat_kepler_on_rails(rails, escaping));
+}
+
+// Test Barnes-Hut gravity against summing up every pair of satellites
+TEST(Universe, SatGravityBarnesHut)
+{
+    constexpr uint32_t sc_count = 300;
+    constexpr int      sc_precision = 10;
+
+    CoSpaceSatData data{};
+    sat_data_allocate(data, sc_count);
+    data.m_satCount = sc_count;
+
+    auto const [x, y, z]    = sat_views(data.m_satPositions,  data.m_data, sc_count);
+    auto const [vx, vy, vz] = sat_views(data.m_satVelocities, data.m_data, sc_count);
+    auto const mass         = data.m_satMasses.view(Corrade::Containers::arrayView(data.m_data), sc_count);
+
+    std::mt19937 gen(1337);
+    std::normal_distribution<double>        posDist(0.0, 1.0e9);
+    std::uniform_real_distribution<double>  massDist(1.0e20, 1.0e24);
+
+    for (std::size_t i = 0; i < sc_count; ++i)
+    {
+        x[i]    = mul_2pow<spaceint_t, int>(spaceint_t(posDist(gen)), sc_precision);
+        y[i]    = mul_2pow<spaceint_t, int>(spaceint_t(posDist(gen)), sc_precision);
+        z[i]    = mul_2pow<spaceint_t, int>(spaceint_t(posDist(gen)), sc_precision);
+        mass[i] = massDist(gen);
+    }
+
+    SatGravityParams params
+    {
+        .m_deltaTime     = 1.0,
+        .m_metersPerUnit = mul_2pow<double, int>(1.0, -sc_precision)
+    };
+
+    // Expected change in velocity, O(N^2)
+    std::vector<Vector3d> expected(sc_count, Vector3d{0.0});
+    for (std::size_t i = 0; i < sc_count; ++i)
+    {
+        for (std::size_t j = 0; j < sc_count; ++j)
+        {
+            if (i != j)
+            {
+                Vector3d const diff = Vector3d(to_vec<Vector3g>(j, x, y, z) - to_vec<Vector3g>(i, x, y, z)) * params.m_metersPerUnit;
+                expected[i] += diff * params.m_gravConstant * mass[j] / Magnum::Math::pow<3>(diff.length());
+            }
+        }
+    }
+
+    auto const run = [&] (double const openingAngle, SatOctree &rTree)
+    {
+        for (std::size_t i = 0; i < sc_count; ++i)
+        {
+            vx[i] = 0.0;
+            vy[i] = 0.0;
+            vz[i] = 0.0;
+        }
+
+        params.m_openingAngle = openingAngle;
+        sat_octree_build(rTree, data);
+
+        // Split into uneven ranges, like parallel_for would
+        sat_gravity_apply(rTree, data, 0,   100,      params);
+        sat_gravity_apply(rTree, data, 100, sc_count, params);
+
+        double errorSum = 0.0;
+        for (std::size_t i = 0; i < sc_count; ++i)
+        {
+            errorSum += (to_vec<Vector3d>(i, vx, vy, vz) - expected[i]).length() / expected[i].length();
+        }
+        return errorSum / sc_count;
+    };
+
+    SatOctree tree;
+
+    // Opening angle of 0 never approximates, only satellites in leaves pull
+    EXPECT_LT(run(0.0, tree), 1.0e-12);
+    EXPECT_EQ(tree.m_nodes[0].m_first, 0u);
+    EXPECT_EQ(tree.m_nodes[0].m_last,  sc_count);
+
+    // Approximations should be within a percent on average
+    EXPECT_LT(run(0.5, tree), 0.01);
+
+    // Rebuilding after satellites move starts from the previous order, and results in the same
+    // tree as building from scratch
+    for (std::size_t i = 0; i < sc_count; ++i)
+    {
+        x[i] += spaceint_t(i % 7) * 1000;
+    }
+
+    SatOctree fresh;
+    EXPECT_LT(run(0.5, fresh), 0.01);
+    run(0.5, tree);
+
+    ASSERT_EQ(tree.m_nodes.size(), fresh.m_nodes.size());
+    for (std::size_t i = 0; i < tree.m_nodes.size(); ++i)
+    {
+        EXPECT_EQ(tree.m_nodes[i].m_first, fresh.m_nodes[i].m_first);
+        EXPECT_EQ(tree.m_nodes[i].m_last,  fresh.m_nodes[i].m_last);
+        EXPECT_NEAR(tree.m_nodes[i].m_mass, fresh.m_nodes[i].m_mass, fresh.m_nodes[i].m_mass * 1.0e-12);
+    }
+
+    // Satellites at the same position don't pull on each other, even without softening
+    CoSpaceSatData stacked{};
+    sat_data_allocate(stacked, 3);
+    stacked.m_satCount = 3;
+
+    auto const [sx, sy, sz]     = sat_views(stacked.m_satPositions,  stacked.m_data, 3);
+    auto const [svx, svy, svz]  = sat_views(stacked.m_satVelocities, stacked.m_data, 3);
+    auto const stackedMass      = stacked.m_satMasses.view(Corrade::Containers::arrayView(stacked.m_data), 3);
+    for (std::size_t i = 0; i < 3; ++i)
+    {
+        sx[i] = (i == 2) ? 1000 : 0;
+        sy[i] = 0;
+        sz[i] = 0;
+        svx[i] = svy[i] = svz[i] = 0.0;
+        stackedMass[i] = 1.0e20;
+    }
+
+    params.m_softening = 0.0;
+    sat_octree_build(fresh, stacked);
+    sat_gravity_apply(fresh, stacked, 0, 3, params);
+
+    for (std::size_t i = 0; i < 3; ++i)
+    {
+        EXPECT_TRUE(std::isfinite(svx[i]));
+        EXPECT_EQ(svy[i], 0.0);
+        EXPECT_EQ(svz[i], 0.0);
+    }
+    EXPECT_GT(svx[0], 0.0);
+    EXPECT_EQ(svx[0], svx[1]);
+    EXPECT_LT(svx[2], 0.0);
+}
+
+// Test nearest and radius queries of the satellite grid against checking every satellite
+TEST(Universe, SatGridQueries)
+{
+    constexpr uint32_t sc_count = 2000;
+
+    CoSpaceSatData data{};
+    sat_data_allocate(data, sc_count);
+    data.m_satCount = sc_count;
+
+    auto const [x, y, z] = sat_views(data.m_satPositions, data.m_data, sc_count);
+
+    std::mt19937 gen(4321);
+    std::uniform_int_distribution<spaceint_t> posDist(-int_2pow<spaceint_t>(30), int_2pow<spaceint_t>(30));
+
+    for (std::size_t i = 0; i < sc_count; ++i)
+    {
+        x[i] = posDist(gen);
+        y[i] = posDist(gen);
+        z[i] = posDist(gen);
+    }
+
+    SatGrid grid;
+    sat_grid_build(grid, data, 24);
+
+    ASSERT_EQ(grid.m_sats.size(), sc_count);
+
+    auto const distance = [&x = x, &y = y, &z = z] (std::size_t const sat, Vector3g const pos)
+    {
+        return Vector3d(to_vec<Vector3g>(sat, x, y, z) - pos).length();
+    };
+
+    for (int query = 0; query < 100; ++query)
+    {
+        Vector3g const pos{posDist(gen), posDist(gen), posDist(gen)};
+
+        // Nearest, with and without a limit that may exclude everything
+        for (double const maxDistance : {std::numeric_limits<double>::infinity(), double(int_2pow<spaceint_t>(26))})
+        {
+            SatGridHit expected{ .m_distance = maxDistance };
+            for (std::size_t i = 0; i < sc_count; ++i)
+            {
+                if (double const dist = distance(i, pos); dist < expected.m_distance)
+                {
+                    expected = { .m_sat = SatId(i), .m_distance = dist };
+                }
+            }
+
+            SatGridHit const nearest = sat_grid_nearest(grid, pos, maxDistance);
+            EXPECT_EQ(nearest.m_sat, expected.m_sat);
+            EXPECT_EQ(nearest.m_distance, expected.m_distance);
+        }
+
+        // Radius, each satellite visited once
+        double const radius = double(int_2pow<spaceint_t>(22 + query % 8));
+
+        std::set<SatId> found;
+        sat_grid_query_radius(grid, pos, radius, [&found] (SatId const sat, double)
+        {
+            EXPECT_TRUE(found.insert(sat).second);
+        });
+
+        std::set<SatId> expected;
+        for (std::size_t i = 0; i < sc_count; ++i)
+        {
+            if (distance(i, pos) < radius)
+            {
+                expected.insert(SatId(i));
+            }
+        }
+
+        EXPECT_EQ(found, expected);
+    }
+
+    // Satellites made with sat_create are found by ID, even after they're moved to another index
+    CoSpaceSatData withIds{};
+    sat_data_allocate(withIds, 4);
+
+    std::array<SatId, 4> sats;
+    for (SatId &rSat : sats)
+    {
+        rSat = sat_create(withIds);
+        auto const [px, py, pz] = sat_views(withIds.m_satPositions, withIds.m_data, withIds.m_satCount);
+        px[sat_index(withIds, rSat)] = int_2pow<spaceint_t>(20) * spaceint_t(rSat);
+    }
+
+    sat_remove(withIds, sats[0]);
+    ASSERT_EQ(sat_index(withIds, sats[3]), 0);
+
+    sat_grid_build(grid, withIds, 20);
+
+    EXPECT_EQ(sat_grid_nearest(grid, {int_2pow<spaceint_t>(20) * spaceint_t(sats[3]), 0, 0}).m_sat, sats[3]);
+    EXPECT_EQ(sat_grid_nearest(grid, {int_2pow<spaceint_t>(20) * spaceint_t(sats[1]), 0, 0}).m_sat, sats[1]);
+}
+
 // TODO: Test CoordTransformer for hopping across nested rotated coordinate spaces